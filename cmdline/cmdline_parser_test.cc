@@ -39,7 +39,8 @@ namespace art {
         lhs.min_methods_to_save_ == rhs.min_methods_to_save_ &&
         lhs.min_classes_to_save_ == rhs.min_classes_to_save_ &&
         lhs.min_notification_before_wake_ == rhs.min_notification_before_wake_ &&
-        lhs.max_notification_before_wake_ == rhs.max_notification_before_wake_;
+        lhs.max_notification_before_wake_ == rhs.max_notification_before_wake_ &&
+        lhs.max_journal_entries_ == rhs.max_journal_entries_;
   }
 
   bool UsuallyEquals(double expected, double actual) {
@@ -324,12 +325,13 @@ TEST_F(CmdlineParserTest, DISABLED_TestXGcOption) {
     option_all_true.verify_pre_gc_rosalloc_ = true;
     option_all_true.verify_pre_sweeping_rosalloc_ = true;
     option_all_true.verify_post_gc_rosalloc_ = true;
+    option_all_true.generational_cc_ = true;
 
     const char * xgc_args_all_true = "-Xgc:concurrent,"
         "preverify,presweepingverify,postverify,"
         "preverify_rosalloc,presweepingverify_rosalloc,"
         "postverify_rosalloc,precise,"
-        "verifycardtable";
+        "verifycardtable,generational_cc";
 
     EXPECT_SINGLE_PARSE_VALUE(option_all_true, xgc_args_all_true, M::GcOption);
 
@@ -341,10 +343,12 @@ TEST_F(CmdlineParserTest, DISABLED_TestXGcOption) {
     option_all_false.verify_pre_gc_rosalloc_ = false;
     option_all_false.verify_pre_sweeping_rosalloc_ = false;
     option_all_false.verify_post_gc_rosalloc_ = false;
+    option_all_false.generational_cc_ = false;
 
     const char* xgc_args_all_false = "-Xgc:nonconcurrent,"
         "nopreverify,nopresweepingverify,nopostverify,nopreverify_rosalloc,"
-        "nopresweepingverify_rosalloc,nopostverify_rosalloc,noprecise,noverifycardtable";
+        "nopresweepingverify_rosalloc,nopostverify_rosalloc,noprecise,noverifycardtable,"
+        "nogenerational_cc";
 
     EXPECT_SINGLE_PARSE_VALUE(option_all_false, xgc_args_all_false, M::GcOption);
 
@@ -484,7 +488,7 @@ TEST_F(CmdlineParserTest, TestJitOptions) {
 * -Xps-*
 */
 TEST_F(CmdlineParserTest, ProfileSaverOptions) {
-  ProfileSaverOptions opt = ProfileSaverOptions(true, 1, 2, 3, 4, 5, 6, 7, "abc", true);
+  ProfileSaverOptions opt = ProfileSaverOptions(true, 1, 2, 3, 4, 5, 6, 7, 8, "abc", true);
 
   EXPECT_SINGLE_PARSE_VALUE(opt,
                             "-Xjitsaveprofilinginfo "
@@ -495,6 +499,7 @@ TEST_F(CmdlineParserTest, ProfileSaverOptions) {
                             "-Xps-min-classes-to-save:5 "
                             "-Xps-min-notification-before-wake:6 "
                             "-Xps-max-notification-before-wake:7 "
+                            "-Xps-max-journal-entries:8 "
                             "-Xps-profile-path:abc "
                             "-Xps-profile-boot-class-path",
                             M::ProfileSaverOpts);
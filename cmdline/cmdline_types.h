@@ -512,6 +512,8 @@ struct XGcOption {
   // Do no measurements for kUseTableLookupReadBarrier to avoid test timeouts. b/31679493
   bool measure_ = kIsDebugBuild && !kUseTableLookupReadBarrier;
   bool gcstress_ = false;
+  // Run young-generation collections with the concurrent copying collector.
+  bool generational_cc_ = false;
 };
 
 template <>
@@ -525,6 +527,14 @@ struct CmdlineType<XGcOption> : CmdlineTypeParser<XGcOption> {
       gc::CollectorType collector_type = ParseCollectorType(gc_option);
       if (collector_type != gc::kCollectorTypeNone) {
         xgc.collector_type_ = collector_type;
+      } else if (gc_option == "GenCC") {
+        // The generational variant of CC.
+        xgc.collector_type_ = gc::kCollectorTypeCC;
+        xgc.generational_cc_ = true;
+      } else if (gc_option == "generational_cc") {
+        xgc.generational_cc_ = true;
+      } else if (gc_option == "nogenerational_cc") {
+        xgc.generational_cc_ = false;
       } else if (gc_option == "preverify") {
         xgc.verify_pre_gc_heap_ = true;
       } else if (gc_option == "nopreverify") {
@@ -764,6 +774,12 @@ struct CmdlineType<ProfileSaverOptions> : CmdlineTypeParser<ProfileSaverOptions>
              &ProfileSaverOptions::max_notification_before_wake_,
              type_parser.Parse(suffix));
     }
+    if (android::base::StartsWith(option, "max-journal-entries:")) {
+      CmdlineType<unsigned int> type_parser;
+      return ParseInto(existing,
+             &ProfileSaverOptions::max_journal_entries_,
+             type_parser.Parse(suffix));
+    }
     if (android::base::StartsWith(option, "profile-path:")) {
       existing.profile_path_ = suffix;
       return Result::SuccessNoValue();
@@ -417,6 +417,12 @@ class CodeGenerator : public DeletableArenaObject<kArenaAllocCodeGenerator> {
     return type == Primitive::kPrimNot && !value->IsNullConstant();
   }
 
+  // Whether a field get loads a reference without a read barrier, see ReadBarrierElimination.
+  static bool IsReadBarrierElided(HInstruction* field_get) {
+    return field_get->IsInstanceFieldGet() &&
+        field_get->AsInstanceFieldGet()->IsReadBarrierElided();
+  }
+
 
   // Performs checks pertaining to an InvokeRuntime call.
   void ValidateInvokeRuntime(QuickEntrypointEnum entrypoint,
@@ -4791,11 +4791,15 @@ void CodeGeneratorX86::MarkGCCard(Register temp,
 void LocationsBuilderX86::HandleFieldGet(HInstruction* instruction, const FieldInfo& field_info) {
   DCHECK(instruction->IsInstanceFieldGet() || instruction->IsStaticFieldGet());
 
+  const bool read_barrier_elided = CodeGenerator::IsReadBarrierElided(instruction);
   bool object_field_get_with_read_barrier =
-      kEmitCompilerReadBarrier && (instruction->GetType() == Primitive::kPrimNot);
+      kEmitCompilerReadBarrier &&
+      (instruction->GetType() == Primitive::kPrimNot) &&
+      !read_barrier_elided;
   LocationSummary* locations =
       new (GetGraph()->GetArena()) LocationSummary(instruction,
-                                                   kEmitCompilerReadBarrier ?
+                                                   (kEmitCompilerReadBarrier &&
+                                                    !read_barrier_elided) ?
                                                        LocationSummary::kCallOnSlowPath :
                                                        LocationSummary::kNoCall);
   if (object_field_get_with_read_barrier && kUseBakerReadBarrier) {
@@ -4866,7 +4870,8 @@ void InstructionCodeGeneratorX86::HandleFieldGet(HInstruction* instruction,
 
     case Primitive::kPrimNot: {
       // /* HeapReference<Object> */ out = *(base + offset)
-      if (kEmitCompilerReadBarrier && kUseBakerReadBarrier) {
+      const bool read_barrier_elided = CodeGenerator::IsReadBarrierElided(instruction);
+      if (kEmitCompilerReadBarrier && kUseBakerReadBarrier && !read_barrier_elided) {
         // Note that a potential implicit null check is handled in this
         // CodeGeneratorX86::GenerateFieldLoadWithBakerReadBarrier call.
         codegen_->GenerateFieldLoadWithBakerReadBarrier(
@@ -4880,10 +4885,14 @@ void InstructionCodeGeneratorX86::HandleFieldGet(HInstruction* instruction,
         if (is_volatile) {
           codegen_->GenerateMemoryBarrier(MemBarrierKind::kLoadAny);
         }
-        // If read barriers are enabled, emit read barriers other than
-        // Baker's using a slow path (and also unpoison the loaded
-        // reference, if heap poisoning is enabled).
-        codegen_->MaybeGenerateReadBarrierSlow(instruction, out, out, base_loc, offset);
+        if (read_barrier_elided) {
+          __ MaybeUnpoisonHeapReference(out.AsRegister<Register>());
+        } else {
+          // If read barriers are enabled, emit read barriers other than
+          // Baker's using a slow path (and also unpoison the loaded
+          // reference, if heap poisoning is enabled).
+          codegen_->MaybeGenerateReadBarrierSlow(instruction, out, out, base_loc, offset);
+        }
       }
       break;
     }
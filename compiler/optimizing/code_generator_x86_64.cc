@@ -4304,7 +4304,9 @@ void LocationsBuilderX86_64::HandleFieldGet(HInstruction* instruction) {
   DCHECK(instruction->IsInstanceFieldGet() || instruction->IsStaticFieldGet());
 
   bool object_field_get_with_read_barrier =
-      kEmitCompilerReadBarrier && (instruction->GetType() == Primitive::kPrimNot);
+      kEmitCompilerReadBarrier &&
+      (instruction->GetType() == Primitive::kPrimNot) &&
+      !CodeGenerator::IsReadBarrierElided(instruction);
   LocationSummary* locations =
       new (GetGraph()->GetArena()) LocationSummary(instruction,
                                                    object_field_get_with_read_barrier ?
@@ -4366,7 +4368,8 @@ void InstructionCodeGeneratorX86_64::HandleFieldGet(HInstruction* instruction,
 
     case Primitive::kPrimNot: {
       // /* HeapReference<Object> */ out = *(base + offset)
-      if (kEmitCompilerReadBarrier && kUseBakerReadBarrier) {
+      const bool read_barrier_elided = CodeGenerator::IsReadBarrierElided(instruction);
+      if (kEmitCompilerReadBarrier && kUseBakerReadBarrier && !read_barrier_elided) {
         // Note that a potential implicit null check is handled in this
         // CodeGeneratorX86_64::GenerateFieldLoadWithBakerReadBarrier call.
         codegen_->GenerateFieldLoadWithBakerReadBarrier(
@@ -4380,10 +4383,14 @@ void InstructionCodeGeneratorX86_64::HandleFieldGet(HInstruction* instruction,
         if (is_volatile) {
           codegen_->GenerateMemoryBarrier(MemBarrierKind::kLoadAny);
         }
-        // If read barriers are enabled, emit read barriers other than
-        // Baker's using a slow path (and also unpoison the loaded
-        // reference, if heap poisoning is enabled).
-        codegen_->MaybeGenerateReadBarrierSlow(instruction, out, out, base_loc, offset);
+        if (read_barrier_elided) {
+          __ MaybeUnpoisonHeapReference(out.AsRegister<CpuRegister>());
+        } else {
+          // If read barriers are enabled, emit read barriers other than
+          // Baker's using a slow path (and also unpoison the loaded
+          // reference, if heap poisoning is enabled).
+          codegen_->MaybeGenerateReadBarrierSlow(instruction, out, out, base_loc, offset);
+        }
       }
       break;
     }
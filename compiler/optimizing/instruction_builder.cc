@@ -21,6 +21,8 @@
 #include "class_linker.h"
 #include "dex_instruction-inl.h"
 #include "driver/compiler_options.h"
+#include "gc/allocation_site_tracker.h"
+#include "gc/heap.h"
 #include "imtable-inl.h"
 #include "quicken_info.h"
 #include "sharpening.h"
@@ -956,6 +958,17 @@ bool HInstructionBuilder::BuildInvokePolymorphic(const Instruction& instruction
                       false /* is_unresolved */);
 }
 
+bool HInstructionBuilder::ShouldPretenure(Handle<mirror::Class> klass, uint32_t dex_pc) const {
+  // Strings are allocated by the StringFactory, not by the new-instance.
+  if (!Runtime::Current()->UseJitCompilation() ||
+      graph_->GetArtMethod() == nullptr ||
+      klass->IsStringClass()) {
+    return false;
+  }
+  gc::AllocationSiteTracker* tracker = Runtime::Current()->GetHeap()->GetAllocationSiteTracker();
+  return tracker != nullptr && tracker->ShouldPretenure(graph_->GetArtMethod(), dex_pc);
+}
+
 HNewInstance* HInstructionBuilder::BuildNewInstance(dex::TypeIndex type_index, uint32_t dex_pc) {
   ScopedObjectAccess soa(Thread::Current());
 
@@ -975,6 +988,8 @@ HNewInstance* HInstructionBuilder::BuildNewInstance(dex::TypeIndex type_index, u
   QuickEntrypointEnum entrypoint = kQuickAllocObjectInitialized;
   if (load_class->NeedsAccessCheck() || klass->IsFinalizable() || !klass->IsInstantiable()) {
     entrypoint = kQuickAllocObjectWithChecks;
+  } else if (ShouldPretenure(klass, dex_pc)) {
+    entrypoint = kQuickAllocObjectNonMoving;
   }
 
   // Consider classes we haven't resolved as potentially finalizable.
@@ -289,6 +289,11 @@ class HInstructionBuilder : public ValueObject {
       HInvokeStaticOrDirect::ClinitCheckRequirement* clinit_check_requirement)
       REQUIRES_SHARED(Locks::mutator_lock_);
 
+  // Return whether the runtime profiled the new-instance at `dex_pc` as allocating long-lived
+  // objects, which are then allocated in the non-moving space.
+  bool ShouldPretenure(Handle<mirror::Class> klass, uint32_t dex_pc) const
+      REQUIRES_SHARED(Locks::mutator_lock_);
+
   // Build a HNewInstance instruction.
   HNewInstance* BuildNewInstance(dex::TypeIndex type_index, uint32_t dex_pc);
 
@@ -5510,9 +5510,18 @@ class HInstanceFieldGet FINAL : public HExpression<1> {
   Primitive::Type GetFieldType() const { return field_info_.GetFieldType(); }
   bool IsVolatile() const { return field_info_.IsVolatile(); }
 
+  // Whether the loaded reference needs no read barrier, see ReadBarrierElimination.
+  bool IsReadBarrierElided() const { return GetPackedFlag<kFlagReadBarrierElided>(); }
+  void SetReadBarrierElided() { SetPackedFlag<kFlagReadBarrierElided>(true); }
+
   DECLARE_INSTRUCTION(InstanceFieldGet);
 
  private:
+  static constexpr size_t kFlagReadBarrierElided = kNumberOfExpressionPackedBits;
+  static constexpr size_t kNumberOfInstanceFieldGetPackedBits = kFlagReadBarrierElided + 1;
+  static_assert(kNumberOfInstanceFieldGetPackedBits <= kMaxNumberOfPackedBits,
+                "Too many packed fields.");
+
   const FieldInfo field_info_;
 
   DISALLOW_COPY_AND_ASSIGN(HInstanceFieldGet);
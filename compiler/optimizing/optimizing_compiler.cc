@@ -46,6 +46,7 @@
 #include "base/dumpable.h"
 #include "base/macros.h"
 #include "base/mutex.h"
+#include "base/time_utils.h"
 #include "base/timing_logger.h"
 #include "bounds_check_elimination.h"
 #include "builder.h"
@@ -85,6 +86,7 @@
 #include "nodes.h"
 #include "oat_quick_method_header.h"
 #include "prepare_for_register_allocation.h"
+#include "read_barrier_elimination.h"
 #include "reference_type_propagation.h"
 #include "register_allocator_linear_scan.h"
 #include "select_generator.h"
@@ -146,7 +148,8 @@ class PassObserver : public ValueObject {
                CodeGenerator* codegen,
                std::ostream* visualizer_output,
                CompilerDriver* compiler_driver,
-               Mutex& dump_mutex)
+               Mutex& dump_mutex,
+               std::vector<std::pair<const char*, uint64_t>>* pass_timings)
       : graph_(graph),
         cached_method_name_(),
         timing_logger_enabled_(compiler_driver->GetDumpPasses()),
@@ -159,6 +162,8 @@ class PassObserver : public ValueObject {
         visualizer_enabled_(!compiler_driver->GetCompilerOptions().GetDumpCfgFileName().empty()),
         visualizer_(&visualizer_oss_, graph, *codegen),
         visualizer_dump_mutex_(dump_mutex),
+        pass_timings_(pass_timings),
+        pass_start_ns_(0),
         graph_in_bad_state_(false) {
     if (timing_logger_enabled_ || visualizer_enabled_) {
       if (!IsVerboseMethod(compiler_driver, GetMethodName())) {
@@ -210,6 +215,9 @@ class PassObserver : public ValueObject {
     if (timing_logger_enabled_) {
       timing_logger_.StartTiming(pass_name);
     }
+    if (pass_timings_ != nullptr) {
+      pass_start_ns_ = NanoTime();
+    }
   }
 
   void FlushVisualizer() REQUIRES(!visualizer_dump_mutex_) {
@@ -225,6 +233,9 @@ class PassObserver : public ValueObject {
     if (timing_logger_enabled_) {
       timing_logger_.EndTiming();
     }
+    if (pass_timings_ != nullptr) {
+      pass_timings_->emplace_back(pass_name, NanoTime() - pass_start_ns_);
+    }
     if (visualizer_enabled_) {
       visualizer_.DumpGraph(pass_name, /* is_after_pass */ true, graph_in_bad_state_);
       FlushVisualizer();
@@ -276,6 +287,10 @@ class PassObserver : public ValueObject {
   HGraphVisualizer visualizer_;
   Mutex& visualizer_dump_mutex_;
 
+  // Time spent in each pass, collected for the JIT's compilation statistics. May be null.
+  std::vector<std::pair<const char*, uint64_t>>* const pass_timings_;
+  uint64_t pass_start_ns_;
+
   // Flag to be set by the compiler if the pass failed and the graph is not
   // expected to validate.
   bool graph_in_bad_state_;
@@ -397,7 +412,8 @@ class OptimizingCompiler FINAL : public Compiler {
                             Handle<mirror::DexCache> dex_cache,
                             ArtMethod* method,
                             bool osr,
-                            VariableSizedHandleScope* handles) const;
+                            VariableSizedHandleScope* handles,
+                            std::vector<std::pair<const char*, uint64_t>>* pass_timings) const;
 
   void MaybeRunInliner(HGraph* graph,
                        CodeGenerator* codegen,
@@ -538,6 +554,8 @@ static HOptimization* BuildOptimization(
     return new (arena) CHAGuardOptimization(graph);
   } else if (opt_name == CodeSinking::kCodeSinkingPassName) {
     return new (arena) CodeSinking(graph, stats);
+  } else if (opt_name == ReadBarrierElimination::kReadBarrierEliminationPassName) {
+    return new (arena) ReadBarrierElimination(graph, stats);
 #ifdef ART_ENABLE_CODEGEN_arm
   } else if (opt_name == arm::InstructionSimplifierArm::kInstructionSimplifierArmPassName) {
     return new (arena) arm::InstructionSimplifierArm(graph, stats);
@@ -887,6 +905,16 @@ void OptimizingCompiler::RunOptimizations(HGraph* graph,
   }
 
   RunArchOptimizations(driver->GetInstructionSet(), graph, codegen, pass_observer);
+
+  if (kEmitCompilerReadBarrier && kUseBakerReadBarrier) {
+    // Depends on the final order of the instructions, so it must run last.
+    HOptimization* read_barrier_optimizations[] = {
+      new (arena) ReadBarrierElimination(graph, stats),
+    };
+    RunOptimizations(read_barrier_optimizations,
+                     arraysize(read_barrier_optimizations),
+                     pass_observer);
+  }
 }
 
 static ArenaVector<LinkerPatch> EmitAndSortLinkerPatches(CodeGenerator* codegen) {
@@ -949,7 +977,9 @@ CodeGenerator* OptimizingCompiler::TryCompile(ArenaAllocator* arena,
                                               Handle<mirror::DexCache> dex_cache,
                                               ArtMethod* method,
                                               bool osr,
-                                              VariableSizedHandleScope* handles) const {
+                                              VariableSizedHandleScope* handles,
+                                              std::vector<std::pair<const char*, uint64_t>>*
+                                                  pass_timings) const {
   MaybeRecordStat(MethodCompilationStat::kAttemptCompilation);
   CompilerDriver* compiler_driver = GetCompilerDriver();
   InstructionSet instruction_set = compiler_driver->GetInstructionSet();
@@ -1032,7 +1062,8 @@ CodeGenerator* OptimizingCompiler::TryCompile(ArenaAllocator* arena,
                              codegen.get(),
                              visualizer_output_.get(),
                              compiler_driver,
-                             dump_mutex_);
+                             dump_mutex_,
+                             pass_timings);
 
   {
     VLOG(compiler) << "Building " << pass_observer.GetMethodName();
@@ -1125,7 +1156,8 @@ CompiledMethod* OptimizingCompiler::Compile(const DexFile::CodeItem* code_item,
                      dex_cache,
                      nullptr,
                      /* osr */ false,
-                     &handles));
+                     &handles,
+                     /* pass_timings */ nullptr));
     }
     if (codegen.get() != nullptr) {
       MaybeRecordStat(MethodCompilationStat::kCompiled);
@@ -1199,6 +1231,7 @@ bool OptimizingCompiler::JitCompile(Thread* self,
                                     ArtMethod* method,
                                     bool osr,
                                     jit::JitLogger* jit_logger) {
+  uint64_t start_ns = NanoTime();
   StackHandleScope<3> hs(self);
   Handle<mirror::ClassLoader> class_loader(hs.NewHandle(
       method->GetDeclaringClass()->GetClassLoader()));
@@ -1215,6 +1248,7 @@ bool OptimizingCompiler::JitCompile(Thread* self,
   ArenaAllocator arena(Runtime::Current()->GetJitArenaPool());
   CodeVectorAllocator code_allocator(&arena);
   VariableSizedHandleScope handles(self);
+  std::vector<std::pair<const char*, uint64_t>> pass_timings;
 
   std::unique_ptr<CodeGenerator> codegen;
   {
@@ -1233,7 +1267,8 @@ bool OptimizingCompiler::JitCompile(Thread* self,
                    dex_cache,
                    method,
                    osr,
-                   &handles));
+                   &handles,
+                   &pass_timings));
     if (codegen.get() == nullptr) {
       return false;
     }
@@ -1334,6 +1369,12 @@ bool OptimizingCompiler::JitCompile(Thread* self,
   }
 
   Runtime::Current()->GetJit()->AddMemoryUsage(method, arena.BytesUsed());
+  jit::JitCompilationStats stats;
+  stats.compile_time_ns = NanoTime() - start_ns;
+  stats.code_size = code_allocator.GetSize();
+  stats.osr = osr;
+  code_cache->AddCompilationStats(
+      reinterpret_cast<const OatQuickMethodHeader*>(code)->GetCode(), stats, pass_timings);
   if (jit_logger != nullptr) {
     jit_logger->WriteLog(code, code_allocator.GetSize(), method);
   }
@@ -69,6 +69,7 @@ enum MethodCompilationStat {
   kExplicitNullCheckGenerated,
   kSimplifyIf,
   kInstructionSunk,
+  kReadBarrierElided,
   kNotInlinedUnresolvedEntrypoint,
   kNotInlinedDexCache,
   kNotInlinedStackMaps,
@@ -201,6 +202,7 @@ class OptimizingCompilerStats {
       case kExplicitNullCheckGenerated: name = "ExplicitNullCheckGenerated"; break;
       case kSimplifyIf: name = "SimplifyIf"; break;
       case kInstructionSunk: name = "InstructionSunk"; break;
+      case kReadBarrierElided: name = "ReadBarrierElided"; break;
       case kNotInlinedUnresolvedEntrypoint: name = "NotInlinedUnresolvedEntrypoint"; break;
       case kNotInlinedDexCache: name = "NotInlinedDexCache"; break;
       case kNotInlinedStackMaps: name = "NotInlinedStackMaps"; break;
@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "read_barrier_elimination.h"
+
+#include "base/stl_util.h"
+
+namespace art {
+
+void ReadBarrierElimination::Run() {
+  // Objects allocated in the current block since the last GC point.
+  ArenaVector<HInstruction*> new_objects(graph_->GetArena()->Adapter(kArenaAllocMisc));
+  for (HBasicBlock* block : graph_->GetReversePostOrder()) {
+    new_objects.clear();
+    for (HInstructionIterator it(block->GetInstructions()); !it.Done(); it.Advance()) {
+      HInstruction* instruction = it.Current();
+      if (instruction->IsInstanceFieldGet()) {
+        HInstanceFieldGet* field_get = instruction->AsInstanceFieldGet();
+        if (field_get->GetType() == Primitive::kPrimNot &&
+            ContainsElement(new_objects, field_get->InputAt(0))) {
+          field_get->SetReadBarrierElided();
+          MaybeRecordStat(kReadBarrierElided);
+        }
+      } else if (instruction->GetSideEffects().Includes(SideEffects::CanTriggerGC())) {
+        new_objects.clear();
+      }
+      // The allocation is a GC point itself, the object is only added once it returns.
+      if (instruction->IsNewInstance() || instruction->IsNewArray()) {
+        new_objects.push_back(instruction);
+      }
+    }
+  }
+}
+
+}  // namespace art
@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_COMPILER_OPTIMIZING_READ_BARRIER_ELIMINATION_H_
+#define ART_COMPILER_OPTIMIZING_READ_BARRIER_ELIMINATION_H_
+
+#include "nodes.h"
+#include "optimization.h"
+
+namespace art {
+
+/**
+ * Optimization pass marking the reference field loads that do not need a Baker read
+ * barrier: loads from an object allocated earlier in the same block, with no instruction
+ * that can trigger a GC in between. The object was allocated either while the GC was not
+ * marking or as a non-gray object while it was, and the GC cannot change phase before the
+ * load since the thread does not reach a GC point in between. The pass depends on the final
+ * order of the instructions, so it runs after all the other optimizations.
+ */
+class ReadBarrierElimination : public HOptimization {
+ public:
+  ReadBarrierElimination(HGraph* graph, OptimizingCompilerStats* stats)
+      : HOptimization(graph, kReadBarrierEliminationPassName, stats) {}
+
+  void Run() OVERRIDE;
+
+  static constexpr const char* kReadBarrierEliminationPassName = "read_barrier_elimination";
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(ReadBarrierElimination);
+};
+
+}  // namespace art
+
+#endif  // ART_COMPILER_OPTIMIZING_READ_BARRIER_ELIMINATION_H_
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "base/arena_allocator.h"
+#include "nodes.h"
+#include "optimizing_unit_test.h"
+#include "read_barrier_elimination.h"
+
+namespace art {
+
+class ReadBarrierEliminationTest : public CommonCompilerTest {};
+
+static HInstanceFieldGet* AddReferenceGet(ArenaAllocator* allocator,
+                                          HGraph* graph,
+                                          HBasicBlock* block,
+                                          HInstruction* object) {
+  HInstanceFieldGet* get = new (allocator) HInstanceFieldGet(object,
+                                                             nullptr,
+                                                             Primitive::kPrimNot,
+                                                             MemberOffset(42),
+                                                             false,
+                                                             kUnknownFieldIndex,
+                                                             kUnknownClassDefIndex,
+                                                             graph->GetDexFile(),
+                                                             0);
+  block->AddInstruction(get);
+  return get;
+}
+
+TEST_F(ReadBarrierEliminationTest, NewObjectUntilGcPoint) {
+  ArenaPool pool;
+  ArenaAllocator allocator(&pool);
+
+  HGraph* graph = CreateGraph(&allocator);
+  HBasicBlock* entry = new (&allocator) HBasicBlock(graph);
+  graph->AddBlock(entry);
+  graph->SetEntryBlock(entry);
+  HInstruction* parameter = new (&allocator) HParameterValue(graph->GetDexFile(),
+                                                             dex::TypeIndex(0),
+                                                             0,
+                                                             Primitive::kPrimNot);
+  entry->AddInstruction(parameter);
+
+  HBasicBlock* block = new (&allocator) HBasicBlock(graph);
+  graph->AddBlock(block);
+  entry->AddSuccessor(block);
+
+  HInstruction* new_instance = new (&allocator) HNewInstance(parameter,
+                                                             0,
+                                                             dex::TypeIndex(0),
+                                                             graph->GetDexFile(),
+                                                             false,
+                                                             kQuickAllocObjectInitialized);
+  block->AddInstruction(new_instance);
+  HInstanceFieldGet* from_new = AddReferenceGet(&allocator, graph, block, new_instance);
+  HInstanceFieldGet* from_parameter = AddReferenceGet(&allocator, graph, block, parameter);
+  block->AddInstruction(new (&allocator) HSuspendCheck());
+  HInstanceFieldGet* after_gc_point = AddReferenceGet(&allocator, graph, block, new_instance);
+  block->AddInstruction(new (&allocator) HExit());
+
+  graph->BuildDominatorTree();
+  ReadBarrierElimination(graph, nullptr).Run();
+
+  // The new object cannot be gray until this thread passes a GC point.
+  EXPECT_TRUE(from_new->IsReadBarrierElided());
+  EXPECT_FALSE(from_parameter->IsReadBarrierElided());
+  EXPECT_FALSE(after_gc_point->IsReadBarrierElided());
+}
+
+}  // namespace art
@@ -63,6 +63,7 @@
 #include "elf_file.h"
 #include "elf_writer.h"
 #include "elf_writer_quick.h"
+#include "field_layout_profile.h"
 #include "gc/space/image_space.h"
 #include "gc/space/space-inl.h"
 #include "gc/verification.h"
@@ -1621,6 +1622,14 @@ class Dex2Oat FINAL {
       // Store the class loader context in the oat header.
       key_value_store_->Put(OatHeader::kClassPathKey,
                             class_loader_context_->EncodeContextForOatFile(classpath_dir_));
+
+      // The compiled code has the field offsets of the field layout profile, if any.
+      const FieldLayoutProfile* field_layout_profile =
+          runtime_->GetClassLinker()->GetFieldLayoutProfile();
+      if (field_layout_profile != nullptr) {
+        key_value_store_->Put(OatHeader::kFieldLayoutProfileKey,
+                              field_layout_profile->GetChecksum());
+      }
     }
 
     // Now that we have finalized key_value_store_, start writing the oat file.
@@ -31,11 +31,13 @@ static constexpr const uint32_t kMinNewClassesPercentChangeForCompilation = 2;
 
 ProfileAssistant::ProcessingResult ProfileAssistant::ProcessProfilesInternal(
         const std::vector<ScopedFlock>& profile_files,
-        const ScopedFlock& reference_profile_file) {
+        const ScopedFlock& reference_profile_file,
+        bool store_mapped) {
   DCHECK(!profile_files.empty());
 
   ProfileCompilationInfo info;
-  // Load the reference profile.
+  // Load the reference profile. A mapped reference profile is written back the same way.
+  store_mapped |= ProfileCompilationInfo::IsMappedProfile(reference_profile_file->Fd());
   if (!info.Load(reference_profile_file->Fd())) {
     LOG(WARNING) << "Could not load reference profile file";
     return kErrorBadProfiles;
@@ -47,6 +49,21 @@ ProfileAssistant::ProcessingResult ProfileAssistant::ProcessProfilesInternal(
 
   // Merge all current profiles.
   for (size_t i = 0; i < profile_files.size(); i++) {
+    if (ProfileCompilationInfo::IsMappedProfile(profile_files[i]->Fd())) {
+      // Mapped profiles are streamed straight into the reference without being loaded first.
+      std::string error;
+      std::unique_ptr<ProfileCompilationInfo::MappedProfile> mapped =
+          ProfileCompilationInfo::MappedProfile::Open(profile_files[i]->Fd(), &error);
+      if (mapped == nullptr) {
+        LOG(WARNING) << "Could not map profile file at index " << i << ": " << error;
+        return kErrorBadProfiles;
+      }
+      if (!info.MergeWith(*mapped)) {
+        LOG(WARNING) << "Could not merge profile file at index " << i;
+        return kErrorBadProfiles;
+      }
+      continue;
+    }
     ProfileCompilationInfo cur_info;
     if (!cur_info.Load(profile_files[i]->Fd())) {
       LOG(WARNING) << "Could not load profile file at index " << i;
@@ -76,7 +93,8 @@ ProfileAssistant::ProcessingResult ProfileAssistant::ProcessProfilesInternal(
     PLOG(WARNING) << "Could not clear reference profile file";
     return kErrorIO;
   }
-  if (!info.Save(reference_profile_file->Fd())) {
+  if (!(store_mapped ? info.SaveMapped(reference_profile_file->Fd())
+                     : info.Save(reference_profile_file->Fd()))) {
     LOG(WARNING) << "Could not save reference profile file";
     return kErrorIO;
   }
@@ -122,7 +140,8 @@ class ScopedFlockList {
 
 ProfileAssistant::ProcessingResult ProfileAssistant::ProcessProfiles(
         const std::vector<int>& profile_files_fd,
-        int reference_profile_file_fd) {
+        int reference_profile_file_fd,
+        bool store_mapped) {
   DCHECK_GE(reference_profile_file_fd, 0);
 
   std::string error;
@@ -143,12 +162,13 @@ ProfileAssistant::ProcessingResult ProfileAssistant::ProcessProfiles(
     return kErrorCannotLock;
   }
 
-  return ProcessProfilesInternal(profile_files.Get(), reference_profile_file);
+  return ProcessProfilesInternal(profile_files.Get(), reference_profile_file, store_mapped);
 }
 
 ProfileAssistant::ProcessingResult ProfileAssistant::ProcessProfiles(
         const std::vector<std::string>& profile_files,
-        const std::string& reference_profile_file) {
+        const std::string& reference_profile_file,
+        bool store_mapped) {
   std::string error;
 
   ScopedFlockList profile_files_list(profile_files.size());
@@ -164,7 +184,9 @@ ProfileAssistant::ProcessingResult ProfileAssistant::ProcessProfiles(
     return kErrorCannotLock;
   }
 
-  return ProcessProfilesInternal(profile_files_list.Get(), locked_reference_profile_file);
+  return ProcessProfilesInternal(profile_files_list.Get(),
+                                 locked_reference_profile_file,
+                                 store_mapped);
 }
 
 }  // namespace art
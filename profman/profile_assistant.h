@@ -51,18 +51,24 @@ class ProfileAssistant {
   // merge of the current profiles and the reference one is insignificant. In
   // this case no file will be updated.
   //
+  // If store_mapped is true, or the reference profile already uses the mapped format,
+  // the updated reference profile is written with ProfileCompilationInfo::SaveMapped.
+  //
   static ProcessingResult ProcessProfiles(
       const std::vector<std::string>& profile_files,
-      const std::string& reference_profile_file);
+      const std::string& reference_profile_file,
+      bool store_mapped = false);
 
   static ProcessingResult ProcessProfiles(
       const std::vector<int>& profile_files_fd_,
-      int reference_profile_file_fd);
+      int reference_profile_file_fd,
+      bool store_mapped = false);
 
  private:
   static ProcessingResult ProcessProfilesInternal(
       const std::vector<ScopedFlock>& profile_files,
-      const ScopedFlock& reference_profile_file);
+      const ScopedFlock& reference_profile_file,
+      bool store_mapped);
 
   DISALLOW_COPY_AND_ASSIGN(ProfileAssistant);
 };
@@ -173,7 +173,9 @@ class ProfileAssistantTest : public CommonRuntimeTest {
   }
 
   // Runs test with given arguments.
-  int ProcessProfiles(const std::vector<int>& profiles_fd, int reference_profile_fd) {
+  int ProcessProfiles(const std::vector<int>& profiles_fd,
+                      int reference_profile_fd,
+                      const std::vector<std::string>& extra_args = std::vector<std::string>()) {
     std::string profman_cmd = GetProfmanCmd();
     std::vector<std::string> argv_str;
     argv_str.push_back(profman_cmd);
@@ -181,6 +183,7 @@ class ProfileAssistantTest : public CommonRuntimeTest {
       argv_str.push_back("--profile-file-fd=" + std::to_string(profiles_fd[k]));
     }
     argv_str.push_back("--reference-profile-file-fd=" + std::to_string(reference_profile_fd));
+    argv_str.insert(argv_str.end(), extra_args.begin(), extra_args.end());
 
     std::string error;
     return ExecAndReturnCode(argv_str, &error);
@@ -417,6 +420,39 @@ TEST_F(ProfileAssistantTest, AdviseCompilationEmptyReferences) {
   CheckProfileInfo(profile2, info2);
 }
 
+TEST_F(ProfileAssistantTest, StoreMappedReferenceProfile) {
+  ScratchFile profile1;
+  ScratchFile profile2;
+  ScratchFile reference_profile;
+
+  std::vector<int> profile_fds({
+      GetFd(profile1),
+      GetFd(profile2)});
+  int reference_profile_fd = GetFd(reference_profile);
+
+  const uint16_t kNumberOfMethodsToEnableCompilation = 100;
+  ProfileCompilationInfo info1;
+  SetupProfile("p1", 1, kNumberOfMethodsToEnableCompilation, 0, profile1, &info1);
+  ProfileCompilationInfo info2;
+  SetupProfile("p2", 2, kNumberOfMethodsToEnableCompilation, 0, profile2, &info2);
+
+  ASSERT_EQ(ProfileAssistant::kCompile,
+            ProcessProfiles(profile_fds,
+                            reference_profile_fd,
+                            {"--store-mapped-reference-profile"}));
+  // The reference profile is written in the mapped format and still loads as the merge of
+  // the inputs.
+  ASSERT_TRUE(reference_profile.GetFile()->ResetOffset());
+  ASSERT_TRUE(ProfileCompilationInfo::IsMappedProfile(reference_profile_fd));
+  ProfileCompilationInfo result;
+  ASSERT_TRUE(result.Load(reference_profile_fd));
+
+  ProfileCompilationInfo expected;
+  ASSERT_TRUE(expected.MergeWith(info1));
+  ASSERT_TRUE(expected.MergeWith(info2));
+  ASSERT_TRUE(expected.Equals(result));
+}
+
 // TODO(calin): Add more tests for classes.
 TEST_F(ProfileAssistantTest, AdviseCompilationEmptyReferencesBecauseOfClasses) {
   ScratchFile profile1;
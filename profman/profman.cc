@@ -114,6 +114,11 @@ NO_RETURN static void Usage(const char *fmt, ...) {
   UsageError("      accepts a file descriptor. Cannot be used together with");
   UsageError("      --reference-profile-file.");
   UsageError("");
+  UsageError("  --store-mapped-reference-profile: write the merged reference profile in the");
+  UsageError("      memory mapped format, which later merges read without decompressing it.");
+  UsageError("      The compiler loads it like any other profile. A reference profile that");
+  UsageError("      is already in that format is always written back in it.");
+  UsageError("");
   UsageError("  --generate-test-profile=<filename>: generates a random profile file for testing.");
   UsageError("  --generate-test-profile-num-dex=<number>: number of dex files that should be");
   UsageError("      included in the generated profile. Defaults to 20.");
@@ -177,6 +182,7 @@ class ProfMan FINAL {
       dump_only_(false),
       dump_classes_and_methods_(false),
       generate_boot_image_profile_(false),
+      store_mapped_reference_profile_(false),
       dump_output_to_fd_(kInvalidFd),
       test_profile_num_dex_(kDefaultTestProfileNumDex),
       test_profile_method_ratio_(kDefaultTestProfileMethodRatio),
@@ -212,6 +218,8 @@ class ProfMan FINAL {
         dump_only_ = true;
       } else if (option == "--dump-classes-and-methods") {
         dump_classes_and_methods_ = true;
+      } else if (option == "--store-mapped-reference-profile") {
+        store_mapped_reference_profile_ = true;
       } else if (option.starts_with("--create-profile-from=")) {
         create_profile_from_file_ = option.substr(strlen("--create-profile-from=")).ToString();
       } else if (option.starts_with("--dump-output-to-fd=")) {
@@ -302,10 +310,14 @@ class ProfMan FINAL {
       // The file doesn't need to be flushed here (ProcessProfiles will do it)
       // so don't check the usage.
       File file(reference_profile_file_fd_, false);
-      result = ProfileAssistant::ProcessProfiles(profile_files_fd_, reference_profile_file_fd_);
+      result = ProfileAssistant::ProcessProfiles(profile_files_fd_,
+                                                 reference_profile_file_fd_,
+                                                 store_mapped_reference_profile_);
       CloseAllFds(profile_files_fd_, "profile_files_fd_");
     } else {
-      result = ProfileAssistant::ProcessProfiles(profile_files_, reference_profile_file_);
+      result = ProfileAssistant::ProcessProfiles(profile_files_,
+                                                 reference_profile_file_,
+                                                 store_mapped_reference_profile_);
     }
     return result;
   }
@@ -1097,6 +1109,7 @@ class ProfMan FINAL {
   bool dump_only_;
   bool dump_classes_and_methods_;
   bool generate_boot_image_profile_;
+  bool store_mapped_reference_profile_;
   int dump_output_to_fd_;
   BootImageOptions boot_image_options_;
   std::string test_profile_;
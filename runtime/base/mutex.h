@@ -89,6 +89,7 @@ enum LockLevel {
   kTracingStreamingLock,
   kDeoptimizedMethodsLock,
   kClassLoaderClassesLock,
+  kGcProfilerRecordLock,
   kDefaultMutexLevel,
   kDexLock,
   kMarkSweepLargeObjectLock,
@@ -46,6 +46,7 @@
 #include "cha.h"
 #include "class_linker-inl.h"
 #include "class_loader_utils.h"
+#include "class_preloader.h"
 #include "class_table-inl.h"
 #include "compiler_callbacks.h"
 #include "debugger.h"
@@ -53,6 +54,7 @@
 #include "entrypoints/entrypoint_utils.h"
 #include "entrypoints/runtime_asm_entrypoints.h"
 #include "experimental_flags.h"
+#include "field_layout_profile.h"
 #include "gc/accounting/card_table-inl.h"
 #include "gc/accounting/heap_bitmap-inl.h"
 #include "gc/accounting/space_bitmap-inl.h"
@@ -3479,6 +3481,11 @@ ObjPtr<mirror::DexCache> ClassLinker::RegisterDexFile(const DexFile& dex_file,
     // Since we added a strong root to the class table, do the write barrier as required for
     // remembered sets and generational GCs.
     Runtime::Current()->GetHeap()->WriteBarrierEveryFieldOf(h_class_loader.Get());
+    // Start linking the startup classes of the dex file ahead of their first use.
+    ClassPreloader* class_preloader = Runtime::Current()->GetClassPreloader();
+    if (class_preloader != nullptr) {
+      class_preloader->DexFileRegistered(self, dex_file, h_class_loader.Get());
+    }
   }
   return h_dex_cache.Get();
 }
@@ -7387,8 +7394,68 @@ bool ClassLinker::LinkStaticFields(Thread* self, Handle<mirror::Class> klass, si
   return LinkFields(self, klass, true, class_size);
 }
 
+void ClassLinker::SetFieldLayoutProfile(std::unique_ptr<FieldLayoutProfile> profile) {
+  field_layout_profile_ = std::move(profile);
+}
+
+bool ClassLinker::ShouldUseFieldLayoutProfile(ObjPtr<mirror::Class> klass) {
+  // Boot classes mirror the runtime's C++ layouts and are laid out in the boot image.
+  if (field_layout_profile_ == nullptr ||
+      klass->IsBootStrapClassLoaded() ||
+      klass->IsProxyClass()) {
+    return false;
+  }
+  const OatDexFile* oat_dex_file = klass->GetDexFile().GetOatDexFile();
+  if (oat_dex_file == nullptr || oat_dex_file->GetOatFile() == nullptr) {
+    return true;
+  }
+  const char* checksum = oat_dex_file->GetOatFile()->GetOatHeader().GetStoreValueByKey(
+      OatHeader::kFieldLayoutProfileKey);
+  return checksum != nullptr && field_layout_profile_->GetChecksum() == checksum;
+}
+
+// Access counts of the fields laid out first, the most accessed fields of the class that fit in
+// FieldLayoutProfile::kHotFieldBytes.
+using HotFields = std::unordered_map<ArtField*, uint64_t>;
+
+static void SelectHotFields(const FieldLayoutProfile::FieldCounts& counts,
+                            LengthPrefixedArray<ArtField>* fields,
+                            HotFields* hot_fields)
+    REQUIRES_SHARED(Locks::mutator_lock_) {
+  std::vector<std::pair<uint64_t, ArtField*>> candidates;
+  for (ArtField& field : MakeIterationRangeFromLengthPrefixedArray(fields)) {
+    auto it = counts.find(field.GetName());
+    if (it != counts.end() && it->second != 0u) {
+      candidates.emplace_back(it->second, &field);
+    }
+  }
+  std::sort(candidates.begin(),
+            candidates.end(),
+            [](const std::pair<uint64_t, ArtField*>& lhs,
+               const std::pair<uint64_t, ArtField*>& rhs) NO_THREAD_SAFETY_ANALYSIS {
+              if (lhs.first != rhs.first) {
+                return lhs.first > rhs.first;
+              }
+              return lhs.second->GetDexFieldIndex() < rhs.second->GetDexFieldIndex();
+            });
+  size_t hot_bytes = 0u;
+  for (const std::pair<uint64_t, ArtField*>& candidate : candidates) {
+    Primitive::Type type = candidate.second->GetTypeAsPrimitiveType();
+    size_t size = (type == Primitive::kPrimNot)
+        ? sizeof(mirror::HeapReference<mirror::Object>)
+        : Primitive::ComponentSize(type);
+    if (hot_bytes + size > FieldLayoutProfile::kHotFieldBytes) {
+      break;
+    }
+    hot_bytes += size;
+    hot_fields->emplace(candidate.second, candidate.first);
+  }
+}
+
 struct LinkFieldsComparator {
-  explicit LinkFieldsComparator() REQUIRES_SHARED(Locks::mutator_lock_) {
+  explicit LinkFieldsComparator(const HotFields* hot_fields = nullptr)
+      REQUIRES_SHARED(Locks::mutator_lock_)
+      : hot_fields_(hot_fields) {
   }
   // No thread safety analysis as will be called from STL. Checked lock held in constructor.
   bool operator()(ArtField* field1, ArtField* field2)
@@ -7396,6 +7463,19 @@ struct LinkFieldsComparator {
     // First come reference fields, then 64-bit, then 32-bit, and then 16-bit, then finally 8-bit.
     Primitive::Type type1 = field1->GetTypeAsPrimitiveType();
     Primitive::Type type2 = field2->GetTypeAsPrimitiveType();
+    if (hot_fields_ != nullptr &&
+        (type1 == Primitive::kPrimNot) == (type2 == Primitive::kPrimNot)) {
+      // Hot fields go first among the references or the primitives, the most accessed first
+      // among the ones of the same size.
+      uint64_t count1 = GetAccessCount(field1);
+      uint64_t count2 = GetAccessCount(field2);
+      if ((count1 != 0u) != (count2 != 0u)) {
+        return count1 != 0u;
+      }
+      if (count1 != count2 && Primitive::ComponentSize(type1) == Primitive::ComponentSize(type2)) {
+        return count1 > count2;
+      }
+    }
     if (type1 != type2) {
       if (type1 == Primitive::kPrimNot) {
         // Reference always goes first.
@@ -7419,6 +7499,14 @@ struct LinkFieldsComparator {
     // NOTE: This works also for proxies. Their static fields are assigned appropriate indexes.
     return field1->GetDexFieldIndex() < field2->GetDexFieldIndex();
   }
+
+ private:
+  uint64_t GetAccessCount(ArtField* field) const {
+    auto it = hot_fields_->find(field);
+    return it != hot_fields_->end() ? it->second : 0u;
+  }
+
+  const HotFields* const hot_fields_;
 };
 
 bool ClassLinker::LinkFields(Thread* self,
@@ -7461,14 +7549,27 @@ bool ClassLinker::LinkFields(Thread* self,
   //
   // Once the fields are sorted in this order we will attempt to fill any gaps that might be present
   // in the memory layout of the structure. See ShuffleForward for how this is done.
+  //
+  // With a field layout profile, the hot instance fields come first among the references and
+  // among the primitives, see SelectHotFields.
   std::deque<ArtField*> grouped_and_sorted_fields;
   const char* old_no_suspend_cause = self->StartAssertNoThreadSuspension(
       "Naked ArtField references in deque");
   for (size_t i = 0; i < num_fields; i++) {
     grouped_and_sorted_fields.push_back(&fields->At(i));
   }
+  HotFields hot_fields;
+  if (!is_static && num_fields != 0u && ShouldUseFieldLayoutProfile(klass.Get())) {
+    std::string temp;
+    const FieldLayoutProfile::FieldCounts* counts =
+        field_layout_profile_->FindClass(klass->GetDescriptor(&temp));
+    if (counts != nullptr) {
+      SelectHotFields(*counts, fields, &hot_fields);
+    }
+  }
+  const bool use_hot_fields = !hot_fields.empty();
   std::sort(grouped_and_sorted_fields.begin(), grouped_and_sorted_fields.end(),
-            LinkFieldsComparator());
+            LinkFieldsComparator(use_hot_fields ? &hot_fields : nullptr));
 
   // References should be at the front.
   size_t current_field = 0;
@@ -7495,14 +7596,27 @@ bool ClassLinker::LinkFields(Thread* self,
     field_offset = MemberOffset(field_offset.Uint32Value() +
                                 sizeof(mirror::HeapReference<mirror::Object>));
   }
+  // The hot primitives are shuffled forward before the cold ones, each run is sorted from largest
+  // to smallest.
+  std::deque<ArtField*> cold_fields;
+  if (use_hot_fields) {
+    auto first_cold = std::find_if(grouped_and_sorted_fields.begin(),
+                                   grouped_and_sorted_fields.end(),
+                                   [&hot_fields](ArtField* field) {
+                                     return hot_fields.find(field) == hot_fields.end();
+                                   });
+    cold_fields.assign(first_cold, grouped_and_sorted_fields.end());
+    grouped_and_sorted_fields.erase(first_cold, grouped_and_sorted_fields.end());
+  }
   // Gaps are stored as a max heap which means that we must shuffle from largest to smallest
   // otherwise we could end up with suboptimal gap fills.
-  ShuffleForward<8>(&current_field, &field_offset, &grouped_and_sorted_fields, &gaps);
-  ShuffleForward<4>(&current_field, &field_offset, &grouped_and_sorted_fields, &gaps);
-  ShuffleForward<2>(&current_field, &field_offset, &grouped_and_sorted_fields, &gaps);
-  ShuffleForward<1>(&current_field, &field_offset, &grouped_and_sorted_fields, &gaps);
-  CHECK(grouped_and_sorted_fields.empty()) << "Missed " << grouped_and_sorted_fields.size() <<
-      " fields.";
+  for (std::deque<ArtField*>* run : { &grouped_and_sorted_fields, &cold_fields }) {
+    ShuffleForward<8>(&current_field, &field_offset, run, &gaps);
+    ShuffleForward<4>(&current_field, &field_offset, run, &gaps);
+    ShuffleForward<2>(&current_field, &field_offset, run, &gaps);
+    ShuffleForward<1>(&current_field, &field_offset, run, &gaps);
+    CHECK(run->empty()) << "Missed " << run->size() << " fields.";
+  }
   self->EndAssertNoThreadSuspension(old_no_suspend_cause);
 
   // We lie to the GC about the java.lang.ref.Reference.referent field, so it doesn't scan it.
@@ -7561,7 +7675,8 @@ bool ClassLinker::LinkFields(Thread* self,
 
   if (kIsDebugBuild) {
     // Make sure that the fields array is ordered by name but all reference
-    // offsets are at the beginning as far as alignment allows.
+    // offsets are at the beginning as far as alignment allows. Hot references
+    // are laid out out of name order.
     MemberOffset start_ref_offset = is_static
         ? klass->GetFirstReferenceStaticFieldOffsetDuringLinking(image_pointer_size_)
         : klass->GetFirstReferenceInstanceFieldOffset();
@@ -7597,7 +7712,13 @@ bool ClassLinker::LinkFields(Thread* self,
           CHECK(!IsAligned<sizeof(mirror::HeapReference<mirror::Object>)>(offset.Uint32Value()));
         }
       } else {
-        CHECK_EQ(current_ref_offset.Uint32Value(), offset.Uint32Value());
+        if (use_hot_fields) {
+          CHECK_GE(offset.Uint32Value(), start_ref_offset.Uint32Value());
+          CHECK_LT(offset.Uint32Value(), end_ref_offset.Uint32Value());
+          CHECK_ALIGNED(offset.Uint32Value(), sizeof(mirror::HeapReference<mirror::Object>));
+        } else {
+          CHECK_EQ(current_ref_offset.Uint32Value(), offset.Uint32Value());
+        }
         current_ref_offset = MemberOffset(current_ref_offset.Uint32Value() +
                                           sizeof(mirror::HeapReference<mirror::Object>));
       }
@@ -8468,6 +8589,19 @@ pid_t ClassLinker::GetDexLockOwner() {
   return Locks::dex_lock_->GetExclusiveOwnerTid();
 }
 
+bool ClassLinker::IsAnyClassTableLocked() {
+  // GetExclusiveOwnerTid is non zero for a lock held by readers too.
+  if (boot_class_table_->GetLock().GetExclusiveOwnerTid() != 0) {
+    return true;
+  }
+  for (const ClassLoaderData& data : class_loaders_) {
+    if (data.class_table->GetLock().GetExclusiveOwnerTid() != 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
 void ClassLinker::SetClassRoot(ClassRoot class_root, ObjPtr<mirror::Class> klass) {
   DCHECK(!init_done_);
 
@@ -62,6 +62,7 @@ namespace mirror {
 
 class ClassHierarchyAnalysis;
 class ClassTable;
+class FieldLayoutProfile;
 template<class T> class Handle;
 class ImtConflictTable;
 template<typename T> class LengthPrefixedArray;
@@ -493,6 +494,10 @@ class ClassLinker {
   pid_t GetClassesLockOwner();  // For SignalCatcher.
   pid_t GetDexLockOwner();  // For SignalCatcher.
 
+  // Whether a thread holds the lock of the boot class table or of a class loader's class table.
+  // For the forked heap dump, whose child process must not wait for a thread that does not exist.
+  bool IsAnyClassTableLocked() REQUIRES(Locks::classlinker_classes_lock_);
+
   mirror::Class* GetClassRoot(ClassRoot class_root) REQUIRES_SHARED(Locks::mutator_lock_);
 
   static const char* GetClassRootDescriptor(ClassRoot class_root);
@@ -680,6 +685,14 @@ class ClassLinker {
     return cha_.get();
   }
 
+  // Set the access profile used to lay out the instance fields of non-boot classes. Must be
+  // called before any such class is linked.
+  void SetFieldLayoutProfile(std::unique_ptr<FieldLayoutProfile> profile);
+
+  const FieldLayoutProfile* GetFieldLayoutProfile() const {
+    return field_layout_profile_.get();
+  }
+
   struct DexCacheData {
     // Construct an invalid data object.
     DexCacheData()
@@ -1115,6 +1128,10 @@ class ClassLinker {
       REQUIRES_SHARED(Locks::mutator_lock_);
   bool LinkFields(Thread* self, Handle<mirror::Class> klass, bool is_static, size_t* class_size)
       REQUIRES_SHARED(Locks::mutator_lock_);
+  // Whether the instance fields of the class are laid out with the field layout profile. The
+  // layout must match the one the class's oat file, if any, was compiled with.
+  bool ShouldUseFieldLayoutProfile(ObjPtr<mirror::Class> klass)
+      REQUIRES_SHARED(Locks::mutator_lock_);
   void CreateReferenceInstanceOffsets(Handle<mirror::Class> klass)
       REQUIRES_SHARED(Locks::mutator_lock_);
 
@@ -1286,6 +1303,8 @@ class ClassLinker {
 
   std::unique_ptr<ClassHierarchyAnalysis> cha_;
 
+  std::unique_ptr<FieldLayoutProfile> field_layout_profile_;
+
   class FindVirtualMethodHolderVisitor;
 
   friend class AppImageClassLoadersAndDexCachesHelper;
@@ -30,6 +30,7 @@
 #include "dex_file_types.h"
 #include "experimental_flags.h"
 #include "entrypoints/entrypoint_utils-inl.h"
+#include "field_layout_profile.h"
 #include "gc/heap.h"
 #include "mirror/accessible_object.h"
 #include "mirror/call_site.h"
@@ -933,6 +934,38 @@ TEST_F(ClassLinkerTest, LookupResolvedType) {
       klass);
 }
 
+TEST_F(ClassLinkerTest, FieldLayoutProfile) {
+  std::string error_msg;
+  std::unique_ptr<FieldLayoutProfile> profile = FieldLayoutProfile::Parse(
+      "LAllFields;->iObjectArray 100\n"
+      "LAllFields;->iB 10\n"
+      "LAllFields;->iZ 50\n"
+      "LAllFields;->sI 1000\n",
+      &error_msg);
+  ASSERT_TRUE(profile != nullptr) << error_msg;
+  class_linker_->SetFieldLayoutProfile(std::move(profile));
+
+  ScopedObjectAccess soa(Thread::Current());
+  StackHandleScope<1> hs(soa.Self());
+  Handle<mirror::ClassLoader> class_loader(
+      hs.NewHandle(soa.Decode<mirror::ClassLoader>(LoadDex("AllFields"))));
+  ObjPtr<mirror::Class> klass = class_linker_->FindClass(soa.Self(), "LAllFields;", class_loader);
+  ASSERT_OBJ_PTR_NE(klass, ObjPtr<mirror::Class>(nullptr));
+  auto offset_of = [klass](const char* name, const char* type)
+      REQUIRES_SHARED(Locks::mutator_lock_) {
+    ArtField* field = klass->FindDeclaredInstanceField(name, type);
+    CHECK(field != nullptr) << name;
+    return field->GetOffset().Uint32Value();
+  };
+  // The hot reference goes first, the hot primitives right after the references.
+  EXPECT_LT(offset_of("iObjectArray", "[Ljava/lang/Object;"),
+            offset_of("iObject", "Ljava/lang/Object;"));
+  EXPECT_LT(offset_of("iZ", "Z"), offset_of("iB", "B"));
+  EXPECT_LT(offset_of("iB", "B"), offset_of("iD", "D"));
+  EXPECT_LT(offset_of("iB", "B"), offset_of("iJ", "J"));
+  EXPECT_EQ(klass->NumReferenceInstanceFields(), 2u);
+}
+
 TEST_F(ClassLinkerTest, LookupResolvedTypeArray) {
   ScopedObjectAccess soa(Thread::Current());
   StackHandleScope<2> hs(soa.Self());
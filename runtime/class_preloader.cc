@@ -0,0 +1,222 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "class_preloader.h"
+
+#include <algorithm>
+#include <ostream>
+#include <vector>
+
+#include "base/logging.h"
+#include "class_linker.h"
+#include "dex_file-inl.h"
+#include "handle_scope-inl.h"
+#include "java_vm_ext.h"
+#include "jit/profile_compilation_info.h"
+#include "mirror/class-inl.h"
+#include "mirror/class_loader.h"
+#include "runtime.h"
+#include "scoped_thread_state_change-inl.h"
+#include "thread-current-inl.h"
+#include "thread_pool.h"
+
+namespace art {
+
+constexpr size_t ClassPreloader::kClassesPerTask;
+
+// Weak global reference to the class loader of a dex file, shared by the tasks preloading its
+// classes. The loader may be unloaded while its classes are queued.
+class ClassPreloader::LoaderReference {
+ public:
+  LoaderReference(Thread* self, ObjPtr<mirror::ClassLoader> class_loader)
+      REQUIRES_SHARED(Locks::mutator_lock_)
+      : loader_(Runtime::Current()->GetJavaVM()->AddWeakGlobalRef(self, class_loader)) {}
+
+  ~LoaderReference() {
+    Runtime::Current()->GetJavaVM()->DeleteWeakGlobalRef(Thread::Current(), loader_);
+  }
+
+  jweak Get() const {
+    return loader_;
+  }
+
+ private:
+  const jweak loader_;
+
+  DISALLOW_COPY_AND_ASSIGN(LoaderReference);
+};
+
+class ClassPreloader::PreloadTask FINAL : public SelfDeletingTask {
+ public:
+  PreloadTask(ClassPreloader* preloader,
+              const DexFile* dex_file,
+              std::shared_ptr<LoaderReference> loader,
+              std::vector<dex::TypeIndex>&& type_indexes)
+      : preloader_(preloader),
+        dex_file_(dex_file),
+        loader_(std::move(loader)),
+        type_indexes_(std::move(type_indexes)) {}
+
+  void Run(Thread* self) OVERRIDE {
+    if (preloader_->IsShuttingDown()) {
+      return;
+    }
+    ScopedObjectAccess soa(self);
+    StackHandleScope<2> hs(self);
+    Handle<mirror::ClassLoader> class_loader(
+        hs.NewHandle(soa.Decode<mirror::ClassLoader>(loader_->Get())));
+    if (class_loader == nullptr) {
+      // The class loader was unloaded, and the dex file with it.
+      return;
+    }
+    MutableHandle<mirror::Class> klass(hs.NewHandle<mirror::Class>(nullptr));
+    for (dex::TypeIndex type_index : type_indexes_) {
+      if (preloader_->IsShuttingDown()) {
+        return;
+      }
+      preloader_->PreloadClass(self, *dex_file_, type_index, class_loader, klass);
+    }
+  }
+
+ private:
+  ClassPreloader* const preloader_;
+  const DexFile* const dex_file_;
+  const std::shared_ptr<LoaderReference> loader_;
+  const std::vector<dex::TypeIndex> type_indexes_;
+
+  DISALLOW_COPY_AND_ASSIGN(PreloadTask);
+};
+
+std::unique_ptr<ClassPreloader> ClassPreloader::Create(const std::string& profile_filename,
+                                                       size_t num_threads,
+                                                       std::string* error_msg) {
+  DCHECK_NE(num_threads, 0u);
+  std::unique_ptr<ProfileCompilationInfo> profile(new ProfileCompilationInfo());
+  if (!profile->Load(profile_filename, /* clear_if_invalid */ false)) {
+    *error_msg = "Could not load profile " + profile_filename;
+    return nullptr;
+  }
+  if (profile->GetNumberOfResolvedClasses() == 0) {
+    *error_msg = "No startup class in profile " + profile_filename;
+    return nullptr;
+  }
+  return std::unique_ptr<ClassPreloader>(new ClassPreloader(std::move(profile), num_threads));
+}
+
+ClassPreloader::ClassPreloader(std::unique_ptr<ProfileCompilationInfo> profile,
+                               size_t num_threads)
+    : profile_(std::move(profile)),
+      thread_pool_(new ThreadPool("Class preloader", num_threads)),
+      shutting_down_(false),
+      lock_("class preloader lock"),
+      loaded_(0u),
+      verified_(0u),
+      initialized_(0u),
+      failed_(0u) {
+  thread_pool_->StartWorkers(Thread::Current());
+}
+
+ClassPreloader::~ClassPreloader() {
+  shutting_down_.StoreRelaxed(true);
+  // Let the queued tasks run, they return right away and delete themselves.
+  thread_pool_->Wait(Thread::Current(), /* do_work */ false, /* may_hold_locks */ false);
+  thread_pool_.reset();
+}
+
+void ClassPreloader::DexFileRegistered(Thread* self,
+                                       const DexFile& dex_file,
+                                       ObjPtr<mirror::ClassLoader> class_loader) {
+  if (class_loader == nullptr || IsShuttingDown()) {
+    return;
+  }
+  {
+    MutexLock mu(self, lock_);
+    if (!queued_dex_files_.insert(&dex_file).second) {
+      return;
+    }
+  }
+  std::set<dex::TypeIndex> classes;
+  std::set<uint16_t> hot_methods;
+  std::set<uint16_t> startup_methods;
+  std::set<uint16_t> post_startup_methods;
+  if (!profile_->GetClassesAndMethods(dex_file,
+                                      &classes,
+                                      &hot_methods,
+                                      &startup_methods,
+                                      &post_startup_methods) ||
+      classes.empty()) {
+    return;
+  }
+  VLOG(class_linker) << "Preloading " << classes.size() << " classes of "
+                     << dex_file.GetLocation();
+  std::shared_ptr<LoaderReference> loader = std::make_shared<LoaderReference>(self, class_loader);
+  std::vector<dex::TypeIndex> type_indexes(classes.begin(), classes.end());
+  for (size_t begin = 0; begin < type_indexes.size(); begin += kClassesPerTask) {
+    size_t end = std::min(begin + kClassesPerTask, type_indexes.size());
+    std::vector<dex::TypeIndex> task_indexes(type_indexes.begin() + begin,
+                                             type_indexes.begin() + end);
+    thread_pool_->AddTask(self, new PreloadTask(this, &dex_file, loader, std::move(task_indexes)));
+  }
+}
+
+void ClassPreloader::PreloadClass(Thread* self,
+                                  const DexFile& dex_file,
+                                  dex::TypeIndex type_index,
+                                  Handle<mirror::ClassLoader> class_loader,
+                                  MutableHandle<mirror::Class> klass) {
+  ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
+  klass.Assign(class_linker->FindClass(self, dex_file.StringByTypeIdx(type_index), class_loader));
+  if (klass == nullptr) {
+    // Either the class is gone, or the class loader chain needs Java code to find it. The first
+    // use of the class will report the error, if any.
+    self->ClearException();
+    failed_.FetchAndAddRelaxed(1u);
+    return;
+  }
+  loaded_.FetchAndAddRelaxed(1u);
+  // Links the superclasses and interfaces and verifies the class, then initializes it if that
+  // runs no code.
+  if (class_linker->EnsureInitialized(self,
+                                      klass,
+                                      /* can_init_fields */ false,
+                                      /* can_init_parents */ true)) {
+    verified_.FetchAndAddRelaxed(1u);
+    initialized_.FetchAndAddRelaxed(1u);
+    return;
+  }
+  if (!self->IsExceptionPending() && !klass->IsVerified()) {
+    class_linker->VerifyClass(self, klass);
+  }
+  if (self->IsExceptionPending() || !klass->IsVerified()) {
+    // Leave it to the first use of the class to throw again.
+    self->ClearException();
+    failed_.FetchAndAddRelaxed(1u);
+    return;
+  }
+  verified_.FetchAndAddRelaxed(1u);
+}
+
+void ClassPreloader::Wait(Thread* self) {
+  thread_pool_->Wait(self, /* do_work */ false, /* may_hold_locks */ false);
+}
+
+void ClassPreloader::Dump(std::ostream& os) {
+  os << "Class preloader: " << thread_pool_->GetThreadCount() << " threads, "
+     << GetLoadedCount() << " loaded, " << GetVerifiedCount() << " verified, "
+     << GetInitializedCount() << " initialized, " << GetFailedCount() << " failed\n";
+}
+
+}  // namespace art
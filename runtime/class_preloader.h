@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_CLASS_PRELOADER_H_
+#define ART_RUNTIME_CLASS_PRELOADER_H_
+
+#include <iosfwd>
+#include <memory>
+#include <set>
+#include <string>
+
+#include "atomic.h"
+#include "base/macros.h"
+#include "base/mutex.h"
+#include "dex_file_types.h"
+#include "handle.h"
+#include "obj_ptr.h"
+
+namespace art {
+
+class DexFile;
+class ProfileCompilationInfo;
+class Thread;
+class ThreadPool;
+
+namespace mirror {
+  class Class;
+  class ClassLoader;
+}  // namespace mirror
+
+// Loads, links and verifies the classes an app used during its previous startups on a pool of
+// worker threads, so that the main thread finds them ready instead of linking them one by one
+// on first use. The classes are those the profile saver recorded in the app's current profile.
+// Work is queued when a dex file of the profile is registered with the class linker.
+//
+// Class initialization must keep the order of the program, so only classes whose initialization
+// has no side effect are initialized ahead: classes without <clinit> nor static values, whose
+// superclasses and default method interfaces have neither. Workers can't call into Java, so
+// classes that the class loader chain can't find natively are left to their first use.
+class ClassPreloader {
+ public:
+  // Number of classes preloaded by one task.
+  static constexpr size_t kClassesPerTask = 16;
+
+  // Returns null and sets error_msg if the profile can't be read or has no class.
+  static std::unique_ptr<ClassPreloader> Create(const std::string& profile_filename,
+                                                size_t num_threads,
+                                                std::string* error_msg);
+
+  ClassPreloader(std::unique_ptr<ProfileCompilationInfo> profile, size_t num_threads);
+
+  // Skips the queued classes and waits for the running tasks.
+  ~ClassPreloader();
+
+  // Queue the profile classes of a dex file the first time it is registered. Dex files of the
+  // boot class path are not preloaded.
+  void DexFileRegistered(Thread* self,
+                         const DexFile& dex_file,
+                         ObjPtr<mirror::ClassLoader> class_loader)
+      REQUIRES_SHARED(Locks::mutator_lock_)
+      REQUIRES(!lock_);
+
+  // Wait for the queued classes to be preloaded.
+  void Wait(Thread* self) REQUIRES(!Locks::mutator_lock_);
+
+  void Dump(std::ostream& os);
+
+  size_t GetLoadedCount() const {
+    return loaded_.LoadRelaxed();
+  }
+
+  size_t GetVerifiedCount() const {
+    return verified_.LoadRelaxed();
+  }
+
+  size_t GetInitializedCount() const {
+    return initialized_.LoadRelaxed();
+  }
+
+  size_t GetFailedCount() const {
+    return failed_.LoadRelaxed();
+  }
+
+ private:
+  class LoaderReference;
+  class PreloadTask;
+
+  void PreloadClass(Thread* self,
+                    const DexFile& dex_file,
+                    dex::TypeIndex type_index,
+                    Handle<mirror::ClassLoader> class_loader,
+                    MutableHandle<mirror::Class> klass)
+      REQUIRES_SHARED(Locks::mutator_lock_);
+
+  bool IsShuttingDown() const {
+    return shutting_down_.LoadRelaxed();
+  }
+
+  const std::unique_ptr<ProfileCompilationInfo> profile_;
+  std::unique_ptr<ThreadPool> thread_pool_;
+  // Set on deletion, the tasks still queued return without preloading.
+  Atomic<bool> shutting_down_;
+
+  Mutex lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  // Dex files whose classes were already queued.
+  std::set<const DexFile*> queued_dex_files_ GUARDED_BY(lock_);
+
+  // Classes found, verified and initialized by the workers, and classes the workers could not
+  // load or that failed verification or initialization.
+  Atomic<size_t> loaded_;
+  Atomic<size_t> verified_;
+  Atomic<size_t> initialized_;
+  Atomic<size_t> failed_;
+
+  DISALLOW_COPY_AND_ASSIGN(ClassPreloader);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_CLASS_PRELOADER_H_
@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "class_preloader.h"
+
+#include <vector>
+
+#include "class_linker.h"
+#include "common_runtime_test.h"
+#include "dex_file.h"
+#include "handle_scope-inl.h"
+#include "jit/profile_compilation_info.h"
+#include "mirror/class-inl.h"
+#include "mirror/class_loader.h"
+#include "scoped_thread_state_change-inl.h"
+
+namespace art {
+
+class ClassPreloaderTest : public CommonRuntimeTest {};
+
+TEST_F(ClassPreloaderTest, PreloadsProfileClasses) {
+  Thread* self = Thread::Current();
+  jobject jclass_loader;
+  std::unique_ptr<ClassPreloader> preloader;
+  {
+    ScopedObjectAccess soa(self);
+    jclass_loader = LoadDex("Interfaces");
+    std::vector<const DexFile*> dex_files = GetDexFiles(jclass_loader);
+    ASSERT_EQ(dex_files.size(), 1u);
+    const DexFile* dex_file = dex_files[0];
+    std::vector<dex::TypeIndex> classes;
+    for (const char* descriptor : {"LInterfaces$A;", "LInterfaces$J;"}) {
+      const DexFile::TypeId* type_id = dex_file->FindTypeId(descriptor);
+      ASSERT_TRUE(type_id != nullptr) << descriptor;
+      classes.push_back(dex_file->GetIndexForTypeId(*type_id));
+    }
+    std::unique_ptr<ProfileCompilationInfo> profile(new ProfileCompilationInfo());
+    ASSERT_TRUE(profile->AddClassesForDex(dex_file, classes.begin(), classes.end()));
+    preloader.reset(new ClassPreloader(std::move(profile), /* num_threads */ 2));
+
+    ObjPtr<mirror::ClassLoader> class_loader = soa.Decode<mirror::ClassLoader>(jclass_loader);
+    preloader->DexFileRegistered(self, *dex_file, class_loader);
+    // The classes are only queued once.
+    preloader->DexFileRegistered(self, *dex_file, class_loader);
+  }
+  preloader->Wait(self);
+  EXPECT_EQ(preloader->GetLoadedCount(), 2u);
+  EXPECT_EQ(preloader->GetVerifiedCount(), 2u);
+  EXPECT_EQ(preloader->GetFailedCount(), 0u);
+  // Interfaces$J has a static value, only Interfaces$A can be initialized ahead.
+  EXPECT_EQ(preloader->GetInitializedCount(), 1u);
+
+  ScopedObjectAccess soa(self);
+  ObjPtr<mirror::ClassLoader> class_loader = soa.Decode<mirror::ClassLoader>(jclass_loader);
+  ObjPtr<mirror::Class> a = class_linker_->LookupClass(self, "LInterfaces$A;", class_loader);
+  ASSERT_TRUE(a != nullptr);
+  EXPECT_TRUE(a->IsInitialized());
+  ObjPtr<mirror::Class> j = class_linker_->LookupClass(self, "LInterfaces$J;", class_loader);
+  ASSERT_TRUE(j != nullptr);
+  EXPECT_TRUE(j->IsVerified());
+  EXPECT_FALSE(j->IsInitialized());
+  // Classes not in the profile are left to their first use.
+  EXPECT_TRUE(class_linker_->LookupClass(self, "LInterfaces$B;", class_loader) == nullptr);
+}
+
+TEST_F(ClassPreloaderTest, IgnoresBootClassPath) {
+  Thread* self = Thread::Current();
+  const DexFile* dex_file = java_lang_dex_file_;
+  std::vector<dex::TypeIndex> classes;
+  const DexFile::TypeId* type_id = dex_file->FindTypeId("Ljava/lang/Object;");
+  ASSERT_TRUE(type_id != nullptr);
+  classes.push_back(dex_file->GetIndexForTypeId(*type_id));
+  std::unique_ptr<ProfileCompilationInfo> profile(new ProfileCompilationInfo());
+  ASSERT_TRUE(profile->AddClassesForDex(dex_file, classes.begin(), classes.end()));
+  ClassPreloader preloader(std::move(profile), /* num_threads */ 1);
+  {
+    ScopedObjectAccess soa(self);
+    preloader.DexFileRegistered(self, *dex_file, /* class_loader */ nullptr);
+  }
+  preloader.Wait(self);
+  EXPECT_EQ(preloader.GetLoadedCount(), 0u);
+  EXPECT_EQ(preloader.GetFailedCount(), 0u);
+}
+
+}  // namespace art
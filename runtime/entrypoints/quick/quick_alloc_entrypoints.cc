@@ -127,6 +127,20 @@ GENERATE_ENTRYPOINTS_FOR_ALLOCATOR(TLAB, gc::kAllocatorTypeTLAB)
 GENERATE_ENTRYPOINTS_FOR_ALLOCATOR(Region, gc::kAllocatorTypeRegion)
 GENERATE_ENTRYPOINTS_FOR_ALLOCATOR(RegionTLAB, gc::kAllocatorTypeRegionTLAB)
 
+// Allocations of the pretenured sites, see gc::AllocationSiteTracker. Unlike the entrypoints
+// above these do not depend on the current allocator.
+#define GENERATE_NON_MOVING_ENTRYPOINT(suffix, instrumented_bool) \
+extern "C" mirror::Object* artAllocObjectFromCodeNonMoving##suffix( \
+    mirror::Class* klass, Thread* self) \
+    REQUIRES_SHARED(Locks::mutator_lock_) { \
+  ScopedQuickEntrypointChecks sqec(self); \
+  return AllocObjectFromCode<instrumented_bool>( \
+      klass, self, Runtime::Current()->GetHeap()->GetPretenureAllocator()); \
+}
+
+GENERATE_NON_MOVING_ENTRYPOINT(Instrumented, true)
+GENERATE_NON_MOVING_ENTRYPOINT(, false)
+
 #define GENERATE_ENTRYPOINTS(suffix) \
 extern "C" void* art_quick_alloc_array_resolved##suffix(mirror::Class* klass, int32_t); \
 extern "C" void* art_quick_alloc_array_resolved8##suffix(mirror::Class* klass, int32_t); \
@@ -180,6 +194,8 @@ void SetQuickAllocEntryPoints##suffix(QuickEntryPoints* qpoints, bool instrument
 
 // Generate the entrypoint functions.
 #if !defined(__APPLE__) || !defined(__LP64__)
+extern "C" void* art_quick_alloc_object_non_moving(mirror::Class* klass);
+extern "C" void* art_quick_alloc_object_non_moving_instrumented(mirror::Class* klass);
 GENERATE_ENTRYPOINTS(_dlmalloc)
 GENERATE_ENTRYPOINTS(_rosalloc)
 GENERATE_ENTRYPOINTS(_bump_pointer)
@@ -201,6 +217,9 @@ void SetQuickAllocEntryPointsInstrumented(bool instrumented) {
 
 void ResetQuickAllocEntryPoints(QuickEntryPoints* qpoints, bool is_marking) {
 #if !defined(__APPLE__) || !defined(__LP64__)
+  qpoints->pAllocObjectNonMoving = entry_points_instrumented
+      ? art_quick_alloc_object_non_moving_instrumented
+      : art_quick_alloc_object_non_moving;
   switch (entry_points_allocator) {
     case gc::kAllocatorTypeDlMalloc: {
       SetQuickAllocEntryPoints_dlmalloc(qpoints, entry_points_instrumented);
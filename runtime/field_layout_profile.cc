@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "field_layout_profile.h"
+
+#include <stdlib.h>
+#include <zlib.h>
+
+#include <sstream>
+
+#include "android-base/stringprintf.h"
+
+#include "utils.h"
+
+namespace art {
+
+using android::base::StringPrintf;
+
+constexpr size_t FieldLayoutProfile::kHotFieldBytes;
+
+std::unique_ptr<FieldLayoutProfile> FieldLayoutProfile::Create(const std::string& filename,
+                                                               std::string* error_msg) {
+  std::string contents;
+  if (!ReadFileToString(filename, &contents)) {
+    *error_msg = StringPrintf("Failed to read field layout profile '%s'", filename.c_str());
+    return nullptr;
+  }
+  std::unique_ptr<FieldLayoutProfile> profile = Parse(contents, error_msg);
+  if (profile == nullptr) {
+    *error_msg = StringPrintf("%s: %s", filename.c_str(), error_msg->c_str());
+  }
+  return profile;
+}
+
+std::unique_ptr<FieldLayoutProfile> FieldLayoutProfile::Parse(const std::string& contents,
+                                                              std::string* error_msg) {
+  std::unique_ptr<FieldLayoutProfile> profile(new FieldLayoutProfile());
+  std::istringstream in(contents);
+  std::string line;
+  for (size_t line_number = 1; std::getline(in, line); ++line_number) {
+    std::istringstream fields(line);
+    std::string field;
+    if (!(fields >> field) || field[0] == '#') {
+      continue;
+    }
+    std::string count_string;
+    std::string extra;
+    size_t separator = field.find("->");
+    if (separator == std::string::npos ||
+        separator == 0u ||
+        separator + 2 == field.size() ||
+        !(fields >> count_string) ||
+        (fields >> extra)) {
+      *error_msg = StringPrintf("Malformed field layout profile line %zu: '%s'",
+                                line_number,
+                                line.c_str());
+      return nullptr;
+    }
+    char* end;
+    uint64_t count = strtoull(count_string.c_str(), &end, 10);
+    if (*end != '\0' || count_string[0] == '-') {
+      *error_msg = StringPrintf("Invalid access count on field layout profile line %zu: '%s'",
+                                line_number,
+                                count_string.c_str());
+      return nullptr;
+    }
+    std::string descriptor = field.substr(0, separator);
+    std::string name = field.substr(separator + 2);
+    auto class_it = profile->classes_.lower_bound(descriptor);
+    if (class_it == profile->classes_.end() || class_it->first != descriptor) {
+      class_it = profile->classes_.PutBefore(class_it, descriptor, FieldCounts());
+    }
+    FieldCounts& counts = class_it->second;
+    auto it = counts.find(name);
+    if (it == counts.end()) {
+      counts.Put(name, count);
+      ++profile->num_fields_;
+    } else {
+      it->second += count;
+    }
+  }
+  uint32_t checksum = adler32(adler32(0L, Z_NULL, 0),
+                              reinterpret_cast<const Bytef*>(contents.data()),
+                              contents.size());
+  profile->checksum_ = StringPrintf("%08x", checksum);
+  return profile;
+}
+
+const FieldLayoutProfile::FieldCounts* FieldLayoutProfile::FindClass(
+    const char* descriptor) const {
+  auto it = classes_.find(descriptor);
+  return it != classes_.end() ? &it->second : nullptr;
+}
+
+}  // namespace art
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_FIELD_LAYOUT_PROFILE_H_
+#define ART_RUNTIME_FIELD_LAYOUT_PROFILE_H_
+
+#include <memory>
+#include <string>
+
+#include "base/macros.h"
+#include "safe_map.h"
+
+namespace art {
+
+// Instance field access counts used by the class linker to lay out hot fields first. The profile
+// is a text file with one field per line, "<class descriptor>-><field name> <count>", for example
+// "Ljava/util/HashMap$Node;->next 1200". Blank lines and lines starting with '#' are ignored and
+// the counts of repeated fields are added up.
+//
+// Field offsets are baked into compiled code, so oat files record the checksum of the profile
+// they were compiled with and are only used by a runtime with the same profile.
+class FieldLayoutProfile {
+ public:
+  // Access counts of the fields of a class, keyed by field name.
+  using FieldCounts = SafeMap<std::string, uint64_t>;
+
+  // Size of the hot fields laid out first in each class, one cache line.
+  static constexpr size_t kHotFieldBytes = 64;
+
+  static std::unique_ptr<FieldLayoutProfile> Create(const std::string& filename,
+                                                    std::string* error_msg);
+  static std::unique_ptr<FieldLayoutProfile> Parse(const std::string& contents,
+                                                   std::string* error_msg);
+
+  // Returns null if no field of the class is in the profile.
+  const FieldCounts* FindClass(const char* descriptor) const;
+
+  const std::string& GetChecksum() const {
+    return checksum_;
+  }
+
+  size_t GetNumberOfFields() const {
+    return num_fields_;
+  }
+
+ private:
+  FieldLayoutProfile() : num_fields_(0u) {}
+
+  SafeMap<std::string, FieldCounts> classes_;
+  size_t num_fields_;
+  std::string checksum_;
+
+  DISALLOW_COPY_AND_ASSIGN(FieldLayoutProfile);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_FIELD_LAYOUT_PROFILE_H_
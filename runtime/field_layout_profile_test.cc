@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "field_layout_profile.h"
+
+#include "gtest/gtest.h"
+
+namespace art {
+
+TEST(FieldLayoutProfileTest, Parse) {
+  std::string error_msg;
+  std::unique_ptr<FieldLayoutProfile> profile = FieldLayoutProfile::Parse(
+      "# Sampled field accesses.\n"
+      "LNode;->next 1200\n"
+      "\n"
+      "LNode;->value 300\n"
+      "LNode;->next 34\n"
+      "LOther;->count 7\n",
+      &error_msg);
+  ASSERT_TRUE(profile != nullptr) << error_msg;
+  EXPECT_EQ(profile->GetNumberOfFields(), 3u);
+  const FieldLayoutProfile::FieldCounts* node = profile->FindClass("LNode;");
+  ASSERT_TRUE(node != nullptr);
+  EXPECT_EQ(node->Get("next"), 1234u);
+  EXPECT_EQ(node->Get("value"), 300u);
+  EXPECT_TRUE(profile->FindClass("LMissing;") == nullptr);
+  EXPECT_EQ(profile->GetChecksum().size(), 8u);
+
+  std::unique_ptr<FieldLayoutProfile> other = FieldLayoutProfile::Parse("LNode;->next 1\n",
+                                                                         &error_msg);
+  ASSERT_TRUE(other != nullptr) << error_msg;
+  EXPECT_NE(profile->GetChecksum(), other->GetChecksum());
+}
+
+TEST(FieldLayoutProfileTest, Malformed) {
+  std::string error_msg;
+  EXPECT_TRUE(FieldLayoutProfile::Parse("LNode;.next 1\n", &error_msg) == nullptr);
+  EXPECT_TRUE(FieldLayoutProfile::Parse("LNode;->next\n", &error_msg) == nullptr);
+  EXPECT_TRUE(FieldLayoutProfile::Parse("LNode;->next x\n", &error_msg) == nullptr);
+  EXPECT_TRUE(FieldLayoutProfile::Parse("LNode;->next -1\n", &error_msg) == nullptr);
+  EXPECT_TRUE(FieldLayoutProfile::Parse("LNode;->next 1 2\n", &error_msg) == nullptr);
+  EXPECT_TRUE(FieldLayoutProfile::Parse("->next 1\n", &error_msg) == nullptr);
+  EXPECT_NE(error_msg.find("line 1"), std::string::npos);
+}
+
+}  // namespace art
@@ -18,6 +18,8 @@
 
 #include <sys/mman.h>
 
+#include <algorithm>
+
 #include "base/logging.h"
 #include "base/systrace.h"
 #include "card_table-inl.h"
@@ -36,6 +38,8 @@ constexpr size_t CardTable::kCardShift;
 constexpr size_t CardTable::kCardSize;
 constexpr uint8_t CardTable::kCardClean;
 constexpr uint8_t CardTable::kCardDirty;
+constexpr size_t CardTable::kParallelScanTasksPerThread;
+constexpr size_t CardTable::kMinParallelScanCards;
 
 /*
  * Maintain a card table from the write barrier. All writes of
@@ -113,6 +117,13 @@ void CardTable::ClearCardRange(uint8_t* start, uint8_t* end) {
   ZeroAndReleasePages(start_card, end_card - start_card);
 }
 
+size_t CardTable::ParallelScanChunkSize(size_t address_range, size_t thread_count) {
+  DCHECK_NE(thread_count, 0u);
+  const size_t num_tasks = thread_count * kParallelScanTasksPerThread;
+  const size_t chunk_size = RoundUp(address_range / num_tasks + 1, kCardSize);
+  return std::max(chunk_size, kMinParallelScanCards * kCardSize);
+}
+
 bool CardTable::AddrIsInCardTable(const void* addr) const {
   return IsValidCard(biased_begin_ + ((uintptr_t)addr >> kCardShift));
 }
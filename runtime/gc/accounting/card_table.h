@@ -52,6 +52,11 @@ class CardTable {
   static constexpr uint8_t kCardClean = 0x0;
   static constexpr uint8_t kCardDirty = 0x70;
   static constexpr uint8_t kCardAged = kCardDirty - 1;
+  // Parallel card scanning hands out about this many ranges per thread, so that a thread whose
+  // range has few dirty cards takes more work from the pool instead of waiting for the others.
+  static constexpr size_t kParallelScanTasksPerThread = 4;
+  // Smallest number of cards worth a task of its own.
+  static constexpr size_t kMinParallelScanCards = 256;
 
   static CardTable* Create(const uint8_t* heap_begin, size_t heap_capacity);
   ~CardTable();
@@ -115,6 +120,10 @@ class CardTable {
       REQUIRES(Locks::heap_bitmap_lock_)
       REQUIRES_SHARED(Locks::mutator_lock_);
 
+  // Returns how many bytes of heap each task covers when address_range bytes of heap are scanned
+  // with thread_count threads. The result is a multiple of kCardSize.
+  static size_t ParallelScanChunkSize(size_t address_range, size_t thread_count);
+
   // Assertion used to check the given address is covered by the card table
   void CheckAddrIsInCardTable(const uint8_t* addr) const;
 
@@ -16,6 +16,7 @@
 
 #include "mod_union_table.h"
 
+#include <algorithm>
 #include <memory>
 
 #include "base/stl_util.h"
@@ -30,11 +31,60 @@
 #include "object_callbacks.h"
 #include "space_bitmap-inl.h"
 #include "thread-current-inl.h"
+#include "thread_pool.h"
 
 namespace art {
 namespace gc {
 namespace accounting {
 
+// Runs a visitor over one [begin, end) range of indices on a thread pool worker.
+template <typename Visitor>
+class ModUnionChunkTask : public Task {
+ public:
+  ModUnionChunkTask(const Visitor* visitor, size_t begin, size_t end)
+      : visitor_(visitor), begin_(begin), end_(end) {}
+
+  // The workers rely on the thread that started them holding the heap bitmap lock.
+  virtual void Run(Thread* self ATTRIBUTE_UNUSED) OVERRIDE NO_THREAD_SAFETY_ANALYSIS {
+    (*visitor_)(begin_, end_);
+  }
+
+  virtual void Finalize() OVERRIDE {
+    delete this;
+  }
+
+ private:
+  const Visitor* const visitor_;
+  const size_t begin_;
+  const size_t end_;
+};
+
+// Splits [0, count) into ranges starting at multiples of granularity and visits them on the
+// thread pool, with the calling thread helping. Small counts are visited on the calling thread.
+template <typename Visitor>
+static void VisitChunksInParallel(ThreadPool* thread_pool,
+                                  size_t thread_count,
+                                  size_t count,
+                                  size_t granularity,
+                                  const Visitor& visitor) {
+  const size_t num_tasks = thread_count * CardTable::kParallelScanTasksPerThread;
+  const size_t chunk_size = RoundUp(
+      std::max(count / num_tasks + 1, CardTable::kMinParallelScanCards), granularity);
+  if (thread_pool == nullptr || thread_count <= 1 || count <= chunk_size) {
+    visitor(0, count);
+    return;
+  }
+  Thread* self = Thread::Current();
+  for (size_t begin = 0; begin < count; begin += chunk_size) {
+    thread_pool->AddTask(
+        self, new ModUnionChunkTask<Visitor>(&visitor, begin, std::min(begin + chunk_size, count)));
+  }
+  thread_pool->SetMaxActiveWorkers(thread_count - 1);
+  thread_pool->StartWorkers(self);
+  thread_pool->Wait(self, true, true);
+  thread_pool->StopWorkers(self);
+}
+
 class ModUnionAddToCardSetVisitor {
  public:
   explicit ModUnionAddToCardSetVisitor(ModUnionTable::CardSet* const cleared_cards)
@@ -409,7 +459,74 @@ void ModUnionTableReferenceCache::VisitObjects(ObjectCallback callback, void* ar
   }
 }
 
+// Marks the cached references of a card. Returns true if all of them are null.
+static bool MarkCardReferences(MarkObjectVisitor* visitor,
+                               std::vector<mirror::HeapReference<mirror::Object>*>* references)
+    REQUIRES_SHARED(Locks::mutator_lock_) {
+  // Since there is no card mark for setting a reference to null, we check each reference.
+  // If all of the references of a card are null then we can remove that card. This is racy
+  // with the mutators, but handled by rescanning dirty cards.
+  bool all_null = true;
+  for (mirror::HeapReference<mirror::Object>* obj_ptr : *references) {
+    if (obj_ptr->AsMirrorPtr() != nullptr) {
+      all_null = false;
+      visitor->MarkHeapReference(obj_ptr, /*do_atomic_update*/ false);
+    }
+  }
+  return all_null;
+}
+
 void ModUnionTableReferenceCache::UpdateAndMarkReferences(MarkObjectVisitor* visitor) {
+  UpdateClearedCards(visitor);
+  size_t count = 0;
+  for (auto it = references_.begin(); it != references_.end();) {
+    std::vector<mirror::HeapReference<mirror::Object>*>& references = it->second;
+    count += references.size();
+    if (!MarkCardReferences(visitor, &references)) {
+      ++it;
+    } else {
+      // All null references, erase the array from the set.
+      it = references_.erase(it);
+    }
+  }
+  if (VLOG_IS_ON(heap)) {
+    VLOG(gc) << "Marked " << count << " references in mod union table";
+  }
+}
+
+void ModUnionTableReferenceCache::UpdateAndMarkReferencesParallel(MarkObjectVisitor* visitor,
+                                                                  ThreadPool* thread_pool,
+                                                                  size_t thread_count) {
+  // Rescanning the cleared cards changes references_, so it stays on this thread. Marking through
+  // the cached references of all the other cards is the bulk of the work.
+  UpdateClearedCards(visitor);
+  std::vector<decltype(references_)::iterator> entries;
+  entries.reserve(references_.size());
+  for (auto it = references_.begin(); it != references_.end(); ++it) {
+    entries.push_back(it);
+  }
+  // One byte per entry so that threads never write to the same location.
+  std::vector<uint8_t> all_null(entries.size(), 0u);
+  auto mark_entries = [visitor, &entries, &all_null](size_t begin, size_t end)
+      REQUIRES_SHARED(Locks::mutator_lock_) {
+    for (size_t i = begin; i < end; ++i) {
+      all_null[i] = MarkCardReferences(visitor, &entries[i]->second) ? 1u : 0u;
+    }
+  };
+  VisitChunksInParallel(thread_pool, thread_count, entries.size(), 1u, mark_entries);
+  size_t count = 0;
+  for (size_t i = 0; i < entries.size(); ++i) {
+    count += entries[i]->second.size();
+    if (all_null[i] != 0u) {
+      references_.erase(entries[i]);
+    }
+  }
+  if (VLOG_IS_ON(heap)) {
+    VLOG(gc) << "Marked " << count << " references in mod union table";
+  }
+}
+
+void ModUnionTableReferenceCache::UpdateClearedCards(MarkObjectVisitor* visitor) {
   CardTable* const card_table = heap_->GetCardTable();
   std::vector<mirror::HeapReference<mirror::Object>*> cards_references;
   // If has_target_reference is true then there was a GcRoot compressed reference which wasn't
@@ -451,30 +568,6 @@ void ModUnionTableReferenceCache::UpdateAndMarkReferences(MarkObjectVisitor* vis
     }
   }
   cleared_cards_ = std::move(new_cleared_cards);
-  size_t count = 0;
-  for (auto it = references_.begin(); it != references_.end();) {
-    std::vector<mirror::HeapReference<mirror::Object>*>& references = it->second;
-    // Since there is no card mark for setting a reference to null, we check each reference.
-    // If all of the references of a card are null then we can remove that card. This is racy
-    // with the mutators, but handled by rescanning dirty cards.
-    bool all_null = true;
-    for (mirror::HeapReference<mirror::Object>* obj_ptr : references) {
-      if (obj_ptr->AsMirrorPtr() != nullptr) {
-        all_null = false;
-        visitor->MarkHeapReference(obj_ptr, /*do_atomic_update*/ false);
-      }
-    }
-    count += references.size();
-    if (!all_null) {
-      ++it;
-    } else {
-      // All null references, erase the array from the set.
-      it = references_.erase(it);
-    }
-  }
-  if (VLOG_IS_ON(heap)) {
-    VLOG(gc) << "Marked " << count << " references in mod union table";
-  }
 }
 
 ModUnionTableCardCache::ModUnionTableCardCache(const std::string& name,
@@ -551,6 +644,25 @@ void ModUnionTableCardCache::UpdateAndMarkReferences(MarkObjectVisitor* visitor)
       0, RoundUp(space_->Size(), CardTable::kCardSize) / CardTable::kCardSize, bit_visitor);
 }
 
+void ModUnionTableCardCache::UpdateAndMarkReferencesParallel(MarkObjectVisitor* visitor,
+                                                             ThreadPool* thread_pool,
+                                                             size_t thread_count) {
+  space::ImageSpace* image_space =
+      heap_->GetBootImageSpaces().empty() ? nullptr : heap_->GetBootImageSpaces()[0];
+  CardBitVisitor bit_visitor(visitor, space_, image_space != nullptr ? image_space : space_,
+      card_bitmap_.get());
+  // CardBitVisitor clears bits non atomically, so no two threads may visit bits of the same
+  // bitmap word.
+  auto visit_bits = [this, &bit_visitor](size_t begin, size_t end) {
+    card_bitmap_->VisitSetBits(begin, end, bit_visitor);
+  };
+  VisitChunksInParallel(thread_pool,
+                        thread_count,
+                        RoundUp(space_->Size(), CardTable::kCardSize) / CardTable::kCardSize,
+                        kBitsPerIntPtrT,
+                        visit_bits);
+}
+
 void ModUnionTableCardCache::VisitObjects(ObjectCallback callback, void* arg) {
   card_bitmap_->VisitSetBits(
       0,
@@ -34,6 +34,7 @@ class Object;
 }  // namespace mirror
 
 class MarkObjectVisitor;
+class ThreadPool;
 
 namespace gc {
 namespace space {
@@ -78,6 +79,15 @@ class ModUnionTable {
   // references to other spaces which are stored in the mod-union table.
   virtual void UpdateAndMarkReferences(MarkObjectVisitor* visitor) = 0;
 
+  // Same as UpdateAndMarkReferences, but splits the work in chunks run on the thread pool by up
+  // to thread_count threads, the calling thread included. The visitor must be safe to call from
+  // several threads at once. Tables that can't be split fall back to UpdateAndMarkReferences.
+  virtual void UpdateAndMarkReferencesParallel(MarkObjectVisitor* visitor,
+                                               ThreadPool* thread_pool ATTRIBUTE_UNUSED,
+                                               size_t thread_count ATTRIBUTE_UNUSED) {
+    UpdateAndMarkReferences(visitor);
+  }
+
   // Visit all of the objects that may contain references to other spaces.
   virtual void VisitObjects(ObjectCallback callback, void* arg) = 0;
 
@@ -131,6 +141,13 @@ class ModUnionTableReferenceCache : public ModUnionTable {
       REQUIRES_SHARED(Locks::mutator_lock_)
       REQUIRES(Locks::heap_bitmap_lock_);
 
+  // Rescans the cleared cards on the calling thread, then marks the cached references in parallel.
+  void UpdateAndMarkReferencesParallel(MarkObjectVisitor* visitor,
+                                       ThreadPool* thread_pool,
+                                       size_t thread_count) OVERRIDE
+      REQUIRES_SHARED(Locks::mutator_lock_)
+      REQUIRES(Locks::heap_bitmap_lock_);
+
   virtual void VisitObjects(ObjectCallback callback, void* arg) OVERRIDE
       REQUIRES(Locks::heap_bitmap_lock_)
       REQUIRES_SHARED(Locks::mutator_lock_);
@@ -153,6 +170,11 @@ class ModUnionTableReferenceCache : public ModUnionTable {
   virtual void ClearTable() OVERRIDE;
 
  protected:
+  // Recompute the cached references of the cleared cards.
+  void UpdateClearedCards(MarkObjectVisitor* visitor)
+      REQUIRES_SHARED(Locks::mutator_lock_)
+      REQUIRES(Locks::heap_bitmap_lock_);
+
   // Cleared card array, used to update the mod-union table.
   ModUnionTable::CardSet cleared_cards_;
 
@@ -178,6 +200,13 @@ class ModUnionTableCardCache : public ModUnionTable {
       REQUIRES(Locks::heap_bitmap_lock_)
       REQUIRES_SHARED(Locks::mutator_lock_);
 
+  // Each thread visits ranges of the card bitmap starting at bitmap word boundaries.
+  virtual void UpdateAndMarkReferencesParallel(MarkObjectVisitor* visitor,
+                                               ThreadPool* thread_pool,
+                                               size_t thread_count) OVERRIDE
+      REQUIRES(Locks::heap_bitmap_lock_)
+      REQUIRES_SHARED(Locks::mutator_lock_);
+
   virtual void VisitObjects(ObjectCallback callback, void* arg) OVERRIDE
       REQUIRES(Locks::heap_bitmap_lock_)
       REQUIRES_SHARED(Locks::mutator_lock_);
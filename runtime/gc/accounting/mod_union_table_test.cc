@@ -23,6 +23,7 @@
 #include "space_bitmap-inl.h"
 #include "thread-current-inl.h"
 #include "thread_list.h"
+#include "thread_pool.h"
 
 namespace art {
 namespace gc {
@@ -65,6 +66,8 @@ class ModUnionTableTest : public CommonRuntimeTest {
     java_lang_object_array_ = nullptr;
   }
   void RunTest(ModUnionTableFactory::TableType type);
+  // Checks that UpdateAndMarkReferencesParallel marks the same objects for any thread count.
+  void RunParallelTest(ModUnionTableFactory::TableType type);
 
  private:
   mirror::Class* GetObjectArrayClass(Thread* self, space::ContinuousMemMapAllocSpace* space)
@@ -114,6 +117,34 @@ class CollectVisitedVisitor : public MarkObjectVisitor {
   std::set<mirror::Object*>* const out_;
 };
 
+// Marks objects in a bitmap from several threads at once and counts the newly marked ones, like
+// a parallel collector would.
+class AtomicMarkVisitor : public MarkObjectVisitor {
+ public:
+  explicit AtomicMarkVisitor(ContinuousSpaceBitmap* bitmap) : bitmap_(bitmap), marked_(0) {}
+  virtual void MarkHeapReference(mirror::HeapReference<mirror::Object>* ref,
+                                 bool do_atomic_update ATTRIBUTE_UNUSED) OVERRIDE
+      REQUIRES_SHARED(Locks::mutator_lock_) {
+    DCHECK(ref != nullptr);
+    MarkObject(ref->AsMirrorPtr());
+  }
+  virtual mirror::Object* MarkObject(mirror::Object* obj) OVERRIDE
+      REQUIRES_SHARED(Locks::mutator_lock_) {
+    DCHECK(obj != nullptr);
+    if (bitmap_->HasAddress(obj) && !bitmap_->AtomicTestAndSet(obj)) {
+      marked_.FetchAndAddRelaxed(1);
+    }
+    return obj;
+  }
+  size_t GetMarked() const {
+    return marked_.LoadRelaxed();
+  }
+
+ private:
+  ContinuousSpaceBitmap* const bitmap_;
+  Atomic<size_t> marked_;
+};
+
 // A mod union table that only holds references to a specified target space.
 class ModUnionTableRefCacheToSpace : public ModUnionTableReferenceCache {
  public:
@@ -174,6 +205,14 @@ TEST_F(ModUnionTableTest, TestReferenceCache) {
   RunTest(ModUnionTableFactory::kTableTypeReferenceCache);
 }
 
+TEST_F(ModUnionTableTest, ParallelUpdateCardCache) {
+  RunParallelTest(ModUnionTableFactory::kTableTypeCardCache);
+}
+
+TEST_F(ModUnionTableTest, ParallelUpdateReferenceCache) {
+  RunParallelTest(ModUnionTableFactory::kTableTypeReferenceCache);
+}
+
 void ModUnionTableTest::RunTest(ModUnionTableFactory::TableType type) {
   Thread* const self = Thread::Current();
   ScopedObjectAccess soa(self);
@@ -264,6 +303,56 @@ void ModUnionTableTest::RunTest(ModUnionTableFactory::TableType type) {
   heap->RemoveSpace(other_space.get());
 }
 
+void ModUnionTableTest::RunParallelTest(ModUnionTableFactory::TableType type) {
+  static constexpr size_t kNumObjects = 4096;
+  static constexpr size_t kNumTargets = 512;
+  static constexpr size_t kComponentCount = 64;
+  static constexpr size_t kMaxThreads = 4;
+  Thread* const self = Thread::Current();
+  ThreadPool thread_pool("Mod union test thread pool", kMaxThreads - 1);
+  ScopedObjectAccess soa(self);
+  gc::Heap* const heap = Runtime::Current()->GetHeap();
+  auto* space = heap->GetNonMovingSpace();
+  ResetClass();
+  std::unique_ptr<space::DlMallocSpace> other_space(space::DlMallocSpace::Create(
+      "other space", 1 * MB, 8 * MB, 8 * MB, nullptr, false));
+  ASSERT_TRUE(other_space.get() != nullptr);
+  {
+    ScopedThreadSuspension sts(self, kSuspended);
+    ScopedSuspendAll ssa("Add image space");
+    heap->AddSpace(other_space.get());
+  }
+  std::unique_ptr<ModUnionTable> table(ModUnionTableFactory::Create(
+      type, space, other_space.get()));
+  ASSERT_TRUE(table.get() != nullptr);
+  std::vector<mirror::ObjectArray<mirror::Object>*> targets;
+  for (size_t i = 0; i < kNumTargets; ++i) {
+    auto* target = AllocObjectArray(self, other_space.get(), 1);
+    ASSERT_TRUE(target != nullptr);
+    targets.push_back(target);
+  }
+  for (size_t i = 0; i < kNumObjects; ++i) {
+    auto* obj = AllocObjectArray(self, space, kComponentCount);
+    ASSERT_TRUE(obj != nullptr);
+    for (size_t j = 0; j < kComponentCount; ++j) {
+      obj->Set(j, targets[(i * kComponentCount + j) % kNumTargets]);
+    }
+  }
+  table->ProcessCards();
+  ContinuousSpaceBitmap* const mark_bitmap = other_space->GetMarkBitmap();
+  for (size_t thread_count = 1; thread_count <= kMaxThreads; thread_count *= 2) {
+    // Make every card of the space go through the table again.
+    table->SetCards();
+    mark_bitmap->Clear();
+    AtomicMarkVisitor visitor(mark_bitmap);
+    table->UpdateAndMarkReferencesParallel(&visitor, &thread_pool, thread_count);
+    EXPECT_EQ(visitor.GetMarked(), kNumTargets) << type << " with " << thread_count << " threads";
+  }
+  ScopedThreadSuspension sts(self, kSuspended);
+  ScopedSuspendAll ssa("Add image space");
+  heap->RemoveSpace(other_space.get());
+}
+
 }  // namespace accounting
 }  // namespace gc
 }  // namespace art
@@ -21,6 +21,10 @@
 
 #include <memory>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
 #include "atomic.h"
 #include "base/bit_utils.h"
 #include "base/logging.h"
@@ -61,6 +65,39 @@ inline bool SpaceBitmap<kAlignment>::Test(const mirror::Object* obj) const {
   return (bitmap_begin_[OffsetToIndex(offset)].LoadRelaxed() & OffsetToMask(offset)) != 0;
 }
 
+template<size_t kAlignment>
+inline bool SpaceBitmap<kAlignment>::BlockIsEmpty(const Atomic<uintptr_t>* words) {
+#if defined(__AVX2__)
+  const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(words));
+  return _mm256_testz_si256(block, block) != 0;
+#else
+  // Or the words together without branching, which compilers turn into vector code where the
+  // target has it.
+  uintptr_t bits = 0;
+  for (size_t i = 0; i < kBlockWords; ++i) {
+    bits |= words[i].LoadRelaxed();
+  }
+  return bits == 0;
+#endif
+}
+
+template<size_t kAlignment>
+inline bool SpaceBitmap<kAlignment>::BlockHasGarbage(const Atomic<uintptr_t>* live,
+                                                     const Atomic<uintptr_t>* mark) {
+#if defined(__AVX2__)
+  const __m256i live_block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(live));
+  const __m256i mark_block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(mark));
+  // testc sets the carry iff (~mark & live) is zero.
+  return _mm256_testc_si256(mark_block, live_block) == 0;
+#else
+  uintptr_t garbage = 0;
+  for (size_t i = 0; i < kBlockWords; ++i) {
+    garbage |= live[i].LoadRelaxed() & ~mark[i].LoadRelaxed();
+  }
+  return garbage != 0;
+#endif
+}
+
 template<size_t kAlignment> template<typename Visitor>
 inline void SpaceBitmap<kAlignment>::VisitMarkedRange(uintptr_t visit_begin,
                                                       uintptr_t visit_end,
@@ -117,6 +154,14 @@ inline void SpaceBitmap<kAlignment>::VisitMarkedRange(uintptr_t visit_begin,
 
     // Traverse the middle, full part.
     for (size_t i = index_start + 1; i < index_end; ++i) {
+      // Skip the empty blocks.
+      while (i % kBlockWords == 0 && i + kBlockWords <= index_end &&
+             BlockIsEmpty(&bitmap_begin_[i])) {
+        i += kBlockWords;
+      }
+      if (i >= index_end) {
+        break;
+      }
       uintptr_t w = bitmap_begin_[i].LoadRelaxed();
       if (w != 0) {
         const uintptr_t ptr_base = IndexToOffset(i) + heap_begin_;
@@ -163,6 +208,13 @@ void SpaceBitmap<kAlignment>::Walk(Visitor&& visitor) {
   uintptr_t end = OffsetToIndex(HeapLimit() - heap_begin_ - 1);
   Atomic<uintptr_t>* bitmap_begin = bitmap_begin_;
   for (uintptr_t i = 0; i <= end; ++i) {
+    // Skip the empty blocks.
+    while (i % kBlockWords == 0 && i + kBlockWords <= end + 1 && BlockIsEmpty(&bitmap_begin[i])) {
+      i += kBlockWords;
+    }
+    if (i > end) {
+      break;
+    }
     uintptr_t w = bitmap_begin[i].LoadRelaxed();
     if (w != 0) {
       uintptr_t ptr_base = IndexToOffset(i) + heap_begin_;
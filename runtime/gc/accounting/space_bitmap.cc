@@ -16,6 +16,8 @@
 
 #include "space_bitmap-inl.h"
 
+#include <string.h>
+
 #include "android-base/stringprintf.h"
 
 #include "art_field-inl.h"
@@ -127,8 +129,12 @@ void SpaceBitmap<kAlignment>::ClearRange(const mirror::Object* begin, const mirr
   }
   const uintptr_t start_index = OffsetToIndex(begin_offset);
   const uintptr_t end_index = OffsetToIndex(end_offset);
-  ZeroAndReleasePages(reinterpret_cast<uint8_t*>(&bitmap_begin_[start_index]),
-                      (end_index - start_index) * sizeof(*bitmap_begin_));
+  const size_t clear_bytes = (end_index - start_index) * sizeof(*bitmap_begin_);
+  if (clear_bytes < kMinMadviseClearBytes) {
+    memset(&bitmap_begin_[start_index], 0, clear_bytes);
+  } else {
+    ZeroAndReleasePages(reinterpret_cast<uint8_t*>(&bitmap_begin_[start_index]), clear_bytes);
+  }
 }
 
 template<size_t kAlignment>
@@ -177,6 +183,14 @@ void SpaceBitmap<kAlignment>::SweepWalk(const SpaceBitmap<kAlignment>& live_bitm
   Atomic<uintptr_t>* live = live_bitmap.bitmap_begin_;
   Atomic<uintptr_t>* mark = mark_bitmap.bitmap_begin_;
   for (size_t i = start; i <= end; i++) {
+    // Skip the blocks where everything live is marked.
+    while (i % kBlockWords == 0 && i + kBlockWords <= end + 1 &&
+           !BlockHasGarbage(&live[i], &mark[i])) {
+      i += kBlockWords;
+    }
+    if (i > end) {
+      break;
+    }
     uintptr_t garbage = live[i].LoadRelaxed() & ~mark[i].LoadRelaxed();
     if (UNLIKELY(garbage != 0)) {
       uintptr_t ptr_base = IndexToOffset(i) + live_bitmap.heap_begin_;
@@ -90,7 +90,7 @@ class SpaceBitmap {
   // Fill the bitmap with zeroes.  Returns the bitmap's memory to the system as a side-effect.
   void Clear();
 
-  // Clear a covered by the bitmap using madvise if possible.
+  // Clear a range covered by the bitmap, using madvise if it is large enough.
   void ClearRange(const mirror::Object* begin, const mirror::Object* end);
 
   bool Test(const mirror::Object* obj) const;
@@ -207,6 +207,21 @@ class SpaceBitmap {
   template<bool kSetBit>
   bool Modify(const mirror::Object* obj);
 
+  // Number of words in a 256-bit block. The scans test whole blocks first so that they can step
+  // over the empty stretches of sparse bitmaps with a single vector compare.
+  static constexpr size_t kBlockWords = 32u / sizeof(uintptr_t);
+
+  // Returns true if none of the kBlockWords words starting at words has a bit set.
+  static bool BlockIsEmpty(const Atomic<uintptr_t>* words) ALWAYS_INLINE;
+
+  // Returns true if a word of the block starting at live has a bit which is not set in mark.
+  static bool BlockHasGarbage(const Atomic<uintptr_t>* live, const Atomic<uintptr_t>* mark)
+      ALWAYS_INLINE;
+
+  // Ranges cleared by ClearRange that are smaller than this are zeroed in place: a memset of a few
+  // pages is cheaper than the madvise and the page faults taken when the bitmap is next written.
+  static constexpr size_t kMinMadviseClearBytes = 16 * kPageSize;
+
   // Backing storage for bitmap.
   std::unique_ptr<MemMap> mem_map_;
 
@@ -207,6 +207,160 @@ TEST_F(SpaceBitmapTest, VisitorPageAlignment) {
   RunTest<kPageSize>();
 }
 
+static constexpr size_t kScanHeapSize = 64 * MB;
+
+// Fills the bitmap with one object every spacing bytes.
+static void SetEvery(ContinuousSpaceBitmap* bitmap, uint8_t* heap_begin, size_t spacing) {
+  for (size_t offset = 0; offset < kScanHeapSize; offset += spacing) {
+    bitmap->Set(reinterpret_cast<mirror::Object*>(heap_begin + offset));
+  }
+}
+
+// Word by word count of the set bits, as the scans did before they skipped empty blocks.
+static size_t CountWordByWord(ContinuousSpaceBitmap* bitmap) {
+  const size_t words = bitmap->Size() / sizeof(intptr_t);
+  size_t count = 0;
+  for (size_t i = 0; i < words; ++i) {
+    uintptr_t w = bitmap->Begin()[i].LoadRelaxed();
+    while (w != 0) {
+      w &= w - 1;
+      ++count;
+    }
+  }
+  return count;
+}
+
+static void SweepCounter(size_t ptr_count, mirror::Object** ptrs ATTRIBUTE_UNUSED, void* arg) {
+  *reinterpret_cast<size_t*>(arg) += ptr_count;
+}
+
+// Checks that VisitMarkedRange and Walk, which skip empty blocks, find the same objects as a word
+// by word scan of the same bitmap.
+static void RunScanTest(size_t spacing) NO_THREAD_SAFETY_ANALYSIS {
+  uint8_t* heap_begin = reinterpret_cast<uint8_t*>(0x10000000);
+  std::unique_ptr<ContinuousSpaceBitmap> bitmap(
+      ContinuousSpaceBitmap::Create("scan bitmap", heap_begin, kScanHeapSize));
+  ASSERT_TRUE(bitmap != nullptr);
+  SetEvery(bitmap.get(), heap_begin, spacing);
+  const size_t expected = kScanHeapSize / spacing;
+
+  EXPECT_EQ(CountWordByWord(bitmap.get()), expected);
+
+  size_t count = 0;
+  bitmap->VisitMarkedRange(reinterpret_cast<uintptr_t>(heap_begin),
+                           reinterpret_cast<uintptr_t>(heap_begin) + kScanHeapSize,
+                           SimpleCounter(&count));
+  EXPECT_EQ(count, expected);
+
+  count = 0;
+  bitmap->Walk(SimpleCounter(&count));
+  EXPECT_EQ(count, expected);
+}
+
+TEST_F(SpaceBitmapTest, ScanSparse) {
+  RunScanTest(64 * KB);
+}
+
+TEST_F(SpaceBitmapTest, ScanDense) {
+  RunScanTest(2 * kObjectAlignment);
+}
+
+// Checks that SweepWalk finds all the garbage when every object is live and one object in
+// garbage_spacing bytes is unmarked.
+static void RunSweepTest(size_t garbage_spacing) {
+  uint8_t* heap_begin = reinterpret_cast<uint8_t*>(0x10000000);
+  std::unique_ptr<ContinuousSpaceBitmap> live(
+      ContinuousSpaceBitmap::Create("live bitmap", heap_begin, kScanHeapSize));
+  std::unique_ptr<ContinuousSpaceBitmap> mark(
+      ContinuousSpaceBitmap::Create("mark bitmap", heap_begin, kScanHeapSize));
+  ASSERT_TRUE(live != nullptr);
+  ASSERT_TRUE(mark != nullptr);
+  SetEvery(live.get(), heap_begin, kObjectAlignment);
+  mark->CopyFrom(live.get());
+  for (size_t offset = 0; offset < kScanHeapSize; offset += garbage_spacing) {
+    mark->Clear(reinterpret_cast<mirror::Object*>(heap_begin + offset));
+  }
+  size_t count = 0;
+  ContinuousSpaceBitmap::SweepWalk(*live,
+                                   *mark,
+                                   reinterpret_cast<uintptr_t>(heap_begin),
+                                   reinterpret_cast<uintptr_t>(heap_begin) + kScanHeapSize,
+                                   &SweepCounter,
+                                   &count);
+  EXPECT_EQ(count, kScanHeapSize / garbage_spacing);
+}
+
+TEST_F(SpaceBitmapTest, SweepSparseGarbage) {
+  RunSweepTest(64 * KB);
+}
+
+TEST_F(SpaceBitmapTest, SweepDenseGarbage) {
+  RunSweepTest(2 * kObjectAlignment);
+}
+
+// Checks SweepWalk over a range that does not start or end on a block boundary.
+TEST_F(SpaceBitmapTest, SweepUnalignedRange) {
+  uint8_t* heap_begin = reinterpret_cast<uint8_t*>(0x10000000);
+  size_t heap_capacity = 16 * MB;
+  std::unique_ptr<ContinuousSpaceBitmap> live(
+      ContinuousSpaceBitmap::Create("live bitmap", heap_begin, heap_capacity));
+  std::unique_ptr<ContinuousSpaceBitmap> mark(
+      ContinuousSpaceBitmap::Create("mark bitmap", heap_begin, heap_capacity));
+  ASSERT_TRUE(live != nullptr);
+  ASSERT_TRUE(mark != nullptr);
+  RandGen r(0x1234);
+  for (int j = 0; j < 10000; ++j) {
+    const mirror::Object* obj = reinterpret_cast<mirror::Object*>(
+        heap_begin + RoundDown(r.next() % heap_capacity, kObjectAlignment));
+    live->Set(obj);
+    if (r.next() % 2 == 1) {
+      mark->Set(obj);
+    }
+  }
+  for (int j = 0; j < 50; ++j) {
+    const size_t offset = RoundDown(r.next() % heap_capacity, kObjectAlignment);
+    const size_t remain = heap_capacity - offset;
+    const size_t end = offset + RoundDown(r.next() % (remain + 1), kObjectAlignment);
+    if (end == offset) {
+      continue;
+    }
+    // SweepWalk sweeps whole words, so count the garbage from the word boundaries.
+    const size_t word_bytes = kObjectAlignment * kBitsPerIntPtrT;
+    size_t manual = 0;
+    for (size_t k = RoundDown(offset, word_bytes); k < RoundUp(end, word_bytes);
+         k += kObjectAlignment) {
+      const mirror::Object* obj = reinterpret_cast<mirror::Object*>(heap_begin + k);
+      if (live->Test(obj) && !mark->Test(obj)) {
+        ++manual;
+      }
+    }
+    size_t count = 0;
+    ContinuousSpaceBitmap::SweepWalk(*live,
+                                     *mark,
+                                     reinterpret_cast<uintptr_t>(heap_begin) + offset,
+                                     reinterpret_cast<uintptr_t>(heap_begin) + end,
+                                     &SweepCounter,
+                                     &count);
+    EXPECT_EQ(count, manual);
+  }
+}
+
+// Checks ClearRange of a region sized range, which is zeroed in place, and of the whole bitmap,
+// which is released with madvise.
+TEST_F(SpaceBitmapTest, ClearRangeSizes) {
+  uint8_t* heap_begin = reinterpret_cast<uint8_t*>(0x10000000);
+  std::unique_ptr<ContinuousSpaceBitmap> bitmap(
+      ContinuousSpaceBitmap::Create("scan bitmap", heap_begin, kScanHeapSize));
+  ASSERT_TRUE(bitmap != nullptr);
+  for (size_t range_size : { 256 * KB, 4 * MB, kScanHeapSize }) {
+    SetEvery(bitmap.get(), heap_begin, kObjectAlignment);
+    bitmap->ClearRange(reinterpret_cast<mirror::Object*>(heap_begin),
+                       reinterpret_cast<mirror::Object*>(heap_begin + range_size));
+    EXPECT_EQ(CountWordByWord(bitmap.get()), (kScanHeapSize - range_size) / kObjectAlignment)
+        << range_size;
+  }
+}
+
 }  // namespace accounting
 }  // namespace gc
 }  // namespace art
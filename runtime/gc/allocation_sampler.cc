@@ -0,0 +1,340 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "allocation_sampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <ostream>
+
+#include "art_method-inl.h"
+#include "base/enums.h"
+#include "base/time_utils.h"
+#include "base/unix_file/fd_file.h"
+#include "gc_root.h"
+#include "handle_scope-inl.h"
+#include "mirror/class-inl.h"
+#include "mirror/object-inl.h"
+#include "os.h"
+#include "stack.h"
+#include "utils.h"
+
+namespace art {
+namespace gc {
+
+constexpr size_t AllocationSampler::kDefaultMaxStackDepth;
+constexpr uint32_t AllocationSampler::kRootNode;
+
+// Sampling points further than this many intervals away are clamped, so that a thread cannot go
+// unsampled for very long because of one unlucky draw.
+static constexpr double kMaxIntervalScale = 20.0;
+
+AllocationSampler::AllocationSampler(size_t sample_interval, size_t max_stack_depth)
+    : sample_interval_(sample_interval),
+      max_stack_depth_(max_stack_depth),
+      random_state_(static_cast<uint64_t>(NanoTime())),
+      lock_("Allocation sampler lock", kAllocTrackerLock),
+      sample_count_(0) {
+  DCHECK_NE(sample_interval_, 0u);
+  nodes_.push_back(StackNode {kRootNode, nullptr, 0u});
+}
+
+size_t AllocationSampler::NextSampleInterval() {
+  // splitmix64 of a shared counter, only sampled allocations get here.
+  uint64_t z = random_state_.FetchAndAddRelaxed(UINT64_C(0x9e3779b97f4a7c15)) +
+      UINT64_C(0x9e3779b97f4a7c15);
+  z = (z ^ (z >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+  z = (z ^ (z >> 27)) * UINT64_C(0x94d049bb133111eb);
+  z = z ^ (z >> 31);
+  // Uniform in (0, 1], then exponentially distributed with the sample interval as mean.
+  const double uniform = (static_cast<double>(z >> 11) + 1.0) / 9007199254740992.0;
+  const double scale = std::min(-std::log(uniform), kMaxIntervalScale);
+  return std::max<size_t>(1u, static_cast<size_t>(scale * sample_interval_));
+}
+
+class AllocationSampleStackVisitor : public StackVisitor {
+ public:
+  AllocationSampleStackVisitor(Thread* thread,
+                               size_t max_depth,
+                               std::vector<std::pair<ArtMethod*, uint32_t>>* frames)
+      REQUIRES_SHARED(Locks::mutator_lock_)
+      : StackVisitor(thread, nullptr, StackVisitor::StackWalkKind::kIncludeInlinedFrames),
+        max_depth_(max_depth),
+        frames_(frames) {}
+
+  bool VisitFrame() OVERRIDE NO_THREAD_SAFETY_ANALYSIS {
+    if (frames_->size() >= max_depth_) {
+      return false;
+    }
+    ArtMethod* m = GetMethod();
+    if (m != nullptr && !m->IsRuntimeMethod()) {
+      m = m->GetInterfaceMethodIfProxy(kRuntimePointerSize);
+      frames_->emplace_back(m, GetDexPc());
+    }
+    return true;
+  }
+
+ private:
+  const size_t max_depth_;
+  std::vector<std::pair<ArtMethod*, uint32_t>>* const frames_;
+};
+
+uint32_t AllocationSampler::InternFrame(uint32_t parent, ArtMethod* method, uint32_t dex_pc) {
+  const StackNode node {parent, method, dex_pc};
+  auto it = node_ids_.find(node);
+  if (it != node_ids_.end()) {
+    return it->second;
+  }
+  const uint32_t id = nodes_.size();
+  nodes_.push_back(node);
+  node_ids_.emplace(node, id);
+  return id;
+}
+
+void AllocationSampler::RecordSample(Thread* self,
+                                     ObjPtr<mirror::Object>* obj,
+                                     size_t byte_count) {
+  // Walk the stack and read the class outside of the lock, both may allocate or suspend.
+  std::vector<std::pair<ArtMethod*, uint32_t>> frames;
+  std::string descriptor;
+  {
+    StackHandleScope<1> hs(self);
+    auto obj_wrapper = hs.NewHandleWrapper(obj);
+    AllocationSampleStackVisitor visitor(self, max_stack_depth_, &frames);
+    visitor.WalkStack();
+  }
+  std::string storage;
+  descriptor = (*obj)->GetClass()->GetDescriptor(&storage);
+  const double probability =
+      1.0 - std::exp(-static_cast<double>(byte_count) / static_cast<double>(sample_interval_));
+  const double weight = probability > 0.0 ? 1.0 / probability : 1.0;
+
+  MutexLock mu(self, lock_);
+  // The visitor saw the innermost frame first, the trie goes from the outermost.
+  uint32_t node = kRootNode;
+  for (auto it = frames.rbegin(); it != frames.rend(); ++it) {
+    node = InternFrame(node, it->first, it->second);
+  }
+  SampleCounts& counts = samples_[std::make_pair(node, std::move(descriptor))];
+  ++counts.samples;
+  counts.objects += weight;
+  counts.bytes += weight * byte_count;
+  ++sample_count_;
+}
+
+void AllocationSampler::VisitRoots(RootVisitor* visitor) {
+  BufferedRootVisitor<kDefaultBufferedRootCount> buffered_visitor(visitor, RootInfo(kRootDebugger));
+  MutexLock mu(Thread::Current(), lock_);
+  for (const StackNode& node : nodes_) {
+    if (node.method != nullptr) {
+      node.method->VisitRoots(buffered_visitor, kRuntimePointerSize);
+    }
+  }
+}
+
+// Minimal protocol buffer encoder for the messages of profile.proto that the profile uses.
+class ProtoWriter {
+ public:
+  void Varint(uint64_t value) {
+    while (value >= 0x80) {
+      data_.push_back(static_cast<char>((value & 0x7f) | 0x80));
+      value >>= 7;
+    }
+    data_.push_back(static_cast<char>(value));
+  }
+
+  void Int(uint32_t field, uint64_t value) {
+    Varint(field << 3);
+    Varint(value);
+  }
+
+  void Bytes(uint32_t field, const std::string& bytes) {
+    Varint((field << 3) | 2u);
+    Varint(bytes.size());
+    data_.append(bytes);
+  }
+
+  void Message(uint32_t field, const ProtoWriter& message) {
+    Bytes(field, message.data_);
+  }
+
+  const std::string& Data() const {
+    return data_;
+  }
+
+ private:
+  std::string data_;
+};
+
+// Field numbers of perftools.profiles.Profile and its nested messages.
+enum PprofField : uint32_t {
+  kProfileSampleType = 1,
+  kProfileSample = 2,
+  kProfileLocation = 4,
+  kProfileFunction = 5,
+  kProfileStringTable = 6,
+  kProfilePeriodType = 11,
+  kProfilePeriod = 12,
+  kValueTypeType = 1,
+  kValueTypeUnit = 2,
+  kSampleLocationId = 1,
+  kSampleValue = 2,
+  kSampleLabel = 3,
+  kLabelKey = 1,
+  kLabelStr = 2,
+  kLocationId = 1,
+  kLocationLine = 4,
+  kLineFunctionId = 1,
+  kLineLine = 2,
+  kFunctionId = 1,
+  kFunctionName = 2,
+  kFunctionSystemName = 3,
+  kFunctionFilename = 4,
+};
+
+class PprofStrings {
+ public:
+  PprofStrings() {
+    Index("");
+  }
+
+  uint64_t Index(const std::string& str) {
+    auto it = indexes_.find(str);
+    if (it != indexes_.end()) {
+      return it->second;
+    }
+    const uint64_t index = strings_.size();
+    strings_.push_back(str);
+    indexes_.emplace(str, index);
+    return index;
+  }
+
+  void Write(ProtoWriter* profile) const {
+    for (const std::string& str : strings_) {
+      profile->Bytes(kProfileStringTable, str);
+    }
+  }
+
+ private:
+  std::vector<std::string> strings_;
+  std::unordered_map<std::string, uint64_t> indexes_;
+};
+
+static ProtoWriter PprofValueType(PprofStrings* strings, const char* type, const char* unit) {
+  ProtoWriter value_type;
+  value_type.Int(kValueTypeType, strings->Index(type));
+  value_type.Int(kValueTypeUnit, strings->Index(unit));
+  return value_type;
+}
+
+void AllocationSampler::WriteProfile(std::string* out) {
+  PprofStrings strings;
+  ProtoWriter profile;
+  profile.Message(kProfileSampleType, PprofValueType(&strings, "alloc_objects", "count"));
+  profile.Message(kProfileSampleType, PprofValueType(&strings, "alloc_space", "bytes"));
+
+  MutexLock mu(Thread::Current(), lock_);
+  const uint64_t class_key = strings.Index("class");
+  for (const auto& entry : samples_) {
+    ProtoWriter sample;
+    // Locations are the trie nodes, innermost frame first.
+    ProtoWriter location_ids;
+    for (uint32_t node = entry.first.first; node != kRootNode; node = nodes_[node].parent) {
+      location_ids.Varint(node);
+    }
+    sample.Bytes(kSampleLocationId, location_ids.Data());
+    ProtoWriter values;
+    values.Varint(static_cast<uint64_t>(std::llround(entry.second.objects)));
+    values.Varint(static_cast<uint64_t>(std::llround(entry.second.bytes)));
+    sample.Bytes(kSampleValue, values.Data());
+    ProtoWriter label;
+    label.Int(kLabelKey, class_key);
+    label.Int(kLabelStr, strings.Index(PrettyDescriptor(entry.first.second.c_str())));
+    sample.Message(kSampleLabel, label);
+    profile.Message(kProfileSample, sample);
+  }
+
+  std::unordered_map<ArtMethod*, uint64_t> function_ids;
+  for (uint32_t id = 1; id < nodes_.size(); ++id) {
+    ArtMethod* method = nodes_[id].method;
+    auto it = function_ids.find(method);
+    if (it == function_ids.end()) {
+      it = function_ids.emplace(method, function_ids.size() + 1).first;
+      const char* source_file = method->GetDeclaringClassSourceFile();
+      const uint64_t name = strings.Index(method->PrettyMethod());
+      ProtoWriter function;
+      function.Int(kFunctionId, it->second);
+      function.Int(kFunctionName, name);
+      function.Int(kFunctionSystemName, name);
+      function.Int(kFunctionFilename,
+                   strings.Index(source_file != nullptr ? source_file : "unknown"));
+      profile.Message(kProfileFunction, function);
+    }
+    ProtoWriter line;
+    line.Int(kLineFunctionId, it->second);
+    const int32_t line_number = method->GetLineNumFromDexPC(nodes_[id].dex_pc);
+    line.Int(kLineLine, static_cast<uint64_t>(std::max(line_number, 0)));
+    ProtoWriter location;
+    location.Int(kLocationId, id);
+    location.Message(kLocationLine, line);
+    profile.Message(kProfileLocation, location);
+  }
+
+  profile.Message(kProfilePeriodType, PprofValueType(&strings, "space", "bytes"));
+  profile.Int(kProfilePeriod, sample_interval_);
+  strings.Write(&profile);
+  *out = profile.Data();
+}
+
+bool AllocationSampler::WriteProfile(const std::string& filename, std::string* error_msg) {
+  std::string data;
+  WriteProfile(&data);
+  std::unique_ptr<File> file(OS::CreateEmptyFile(filename.c_str()));
+  if (file == nullptr) {
+    *error_msg = "Failed to create allocation profile " + filename;
+    return false;
+  }
+  if (!file->WriteFully(data.data(), data.size())) {
+    *error_msg = "Failed to write allocation profile " + filename;
+    file->Erase(/* unlink */ true);
+    return false;
+  }
+  if (file->FlushCloseOrErase() != 0) {
+    *error_msg = "Failed to close allocation profile " + filename;
+    return false;
+  }
+  return true;
+}
+
+void AllocationSampler::Dump(std::ostream& os) {
+  MutexLock mu(Thread::Current(), lock_);
+  os << "Allocation sampler: interval " << PrettySize(sample_interval_) << " samples "
+     << sample_count_ << " distinct stacks and classes " << samples_.size()
+     << " interned frames " << nodes_.size() - 1 << "\n";
+}
+
+size_t AllocationSampler::GetSampleCount() {
+  MutexLock mu(Thread::Current(), lock_);
+  return sample_count_;
+}
+
+size_t AllocationSampler::GetStackNodeCount() {
+  MutexLock mu(Thread::Current(), lock_);
+  return nodes_.size() - 1;
+}
+
+}  // namespace gc
+}  // namespace art
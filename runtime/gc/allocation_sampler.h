@@ -0,0 +1,180 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_GC_ALLOCATION_SAMPLER_H_
+#define ART_RUNTIME_GC_ALLOCATION_SAMPLER_H_
+
+#include <algorithm>
+#include <iosfwd>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "atomic.h"
+#include "base/bit_utils.h"
+#include "base/mutex.h"
+#include "obj_ptr.h"
+#include "thread.h"
+
+namespace art {
+
+class ArtMethod;
+class RootVisitor;
+
+namespace mirror {
+  class Object;
+}  // namespace mirror
+
+namespace gc {
+
+// Poisson sampling allocation profiler, cheap enough to leave enabled. Each thread counts down
+// the bytes it allocates and samples the allocation that crosses a random point, drawn so that
+// on average one sample is taken every sample interval bytes. A sampled allocation of size s
+// therefore stands for 1 / (1 - exp(-s / interval)) allocations of that size, which is how the
+// written profile is unbiased.
+//
+// The allocation fast paths are left alone: the bytes are counted in the slow path when a TLAB is
+// refilled, and a refill that reaches the sample point is cut short there, so that the fast path
+// enters the slow path with the allocation that crosses it. A RosAlloc thread-local run can't be
+// cut short, its allocation that crosses the sample point is taken at the next run refill.
+//
+// Stack traces are interned in a trie of (parent, method, dex pc) nodes shared by all samples,
+// so a sample costs one node lookup per frame and no memory for stacks seen before. Samples are
+// aggregated per (stack, class). The profile is written in the pprof protocol buffer format.
+class AllocationSampler {
+ public:
+  static constexpr size_t kDefaultMaxStackDepth = 64;
+
+  explicit AllocationSampler(size_t sample_interval,
+                             size_t max_stack_depth = kDefaultMaxStackDepth);
+
+  size_t GetSampleInterval() const {
+    return sample_interval_;
+  }
+
+  // Charge the grant_bytes of a TLAB refill, or of an allocation outside of a TLAB, to the
+  // thread, and return how many of them it may use before its next sample point. The first
+  // need_bytes are the allocation in progress, which is flagged for sampling if it reaches the
+  // sample point. The result is at least need_bytes and a multiple of the object alignment if
+  // below grant_bytes. A thread that never allocated since sampling was enabled is armed first.
+  ALWAYS_INLINE size_t ChargeAllocation(Thread* self, size_t need_bytes, size_t grant_bytes) {
+    DCHECK_LE(need_bytes, grant_bytes);
+    Thread::AllocSampling* const sampling = self->GetAllocSampling();
+    size_t bytes_left = sampling->bytes_left;
+    if (UNLIKELY(!sampling->armed)) {
+      sampling->armed = true;
+      bytes_left = NextSampleInterval();
+    }
+    sampling->charged = true;
+    if (bytes_left < need_bytes) {
+      sampling->take_sample = true;
+      bytes_left = need_bytes + NextSampleInterval();
+    }
+    if (LIKELY(bytes_left >= grant_bytes)) {
+      sampling->bytes_left = bytes_left - grant_bytes;
+      return grant_bytes;
+    }
+    // Stop the refill at the sample point. The allocation that crosses it takes the slow path.
+    sampling->bytes_left = 0;
+    return std::min(grant_bytes, RoundUp(bytes_left, kObjectAlignment));
+  }
+
+  // Returns true once if the allocation in progress was flagged by ChargeAllocation().
+  ALWAYS_INLINE static bool TakeSample(Thread* self) {
+    Thread::AllocSampling* const sampling = self->GetAllocSampling();
+    if (LIKELY(!sampling->take_sample)) {
+      return false;
+    }
+    sampling->take_sample = false;
+    return true;
+  }
+
+  // Record the stack and class of a sampled allocation.
+  void RecordSample(Thread* self, ObjPtr<mirror::Object>* obj, size_t byte_count)
+      REQUIRES_SHARED(Locks::mutator_lock_)
+      REQUIRES(!lock_);
+
+  // The methods of the interned stacks must not be unloaded while the profile refers to them.
+  void VisitRoots(RootVisitor* visitor)
+      REQUIRES_SHARED(Locks::mutator_lock_)
+      REQUIRES(!lock_);
+
+  // Serialize the samples as an uncompressed pprof profile.
+  void WriteProfile(std::string* out)
+      REQUIRES_SHARED(Locks::mutator_lock_)
+      REQUIRES(!lock_);
+  bool WriteProfile(const std::string& filename, std::string* error_msg)
+      REQUIRES_SHARED(Locks::mutator_lock_)
+      REQUIRES(!lock_);
+
+  void Dump(std::ostream& os) REQUIRES(!lock_);
+
+  size_t GetSampleCount() REQUIRES(!lock_);
+  // Number of interned frames, the root excluded.
+  size_t GetStackNodeCount() REQUIRES(!lock_);
+
+ private:
+  static constexpr uint32_t kRootNode = 0;
+
+  struct StackNode {
+    uint32_t parent;
+    ArtMethod* method;
+    uint32_t dex_pc;
+
+    bool operator==(const StackNode& other) const {
+      return parent == other.parent && method == other.method && dex_pc == other.dex_pc;
+    }
+  };
+
+  struct StackNodeHash {
+    size_t operator()(const StackNode& node) const {
+      size_t hash = std::hash<void*>()(node.method);
+      hash = hash * 31 + node.parent;
+      return hash * 31 + node.dex_pc;
+    }
+  };
+
+  struct SampleCounts {
+    uint64_t samples = 0;
+    // Unbiased estimates of the allocations the samples stand for.
+    double objects = 0.0;
+    double bytes = 0.0;
+  };
+
+  size_t NextSampleInterval();
+  uint32_t InternFrame(uint32_t parent, ArtMethod* method, uint32_t dex_pc) REQUIRES(lock_);
+
+  const size_t sample_interval_;
+  const size_t max_stack_depth_;
+  // State of the generator of the sampling points, only advanced when a sample is taken.
+  Atomic<uint64_t> random_state_;
+
+  Mutex lock_;
+  // Interned frames indexed by node id, node 0 is the root of every stack.
+  std::vector<StackNode> nodes_ GUARDED_BY(lock_);
+  std::unordered_map<StackNode, uint32_t, StackNodeHash> node_ids_ GUARDED_BY(lock_);
+  // Samples per leaf node and class descriptor.
+  std::map<std::pair<uint32_t, std::string>, SampleCounts> samples_ GUARDED_BY(lock_);
+  size_t sample_count_ GUARDED_BY(lock_);
+
+  DISALLOW_COPY_AND_ASSIGN(AllocationSampler);
+};
+
+}  // namespace gc
+}  // namespace art
+
+#endif  // ART_RUNTIME_GC_ALLOCATION_SAMPLER_H_
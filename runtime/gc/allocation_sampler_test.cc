@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "allocation_sampler.h"
+
+#include "common_runtime_test.h"
+#include "handle_scope-inl.h"
+#include "mirror/string.h"
+#include "scoped_thread_state_change-inl.h"
+
+namespace art {
+namespace gc {
+
+class AllocationSamplerTest : public CommonRuntimeTest {
+ protected:
+  void TearDown() OVERRIDE {
+    // Leave the thread unarmed for the next sampler.
+    *Thread::Current()->GetAllocSampling() = Thread::AllocSampling();
+    CommonRuntimeTest::TearDown();
+  }
+};
+
+TEST_F(AllocationSamplerTest, SamplesAboutOncePerInterval) {
+  Thread* self = Thread::Current();
+  AllocationSampler sampler(4 * KB);
+  size_t samples = 0;
+  const size_t kAllocations = 64 * 1024;
+  for (size_t i = 0; i < kAllocations; ++i) {
+    // Allocations outside of a TLAB are charged one by one.
+    EXPECT_EQ(sampler.ChargeAllocation(self, 64, 64), 64u);
+    if (AllocationSampler::TakeSample(self)) {
+      ++samples;
+    }
+  }
+  // 4 MB allocated with a 4 KB mean interval, about 1024 samples.
+  EXPECT_GT(samples, 800u);
+  EXPECT_LT(samples, 1250u);
+  // An allocation larger than the clamped interval is always sampled.
+  sampler.ChargeAllocation(self, 100 * 4 * KB, 100 * 4 * KB);
+  EXPECT_TRUE(AllocationSampler::TakeSample(self));
+  EXPECT_FALSE(AllocationSampler::TakeSample(self));
+}
+
+TEST_F(AllocationSamplerTest, RefillStopsAtSamplePoint) {
+  Thread* self = Thread::Current();
+  AllocationSampler sampler(4 * KB);
+  Thread::AllocSampling* sampling = self->GetAllocSampling();
+  sampling->armed = true;
+  sampling->bytes_left = 1000;
+  // A refill that reaches the sample point ends there, rounded to the object alignment.
+  EXPECT_EQ(sampler.ChargeAllocation(self, 64, 16 * KB), RoundUp(1000u, kObjectAlignment));
+  EXPECT_FALSE(AllocationSampler::TakeSample(self));
+  EXPECT_EQ(sampling->bytes_left, 0u);
+  // The allocation that did not fit in the rest of the TLAB crosses the sample point.
+  const size_t granted = sampler.ChargeAllocation(self, 32, 16 * KB);
+  EXPECT_TRUE(AllocationSampler::TakeSample(self));
+  EXPECT_GE(granted, 32u);
+  EXPECT_LE(granted, 16 * KB);
+  // A refill short of the sample point is granted in full.
+  sampling->bytes_left = 64 * KB;
+  EXPECT_EQ(sampler.ChargeAllocation(self, 64, 16 * KB), 16 * KB);
+  EXPECT_FALSE(AllocationSampler::TakeSample(self));
+  EXPECT_EQ(sampling->bytes_left, 48 * KB);
+}
+
+TEST_F(AllocationSamplerTest, InternsStacks) {
+  ScopedObjectAccess soa(Thread::Current());
+  AllocationSampler sampler(4 * KB);
+  StackHandleScope<1> hs(soa.Self());
+  Handle<mirror::String> string(
+      hs.NewHandle(mirror::String::AllocFromModifiedUtf8(soa.Self(), "sampled")));
+  ASSERT_TRUE(string != nullptr);
+  ObjPtr<mirror::Object> obj = string.Get();
+  sampler.RecordSample(soa.Self(), &obj, 32);
+  sampler.RecordSample(soa.Self(), &obj, 32);
+  EXPECT_EQ(sampler.GetSampleCount(), 2u);
+  // There are no managed frames in the test, both samples share the root.
+  EXPECT_EQ(sampler.GetStackNodeCount(), 0u);
+
+  std::string profile;
+  sampler.WriteProfile(&profile);
+  EXPECT_NE(profile.find("alloc_space"), std::string::npos);
+  EXPECT_NE(profile.find("java.lang.String"), std::string::npos);
+}
+
+}  // namespace gc
+}  // namespace art
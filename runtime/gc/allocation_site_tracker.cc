@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "allocation_site_tracker.h"
+
+#include <ostream>
+
+#include "art_method-inl.h"
+#include "base/enums.h"
+#include "dex_instruction.h"
+#include "gc/heap.h"
+#include "gc_root-inl.h"
+#include "mirror/class-inl.h"
+#include "mirror/object-inl.h"
+#include "runtime.h"
+#include "stack.h"
+
+namespace art {
+namespace gc {
+
+constexpr size_t AllocationSiteTracker::kMinSamples;
+constexpr size_t AllocationSiteTracker::kSurvivalPercent;
+constexpr size_t AllocationSiteTracker::kMaxPendingSamples;
+
+// Finds the innermost managed frame, inlined frames included.
+class AllocationSiteVisitor : public StackVisitor {
+ public:
+  explicit AllocationSiteVisitor(Thread* thread) REQUIRES_SHARED(Locks::mutator_lock_)
+      : StackVisitor(thread, nullptr, StackVisitor::StackWalkKind::kIncludeInlinedFrames),
+        method_(nullptr),
+        dex_pc_(0u) {}
+
+  bool VisitFrame() OVERRIDE REQUIRES_SHARED(Locks::mutator_lock_) {
+    ArtMethod* m = GetMethod();
+    if (m == nullptr || m->IsRuntimeMethod()) {
+      return true;
+    }
+    if (!m->IsNative() && !m->IsProxyMethod()) {
+      method_ = m;
+      dex_pc_ = GetDexPc(/* abort_on_failure */ false);
+    }
+    return false;
+  }
+
+  ArtMethod* GetAllocatingMethod() const {
+    return method_;
+  }
+
+  uint32_t GetAllocatingDexPc() const {
+    return dex_pc_;
+  }
+
+ private:
+  ArtMethod* method_;
+  uint32_t dex_pc_;
+};
+
+AllocationSiteTracker::AllocationSiteTracker()
+    : SystemWeakHolder(kAllocTrackerLock),
+      pretenured_site_count_(0u) {}
+
+void AllocationSiteTracker::ObjectAllocated(Thread* self,
+                                            ObjPtr<mirror::Object>* obj,
+                                            size_t byte_count ATTRIBUTE_UNUSED) {
+  ObjPtr<mirror::Class> klass = (*obj)->GetClass();
+  if (klass->IsArrayClass() || klass->IsStringClass()) {
+    return;
+  }
+  AllocationSiteVisitor visitor(self);
+  visitor.WalkStack();
+  ArtMethod* method = visitor.GetAllocatingMethod();
+  if (method == nullptr) {
+    return;
+  }
+  // Only new-instance can use the non-moving entrypoint. Objects the runtime allocates on behalf
+  // of other instructions, for example through reflection, are not attributed to a site.
+  const DexFile::CodeItem* code_item = method->GetCodeItem();
+  const uint32_t dex_pc = visitor.GetAllocatingDexPc();
+  if (code_item == nullptr ||
+      dex_pc >= code_item->insns_size_in_code_units_ ||
+      Instruction::At(&code_item->insns_[dex_pc])->Opcode() != Instruction::NEW_INSTANCE) {
+    return;
+  }
+  RecordSample(self, method, dex_pc, obj->Ptr());
+}
+
+void AllocationSiteTracker::RecordSample(Thread* self,
+                                         ArtMethod* method,
+                                         uint32_t dex_pc,
+                                         mirror::Object* obj) {
+  MutexLock mu(self, allow_disallow_lock_);
+  if (pending_samples_.size() >= kMaxPendingSamples) {
+    return;
+  }
+  const Site site(method, dex_pc);
+  auto it = sites_.find(site);
+  if (it != sites_.end() && it->second.pretenured) {
+    return;
+  }
+  // Read under the lock so that a GC starting later sweeps this sample, the object was allocated
+  // before it started.
+  const uint32_t gc_num = Runtime::Current()->GetHeap()->GetCurrentGcNum();
+  pending_samples_.push_back(Sample {site, GcRoot<mirror::Object>(obj), gc_num});
+}
+
+void AllocationSiteTracker::Sweep(IsMarkedVisitor* visitor) {
+  Thread* self = Thread::Current();
+  MutexLock mu(self, allow_disallow_lock_);
+  const uint32_t current_gc_num = Runtime::Current()->GetHeap()->GetCurrentGcNum();
+  size_t kept = 0;
+  for (Sample& sample : pending_samples_) {
+    mirror::Object* obj = sample.object.Read<kWithoutReadBarrier>();
+    mirror::Object* new_obj = visitor->IsMarked(obj);
+    if (sample.gc_num == current_gc_num) {
+      // Taken while this GC runs, resolve it with the next one.
+      if (new_obj != nullptr) {
+        sample.object = GcRoot<mirror::Object>(new_obj);
+        pending_samples_[kept++] = sample;
+      }
+      continue;
+    }
+    SiteCounts& counts = sites_[sample.site];
+    if (new_obj != nullptr) {
+      ++counts.survived;
+    } else {
+      ++counts.died;
+    }
+    const uint64_t total = counts.survived + counts.died;
+    if (!counts.pretenured &&
+        total >= kMinSamples &&
+        counts.survived * 100u >= total * kSurvivalPercent) {
+      counts.pretenured = true;
+      ++pretenured_site_count_;
+    }
+  }
+  pending_samples_.resize(kept);
+  MarkSweptLocked(self);
+}
+
+bool AllocationSiteTracker::ShouldPretenure(ArtMethod* method, uint32_t dex_pc) {
+  MutexLock mu(Thread::Current(), allow_disallow_lock_);
+  auto it = sites_.find(Site(method, dex_pc));
+  return it != sites_.end() && it->second.pretenured;
+}
+
+size_t AllocationSiteTracker::GetPretenuredSiteCount() {
+  MutexLock mu(Thread::Current(), allow_disallow_lock_);
+  return pretenured_site_count_;
+}
+
+void AllocationSiteTracker::Dump(std::ostream& os) {
+  MutexLock mu(Thread::Current(), allow_disallow_lock_);
+  os << "Allocation sites: " << sites_.size() << " sampled, " << pretenured_site_count_
+     << " pretenured\n";
+}
+
+}  // namespace gc
+}  // namespace art
@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_GC_ALLOCATION_SITE_TRACKER_H_
+#define ART_RUNTIME_GC_ALLOCATION_SITE_TRACKER_H_
+
+#include <iosfwd>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "gc/allocation_listener.h"
+#include "gc/system_weak.h"
+#include "gc_root.h"
+
+namespace art {
+
+class ArtMethod;
+
+namespace gc {
+
+// Survival profile of the new-instance sites, used to pretenure the sites whose objects mostly
+// outlive the next GC. Sampled objects are held weakly until the next sweep of the system weaks,
+// which counts them as survivors or as dead. A site with enough samples and a high survival rate
+// is pretenured: the JIT compiles its new-instance to the non-moving allocation entrypoint, so its
+// objects are no longer copied by every collection.
+//
+// The heap samples the allocations that refill a thread-local allocation buffer, about one per
+// buffer size of allocated bytes, which costs nothing on the allocation fast paths.
+class AllocationSiteTracker : public AllocationListener, public SystemWeakHolder {
+ public:
+  // Resolved samples a site needs before it may be pretenured.
+  static constexpr size_t kMinSamples = 16;
+  // Percentage of the samples of a site that must survive for it to be pretenured.
+  static constexpr size_t kSurvivalPercent = 80;
+  // Unresolved samples above which new ones are dropped until the next GC.
+  static constexpr size_t kMaxPendingSamples = 4096;
+
+  AllocationSiteTracker();
+
+  // Record the new-instance site of the allocation, if any.
+  void ObjectAllocated(Thread* self, ObjPtr<mirror::Object>* obj, size_t byte_count) OVERRIDE
+      REQUIRES_SHARED(Locks::mutator_lock_)
+      REQUIRES(!allow_disallow_lock_);
+
+  void RecordSample(Thread* self, ArtMethod* method, uint32_t dex_pc, mirror::Object* obj)
+      REQUIRES_SHARED(Locks::mutator_lock_)
+      REQUIRES(!allow_disallow_lock_);
+
+  // Count the pending samples taken before the current GC started as survivors or dead and
+  // update the pretenured sites. Samples taken since may be allocated black by the GC, so they
+  // stay pending until the next one.
+  void Sweep(IsMarkedVisitor* visitor) OVERRIDE
+      REQUIRES_SHARED(Locks::mutator_lock_)
+      REQUIRES(!allow_disallow_lock_);
+
+  bool ShouldPretenure(ArtMethod* method, uint32_t dex_pc) REQUIRES(!allow_disallow_lock_);
+
+  size_t GetPretenuredSiteCount() REQUIRES(!allow_disallow_lock_);
+
+  void Dump(std::ostream& os) REQUIRES(!allow_disallow_lock_);
+
+ private:
+  // Methods are not dereferenced, a site of an unloaded method is only stale.
+  using Site = std::pair<ArtMethod*, uint32_t>;
+
+  struct SiteCounts {
+    uint64_t survived = 0;
+    uint64_t died = 0;
+    bool pretenured = false;
+  };
+
+  struct Sample {
+    Site site;
+    GcRoot<mirror::Object> object;
+    // Heap::GetCurrentGcNum() when the sample was recorded.
+    uint32_t gc_num;
+  };
+
+  std::map<Site, SiteCounts> sites_ GUARDED_BY(allow_disallow_lock_);
+  std::vector<Sample> pending_samples_ GUARDED_BY(allow_disallow_lock_);
+  size_t pretenured_site_count_ GUARDED_BY(allow_disallow_lock_);
+
+  DISALLOW_COPY_AND_ASSIGN(AllocationSiteTracker);
+};
+
+}  // namespace gc
+}  // namespace art
+
+#endif  // ART_RUNTIME_GC_ALLOCATION_SITE_TRACKER_H_
@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "allocation_site_tracker.h"
+
+#include "common_runtime_test.h"
+#include "class_linker.h"
+#include "gc/heap.h"
+#include "handle_scope-inl.h"
+#include "mirror/class-inl.h"
+#include "mirror/object-inl.h"
+#include "object_callbacks.h"
+#include "scoped_thread_state_change-inl.h"
+
+namespace art {
+namespace gc {
+
+class AllocationSiteTrackerTest : public CommonRuntimeTest {
+ protected:
+  // Sweep as a GC that started after the samples were taken.
+  void SweepAfterGcStart(AllocationSiteTracker* tracker, IsMarkedVisitor* visitor)
+      REQUIRES_SHARED(Locks::mutator_lock_) {
+    Runtime::Current()->GetHeap()->IncrementGcsStarted();
+    tracker->Sweep(visitor);
+  }
+};
+
+// Reports every object as alive or every object as dead.
+class FixedIsMarkedVisitor : public IsMarkedVisitor {
+ public:
+  explicit FixedIsMarkedVisitor(bool alive) : alive_(alive) {}
+
+  mirror::Object* IsMarked(mirror::Object* obj) OVERRIDE {
+    return alive_ ? obj : nullptr;
+  }
+
+ private:
+  const bool alive_;
+};
+
+TEST_F(AllocationSiteTrackerTest, PretenuresSurvivingSites) {
+  ScopedObjectAccess soa(Thread::Current());
+  StackHandleScope<2> hs(soa.Self());
+  Handle<mirror::Class> klass(
+      hs.NewHandle(class_linker_->FindSystemClass(soa.Self(), "Ljava/lang/Object;")));
+  ASSERT_TRUE(klass != nullptr);
+  Handle<mirror::Object> obj(hs.NewHandle(klass->AllocObject(soa.Self())));
+  ASSERT_TRUE(obj != nullptr);
+  // The methods are only used as keys.
+  ArtMethod* const surviving = reinterpret_cast<ArtMethod*>(0x1000);
+  ArtMethod* const dying = reinterpret_cast<ArtMethod*>(0x2000);
+  AllocationSiteTracker tracker;
+  FixedIsMarkedVisitor alive(true);
+  FixedIsMarkedVisitor dead(false);
+  for (size_t i = 0; i + 1 < AllocationSiteTracker::kMinSamples; ++i) {
+    tracker.RecordSample(soa.Self(), surviving, 4u, obj.Get());
+  }
+  SweepAfterGcStart(&tracker, &alive);
+  EXPECT_FALSE(tracker.ShouldPretenure(surviving, 4u));
+  tracker.RecordSample(soa.Self(), surviving, 4u, obj.Get());
+  SweepAfterGcStart(&tracker, &alive);
+  EXPECT_TRUE(tracker.ShouldPretenure(surviving, 4u));
+  // Sites are per dex pc.
+  EXPECT_FALSE(tracker.ShouldPretenure(surviving, 8u));
+
+  for (size_t i = 0; i < 2 * AllocationSiteTracker::kMinSamples; ++i) {
+    tracker.RecordSample(soa.Self(), dying, 4u, obj.Get());
+  }
+  SweepAfterGcStart(&tracker, &dead);
+  EXPECT_FALSE(tracker.ShouldPretenure(dying, 4u));
+  EXPECT_EQ(tracker.GetPretenuredSiteCount(), 1u);
+}
+
+TEST_F(AllocationSiteTrackerTest, KeepsSamplesOfTheRunningGc) {
+  ScopedObjectAccess soa(Thread::Current());
+  StackHandleScope<1> hs(soa.Self());
+  Handle<mirror::Class> klass(
+      hs.NewHandle(class_linker_->FindSystemClass(soa.Self(), "Ljava/lang/Object;")));
+  ASSERT_TRUE(klass != nullptr);
+  mirror::Object* obj = klass->AllocObject(soa.Self());
+  ASSERT_TRUE(obj != nullptr);
+  ArtMethod* const method = reinterpret_cast<ArtMethod*>(0x1000);
+  AllocationSiteTracker tracker;
+  FixedIsMarkedVisitor alive(true);
+  FixedIsMarkedVisitor dead(false);
+  Runtime::Current()->GetHeap()->IncrementGcsStarted();
+  for (size_t i = 0; i < AllocationSiteTracker::kMinSamples; ++i) {
+    tracker.RecordSample(soa.Self(), method, 4u, obj);
+  }
+  // The samples were taken after the GC started, which may have allocated them black. They are
+  // not counted as survivors yet.
+  tracker.Sweep(&alive);
+  EXPECT_FALSE(tracker.ShouldPretenure(method, 4u));
+  // The next GC finds them dead.
+  SweepAfterGcStart(&tracker, &dead);
+  EXPECT_FALSE(tracker.ShouldPretenure(method, 4u));
+  // As many survivors would be enough on their own, but the dead samples were counted.
+  for (size_t i = 0; i < AllocationSiteTracker::kMinSamples; ++i) {
+    tracker.RecordSample(soa.Self(), method, 4u, obj);
+  }
+  SweepAfterGcStart(&tracker, &alive);
+  EXPECT_FALSE(tracker.ShouldPretenure(method, 4u));
+}
+
+}  // namespace gc
+}  // namespace art
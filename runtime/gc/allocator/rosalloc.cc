@@ -16,6 +16,7 @@
 
 #include "rosalloc.h"
 
+#include <algorithm>
 #include <map>
 #include <list>
 #include <sstream>
@@ -48,6 +49,7 @@ size_t RosAlloc::numOfPages[kNumOfSizeBrackets];
 size_t RosAlloc::numOfSlots[kNumOfSizeBrackets];
 size_t RosAlloc::headerSizes[kNumOfSizeBrackets];
 bool RosAlloc::initialized_ = false;
+constexpr size_t RosAlloc::kMaxReleaseBytesPerLock;
 size_t RosAlloc::dedicated_full_run_storage_[kPageSize / sizeof(size_t)] = { 0 };
 RosAlloc::Run* RosAlloc::dedicated_full_run_ =
     reinterpret_cast<RosAlloc::Run*>(dedicated_full_run_storage_);
@@ -1119,107 +1121,119 @@ size_t RosAlloc::BulkFree(Thread* self, void** ptrs, size_t num_ptrs) {
   // Now, iterate over the affected runs and update the alloc bit map
   // based on the bulk free bit map (for non-thread-local runs) and
   // union the bulk free bit map into the thread-local free bit map
-  // (for thread-local runs.)
-  for (Run* run : runs) {
+  // (for thread-local runs.) The runs are grouped by size bracket so
+  // that each bracket lock is taken once rather than once per run.
 #ifdef ART_TARGET_ANDROID
-    DCHECK(run->to_be_bulk_freed_);
-    run->to_be_bulk_freed_ = false;
+  std::vector<Run*>& sorted_runs = runs;
+#else
+  std::vector<Run*> sorted_runs(runs.begin(), runs.end());
 #endif
-    size_t idx = run->size_bracket_idx_;
+  std::sort(sorted_runs.begin(), sorted_runs.end(), [](const Run* a, const Run* b) {
+    return a->size_bracket_idx_ < b->size_bracket_idx_;
+  });
+  for (size_t i = 0; i < sorted_runs.size(); ) {
+    const size_t idx = sorted_runs[i]->size_bracket_idx_;
     MutexLock brackets_mu(self, *size_bracket_locks_[idx]);
-    if (run->IsThreadLocal()) {
-      DCHECK_LT(run->size_bracket_idx_, kNumThreadLocalSizeBrackets);
-      DCHECK(non_full_runs_[idx].find(run) == non_full_runs_[idx].end());
-      DCHECK(full_runs_[idx].find(run) == full_runs_[idx].end());
-      run->MergeBulkFreeListToThreadLocalFreeList();
-      if (kTraceRosAlloc) {
-        LOG(INFO) << "RosAlloc::BulkFree() : Freed slot(s) in a thread local run 0x"
-                  << std::hex << reinterpret_cast<intptr_t>(run);
-      }
-      DCHECK(run->IsThreadLocal());
-      // A thread local run will be kept as a thread local even if
-      // it's become all free.
-    } else {
-      bool run_was_full = run->IsFull();
-      run->MergeBulkFreeListToFreeList();
-      if (kTraceRosAlloc) {
-        LOG(INFO) << "RosAlloc::BulkFree() : Freed slot(s) in a run 0x" << std::hex
-                  << reinterpret_cast<intptr_t>(run);
-      }
-      // Check if the run should be moved to non_full_runs_ or
-      // free_page_runs_.
-      auto* non_full_runs = &non_full_runs_[idx];
-      auto* full_runs = kIsDebugBuild ? &full_runs_[idx] : nullptr;
-      if (run->IsAllFree()) {
-        // It has just become completely free. Free the pages of the
-        // run.
-        bool run_was_current = run == current_runs_[idx];
-        if (run_was_current) {
-          DCHECK(full_runs->find(run) == full_runs->end());
-          DCHECK(non_full_runs->find(run) == non_full_runs->end());
-          // If it was a current run, reuse it.
-        } else if (run_was_full) {
-          // If it was full, remove it from the full run set (debug
-          // only.)
-          if (kIsDebugBuild) {
-            std::unordered_set<Run*, hash_run, eq_run>::iterator pos = full_runs->find(run);
-            DCHECK(pos != full_runs->end());
-            full_runs->erase(pos);
+    for (; i < sorted_runs.size() && sorted_runs[i]->size_bracket_idx_ == idx; ++i) {
+      Run* run = sorted_runs[i];
+#ifdef ART_TARGET_ANDROID
+      DCHECK(run->to_be_bulk_freed_);
+      run->to_be_bulk_freed_ = false;
+#endif
+      if (run->IsThreadLocal()) {
+        DCHECK_LT(run->size_bracket_idx_, kNumThreadLocalSizeBrackets);
+        DCHECK(non_full_runs_[idx].find(run) == non_full_runs_[idx].end());
+        DCHECK(full_runs_[idx].find(run) == full_runs_[idx].end());
+        run->MergeBulkFreeListToThreadLocalFreeList();
+        if (kTraceRosAlloc) {
+          LOG(INFO) << "RosAlloc::BulkFree() : Freed slot(s) in a thread local run 0x"
+                    << std::hex << reinterpret_cast<intptr_t>(run);
+        }
+        DCHECK(run->IsThreadLocal());
+        // A thread local run will be kept as a thread local even if
+        // it's become all free.
+      } else {
+        bool run_was_full = run->IsFull();
+        run->MergeBulkFreeListToFreeList();
+        if (kTraceRosAlloc) {
+          LOG(INFO) << "RosAlloc::BulkFree() : Freed slot(s) in a run 0x" << std::hex
+                    << reinterpret_cast<intptr_t>(run);
+        }
+        // Check if the run should be moved to non_full_runs_ or
+        // free_page_runs_.
+        auto* non_full_runs = &non_full_runs_[idx];
+        auto* full_runs = kIsDebugBuild ? &full_runs_[idx] : nullptr;
+        if (run->IsAllFree()) {
+          // It has just become completely free. Free the pages of the
+          // run.
+          bool run_was_current = run == current_runs_[idx];
+          if (run_was_current) {
+            DCHECK(full_runs->find(run) == full_runs->end());
+            DCHECK(non_full_runs->find(run) == non_full_runs->end());
+            // If it was a current run, reuse it.
+          } else if (run_was_full) {
+            // If it was full, remove it from the full run set (debug
+            // only.)
+            if (kIsDebugBuild) {
+              std::unordered_set<Run*, hash_run, eq_run>::iterator pos = full_runs->find(run);
+              DCHECK(pos != full_runs->end());
+              full_runs->erase(pos);
+              if (kTraceRosAlloc) {
+                LOG(INFO) << "RosAlloc::BulkFree() : Erased run 0x" << std::hex
+                          << reinterpret_cast<intptr_t>(run)
+                          << " from full_runs_";
+              }
+              DCHECK(full_runs->find(run) == full_runs->end());
+            }
+          } else {
+            // If it was in a non full run set, remove it from the set.
+            DCHECK(full_runs->find(run) == full_runs->end());
+            DCHECK(non_full_runs->find(run) != non_full_runs->end());
+            non_full_runs->erase(run);
             if (kTraceRosAlloc) {
               LOG(INFO) << "RosAlloc::BulkFree() : Erased run 0x" << std::hex
                         << reinterpret_cast<intptr_t>(run)
-                        << " from full_runs_";
+                        << " from non_full_runs_";
             }
-            DCHECK(full_runs->find(run) == full_runs->end());
+            DCHECK(non_full_runs->find(run) == non_full_runs->end());
           }
-        } else {
-          // If it was in a non full run set, remove it from the set.
-          DCHECK(full_runs->find(run) == full_runs->end());
-          DCHECK(non_full_runs->find(run) != non_full_runs->end());
-          non_full_runs->erase(run);
-          if (kTraceRosAlloc) {
-            LOG(INFO) << "RosAlloc::BulkFree() : Erased run 0x" << std::hex
-                      << reinterpret_cast<intptr_t>(run)
-                      << " from non_full_runs_";
+          if (!run_was_current) {
+            run->ZeroHeaderAndSlotHeaders();
+            MutexLock lock_mu(self, lock_);
+            FreePages(self, run, true);
           }
-          DCHECK(non_full_runs->find(run) == non_full_runs->end());
-        }
-        if (!run_was_current) {
-          run->ZeroHeaderAndSlotHeaders();
-          MutexLock lock_mu(self, lock_);
-          FreePages(self, run, true);
-        }
-      } else {
-        // It is not completely free. If it wasn't the current run or
-        // already in the non-full run set (i.e., it was full) insert
-        // it into the non-full run set.
-        if (run == current_runs_[idx]) {
-          DCHECK(non_full_runs->find(run) == non_full_runs->end());
-          DCHECK(full_runs->find(run) == full_runs->end());
-          // If it was a current run, keep it.
-        } else if (run_was_full) {
-          // If it was full, remove it from the full run set (debug
-          // only) and insert into the non-full run set.
-          DCHECK(full_runs->find(run) != full_runs->end());
-          DCHECK(non_full_runs->find(run) == non_full_runs->end());
-          if (kIsDebugBuild) {
-            full_runs->erase(run);
+        } else {
+          // It is not completely free. If it wasn't the current run or
+          // already in the non-full run set (i.e., it was full) insert
+          // it into the non-full run set.
+          if (run == current_runs_[idx]) {
+            DCHECK(non_full_runs->find(run) == non_full_runs->end());
+            DCHECK(full_runs->find(run) == full_runs->end());
+            // If it was a current run, keep it.
+          } else if (run_was_full) {
+            // If it was full, remove it from the full run set (debug
+            // only) and insert into the non-full run set.
+            DCHECK(full_runs->find(run) != full_runs->end());
+            DCHECK(non_full_runs->find(run) == non_full_runs->end());
+            if (kIsDebugBuild) {
+              full_runs->erase(run);
+              if (kTraceRosAlloc) {
+                LOG(INFO) << "RosAlloc::BulkFree() : Erased run 0x" << std::hex
+                          << reinterpret_cast<intptr_t>(run)
+                          << " from full_runs_";
+              }
+            }
+            non_full_runs->insert(run);
             if (kTraceRosAlloc) {
-              LOG(INFO) << "RosAlloc::BulkFree() : Erased run 0x" << std::hex
+              LOG(INFO) << "RosAlloc::BulkFree() : Inserted run 0x" << std::hex
                         << reinterpret_cast<intptr_t>(run)
-                        << " from full_runs_";
+                        << " into non_full_runs_[" << std::dec << idx;
             }
+          } else {
+            // If it was not full, so leave it in the non full run set.
+            DCHECK(full_runs->find(run) == full_runs->end());
+            DCHECK(non_full_runs->find(run) != non_full_runs->end());
           }
-          non_full_runs->insert(run);
-          if (kTraceRosAlloc) {
-            LOG(INFO) << "RosAlloc::BulkFree() : Inserted run 0x" << std::hex
-                      << reinterpret_cast<intptr_t>(run)
-                      << " into non_full_runs_[" << std::dec << idx;
-          }
-        } else {
-          // If it was not full, so leave it in the non full run set.
-          DCHECK(full_runs->find(run) == full_runs->end());
-          DCHECK(non_full_runs->find(run) != non_full_runs->end());
         }
       }
     }
@@ -1651,11 +1665,11 @@ void RosAlloc::Initialize() {
   static_assert(kNumRegularSizeBrackets == kNumOfSizeBrackets - 2,
                 "There should be two non-regular brackets");
   for (size_t i = 0; i < kNumOfSizeBrackets; i++) {
-    if (i < kNumThreadLocalSizeBrackets) {
+    if (i < kNumFastPathSizeBrackets) {
       bracketSizes[i] = kThreadLocalBracketQuantumSize * (i + 1);
     } else if (i < kNumRegularSizeBrackets) {
-      bracketSizes[i] = kBracketQuantumSize * (i - kNumThreadLocalSizeBrackets + 1) +
-          (kThreadLocalBracketQuantumSize *  kNumThreadLocalSizeBrackets);
+      bracketSizes[i] = kBracketQuantumSize * (i - kNumFastPathSizeBrackets + 1) +
+          (kThreadLocalBracketQuantumSize *  kNumFastPathSizeBrackets);
     } else if (i == kNumOfSizeBrackets - 2) {
       bracketSizes[i] = 1 * KB;
     } else {
@@ -1668,9 +1682,9 @@ void RosAlloc::Initialize() {
   }
   // numOfPages.
   for (size_t i = 0; i < kNumOfSizeBrackets; i++) {
-    if (i < kNumThreadLocalSizeBrackets) {
+    if (i < kNumFastPathSizeBrackets) {
       numOfPages[i] = 1;
-    } else if (i < (kNumThreadLocalSizeBrackets + kNumRegularSizeBrackets) / 2) {
+    } else if (i < (kNumFastPathSizeBrackets + kNumRegularSizeBrackets) / 2) {
       numOfPages[i] = 1;
     } else if (i < kNumRegularSizeBrackets) {
       numOfPages[i] = 1;
@@ -1740,6 +1754,7 @@ void RosAlloc::Initialize() {
   DCHECK_LE(sizeof(Slot), bracketSizes[0]) << "sizeof(Slot) <= the smallest bracket size";
   // Check the invariants between the max bracket sizes and the number of brackets.
   DCHECK_EQ(kMaxThreadLocalBracketSize, bracketSizes[kNumThreadLocalSizeBrackets - 1]);
+  DCHECK_EQ(kMaxFastPathBracketSize, bracketSizes[kNumFastPathSizeBrackets - 1]);
   DCHECK_EQ(kMaxRegularBracketSize, bracketSizes[kNumRegularSizeBrackets - 1]);
 }
 
@@ -2017,7 +2032,7 @@ size_t RosAlloc::ReleasePages() {
       case kPageMapReleased:
         // Fall through.
       case kPageMapEmpty: {
-        // This is currently the start of a free page run.
+        // This is usually the start of a free page run.
         // Acquire the lock to prevent other threads racing in and modifying the page map.
         MutexLock mu(self, lock_);
         // Check that it's still empty after we acquired the lock since another thread could have
@@ -2025,21 +2040,27 @@ size_t RosAlloc::ReleasePages() {
         if (IsFreePage(i)) {
           // Free page runs can start with a released page if we coalesced a released page free
           // page run with an empty page run.
-          FreePageRun* fpr = reinterpret_cast<FreePageRun*>(base_ + i * kPageSize);
-          // There is a race condition where FreePage can coalesce fpr with the previous
-          // free page run before we acquire lock_. In that case free_page_runs_.find will not find
-          // a run starting at fpr. To handle this race, we skip reclaiming the page range and go
-          // to the next page.
-          if (free_page_runs_.find(fpr) != free_page_runs_.end()) {
+          uint8_t* const start = base_ + i * kPageSize;
+          // Find the free page run that contains the page. It starts before the page if the
+          // previous chunk of the run was released before the lock was dropped, or if FreePage
+          // coalesced the run with the previous one before we acquired lock_.
+          auto it = free_page_runs_.upper_bound(reinterpret_cast<FreePageRun*>(start));
+          if (it != free_page_runs_.begin()) {
+            FreePageRun* fpr = *--it;
             size_t fpr_size = fpr->ByteSize(this);
             DCHECK_ALIGNED(fpr_size, kPageSize);
-            uint8_t* start = reinterpret_cast<uint8_t*>(fpr);
-            reclaimed_bytes += ReleasePageRange(start, start + fpr_size);
-            size_t pages = fpr_size / kPageSize;
-            CHECK_GT(pages, 0U) << "Infinite loop probable";
-            i += pages;
-            DCHECK_LE(i, page_map_size_);
-            break;
+            uint8_t* const fpr_end = reinterpret_cast<uint8_t*>(fpr) + fpr_size;
+            if (start < fpr_end) {
+              uint8_t* const end = std::min(fpr_end, start + kMaxReleaseBytesPerLock);
+              // Only the chunk that starts the run holds its header.
+              const bool starts_free_page_run = start == reinterpret_cast<uint8_t*>(fpr);
+              reclaimed_bytes += ReleasePageRange(start, end, starts_free_page_run);
+              size_t pages = (end - start) / kPageSize;
+              CHECK_GT(pages, 0U) << "Infinite loop probable";
+              i += pages;
+              DCHECK_LE(i, page_map_size_);
+              break;
+            }
           }
         }
         FALLTHROUGH_INTENDED;
@@ -2058,11 +2079,11 @@ size_t RosAlloc::ReleasePages() {
   return reclaimed_bytes;
 }
 
-size_t RosAlloc::ReleasePageRange(uint8_t* start, uint8_t* end) {
+size_t RosAlloc::ReleasePageRange(uint8_t* start, uint8_t* end, bool starts_free_page_run) {
   DCHECK_ALIGNED(start, kPageSize);
   DCHECK_ALIGNED(end, kPageSize);
   DCHECK_LT(start, end);
-  if (kIsDebugBuild) {
+  if (kIsDebugBuild && starts_free_page_run) {
     // In the debug build, the first page of a free page run
     // contains a magic number for debugging. Exclude it.
     start += kPageSize;
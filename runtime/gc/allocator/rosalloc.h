@@ -104,7 +104,7 @@ class RosAlloc {
       size_t byte_size = ByteSize(rosalloc);
       DCHECK_EQ(byte_size % kPageSize, static_cast<size_t>(0));
       if (ShouldReleasePages(rosalloc)) {
-        rosalloc->ReleasePageRange(start, start + byte_size);
+        rosalloc->ReleasePageRange(start, start + byte_size, /* starts_free_page_run */ true);
       }
     }
 
@@ -517,7 +517,7 @@ class RosAlloc {
   // Returns the index of the size bracket from the bracket size.
   static size_t BracketSizeToIndex(size_t size) {
     DCHECK(8 <= size &&
-           ((size <= kMaxThreadLocalBracketSize && size % kThreadLocalBracketQuantumSize == 0) ||
+           ((size <= kMaxFastPathBracketSize && size % kThreadLocalBracketQuantumSize == 0) ||
             (size <= kMaxRegularBracketSize && size % kBracketQuantumSize == 0) ||
             size == 1 * KB || size == 2 * KB));
     size_t idx;
@@ -525,14 +525,14 @@ class RosAlloc {
       idx = kNumOfSizeBrackets - 2;
     } else if (UNLIKELY(size == 2 * KB)) {
       idx = kNumOfSizeBrackets - 1;
-    } else if (LIKELY(size <= kMaxThreadLocalBracketSize)) {
+    } else if (LIKELY(size <= kMaxFastPathBracketSize)) {
       DCHECK_EQ(size % kThreadLocalBracketQuantumSize, 0U);
       idx = size / kThreadLocalBracketQuantumSize - 1;
     } else {
       DCHECK(size <= kMaxRegularBracketSize);
-      DCHECK_EQ((size - kMaxThreadLocalBracketSize) % kBracketQuantumSize, 0U);
-      idx = ((size - kMaxThreadLocalBracketSize) / kBracketQuantumSize - 1)
-          + kNumThreadLocalSizeBrackets;
+      DCHECK_EQ((size - kMaxFastPathBracketSize) % kBracketQuantumSize, 0U);
+      idx = ((size - kMaxFastPathBracketSize) / kBracketQuantumSize - 1)
+          + kNumFastPathSizeBrackets;
     }
     DCHECK(bracketSizes[idx] == size);
     return idx;
@@ -547,7 +547,7 @@ class RosAlloc {
   // Rounds up the size up the nearest bracket size.
   static size_t RoundToBracketSize(size_t size) {
     DCHECK(size <= kLargeSizeThreshold);
-    if (LIKELY(size <= kMaxThreadLocalBracketSize)) {
+    if (LIKELY(size <= kMaxFastPathBracketSize)) {
       return RoundUp(size, kThreadLocalBracketQuantumSize);
     } else if (size <= kMaxRegularBracketSize) {
       return RoundUp(size, kBracketQuantumSize);
@@ -561,11 +561,11 @@ class RosAlloc {
   // Returns the size bracket index from the byte size with rounding.
   static size_t SizeToIndex(size_t size) {
     DCHECK(size <= kLargeSizeThreshold);
-    if (LIKELY(size <= kMaxThreadLocalBracketSize)) {
+    if (LIKELY(size <= kMaxFastPathBracketSize)) {
       return RoundUp(size, kThreadLocalBracketQuantumSize) / kThreadLocalBracketQuantumSize - 1;
     } else if (size <= kMaxRegularBracketSize) {
-      return (RoundUp(size, kBracketQuantumSize) - kMaxThreadLocalBracketSize) / kBracketQuantumSize
-          - 1 + kNumThreadLocalSizeBrackets;
+      return (RoundUp(size, kBracketQuantumSize) - kMaxFastPathBracketSize) / kBracketQuantumSize
+          - 1 + kNumFastPathSizeBrackets;
     } else if (size <= 1 * KB) {
       return kNumOfSizeBrackets - 2;
     } else {
@@ -578,13 +578,13 @@ class RosAlloc {
     DCHECK(size <= kLargeSizeThreshold);
     size_t idx;
     size_t bracket_size;
-    if (LIKELY(size <= kMaxThreadLocalBracketSize)) {
+    if (LIKELY(size <= kMaxFastPathBracketSize)) {
       bracket_size = RoundUp(size, kThreadLocalBracketQuantumSize);
       idx = bracket_size / kThreadLocalBracketQuantumSize - 1;
     } else if (size <= kMaxRegularBracketSize) {
       bracket_size = RoundUp(size, kBracketQuantumSize);
-      idx = ((bracket_size - kMaxThreadLocalBracketSize) / kBracketQuantumSize - 1)
-          + kNumThreadLocalSizeBrackets;
+      idx = ((bracket_size - kMaxFastPathBracketSize) / kBracketQuantumSize - 1)
+          + kNumFastPathSizeBrackets;
     } else if (size <= 1 * KB) {
       bracket_size = 1 * KB;
       idx = kNumOfSizeBrackets - 2;
@@ -598,7 +598,7 @@ class RosAlloc {
     DCHECK_EQ(bracket_size, bracketSizes[idx]) << idx;
     DCHECK_LE(size, bracket_size) << idx;
     DCHECK(size > kMaxRegularBracketSize ||
-           (size <= kMaxThreadLocalBracketSize &&
+           (size <= kMaxFastPathBracketSize &&
             bracket_size - size < kThreadLocalBracketQuantumSize) ||
            (size <= kMaxRegularBracketSize && bracket_size - size < kBracketQuantumSize)) << idx;
     *bracket_size_out = bracket_size;
@@ -659,18 +659,35 @@ class RosAlloc {
 
   // The default value for page_release_size_threshold_.
   static constexpr size_t kDefaultPageReleaseSizeThreshold = 4 * MB;
+  // The most bytes ReleasePages() madvises per acquisition of the lock, so that allocating
+  // threads do not wait for the release of a whole large free page run.
+  static constexpr size_t kMaxReleaseBytesPerLock = 1 * MB;
 
   // We use thread-local runs for the size brackets whose indexes
   // are less than this index. We use shared (current) runs for the rest.
+  // The brackets up to 256 bytes are thread-local, so that threads allocating
+  // common medium-sized objects in parallel do not contend on the bracket
+  // locks. Every thread may hold a run per thread-local bracket, one page
+  // each here, so the larger brackets stay shared to bound that footprint.
   // Sync this with the length of Thread::rosalloc_runs_.
-  static const size_t kNumThreadLocalSizeBrackets = 16;
+  static const size_t kNumThreadLocalSizeBrackets = 24;
   static_assert(kNumThreadLocalSizeBrackets == kNumRosAllocThreadLocalSizeBracketsInThread,
                 "Mismatch between kNumThreadLocalSizeBrackets and "
                 "kNumRosAllocThreadLocalSizeBracketsInThread");
 
   // The size of the largest bracket we use thread-local runs for.
   // This should be equal to bracketSizes[kNumThreadLocalSizeBrackets - 1].
-  static const size_t kMaxThreadLocalBracketSize = 128;
+  static const size_t kMaxThreadLocalBracketSize = 256;
+
+  // The allocation fast paths in compiled code handle the size brackets
+  // whose indexes are less than this index. These are the 8-byte increment
+  // brackets, whose thread-local run index the fast paths compute from the
+  // size.
+  static const size_t kNumFastPathSizeBrackets = 16;
+
+  // The size of the largest bracket the fast paths handle.
+  // This should be equal to bracketSizes[kNumFastPathSizeBrackets - 1].
+  static const size_t kMaxFastPathBracketSize = 128;
 
   // We use regular (8 or 16-bytes increment) runs for the size brackets whose indexes are less than
   // this index.
@@ -680,14 +697,14 @@ class RosAlloc {
   // 1 KB and the 2 KB brackets. This should be equal to bracketSizes[kNumRegularSizeBrackets - 1].
   static const size_t kMaxRegularBracketSize = 512;
 
-  // The bracket size increment for the thread-local brackets (<= kMaxThreadLocalBracketSize bytes).
+  // The bracket size increment for the fast path brackets (<= kMaxFastPathBracketSize bytes).
   static constexpr size_t kThreadLocalBracketQuantumSize = 8;
 
   // Equal to Log2(kThreadLocalBracketQuantumSize).
   static constexpr size_t kThreadLocalBracketQuantumSizeShift = 3;
 
-  // The bracket size increment for the non-thread-local, regular brackets (of size <=
-  // kMaxRegularBracketSize bytes and > kMaxThreadLocalBracketSize bytes).
+  // The bracket size increment for the other regular brackets (of size <=
+  // kMaxRegularBracketSize bytes and > kMaxFastPathBracketSize bytes).
   static constexpr size_t kBracketQuantumSize = 16;
 
   // Equal to Log2(kBracketQuantumSize).
@@ -821,8 +838,10 @@ class RosAlloc {
   // Revoke the current runs which share an index with the thread local runs.
   void RevokeThreadUnsafeCurrentRuns() REQUIRES(!lock_);
 
-  // Release a range of pages.
-  size_t ReleasePageRange(uint8_t* start, uint8_t* end) REQUIRES(lock_);
+  // Release a range of pages. starts_free_page_run tells whether start is the first page of a free
+  // page run, which debug builds keep for its magic number.
+  size_t ReleasePageRange(uint8_t* start, uint8_t* end, bool starts_free_page_run)
+      REQUIRES(lock_);
 
   // Dumps the page map for debugging.
   std::string DumpPageMap() REQUIRES(lock_);
@@ -890,7 +909,8 @@ class RosAlloc {
                   void* arg)
       REQUIRES(!lock_);
 
-  // Release empty pages.
+  // Release empty pages. Large free page runs are released in chunks of at most
+  // kMaxReleaseBytesPerLock, the lock is dropped between the chunks.
   size_t ReleasePages() REQUIRES(!lock_);
   // Returns the current footprint.
   size_t Footprint() REQUIRES(!lock_);
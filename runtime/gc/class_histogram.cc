@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "class_histogram.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <ostream>
+#include <vector>
+
+#include "utils.h"
+
+namespace art {
+namespace gc {
+
+const ClassHistogram::Entry* ClassHistogram::Find(const std::string& descriptor) const {
+  auto it = entries_.find(descriptor);
+  return it != entries_.end() ? &it->second : nullptr;
+}
+
+void ClassHistogram::Subtract(const ClassHistogram& earlier) {
+  for (const auto& pair : earlier.entries_) {
+    Entry* entry = GetOrCreateEntry(pair.first);
+    entry->instances -= pair.second.instances;
+    entry->bytes -= pair.second.bytes;
+  }
+  for (auto it = entries_.begin(); it != entries_.end();) {
+    if (it->second.instances == 0 && it->second.bytes == 0) {
+      it = entries_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+int64_t ClassHistogram::GetTotalInstances() const {
+  int64_t total = 0;
+  for (const auto& pair : entries_) {
+    total += pair.second.instances;
+  }
+  return total;
+}
+
+int64_t ClassHistogram::GetTotalBytes() const {
+  int64_t total = 0;
+  for (const auto& pair : entries_) {
+    total += pair.second.bytes;
+  }
+  return total;
+}
+
+void ClassHistogram::Dump(std::ostream& os, size_t max_classes) const {
+  os << "Class histogram: " << GetClassCount() << " classes, " << GetTotalInstances()
+     << " instances, " << PrettySize(GetTotalBytes()) << "\n";
+  std::vector<const std::pair<const std::string, Entry>*> sorted;
+  sorted.reserve(entries_.size());
+  for (const auto& pair : entries_) {
+    sorted.push_back(&pair);
+  }
+  auto by_size = [](const std::pair<const std::string, Entry>* a,
+                    const std::pair<const std::string, Entry>* b) {
+    return std::abs(a->second.bytes) > std::abs(b->second.bytes);
+  };
+  const size_t count = std::min(max_classes, sorted.size());
+  std::partial_sort(sorted.begin(), sorted.begin() + count, sorted.end(), by_size);
+  for (size_t i = 0; i < count; ++i) {
+    os << std::setw(10) << PrettySize(sorted[i]->second.bytes) << " "
+       << std::setw(10) << sorted[i]->second.instances << " " << sorted[i]->first << "\n";
+  }
+}
+
+}  // namespace gc
+}  // namespace art
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_GC_CLASS_HISTOGRAM_H_
+#define ART_RUNTIME_GC_CLASS_HISTOGRAM_H_
+
+#include <iosfwd>
+#include <string>
+
+#include "safe_map.h"
+
+namespace art {
+namespace gc {
+
+// Instance counts and sizes of the live objects per class, see Heap::GetClassHistogram. Classes
+// are keyed by descriptor so that histograms taken at different times can be compared; classes
+// of the same name defined by different class loaders are merged.
+class ClassHistogram {
+ public:
+  struct Entry {
+    // Signed so that the difference of two histograms is a histogram too.
+    int64_t instances = 0;
+    int64_t bytes = 0;
+  };
+
+  // The entry of a class, created empty if the class has none yet.
+  Entry* GetOrCreateEntry(const std::string& descriptor) {
+    return &entries_.FindOrAdd(descriptor)->second;
+  }
+
+  // The entry of a class, or null if it has none.
+  const Entry* Find(const std::string& descriptor) const;
+
+  // Subtract an earlier histogram, only the classes whose count or size changed are kept.
+  void Subtract(const ClassHistogram& earlier);
+
+  size_t GetClassCount() const {
+    return entries_.size();
+  }
+  int64_t GetTotalInstances() const;
+  int64_t GetTotalBytes() const;
+
+  // The totals and the classes with the most bytes, or with the largest change of size for a
+  // difference.
+  void Dump(std::ostream& os, size_t max_classes) const;
+
+ private:
+  SafeMap<std::string, Entry> entries_;
+};
+
+}  // namespace gc
+}  // namespace art
+
+#endif  // ART_RUNTIME_GC_CLASS_HISTOGRAM_H_
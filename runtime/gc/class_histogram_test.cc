@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "class_histogram.h"
+
+#include "common_runtime_test.h"
+#include "gc/heap.h"
+#include "handle_scope-inl.h"
+#include "mirror/string.h"
+#include "scoped_thread_state_change-inl.h"
+
+namespace art {
+namespace gc {
+
+class ClassHistogramTest : public CommonRuntimeTest {};
+
+TEST_F(ClassHistogramTest, Subtract) {
+  ClassHistogram before;
+  before.GetOrCreateEntry("A")->instances = 2;
+  before.GetOrCreateEntry("A")->bytes = 32;
+  before.GetOrCreateEntry("B")->instances = 1;
+  before.GetOrCreateEntry("B")->bytes = 100;
+  ClassHistogram after;
+  after.GetOrCreateEntry("A")->instances = 2;
+  after.GetOrCreateEntry("A")->bytes = 32;
+  after.GetOrCreateEntry("C")->instances = 3;
+  after.GetOrCreateEntry("C")->bytes = 48;
+
+  after.Subtract(before);
+  EXPECT_EQ(2u, after.GetClassCount());
+  EXPECT_TRUE(after.Find("A") == nullptr);
+  ASSERT_TRUE(after.Find("B") != nullptr);
+  EXPECT_EQ(-1, after.Find("B")->instances);
+  EXPECT_EQ(-100, after.Find("B")->bytes);
+  ASSERT_TRUE(after.Find("C") != nullptr);
+  EXPECT_EQ(3, after.Find("C")->instances);
+  EXPECT_EQ(2, after.GetTotalInstances());
+  EXPECT_EQ(-52, after.GetTotalBytes());
+}
+
+TEST_F(ClassHistogramTest, CountsLiveObjects) {
+  ScopedObjectAccess soa(Thread::Current());
+  Heap* heap = Runtime::Current()->GetHeap();
+  ClassHistogram before;
+  heap->GetClassHistogram(&before);
+  EXPECT_NE(0u, before.GetClassCount());
+
+  static constexpr size_t kStrings = 10;
+  StackHandleScope<kStrings> hs(soa.Self());
+  for (size_t i = 0; i < kStrings; ++i) {
+    Handle<mirror::String> string(
+        hs.NewHandle(mirror::String::AllocFromModifiedUtf8(soa.Self(), "histogram")));
+    ASSERT_TRUE(string != nullptr);
+  }
+  ClassHistogram after;
+  heap->GetClassHistogram(&after);
+  const ClassHistogram::Entry* strings = after.Find("java.lang.String");
+  ASSERT_TRUE(strings != nullptr);
+  const ClassHistogram::Entry* strings_before = before.Find("java.lang.String");
+  const int64_t instances_before = strings_before != nullptr ? strings_before->instances : 0;
+  EXPECT_GE(strings->instances, instances_before + static_cast<int64_t>(kStrings));
+}
+
+}  // namespace gc
+}  // namespace art
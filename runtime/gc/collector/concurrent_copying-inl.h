@@ -25,11 +25,16 @@
 #include "gc/space/region_space.h"
 #include "lock_word.h"
 #include "mirror/object-readbarrier-inl.h"
+#include "thread.h"
 
 namespace art {
 namespace gc {
 namespace collector {
 
+inline bool ConcurrentCopying::IsGcMarkingThread(Thread* self) const {
+  return self == thread_running_gc_ || self->IsGcMarkingWorker();
+}
+
 inline mirror::Object* ConcurrentCopying::MarkUnevacFromSpaceRegion(
     mirror::Object* ref, accounting::ContinuousSpaceBitmap* bitmap) {
   // For the Baker-style RB, in a rare case, we could incorrectly change the object from white
@@ -57,6 +62,17 @@ inline mirror::Object* ConcurrentCopying::MarkUnevacFromSpaceRegion(
     success = !bitmap->AtomicTestAndSet(ref);
   }
   if (success) {
+    if (kUseBakerReadBarrier && parallel_marking_) {
+      // Don't push an object that was already marked through, as MarkNonMoving does: leave it on
+      // the false gray stack, changed back to white at the end of marking. It was white, so the
+      // thread that marked it through, if any, has set the bitmap and finished with it. The fence
+      // pairs with the CAS release of that thread in ProcessMarkStackRef.
+      QuasiAtomic::ThreadFenceAcquire();
+      if (bitmap->Test(ref)) {
+        PushOntoFalseGrayStack(ref);
+        return ref;
+      }
+    }
     // Newly marked.
     if (kUseBakerReadBarrier) {
       DCHECK_EQ(ref->GetReadBarrierState(), ReadBarrier::GrayState());
@@ -74,7 +90,7 @@ inline mirror::Object* ConcurrentCopying::MarkImmuneSpace(mirror::Object* ref) {
     // true). Also, a mutator doesn't (need to) gray an immune object after GC has updated all
     // immune space objects (when updated_all_immune_objects_ is true).
     if (kIsDebugBuild) {
-      if (Thread::Current() == thread_running_gc_) {
+      if (IsGcMarkingThread(Thread::Current())) {
         DCHECK(!kGrayImmuneObject ||
                updated_all_immune_objects_.LoadRelaxed() ||
                gc_grays_immune_objects_);
@@ -106,7 +122,7 @@ inline mirror::Object* ConcurrentCopying::Mark(mirror::Object* from_ref,
   DCHECK(heap_->collector_type_ == kCollectorTypeCC);
   if (kFromGCThread) {
     DCHECK(is_active_);
-    DCHECK_EQ(Thread::Current(), thread_running_gc_);
+    DCHECK(IsGcMarkingThread(Thread::Current()));
   } else if (UNLIKELY(kUseBakerReadBarrier && !is_active_)) {
     // In the lock word forward address state, the read barrier bits
     // in the lock word are part of the stored forwarding address and
@@ -16,6 +16,8 @@
 
 #include "concurrent_copying.h"
 
+#include <sched.h>
+
 #include "art_field-inl.h"
 #include "base/enums.h"
 #include "base/histogram-inl.h"
@@ -40,6 +42,7 @@
 #include "scoped_thread_state_change-inl.h"
 #include "thread-inl.h"
 #include "thread_list.h"
+#include "thread_pool.h"
 #include "well_known_classes.h"
 
 namespace art {
@@ -61,6 +64,7 @@ static constexpr size_t kReadBarrierMarkStackSize = 512 * KB;
 static constexpr bool kVerifyNoMissingCardMarks = kIsDebugBuild;
 
 ConcurrentCopying::ConcurrentCopying(Heap* heap,
+                                     bool young_gen,
                                      const std::string& name_prefix,
                                      bool measure_read_barrier_slow_path)
     : GarbageCollector(heap,
@@ -76,6 +80,8 @@ ConcurrentCopying::ConcurrentCopying(Heap* heap,
       rb_mark_bit_stack_full_(false),
       mark_stack_lock_("concurrent copying mark stack lock", kMarkSweepMarkStackLock),
       thread_running_gc_(nullptr),
+      parallel_marking_(false),
+      num_busy_markers_(0),
       is_marking_(false),
       is_using_read_barrier_entrypoints_(false),
       is_active_(false),
@@ -98,6 +104,7 @@ ConcurrentCopying::ConcurrentCopying(Heap* heap,
       rb_slow_path_count_total_(0),
       rb_slow_path_count_gc_total_(0),
       rb_table_(heap_->GetReadBarrierTable()),
+      young_gen_(young_gen),
       force_evacuate_all_(false),
       gc_grays_immune_objects_(false),
       immune_gray_stack_lock_("concurrent copying immune gray stack lock",
@@ -164,6 +171,11 @@ void ConcurrentCopying::RunPhases() {
     ReaderMutexLock mu(self, *Locks::mutator_lock_);
     InitializePhase();
   }
+  if (heap_->UseGenerationalCC()) {
+    // Age the generational cards concurrently, the pause only looks at the cards dirtied since.
+    ReaderMutexLock mu(self, *Locks::mutator_lock_);
+    AgeGenerationalCards();
+  }
   if (kUseBakerReadBarrier && kGrayDirtyImmuneObjects) {
     // Switch to read barrier mark entrypoints before we gray the objects. This is required in case
     // a mutator sees a gray bit and dispatches on the entrypoint. (b/37876887).
@@ -172,6 +184,9 @@ void ConcurrentCopying::RunPhases() {
     // the pause.
     ReaderMutexLock mu(self, *Locks::mutator_lock_);
     GrayAllDirtyImmuneObjects();
+    if (young_gen_) {
+      GrayAllDirtyOldObjects();
+    }
   }
   FlipThreadRoots();
   {
@@ -266,9 +281,12 @@ void ConcurrentCopying::BindBitmaps() {
       immune_spaces_.AddSpace(space);
     } else if (space == region_space_) {
       // It is OK to clear the bitmap with mutators running since the only place it is read is
-      // VisitObjects which has exclusion with CC.
+      // VisitObjects which has exclusion with CC. A young-generation GC keeps the bitmap: it has
+      // no unevacuated regions to mark, and the old regions need it to find their live objects.
       region_space_bitmap_ = region_space_->GetMarkBitmap();
-      region_space_bitmap_->Clear();
+      if (!young_gen_) {
+        region_space_bitmap_->Clear();
+      }
     }
   }
 }
@@ -298,7 +316,10 @@ void ConcurrentCopying::InitializePhase() {
   bytes_moved_.StoreRelaxed(0);
   objects_moved_.StoreRelaxed(0);
   GcCause gc_cause = GetCurrentIteration()->GetGcCause();
-  if (gc_cause == kGcCauseExplicit ||
+  if (young_gen_) {
+    // The heap runs a full GC for the causes below.
+    force_evacuate_all_ = false;
+  } else if (gc_cause == kGcCauseExplicit ||
       gc_cause == kGcCauseForNativeAllocBlocking ||
       gc_cause == kGcCauseCollectorTransition ||
       GetCurrentIteration()->GetClearSoftReferences()) {
@@ -325,8 +346,11 @@ void ConcurrentCopying::InitializePhase() {
     }
     LOG(INFO) << "GC end of InitializePhase";
   }
-  // Mark all of the zygote large objects without graying them.
-  MarkZygoteLargeObjects();
+  // Mark all of the zygote large objects without graying them. A young-generation GC does not
+  // sweep the large object space.
+  if (!young_gen_) {
+    MarkZygoteLargeObjects();
+  }
 }
 
 // Used to switch the thread roots of a thread from from-space refs to to-space refs.
@@ -419,19 +443,37 @@ class ConcurrentCopying::FlipCallback : public Closure {
     Locks::mutator_lock_->AssertExclusiveHeld(self);
     {
       TimingLogger::ScopedTiming split2("(Paused)SetFromSpace", cc->GetTimings());
-      cc->region_space_->SetFromSpace(cc->rb_table_, cc->force_evacuate_all_);
+      space::RegionSpace::EvacMode evac_mode =
+          cc->young_gen_
+              ? space::RegionSpace::EvacMode::kEvacModeNewlyAllocated
+              : (cc->force_evacuate_all_
+                     ? space::RegionSpace::EvacMode::kEvacModeForceAll
+                     : space::RegionSpace::EvacMode::kEvacModeLivePercentNewlyAllocated);
+      cc->region_space_->SetFromSpace(cc->rb_table_, evac_mode);
     }
     cc->SwapStacks();
     if (ConcurrentCopying::kEnableFromSpaceAccountingCheck) {
       cc->RecordLiveStackFreezeSize(self);
-      cc->from_space_num_objects_at_first_pause_ = cc->region_space_->GetObjectsAllocated();
-      cc->from_space_num_bytes_at_first_pause_ = cc->region_space_->GetBytesAllocated();
+      if (cc->young_gen_) {
+        // The old regions stay in the to-space and are not accounted as from-space.
+        cc->from_space_num_objects_at_first_pause_ =
+            cc->region_space_->GetObjectsAllocatedInFromSpace();
+        cc->from_space_num_bytes_at_first_pause_ =
+            cc->region_space_->GetBytesAllocatedInFromSpace();
+      } else {
+        cc->from_space_num_objects_at_first_pause_ = cc->region_space_->GetObjectsAllocated();
+        cc->from_space_num_bytes_at_first_pause_ = cc->region_space_->GetBytesAllocated();
+      }
     }
     cc->is_marking_ = true;
     cc->mark_stack_mode_.StoreRelaxed(ConcurrentCopying::kMarkStackModeThreadLocal);
-    if (kIsDebugBuild) {
+    if (kIsDebugBuild && !cc->young_gen_) {
+      // Old regions keep their live bytes across young-generation GCs.
       cc->region_space_->AssertAllRegionLiveBytesZeroOrCleared();
     }
+    if (cc->young_gen_) {
+      cc->GrayAllNewlyDirtyOldObjects();
+    }
     if (UNLIKELY(Runtime::Current()->IsActiveTransaction())) {
       CHECK(Runtime::Current()->IsAotCompiler());
       TimingLogger::ScopedTiming split3("(Paused)VisitTransactionRoots", cc->GetTimings());
@@ -729,6 +771,158 @@ void ConcurrentCopying::GrayAllNewlyDirtyImmuneObjects() {
   updated_all_immune_objects_.StoreRelaxed(true);
 }
 
+void ConcurrentCopying::AgeGenerationalCards() {
+  TimingLogger::ScopedTiming split("AgeGenerationalCards", GetTimings());
+  DCHECK(heap_->UseGenerationalCC());
+  if (young_gen_) {
+    // The old regions, which the card scans walk, do not change until this GC reclaims.
+    region_space_->RecordOldRegions();
+  }
+  // Age with a CAS so that a card the mutators dirty after it is aged stays dirty. Those are the
+  // only cards the pause has to look at.
+  accounting::CardTable* const card_table = heap_->GetCardTable();
+  auto age_card = [](uint8_t card) {
+    return (card != accounting::CardTable::kCardClean) ? accounting::CardTable::kCardAged : card;
+  };
+  card_table->ModifyCardsAtomic(region_space_->Begin(),
+                                region_space_->Limit(),
+                                age_card,
+                                /* card modified visitor */ VoidFunctor());
+  space::ContinuousSpace* non_moving_space = heap_->GetNonMovingSpace();
+  if (non_moving_space != nullptr) {
+    card_table->ModifyCardsAtomic(non_moving_space->Begin(),
+                                  non_moving_space->Limit(),
+                                  age_card,
+                                  /* card modified visitor */ VoidFunctor());
+  }
+}
+
+void ConcurrentCopying::GrayAllDirtyOldObjects() {
+  TimingLogger::ScopedTiming split("GrayAllDirtyOldObjects", GetTimings());
+  DCHECK(young_gen_);
+  DCHECK(old_gray_stack_.empty());
+  accounting::CardTable* const card_table = heap_->GetCardTable();
+  Thread* const self = Thread::Current();
+  // The old objects are not traced by a young-generation GC. The ones on aged cards may refer to
+  // the from-space, so gray them before the mutators resume after the flip, which routes the
+  // mutator reads of their fields through the read barrier, and let the GC scan them. Until the
+  // flip the read barrier returns the reference unchanged. The read barrier state shares the lock
+  // word with the mutators, hence the CAS.
+  auto visitor = [this](mirror::Object* obj) REQUIRES_SHARED(Locks::mutator_lock_) {
+    if (obj->GetReadBarrierState() == ReadBarrier::WhiteState() &&
+        obj->AtomicSetReadBarrierState(ReadBarrier::WhiteState(), ReadBarrier::GrayState())) {
+      old_gray_stack_.push_back(obj);
+    }
+  };
+  region_space_->VisitOldObjectsOnCards(card_table, accounting::CardTable::kCardAged, visitor);
+  space::ContinuousSpace* non_moving_space = heap_->GetNonMovingSpace();
+  if (non_moving_space != nullptr) {
+    // The objects allocated since the last GC are only on the allocation stack, the pause grays
+    // those.
+    WriterMutexLock mu(self, *Locks::heap_bitmap_lock_);
+    card_table->Scan</* kClearCard */ false>(non_moving_space->GetLiveBitmap(),
+                                             non_moving_space->Begin(),
+                                             non_moving_space->End(),
+                                             visitor,
+                                             accounting::CardTable::kCardAged);
+  }
+}
+
+void ConcurrentCopying::GrayAllNewlyDirtyOldObjects() {
+  TimingLogger::ScopedTiming split("(Paused)GrayAllNewlyDirtyOldObjects", GetTimings());
+  DCHECK(young_gen_);
+  accounting::CardTable* const card_table = heap_->GetCardTable();
+  Thread* const self = Thread::Current();
+  // Without the concurrent graying, the aged cards are all left to the pause.
+  const uint8_t minimum_age = (kUseBakerReadBarrier && kGrayDirtyImmuneObjects)
+      ? accounting::CardTable::kCardDirty
+      : accounting::CardTable::kCardAged;
+  auto visitor = [this](mirror::Object* obj) NO_THREAD_SAFETY_ANALYSIS {
+    if (kUseBakerReadBarrier) {
+      if (obj->GetReadBarrierState() != ReadBarrier::WhiteState()) {
+        return;
+      }
+      obj->SetReadBarrierState(ReadBarrier::GrayState());
+    }
+    old_gray_stack_.push_back(obj);
+  };
+  region_space_->VisitOldObjectsOnCards(card_table, minimum_age, visitor);
+  space::ContinuousSpace* non_moving_space = heap_->GetNonMovingSpace();
+  if (non_moving_space != nullptr) {
+    WriterMutexLock mu(self, *Locks::heap_bitmap_lock_);
+    card_table->Scan</* kClearCard */ false>(non_moving_space->GetLiveBitmap(),
+                                             non_moving_space->Begin(),
+                                             non_moving_space->End(),
+                                             visitor,
+                                             minimum_age);
+    // The objects allocated since the last GC are only on the live stack, which the concurrent
+    // card scan could not see. Add them to the bitmap, Sweep() does the same later, which is
+    // harmless, and gray the ones on aged cards. This costs as much as the non-moving
+    // allocations since the last GC.
+    accounting::ObjectStack* live_stack = heap_->GetLiveStack();
+    heap_->MarkAllocStackAsLive(live_stack);
+    for (StackReference<mirror::Object>* it = live_stack->Begin(); it != live_stack->End(); ++it) {
+      mirror::Object* obj = it->AsMirrorPtr();
+      if (obj != nullptr &&
+          non_moving_space->HasAddress(obj) &&
+          *card_table->CardFromAddr(obj) >= accounting::CardTable::kCardAged) {
+        visitor(obj);
+      }
+    }
+  }
+  // Age the cards scanned here, ClearGenerationalCards() clears them after the flip. No mutator
+  // runs, but keep to the atomic update that the concurrent aging and clearing use.
+  auto age_dirty_card = [](uint8_t card) {
+    return (card == accounting::CardTable::kCardDirty) ? accounting::CardTable::kCardAged : card;
+  };
+  card_table->ModifyCardsAtomic(region_space_->Begin(),
+                                region_space_->Limit(),
+                                age_dirty_card,
+                                /* card modified visitor */ VoidFunctor());
+  if (non_moving_space != nullptr) {
+    card_table->ModifyCardsAtomic(non_moving_space->Begin(),
+                                  non_moving_space->Limit(),
+                                  age_dirty_card,
+                                  /* card modified visitor */ VoidFunctor());
+  }
+}
+
+void ConcurrentCopying::PushGrayOldObjects() {
+  TimingLogger::ScopedTiming split("PushGrayOldObjects", GetTimings());
+  DCHECK(young_gen_);
+  if (kVerboseMode) {
+    LOG(INFO) << "old gray stack size=" << old_gray_stack_.size();
+  }
+  // Each object is on the stack once, so it is scanned and whitened once.
+  for (mirror::Object* obj : old_gray_stack_) {
+    PushOntoMarkStack(obj);
+  }
+  old_gray_stack_.clear();
+}
+
+void ConcurrentCopying::ClearGenerationalCards() {
+  TimingLogger::ScopedTiming split("ClearGenerationalCards", GetTimings());
+  // Every old object that may refer to a young one is either grayed for the GC to scan, or traced
+  // by a full GC, and the aged cards hold no other old-to-young reference. A card the mutators
+  // dirtied after the aging stays dirty, as the stores since the flip are the ones the next
+  // young-generation GC needs.
+  accounting::CardTable* const card_table = heap_->GetCardTable();
+  auto clear_aged_card = [](uint8_t card) {
+    return (card == accounting::CardTable::kCardAged) ? accounting::CardTable::kCardClean : card;
+  };
+  card_table->ModifyCardsAtomic(region_space_->Begin(),
+                                region_space_->Limit(),
+                                clear_aged_card,
+                                /* card modified visitor */ VoidFunctor());
+  space::ContinuousSpace* non_moving_space = heap_->GetNonMovingSpace();
+  if (non_moving_space != nullptr) {
+    card_table->ModifyCardsAtomic(non_moving_space->Begin(),
+                                  non_moving_space->Limit(),
+                                  clear_aged_card,
+                                  /* card modified visitor */ VoidFunctor());
+  }
+}
+
 void ConcurrentCopying::SwapStacks() {
   heap_->SwapStacks();
 }
@@ -833,6 +1027,12 @@ void ConcurrentCopying::MarkingPhase() {
     }
     immune_gray_stack_.clear();
   }
+  if (young_gen_) {
+    PushGrayOldObjects();
+  }
+  if (heap_->UseGenerationalCC()) {
+    ClearGenerationalCards();
+  }
 
   {
     TimingLogger::ScopedTiming split2("VisitConcurrentRoots", GetTimings());
@@ -867,6 +1067,9 @@ void ConcurrentCopying::MarkingPhase() {
     // mutators safely transition to the shared mark stack mode (without leaving unprocessed refs on
     // the thread-local mark stacks), without a race. This is why we use a thread-local weak ref
     // access flag Thread::tls32_.weak_ref_access_enabled_ instead of the global ones.
+    // System weak tables swept in the previous cycle must wait for this cycle's sweep before they
+    // can be read without weak ref access.
+    Runtime::Current()->MarkSystemWeaksUnswept();
     SwitchToSharedMarkStackMode();
     CHECK(!self->GetWeakRefAccessEnabled());
     // Now that weak refs accesses are disabled, once we exhaust the shared mark stack again here
@@ -1411,12 +1614,18 @@ bool ConcurrentCopying::ProcessMarkStackOnce() {
   size_t count = 0;
   MarkStackMode mark_stack_mode = mark_stack_mode_.LoadRelaxed();
   if (mark_stack_mode == kMarkStackModeThreadLocal) {
-    // Process the thread-local mark stacks and the GC mark stack.
-    count += ProcessThreadLocalMarkStacks(false, nullptr);
-    while (!gc_mark_stack_->IsEmpty()) {
-      mirror::Object* to_ref = gc_mark_stack_->PopBack();
-      ProcessMarkStackRef(to_ref);
-      ++count;
+    ThreadPool* thread_pool = heap_->GetThreadPool();
+    if (thread_pool != nullptr && heap_->GetParallelGCThreadCount() != 0) {
+      // Process the thread-local mark stacks and the GC mark stack with the heap thread pool.
+      count += ProcessThreadLocalMarkStacksParallel(thread_pool);
+    } else {
+      // Process the thread-local mark stacks and the GC mark stack.
+      count += ProcessThreadLocalMarkStacks(false, nullptr);
+      while (!gc_mark_stack_->IsEmpty()) {
+        mirror::Object* to_ref = gc_mark_stack_->PopBack();
+        ProcessMarkStackRef(to_ref);
+        ++count;
+      }
     }
     gc_mark_stack_->Reset();
   } else if (mark_stack_mode == kMarkStackModeShared) {
@@ -1486,17 +1695,148 @@ size_t ConcurrentCopying::ProcessThreadLocalMarkStacks(bool disable_weak_ref_acc
       ProcessMarkStackRef(to_ref);
       ++count;
     }
+    RecycleMarkStack(Thread::Current(), mark_stack);
+  }
+  return count;
+}
+
+void ConcurrentCopying::RecycleMarkStack(Thread* self, accounting::ObjectStack* mark_stack) {
+  MutexLock mu(self, mark_stack_lock_);
+  if (pooled_mark_stacks_.size() >= kMarkStackPoolSize) {
+    // The pool has enough. Delete it.
+    delete mark_stack;
+  } else {
+    // Otherwise, put it into the pool for later reuse.
+    mark_stack->Reset();
+    pooled_mark_stacks_.push_back(mark_stack);
+  }
+}
+
+class ConcurrentCopying::ParallelMarkTask : public Task {
+ public:
+  ParallelMarkTask(ConcurrentCopying* collector, Atomic<size_t>* count)
+      : collector_(collector), count_(count) {}
+
+  // The GC-running thread holds the mutator lock on behalf of the workers, and waits for them.
+  void Run(Thread* self) OVERRIDE NO_THREAD_SAFETY_ANALYSIS {
+    self->SetIsGcMarkingWorker(true);
+    count_->FetchAndAddSequentiallyConsistent(collector_->RunParallelMarking(self));
+    self->SetIsGcMarkingWorker(false);
+  }
+
+  void Finalize() OVERRIDE {
+    delete this;
+  }
+
+ private:
+  ConcurrentCopying* const collector_;
+  Atomic<size_t>* const count_;
+};
+
+size_t ConcurrentCopying::ProcessThreadLocalMarkStacksParallel(ThreadPool* thread_pool) {
+  Thread* self = Thread::Current();
+  RevokeThreadLocalMarkStacks(false, nullptr);
+  size_t num_refs = gc_mark_stack_->Size();
+  {
+    MutexLock mu(self, mark_stack_lock_);
+    for (accounting::ObjectStack* mark_stack : revoked_mark_stacks_) {
+      num_refs += mark_stack->Size();
+    }
+  }
+  if (num_refs < kMinRefsForParallelMarking) {
+    // Not worth waking up the workers, process the mark stacks on this thread only.
+    num_busy_markers_.StoreSequentiallyConsistent(1);
+    return RunParallelMarking(self);
+  }
+
+  // Every marking thread claims whole mark stacks from revoked_mark_stacks_, and pushes the refs
+  // it marks onto its own mark stack which it drains itself. A thread-local mark stack which
+  // overflows is revoked, so that idle threads can take over the rest of its work.
+  size_t num_workers = std::min(thread_pool->GetThreadCount(), heap_->GetParallelGCThreadCount());
+  Atomic<size_t> count(0);
+  parallel_marking_ = true;
+  num_busy_markers_.StoreSequentiallyConsistent(num_workers + 1);
+  for (size_t i = 0; i < num_workers; ++i) {
+    thread_pool->AddTask(self, new ParallelMarkTask(this, &count));
+  }
+  thread_pool->SetMaxActiveWorkers(num_workers);
+  thread_pool->StartWorkers(self);
+  count.FetchAndAddSequentiallyConsistent(RunParallelMarking(self));
+  thread_pool->Wait(self, /* do_work */ true, /* may_hold_locks */ true);
+  thread_pool->StopWorkers(self);
+  parallel_marking_ = false;
+  return count.LoadSequentiallyConsistent();
+}
+
+size_t ConcurrentCopying::RunParallelMarking(Thread* self) {
+  // Refs are moved from the GC mark stack to shareable mark stacks in chunks of this size.
+  static constexpr size_t kGcMarkStackChunkSize = 4 * KB;
+  size_t count = 0;
+  while (true) {
+    // Drain the mark stack this thread pushes onto.
+    if (self == thread_running_gc_) {
+      while (!gc_mark_stack_->IsEmpty()) {
+        if (parallel_marking_ && gc_mark_stack_->Size() > 2 * kGcMarkStackChunkSize) {
+          // Only this thread can access the GC mark stack. Share part of it with the others.
+          MutexLock mu(self, mark_stack_lock_);
+          accounting::ObjectStack* chunk;
+          if (!pooled_mark_stacks_.empty()) {
+            chunk = pooled_mark_stacks_.back();
+            pooled_mark_stacks_.pop_back();
+          } else {
+            chunk = accounting::ObjectStack::Create(
+                "thread local mark stack", kGcMarkStackChunkSize, kGcMarkStackChunkSize);
+          }
+          DCHECK(chunk->IsEmpty());
+          while (!chunk->IsFull()) {
+            chunk->PushBack(gc_mark_stack_->PopBack());
+          }
+          revoked_mark_stacks_.push_back(chunk);
+        }
+        ProcessMarkStackRef(gc_mark_stack_->PopBack());
+        ++count;
+      }
+    } else {
+      // Pushing may revoke a full thread-local mark stack, so reload it after each ref.
+      accounting::ObjectStack* tl_mark_stack = self->GetThreadLocalMarkStack();
+      while (tl_mark_stack != nullptr && !tl_mark_stack->IsEmpty()) {
+        ProcessMarkStackRef(tl_mark_stack->PopBack());
+        ++count;
+        tl_mark_stack = self->GetThreadLocalMarkStack();
+      }
+    }
+
+    // Claim a revoked mark stack.
+    accounting::ObjectStack* mark_stack = nullptr;
     {
-      MutexLock mu(Thread::Current(), mark_stack_lock_);
-      if (pooled_mark_stacks_.size() >= kMarkStackPoolSize) {
-        // The pool has enough. Delete it.
-        delete mark_stack;
-      } else {
-        // Otherwise, put it into the pool for later reuse.
-        mark_stack->Reset();
-        pooled_mark_stacks_.push_back(mark_stack);
+      MutexLock mu(self, mark_stack_lock_);
+      if (!revoked_mark_stacks_.empty()) {
+        mark_stack = revoked_mark_stacks_.back();
+        revoked_mark_stacks_.pop_back();
       }
     }
+    if (mark_stack != nullptr) {
+      for (StackReference<mirror::Object>* p = mark_stack->Begin(); p != mark_stack->End(); ++p) {
+        ProcessMarkStackRef(p->AsMirrorPtr());
+        ++count;
+      }
+      RecycleMarkStack(self, mark_stack);
+      continue;
+    }
+
+    // Out of work. Wait until a busy marking thread shares some, or all of them are done. Refs
+    // pushed after all the marking threads are done are processed by the next round.
+    num_busy_markers_.FetchAndSubSequentiallyConsistent(1);
+    bool found_work = false;
+    while (!found_work && num_busy_markers_.LoadSequentiallyConsistent() != 0) {
+      sched_yield();
+      MutexLock mu(self, mark_stack_lock_);
+      found_work = !revoked_mark_stacks_.empty();
+    }
+    if (!found_work) {
+      break;
+    }
+    num_busy_markers_.FetchAndAddSequentiallyConsistent(1);
   }
   return count;
 }
@@ -1510,10 +1850,19 @@ inline void ConcurrentCopying::ProcessMarkStackRef(mirror::Object* to_ref) {
   }
   bool add_to_live_bytes = false;
   if (region_space_->IsInUnevacFromSpace(to_ref)) {
-    // Mark the bitmap only in the GC thread here so that we don't need a CAS.
-    if (!kUseBakerReadBarrier || !region_space_bitmap_->Set(to_ref)) {
+    // Mark the bitmap only in the GC marking threads here so that mutators don't need a CAS.
+    // The CAS is only needed when several threads mark in parallel.
+    bool already_marked = false;
+    if (kUseBakerReadBarrier) {
+      already_marked = parallel_marking_
+          ? region_space_bitmap_->AtomicTestAndSet(to_ref)
+          : region_space_bitmap_->Set(to_ref);
+    }
+    if (!already_marked) {
       // It may be already marked if we accidentally pushed the same object twice due to the racy
-      // bitmap read in MarkUnevacFromSpaceRegion.
+      // bitmap read in MarkUnevacFromSpaceRegion. An object is only grayed again once the
+      // thread which marked it through changed it back to white, so the duplicate must be
+      // changed back to white below, also when marking in parallel.
       Scan(to_ref);
       // Only add to the live bytes if the object was not already marked.
       add_to_live_bytes = true;
@@ -1551,12 +1900,16 @@ inline void ConcurrentCopying::ProcessMarkStackRef(mirror::Object* to_ref) {
 #endif
 
   if (add_to_live_bytes) {
-    // Add to the live bytes per unevacuated from space. Note this code is always run by the
-    // GC-running thread (no synchronization required).
+    // Add to the live bytes per unevacuated from space. Note this code is only run by the
+    // GC marking threads, which need synchronization only when marking in parallel.
     DCHECK(region_space_bitmap_->Test(to_ref));
     size_t obj_size = to_ref->SizeOf<kDefaultVerifyFlags>();
     size_t alloc_size = RoundUp(obj_size, space::RegionSpace::kAlignment);
-    region_space_->AddLiveBytes(to_ref, alloc_size);
+    if (parallel_marking_) {
+      region_space_->AtomicAddLiveBytes(to_ref, alloc_size);
+    } else {
+      region_space_->AddLiveBytes(to_ref, alloc_size);
+    }
   }
   if (ReadBarrier::kEnableToSpaceInvariantChecks) {
     CHECK(to_ref != nullptr);
@@ -1671,6 +2024,10 @@ void ConcurrentCopying::Sweep(bool swap_bitmaps) {
     live_stack->Reset();
   }
   CheckEmptyMarkStack();
+  if (young_gen_) {
+    // Nothing outside the newly allocated regions is collected by a young-generation GC.
+    return;
+  }
   TimingLogger::ScopedTiming split("Sweep", GetTimings());
   for (const auto& space : GetHeap()->GetContinuousSpaces()) {
     if (space->IsContinuousMemMapAllocSpace()) {
@@ -1790,7 +2147,10 @@ void ConcurrentCopying::ReclaimPhase() {
   {
     WriterMutexLock mu(self, *Locks::heap_bitmap_lock_);
     Sweep(false);
-    SwapBitmaps();
+    if (!young_gen_) {
+      // A young-generation GC did not mark the non-moving spaces.
+      SwapBitmaps();
+    }
     heap_->UnBindBitmaps();
 
     // The bitmap was cleared at the start of the GC, there is nothing we need to do here.
@@ -1947,7 +2307,7 @@ void ConcurrentCopying::AssertToSpaceInvariantInNonMovingSpace(mirror::Object* o
   if (immune_spaces_.ContainsObject(ref)) {
     if (kUseBakerReadBarrier) {
       // Immune object may not be gray if called from the GC.
-      if (Thread::Current() == thread_running_gc_ && !gc_grays_immune_objects_) {
+      if (IsGcMarkingThread(Thread::Current()) && !gc_grays_immune_objects_) {
         return;
       }
       bool updated_all_immune_objects = updated_all_immune_objects_.LoadSequentiallyConsistent();
@@ -1957,6 +2317,8 @@ void ConcurrentCopying::AssertToSpaceInvariantInNonMovingSpace(mirror::Object* o
           << " ref=" << ref << " ref rb_state=" << ref->GetReadBarrierState()
           << " updated_all_immune_objects=" << updated_all_immune_objects;
     }
+  } else if (young_gen_) {
+    // Non-moving objects are not marked in a young-generation GC, they are all considered live.
   } else {
     accounting::ContinuousSpaceBitmap* mark_bitmap =
         heap_mark_bitmap_->GetContinuousSpaceBitmap(ref);
@@ -2021,7 +2383,7 @@ inline void ConcurrentCopying::Scan(mirror::Object* to_ref) {
     Thread::Current()->ModifyDebugDisallowReadBarrier(1);
   }
   DCHECK(!region_space_->IsInFromSpace(to_ref));
-  DCHECK_EQ(Thread::Current(), thread_running_gc_);
+  DCHECK(IsGcMarkingThread(Thread::Current()));
   RefFieldsVisitor visitor(this);
   // Disable the read barrier for a performance reason.
   to_ref->VisitReferences</*kVisitNativeRoots*/true, kDefaultVerifyFlags, kWithoutReadBarrier>(
@@ -2033,7 +2395,7 @@ inline void ConcurrentCopying::Scan(mirror::Object* to_ref) {
 
 // Process a field.
 inline void ConcurrentCopying::Process(mirror::Object* obj, MemberOffset offset) {
-  DCHECK_EQ(Thread::Current(), thread_running_gc_);
+  DCHECK(IsGcMarkingThread(Thread::Current()));
   mirror::Object* ref = obj->GetFieldObject<
       mirror::Object, kVerifyNone, kWithoutReadBarrier, false>(offset);
   mirror::Object* to_ref = Mark</*kGrayImmuneObject*/false, /*kFromGCThread*/true>(
@@ -2260,8 +2622,10 @@ mirror::Object* ConcurrentCopying::Copy(mirror::Object* from_ref,
   size_t non_moving_space_bytes_allocated = 0U;
   size_t bytes_allocated = 0U;
   size_t dummy;
+  // Keep the survivor on the NUMA node it was allocated on.
+  const uint32_t numa_node = region_space_->NumaNodeOf(from_ref);
   mirror::Object* to_ref = region_space_->AllocNonvirtual<true>(
-      region_space_alloc_size, &region_space_bytes_allocated, nullptr, &dummy);
+      region_space_alloc_size, &region_space_bytes_allocated, nullptr, &dummy, numa_node);
   bytes_allocated = region_space_bytes_allocated;
   if (to_ref != nullptr) {
     DCHECK_EQ(region_space_alloc_size, region_space_bytes_allocated);
@@ -2296,8 +2660,7 @@ mirror::Object* ConcurrentCopying::Copy(mirror::Object* from_ref,
       }
       bytes_allocated = non_moving_space_bytes_allocated;
       // Mark it in the mark bitmap.
-      accounting::ContinuousSpaceBitmap* mark_bitmap =
-          heap_mark_bitmap_->GetContinuousSpaceBitmap(to_ref);
+      accounting::ContinuousSpaceBitmap* mark_bitmap = GetFallBackCopyBitmap(to_ref);
       CHECK(mark_bitmap != nullptr);
       CHECK(!mark_bitmap->AtomicTestAndSet(to_ref));
     }
@@ -2346,8 +2709,7 @@ mirror::Object* ConcurrentCopying::Copy(mirror::Object* from_ref,
         DCHECK(heap_->non_moving_space_->HasAddress(to_ref));
         DCHECK_EQ(bytes_allocated, non_moving_space_bytes_allocated);
         // Free the non-moving-space chunk.
-        accounting::ContinuousSpaceBitmap* mark_bitmap =
-            heap_mark_bitmap_->GetContinuousSpaceBitmap(to_ref);
+        accounting::ContinuousSpaceBitmap* mark_bitmap = GetFallBackCopyBitmap(to_ref);
         CHECK(mark_bitmap != nullptr);
         CHECK(mark_bitmap->Clear(to_ref));
         heap_->non_moving_space_->Free(Thread::Current(), to_ref);
@@ -2385,6 +2747,9 @@ mirror::Object* ConcurrentCopying::Copy(mirror::Object* from_ref,
       bytes_moved_.FetchAndAddRelaxed(region_space_alloc_size);
       if (LIKELY(!fall_back_to_non_moving)) {
         DCHECK(region_space_->IsInToSpace(to_ref));
+        if (region_space_->NumaNodeOf(to_ref) != numa_node) {
+          cumulative_numa_remote_bytes_moved_.FetchAndAddRelaxed(region_space_alloc_size);
+        }
       } else {
         DCHECK(heap_->non_moving_space_->HasAddress(to_ref));
         DCHECK_EQ(bytes_allocated, non_moving_space_bytes_allocated);
@@ -2424,8 +2789,8 @@ mirror::Object* ConcurrentCopying::IsMarked(mirror::Object* from_ref) {
     }
   } else {
     // from_ref is in a non-moving space.
-    if (immune_spaces_.ContainsObject(from_ref)) {
-      // An immune object is alive.
+    if (immune_spaces_.ContainsObject(from_ref) || young_gen_) {
+      // An immune object is alive. So is any non-moving object in a young-generation GC.
       to_ref = from_ref;
     } else {
       // Non-immune non-moving space. Use the mark bitmap.
@@ -2463,6 +2828,16 @@ mirror::Object* ConcurrentCopying::IsMarked(mirror::Object* from_ref) {
   return to_ref;
 }
 
+accounting::ContinuousSpaceBitmap* ConcurrentCopying::GetFallBackCopyBitmap(
+    mirror::Object* to_ref) {
+  if (young_gen_) {
+    // A young-generation GC does not sweep the non-moving space, the copy goes straight to the
+    // live bitmap.
+    return heap_->non_moving_space_->GetLiveBitmap();
+  }
+  return heap_mark_bitmap_->GetContinuousSpaceBitmap(to_ref);
+}
+
 bool ConcurrentCopying::IsOnAllocStack(mirror::Object* ref) {
   QuasiAtomic::ThreadFenceAcquire();
   accounting::ObjectStack* alloc_stack = GetAllocationStack();
@@ -2475,6 +2850,11 @@ mirror::Object* ConcurrentCopying::MarkNonMoving(mirror::Object* ref,
   // ref is in a non-moving space (from_ref == to_ref).
   DCHECK(!region_space_->HasAddress(ref)) << ref;
   DCHECK(!immune_spaces_.ContainsObject(ref));
+  if (young_gen_) {
+    // The non-moving spaces belong to the old generation. Their objects that refer to young
+    // objects were grayed before the mutators resumed.
+    return ref;
+  }
   // Use the mark bitmap.
   accounting::ContinuousSpaceBitmap* mark_bitmap =
       heap_mark_bitmap_->GetContinuousSpaceBitmap(ref);
@@ -2559,8 +2939,9 @@ void ConcurrentCopying::FinishPhase() {
     CHECK_EQ(pooled_mark_stacks_.size(), kMarkStackPoolSize);
   }
   // kVerifyNoMissingCardMarks relies on the region space cards not being cleared to avoid false
-  // positives.
-  if (!kVerifyNoMissingCardMarks) {
+  // positives. The generational mode clears only the aged cards after the flip instead, as
+  // clearing them all here would lose the stores the mutators did during this GC.
+  if (!kVerifyNoMissingCardMarks && !heap_->UseGenerationalCC()) {
     TimingLogger::ScopedTiming split("ClearRegionSpaceCards", GetTimings());
     // We do not currently use the region space cards at all, madvise them away to save ram.
     heap_->GetCardTable()->ClearCardRange(region_space_->Begin(), region_space_->Limit());
@@ -2685,6 +3066,10 @@ void ConcurrentCopying::DumpPerformanceInfo(std::ostream& os) {
   }
   os << "Cumulative bytes moved " << cumulative_bytes_moved_.LoadRelaxed() << "\n";
   os << "Cumulative objects moved " << cumulative_objects_moved_.LoadRelaxed() << "\n";
+  if (region_space_ != nullptr && region_space_->GetNumaNodeCount() > 1) {
+    os << "Cumulative bytes moved to a remote NUMA node "
+       << cumulative_numa_remote_bytes_moved_.LoadRelaxed() << "\n";
+  }
 }
 
 }  // namespace collector
@@ -31,6 +31,7 @@
 namespace art {
 class Closure;
 class RootInfo;
+class ThreadPool;
 
 namespace mirror {
 class Object;
@@ -65,9 +66,12 @@ class ConcurrentCopying : public GarbageCollector {
   // pages.
   static constexpr bool kGrayDirtyImmuneObjects = true;
 
-  explicit ConcurrentCopying(Heap* heap,
-                             const std::string& name_prefix = "",
-                             bool measure_read_barrier_slow_path = false);
+  // A young-generation (sticky) collector only evacuates the regions allocated since the last GC
+  // and treats the rest of the heap as live.
+  ConcurrentCopying(Heap* heap,
+                    bool young_gen,
+                    const std::string& name_prefix = "",
+                    bool measure_read_barrier_slow_path = false);
   ~ConcurrentCopying();
 
   virtual void RunPhases() OVERRIDE
@@ -87,7 +91,7 @@ class ConcurrentCopying : public GarbageCollector {
   void BindBitmaps() REQUIRES_SHARED(Locks::mutator_lock_)
       REQUIRES(!Locks::heap_bitmap_lock_);
   virtual GcType GetGcType() const OVERRIDE {
-    return kGcTypePartial;
+    return young_gen_ ? kGcTypeSticky : kGcTypePartial;
   }
   virtual CollectorType GetCollectorType() const OVERRIDE {
     return kCollectorTypeCC;
@@ -184,8 +188,40 @@ class ConcurrentCopying : public GarbageCollector {
   void VerifyNoMissingCardMarks()
       REQUIRES(Locks::mutator_lock_)
       REQUIRES(!mark_stack_lock_);
+  // Age the cards of the region space and non-moving space, which the generational mode uses to
+  // remember old-to-young references, before the flip.
+  void AgeGenerationalCards()
+      REQUIRES_SHARED(Locks::mutator_lock_);
+  // Gray the old objects on aged cards, which may refer to young objects, before the flip of a
+  // young-generation collection.
+  void GrayAllDirtyOldObjects()
+      REQUIRES_SHARED(Locks::mutator_lock_)
+      REQUIRES(!mark_stack_lock_);
+  // Gray the old objects on the cards dirtied since GrayAllDirtyOldObjects(), in the pause.
+  void GrayAllNewlyDirtyOldObjects()
+      REQUIRES(Locks::mutator_lock_)
+      REQUIRES(!mark_stack_lock_);
+  // Push the grayed old objects for the GC to scan, after the flip.
+  void PushGrayOldObjects()
+      REQUIRES_SHARED(Locks::mutator_lock_)
+      REQUIRES(!mark_stack_lock_);
+  // Clear the aged generational cards after the flip. The cards dirtied since remember the
+  // stores of the mutators for the next young-generation collection.
+  void ClearGenerationalCards()
+      REQUIRES_SHARED(Locks::mutator_lock_);
   size_t ProcessThreadLocalMarkStacks(bool disable_weak_ref_access, Closure* checkpoint_callback)
       REQUIRES_SHARED(Locks::mutator_lock_) REQUIRES(!mark_stack_lock_);
+  // Revoke the thread-local mark stacks and process them, and the GC mark stack, with the heap
+  // thread pool workers. Returns the number of processed refs.
+  size_t ProcessThreadLocalMarkStacksParallel(ThreadPool* thread_pool)
+      REQUIRES_SHARED(Locks::mutator_lock_) REQUIRES(!mark_stack_lock_);
+  // Marking loop of a parallel marking thread. Claims revoked mark stacks, and drains the mark
+  // stack the thread pushes onto, until no marking thread has work left.
+  size_t RunParallelMarking(Thread* self)
+      REQUIRES_SHARED(Locks::mutator_lock_) REQUIRES(!mark_stack_lock_);
+  // Put a processed mark stack back into the pool, or delete it if the pool is full.
+  void RecycleMarkStack(Thread* self, accounting::ObjectStack* mark_stack)
+      REQUIRES(!mark_stack_lock_);
   void RevokeThreadLocalMarkStacks(bool disable_weak_ref_access, Closure* checkpoint_callback)
       REQUIRES_SHARED(Locks::mutator_lock_);
   void SwitchToSharedMarkStackMode() REQUIRES_SHARED(Locks::mutator_lock_)
@@ -215,6 +251,9 @@ class ConcurrentCopying : public GarbageCollector {
       REQUIRES_SHARED(Locks::mutator_lock_) REQUIRES(Locks::heap_bitmap_lock_);
   void MarkZygoteLargeObjects()
       REQUIRES_SHARED(Locks::mutator_lock_);
+  // The bitmap recording an object copied to the non-moving space when the region space is full.
+  accounting::ContinuousSpaceBitmap* GetFallBackCopyBitmap(mirror::Object* to_ref)
+      REQUIRES_SHARED(Locks::mutator_lock_);
   void FillWithDummyObject(mirror::Object* dummy_obj, size_t byte_size)
       REQUIRES(!mark_stack_lock_, !skipped_blocks_lock_, !immune_gray_stack_lock_)
       REQUIRES_SHARED(Locks::mutator_lock_);
@@ -234,6 +273,9 @@ class ConcurrentCopying : public GarbageCollector {
       REQUIRES_SHARED(Locks::mutator_lock_);
   void AssertToSpaceInvariantInNonMovingSpace(mirror::Object* obj, mirror::Object* ref)
       REQUIRES_SHARED(Locks::mutator_lock_);
+  // Whether 'self' may be marking on behalf of the GC: the GC-running thread, or a heap thread
+  // pool worker running a ParallelMarkTask.
+  ALWAYS_INLINE bool IsGcMarkingThread(Thread* self) const;
   void ReenableWeakRefAccess(Thread* self) REQUIRES_SHARED(Locks::mutator_lock_);
   void DisableMarking() REQUIRES_SHARED(Locks::mutator_lock_);
   void IssueDisableMarkingCheckpoint() REQUIRES_SHARED(Locks::mutator_lock_);
@@ -277,6 +319,12 @@ class ConcurrentCopying : public GarbageCollector {
   std::vector<accounting::ObjectStack*> pooled_mark_stacks_
       GUARDED_BY(mark_stack_lock_);
   Thread* thread_running_gc_;
+  // Minimum number of refs to process before marking in parallel with the heap thread pool.
+  static constexpr size_t kMinRefsForParallelMarking = 4 * KB;
+  // True while heap thread pool workers process mark stacks alongside the GC-running thread.
+  bool parallel_marking_;
+  // Number of parallel marking threads which may still produce work.
+  Atomic<size_t> num_busy_markers_;
   bool is_marking_;                       // True while marking is ongoing.
   // True while we might dispatch on the read barrier entrypoints.
   bool is_using_read_barrier_entrypoints_;
@@ -307,6 +355,8 @@ class ConcurrentCopying : public GarbageCollector {
   Atomic<size_t> objects_moved_;
   Atomic<uint64_t> cumulative_bytes_moved_;
   Atomic<uint64_t> cumulative_objects_moved_;
+  // Bytes evacuated into a region of another NUMA node than the one the object came from.
+  Atomic<uint64_t> cumulative_numa_remote_bytes_moved_;
 
   // The skipped blocks are memory blocks/chucks that were copies of
   // objects that were unused due to lost races (cas failures) at
@@ -331,11 +381,16 @@ class ConcurrentCopying : public GarbageCollector {
   uint64_t rb_slow_path_count_gc_total_ GUARDED_BY(rb_slow_path_histogram_lock_);
 
   accounting::ReadBarrierTable* rb_table_;
+  // True if this collector only collects the young generation.
+  const bool young_gen_;
   bool force_evacuate_all_;  // True if all regions are evacuated.
   Atomic<bool> updated_all_immune_objects_;
   bool gc_grays_immune_objects_;
   Mutex immune_gray_stack_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
   std::vector<mirror::Object*> immune_gray_stack_ GUARDED_BY(immune_gray_stack_lock_);
+  // The old objects grayed by a young-generation GC before and in the pause. Only used by the GC
+  // thread.
+  std::vector<mirror::Object*> old_gray_stack_;
 
   // Class of java.lang.Object. Filled in from WellKnownClasses in FlipCallback. Must
   // be filled in before flipping thread roots so that FillDummyObject can run. Not
@@ -355,6 +410,7 @@ class ConcurrentCopying : public GarbageCollector {
   template <bool kConcurrent> class GrayImmuneObjectVisitor;
   class ImmuneSpaceScanObjVisitor;
   class LostCopyVisitor;
+  class ParallelMarkTask;
   class RefFieldsVisitor;
   class RevokeThreadLocalMarkStackCheckpoint;
   class ScopedGcGraysImmuneObjects;
@@ -0,0 +1,253 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "gc/collector/concurrent_copying.h"
+
+#include "class_linker-inl.h"
+#include "common_runtime_test.h"
+#include "gc/accounting/card_table-inl.h"
+#include "gc/heap.h"
+#include "gc/space/region_space.h"
+#include "handle_scope-inl.h"
+#include "java_vm_ext.h"
+#include "mirror/object-readbarrier-inl.h"
+#include "mirror/object_array-inl.h"
+#include "mirror/string-inl.h"
+#include "read_barrier.h"
+#include "scoped_thread_state_change-inl.h"
+#include "thread_pool.h"
+
+namespace art {
+namespace gc {
+namespace collector {
+
+class ConcurrentCopyingTest : public CommonRuntimeTest {
+ protected:
+  void SetUpRuntimeOptions(RuntimeOptions* options) OVERRIDE {
+    CommonRuntimeTest::SetUpRuntimeOptions(options);
+    options->push_back(std::make_pair("-XX:ParallelGCThreads=4", nullptr));
+  }
+};
+
+// Reads all the elements of the arrays until stopped, so that the mutator read barrier marks the
+// objects concurrently with the GC marking threads and grays them again after they were marked
+// through.
+class ReadElementsTask : public Task {
+ public:
+  ReadElementsTask(jobject arrays, Atomic<bool>* stop) : arrays_(arrays), stop_(stop) {}
+
+  void Run(Thread* self) OVERRIDE {
+    while (!stop_->LoadSequentiallyConsistent()) {
+      ScopedObjectAccess soa(self);
+      ObjPtr<mirror::ObjectArray<mirror::ObjectArray<mirror::Object>>> arrays =
+          soa.Decode<mirror::ObjectArray<mirror::ObjectArray<mirror::Object>>>(arrays_);
+      for (int32_t i = 0; i < arrays->GetLength(); ++i) {
+        ObjPtr<mirror::ObjectArray<mirror::Object>> array = arrays->Get(i);
+        for (int32_t j = 0; j < array->GetLength(); ++j) {
+          array->Get(j);
+        }
+      }
+    }
+  }
+
+  void Finalize() OVERRIDE {
+    delete this;
+  }
+
+ private:
+  const jobject arrays_;
+  Atomic<bool>* const stop_;
+};
+
+TEST_F(ConcurrentCopyingTest, NoGrayObjectAfterParallelMarking) {
+  Heap* heap = Runtime::Current()->GetHeap();
+  if (!kUseBakerReadBarrier || heap->CurrentCollectorType() != kCollectorTypeCC) {
+    return;
+  }
+  // Arrays share their elements, which gives several marking threads the same objects to mark.
+  static constexpr int32_t kNumArrays = 64;
+  static constexpr int32_t kArrayLength = 256;
+  static constexpr int32_t kNumStrings = 1024;
+  Thread* self = Thread::Current();
+  jobject arrays_ref;
+  {
+    ScopedObjectAccess soa(self);
+    StackHandleScope<3> hs(self);
+    Handle<mirror::Class> array_class(hs.NewHandle(
+        class_linker_->FindSystemClass(self, "[Ljava/lang/Object;")));
+    Handle<mirror::Class> arrays_class(hs.NewHandle(
+        class_linker_->FindSystemClass(self, "[[Ljava/lang/Object;")));
+    Handle<mirror::ObjectArray<mirror::Object>> strings(hs.NewHandle(
+        mirror::ObjectArray<mirror::Object>::Alloc(self, array_class.Get(), kNumStrings)));
+    ASSERT_TRUE(strings != nullptr);
+    for (int32_t i = 0; i < kNumStrings; ++i) {
+      ObjPtr<mirror::String> string = mirror::String::AllocFromModifiedUtf8(self, "shared");
+      ASSERT_TRUE(string != nullptr);
+      strings->Set<false>(i, string);
+    }
+    StackHandleScope<1> hs2(self);
+    Handle<mirror::ObjectArray<mirror::ObjectArray<mirror::Object>>> arrays(hs2.NewHandle(
+        mirror::ObjectArray<mirror::ObjectArray<mirror::Object>>::Alloc(
+            self, arrays_class.Get(), kNumArrays)));
+    ASSERT_TRUE(arrays != nullptr);
+    for (int32_t i = 0; i < kNumArrays; ++i) {
+      ObjPtr<mirror::ObjectArray<mirror::Object>> array =
+          mirror::ObjectArray<mirror::Object>::Alloc(self, array_class.Get(), kArrayLength);
+      ASSERT_TRUE(array != nullptr);
+      for (int32_t j = 0; j < kArrayLength; ++j) {
+        array->Set<false>(j, strings->Get((i * 7 + j) % kNumStrings));
+      }
+      arrays->Set<false>(i, array);
+    }
+    arrays_ref = soa.Vm()->AddGlobalRef(self, arrays.Get());
+  }
+
+  Atomic<bool> stop(false);
+  ThreadPool readers("Read elements", 2);
+  for (size_t i = 0; i < readers.GetThreadCount(); ++i) {
+    readers.AddTask(self, new ReadElementsTask(arrays_ref, &stop));
+  }
+  readers.StartWorkers(self);
+  for (size_t i = 0; i < 8; ++i) {
+    heap->CollectGarbage(/* clear_soft_references */ false);
+  }
+  stop.StoreSequentiallyConsistent(true);
+  readers.Wait(self, /* do_work */ false, /* may_hold_locks */ false);
+
+  ScopedObjectAccess soa(self);
+  ObjPtr<mirror::ObjectArray<mirror::ObjectArray<mirror::Object>>> arrays =
+      soa.Decode<mirror::ObjectArray<mirror::ObjectArray<mirror::Object>>>(arrays_ref);
+  EXPECT_EQ(arrays->GetReadBarrierState(), ReadBarrier::WhiteState());
+  for (int32_t i = 0; i < kNumArrays; ++i) {
+    ObjPtr<mirror::ObjectArray<mirror::Object>> array = arrays->Get(i);
+    EXPECT_EQ(array->GetReadBarrierState(), ReadBarrier::WhiteState());
+    for (int32_t j = 0; j < kArrayLength; ++j) {
+      ObjPtr<mirror::Object> string = array->Get(j);
+      ASSERT_TRUE(string != nullptr);
+      EXPECT_EQ(string->GetReadBarrierState(), ReadBarrier::WhiteState()) << i << " " << j;
+      EXPECT_TRUE(string->AsString()->Equals("shared"));
+    }
+  }
+  soa.Vm()->DeleteGlobalRef(self, arrays_ref);
+}
+
+class GenerationalConcurrentCopyingTest : public CommonRuntimeTest {
+ protected:
+  void SetUpRuntimeOptions(RuntimeOptions* options) OVERRIDE {
+    CommonRuntimeTest::SetUpRuntimeOptions(options);
+    options->push_back(std::make_pair("-Xgc:generational_cc", nullptr));
+  }
+
+  static bool IsGenerational() {
+    Heap* heap = Runtime::Current()->GetHeap();
+    return kUseBakerReadBarrier &&
+        heap->CurrentCollectorType() == kCollectorTypeCC &&
+        heap->UseGenerationalCC();
+  }
+
+  static GcType CollectYoungGeneration() {
+    return Runtime::Current()->GetHeap()->CollectGarbageInternal(
+        kGcTypeSticky, kGcCauseBackground, /* clear_soft_references */ false);
+  }
+
+  static space::RegionSpace* GetRegionSpace() {
+    return Runtime::Current()->GetHeap()->region_space_;
+  }
+
+  // Store a new string into the old holder, collect the young generation and check that the GC
+  // found the string through the card of the holder and promoted it.
+  void CheckOldToYoungReference(Handle<mirror::ObjectArray<mirror::Object>> holder)
+      REQUIRES_SHARED(Locks::mutator_lock_) {
+    Thread* self = Thread::Current();
+    accounting::CardTable* card_table = Runtime::Current()->GetHeap()->GetCardTable();
+    mirror::ObjectArray<mirror::Object>* const old_holder = holder.Get();
+    {
+      ObjPtr<mirror::String> young = mirror::String::AllocFromModifiedUtf8(self, "young");
+      ASSERT_TRUE(young != nullptr);
+      ASSERT_TRUE(GetRegionSpace()->IsInNewlyAllocatedRegion(young.Ptr()));
+      // Only the holder refers to the string, through a store that dirties its card.
+      holder->Set<false>(0, young);
+    }
+    EXPECT_EQ(card_table->GetCard(holder.Get()), accounting::CardTable::kCardDirty);
+    {
+      ScopedThreadSuspension sts(self, kSuspended);
+      ASSERT_EQ(CollectYoungGeneration(), kGcTypeSticky);
+    }
+    // The old holder stays in place, the string moved out of the young generation.
+    EXPECT_EQ(holder.Get(), old_holder);
+    EXPECT_EQ(holder->GetReadBarrierState(), ReadBarrier::WhiteState());
+    ObjPtr<mirror::Object> promoted = holder->Get(0);
+    ASSERT_TRUE(promoted != nullptr);
+    EXPECT_FALSE(GetRegionSpace()->IsInNewlyAllocatedRegion(promoted.Ptr()));
+    EXPECT_FALSE(GetRegionSpace()->IsInFromSpace(promoted.Ptr()));
+    EXPECT_EQ(promoted->GetReadBarrierState(), ReadBarrier::WhiteState());
+    EXPECT_TRUE(promoted->AsString()->Equals("young"));
+    // The old-to-young reference is gone, so is the card.
+    EXPECT_EQ(card_table->GetCard(holder.Get()), accounting::CardTable::kCardClean);
+  }
+};
+
+TEST_F(GenerationalConcurrentCopyingTest, OldToYoungReferenceInRegionSpace) {
+  if (!IsGenerational()) {
+    return;
+  }
+  Thread* self = Thread::Current();
+  ScopedObjectAccess soa(self);
+  StackHandleScope<2> hs(self);
+  Handle<mirror::Class> array_class(hs.NewHandle(
+      class_linker_->FindSystemClass(self, "[Ljava/lang/Object;")));
+  Handle<mirror::ObjectArray<mirror::Object>> holder(hs.NewHandle(
+      mirror::ObjectArray<mirror::Object>::Alloc(self, array_class.Get(), 1)));
+  ASSERT_TRUE(holder != nullptr);
+  ASSERT_TRUE(GetRegionSpace()->IsInNewlyAllocatedRegion(holder.Get()));
+  {
+    // The first young-generation GC promotes the holder.
+    ScopedThreadSuspension sts(self, kSuspended);
+    ASSERT_EQ(CollectYoungGeneration(), kGcTypeSticky);
+  }
+  ASSERT_TRUE(GetRegionSpace()->HasAddress(holder.Get()));
+  ASSERT_FALSE(GetRegionSpace()->IsInNewlyAllocatedRegion(holder.Get()));
+  // Each young-generation GC clears the card, check that the next one still finds the store.
+  for (size_t i = 0; i < 3; ++i) {
+    CheckOldToYoungReference(holder);
+  }
+}
+
+TEST_F(GenerationalConcurrentCopyingTest, OldToYoungReferenceInNonMovingSpace) {
+  if (!IsGenerational()) {
+    return;
+  }
+  Thread* self = Thread::Current();
+  ScopedObjectAccess soa(self);
+  Heap* heap = Runtime::Current()->GetHeap();
+  StackHandleScope<2> hs(self);
+  Handle<mirror::Class> array_class(hs.NewHandle(
+      class_linker_->FindSystemClass(self, "[Ljava/lang/Object;")));
+  // A non-moving object is old from the start. The first check sees it before any GC put it in
+  // the live bitmap.
+  Handle<mirror::ObjectArray<mirror::Object>> holder(hs.NewHandle(
+      mirror::ObjectArray<mirror::Object>::Alloc(
+          self, array_class.Get(), 1, heap->GetCurrentNonMovingAllocator())));
+  ASSERT_TRUE(holder != nullptr);
+  ASSERT_TRUE(heap->GetNonMovingSpace()->HasAddress(holder.Get()));
+  for (size_t i = 0; i < 3; ++i) {
+    CheckOldToYoungReference(holder);
+  }
+}
+
+}  // namespace collector
+}  // namespace gc
+}  // namespace art
@@ -104,6 +104,7 @@ void GarbageCollector::Run(GcCause gc_cause, bool clear_soft_references) {
   // Note transaction mode is single-threaded and there's no asynchronous GC and this flag doesn't
   // change in the middle of a GC.
   is_transaction_active_ = Runtime::Current()->IsActiveTransaction();
+  heap_->IncrementGcsStarted();
   RunPhases();  // Run all the GC phases.
   // Add the current timings to the cumulative timings.
   cumulative_timings_.AddLogger(*GetTimings());
@@ -1151,7 +1151,34 @@ class MarkSweep::ScanObjectVisitor {
   MarkSweep* const mark_sweep_;
 };
 
+// Marks from several threads at once, pushing newly marked objects on the shared mark stack.
+// Only usable while no objects are being moved.
+class MarkSweep::ParallelMarkObjectVisitor : public MarkObjectVisitor {
+ public:
+  explicit ParallelMarkObjectVisitor(MarkSweep* mark_sweep) : mark_sweep_(mark_sweep) {}
+
+  virtual mirror::Object* MarkObject(mirror::Object* obj) OVERRIDE NO_THREAD_SAFETY_ANALYSIS {
+    if (obj != nullptr) {
+      mark_sweep_->MarkObjectNonNullParallel(obj);
+    }
+    return obj;
+  }
+
+  virtual void MarkHeapReference(mirror::HeapReference<mirror::Object>* ref,
+                                 bool do_atomic_update ATTRIBUTE_UNUSED) OVERRIDE
+      NO_THREAD_SAFETY_ANALYSIS {
+    MarkObject(ref->AsMirrorPtr());
+  }
+
+ private:
+  MarkSweep* const mark_sweep_;
+};
+
 void MarkSweep::UpdateAndMarkModUnion() {
+  const size_t thread_count = GetThreadCount(!IsConcurrent());
+  // Parallel marking can't forward references, so copying collections stay on this thread.
+  const bool parallel = kParallelCardScan && thread_count > 1 && from_bps_ == nullptr;
+  ParallelMarkObjectVisitor parallel_visitor(this);
   for (const auto& space : immune_spaces_.GetSpaces()) {
     const char* name = space->IsZygoteSpace()
         ? "UpdateAndMarkZygoteModUnionTable"
@@ -1159,7 +1186,11 @@ void MarkSweep::UpdateAndMarkModUnion() {
     DCHECK(space->IsZygoteSpace() || space->IsImageSpace()) << *space;
     TimingLogger::ScopedTiming t(name, GetTimings());
     accounting::ModUnionTable* mod_union_table = heap_->FindModUnionTableFromSpace(space);
-    if (mod_union_table != nullptr) {
+    if (mod_union_table != nullptr && parallel) {
+      mod_union_table->UpdateAndMarkReferencesParallel(&parallel_visitor,
+                                                       heap_->GetThreadPool(),
+                                                       thread_count);
+    } else if (mod_union_table != nullptr) {
       mod_union_table->UpdateAndMarkReferences(this);
     } else {
       // No mod-union table, scan all the live bits. This can only occur for app images.
@@ -1752,7 +1783,8 @@ void MarkSweep::ScanGrayObjects(bool paused, uint8_t minimum_age) {
     StackReference<mirror::Object>* mark_stack_end = mark_stack_->End();
     const size_t mark_stack_size = mark_stack_end - mark_stack_begin;
     // Estimated number of work tasks we will create.
-    const size_t mark_stack_tasks = GetHeap()->GetContinuousSpaces().size() * thread_count;
+    const size_t mark_stack_tasks = GetHeap()->GetContinuousSpaces().size() * thread_count *
+        accounting::CardTable::kParallelScanTasksPerThread;
     DCHECK_NE(mark_stack_tasks, 0U);
     const size_t mark_stack_delta = std::min(CardScanTask::kMaxSize / 2,
                                              mark_stack_size / mark_stack_tasks + 1);
@@ -1778,9 +1810,10 @@ void MarkSweep::ScanGrayObjects(bool paused, uint8_t minimum_age) {
       DCHECK_ALIGNED(card_end, accounting::CardTable::kCardSize);
       // Calculate how many bytes of heap we will scan,
       const size_t address_range = card_end - card_begin;
-      // Calculate how much address range each task gets.
-      const size_t card_delta = RoundUp(address_range / thread_count + 1,
-                                        accounting::CardTable::kCardSize);
+      // Calculate how much address range each task gets. Dirty cards tend to cluster, so hand out
+      // several smaller ranges per thread and let the pool balance them.
+      const size_t card_delta =
+          accounting::CardTable::ParallelScanChunkSize(address_range, thread_count);
       // If paused and the space is neither zygote nor image space, we could clear the dirty
       // cards to avoid accumulating them to increase card scanning load in the following GC
       // cycles. We need to keep dirty cards of image space and zygote space in order to track
@@ -44,6 +44,7 @@ const char* PrettyCause(GcCause cause) {
     case kGcCauseHprof: return "Hprof";
     case kGcCauseGetObjectsAllocated: return "ObjectsAllocated";
     case kGcCauseProfileSaver: return "ProfileSaver";
+    case kGcCauseIdle: return "Idle";
   }
   LOG(FATAL) << "Unreachable";
   UNREACHABLE();
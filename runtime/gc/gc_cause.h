@@ -65,6 +65,8 @@ enum GcCause {
   kGcCauseGetObjectsAllocated,
   // GC cause for the profile saver.
   kGcCauseProfileSaver,
+  // GC compacting the heap while the process is idle.
+  kGcCauseIdle,
 };
 
 const char* PrettyCause(GcCause cause);
@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "gc_pacer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <ostream>
+
+#include "base/time_utils.h"
+#include "utils.h"
+
+namespace art {
+namespace gc {
+
+constexpr double GcPacer::kSmoothingFactor;
+constexpr double GcPacer::kMinGrowthScale;
+constexpr double GcPacer::kMaxGrowthScale;
+constexpr double GcPacer::kMaxGrowthScaleStep;
+constexpr double GcPacer::kMinTriggerMargin;
+constexpr double GcPacer::kMaxTriggerMargin;
+
+// Utilization within this ratio of the CPU budget leaves the growth scale alone, so that noise in
+// the measurements does not make the heap size oscillate.
+static constexpr double kUtilizationDeadBand = 0.1;
+// How fast the trigger margin grows after a mutator blocked on a GC, and decays otherwise.
+static constexpr double kTriggerMarginIncrease = 1.5;
+static constexpr double kTriggerMarginDecay = 0.9;
+
+GcPacer::GcPacer(uint64_t pause_target_ns, uint32_t cpu_percent)
+    : pause_target_ns_(pause_target_ns),
+      cpu_percent_(std::min(cpu_percent, 100u)),
+      allocation_rate_(0.0),
+      marking_speed_(0.0),
+      gc_utilization_(0.0),
+      sticky_pause_ns_(0.0),
+      non_sticky_pause_ns_(0.0),
+      growth_scale_(1.0),
+      trigger_margin_(kMinTriggerMargin),
+      last_gc_end_ns_(0),
+      last_bytes_allocated_after_gc_(0),
+      gc_count_(0),
+      sticky_gc_count_(0),
+      non_sticky_gc_count_(0),
+      blocked_gc_count_(0) {
+}
+
+double GcPacer::Smooth(double average, double sample, bool first) {
+  if (first) {
+    return sample;
+  }
+  return average + (sample - average) * kSmoothingFactor;
+}
+
+void GcPacer::RecordGc(uint64_t now_ns,
+                       uint64_t duration_ns,
+                       uint64_t max_pause_ns,
+                       uint64_t bytes_allocated_before_gc,
+                       uint64_t bytes_allocated_after_gc,
+                       uint64_t live_bytes,
+                       bool sticky,
+                       bool mutator_blocked) {
+  duration_ns = std::min(duration_ns, now_ns);
+  const uint64_t gc_start_ns = now_ns - duration_ns;
+  if (gc_count_ != 0 && gc_start_ns > last_gc_end_ns_) {
+    // Allocation rate and GC utilization need the mutator interval since the previous GC.
+    const uint64_t mutator_ns = gc_start_ns - last_gc_end_ns_;
+    const uint64_t allocated = bytes_allocated_before_gc > last_bytes_allocated_after_gc_
+        ? bytes_allocated_before_gc - last_bytes_allocated_after_gc_
+        : 0u;
+    const double rate = static_cast<double>(allocated) * 1e9 / mutator_ns;
+    allocation_rate_ = Smooth(allocation_rate_, rate, allocation_rate_ == 0.0);
+    const double utilization =
+        static_cast<double>(duration_ns) / static_cast<double>(duration_ns + mutator_ns);
+    gc_utilization_ = Smooth(gc_utilization_, utilization, gc_count_ == 1);
+  }
+  if (duration_ns != 0 && live_bytes != 0) {
+    const double speed = static_cast<double>(live_bytes) * 1e9 / duration_ns;
+    marking_speed_ = Smooth(marking_speed_, speed, marking_speed_ == 0.0);
+  }
+  if (sticky) {
+    sticky_pause_ns_ = Smooth(sticky_pause_ns_, max_pause_ns, sticky_gc_count_ == 0);
+    ++sticky_gc_count_;
+  } else {
+    non_sticky_pause_ns_ = Smooth(non_sticky_pause_ns_, max_pause_ns, non_sticky_gc_count_ == 0);
+    ++non_sticky_gc_count_;
+  }
+  // A mutator waiting for memory means the concurrent GC started too late for the allocation
+  // rate. Start earlier until that stops happening, then slowly move back.
+  if (mutator_blocked) {
+    ++blocked_gc_count_;
+    trigger_margin_ = std::min(trigger_margin_ * kTriggerMarginIncrease, kMaxTriggerMargin);
+  } else {
+    trigger_margin_ = std::max(trigger_margin_ * kTriggerMarginDecay, kMinTriggerMargin);
+  }
+  last_gc_end_ns_ = now_ns;
+  last_bytes_allocated_after_gc_ = bytes_allocated_after_gc;
+  ++gc_count_;
+  UpdateGrowthScale();
+}
+
+void GcPacer::UpdateGrowthScale() {
+  if (cpu_percent_ == 0 || gc_utilization_ == 0.0) {
+    return;
+  }
+  // GCs happen once per free space worth of allocation, so the time spent collecting is inversely
+  // proportional to the free space. Scale it by how far we are from the budget.
+  const double goal = cpu_percent_ / 100.0;
+  const double ratio = gc_utilization_ / goal;
+  if (std::abs(ratio - 1.0) <= kUtilizationDeadBand) {
+    return;
+  }
+  const double step = std::min(std::max(ratio, 1.0 / kMaxGrowthScaleStep), kMaxGrowthScaleStep);
+  growth_scale_ = std::min(std::max(growth_scale_ * step, kMinGrowthScale), kMaxGrowthScale);
+}
+
+uint64_t GcPacer::GetConcurrentRemainingBytes() const {
+  if (allocation_rate_ == 0.0 || marking_speed_ == 0.0) {
+    return 0u;
+  }
+  // The next GC has to trace about what survived this one; the mutators keep allocating at their
+  // current rate meanwhile.
+  const double predicted_gc_seconds =
+      static_cast<double>(last_bytes_allocated_after_gc_) / marking_speed_;
+  return static_cast<uint64_t>(allocation_rate_ * predicted_gc_seconds * trigger_margin_);
+}
+
+bool GcPacer::ShouldPreferSticky() const {
+  if (pause_target_ns_ == 0 || sticky_gc_count_ == 0 || non_sticky_gc_count_ == 0) {
+    return false;
+  }
+  return non_sticky_pause_ns_ > pause_target_ns_ && sticky_pause_ns_ <= pause_target_ns_;
+}
+
+void GcPacer::Dump(std::ostream& os) const {
+  os << "GC pacer:";
+  if (pause_target_ns_ != 0) {
+    os << " pause target " << PrettyDuration(pause_target_ns_);
+  }
+  if (cpu_percent_ != 0) {
+    os << " CPU budget " << cpu_percent_ << "%";
+  }
+  os << " GCs " << gc_count_ << " (" << blocked_gc_count_ << " blocking a mutator)\n";
+  os << "GC pacer allocation rate " << PrettySize(GetAllocationRate()) << "/s"
+     << " marking speed " << PrettySize(GetMarkingSpeed()) << "/s"
+     << " GC utilization " << gc_utilization_ * 100.0 << "%\n";
+  os << "GC pacer growth scale " << growth_scale_
+     << " trigger margin " << trigger_margin_
+     << " next trigger " << PrettySize(GetConcurrentRemainingBytes()) << " before the limit"
+     << " sticky pause " << PrettyDuration(static_cast<uint64_t>(sticky_pause_ns_))
+     << " non-sticky pause " << PrettyDuration(static_cast<uint64_t>(non_sticky_pause_ns_))
+     << "\n";
+}
+
+}  // namespace gc
+}  // namespace art
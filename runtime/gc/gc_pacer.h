@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_GC_GC_PACER_H_
+#define ART_RUNTIME_GC_GC_PACER_H_
+
+#include <iosfwd>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "base/macros.h"
+
+namespace art {
+namespace gc {
+
+// Feedback controller for heap growth and concurrent GC triggering. Given a pause target and a
+// GC CPU budget, it measures the mutator allocation rate, the collector's marking speed and the
+// fraction of wall time spent collecting, and derives:
+//  - a scale for the free space the heap leaves after a GC, so that GCs become rarer when they use
+//    more than the CPU budget and the heap shrinks back when they use less;
+//  - how many bytes before the footprint limit the next concurrent GC must start so that it
+//    finishes before the mutators run out of space;
+//  - whether sticky collections should be preferred because full collections pause for longer
+//    than the pause target.
+// All the updates come from the thread running the GC; dumps may race and see stale values.
+class GcPacer {
+ public:
+  // Weight of the newest sample in the smoothed measurements.
+  static constexpr double kSmoothingFactor = 0.5;
+  // Limits on the free space scale and on how much it may change per GC.
+  static constexpr double kMinGrowthScale = 0.25;
+  static constexpr double kMaxGrowthScale = 8.0;
+  static constexpr double kMaxGrowthScaleStep = 2.0;
+  // Limits on the safety margin applied to the predicted allocation during a concurrent GC.
+  static constexpr double kMinTriggerMargin = 1.1;
+  static constexpr double kMaxTriggerMargin = 4.0;
+
+  // A zero pause target or CPU percent disables the corresponding goal.
+  GcPacer(uint64_t pause_target_ns, uint32_t cpu_percent);
+
+  bool IsEnabled() const {
+    return pause_target_ns_ != 0 || cpu_percent_ != 0;
+  }
+
+  // Feed the measurements of a GC that just finished at now_ns. live_bytes is what the GC had to
+  // trace and copy or mark; mutator_blocked is true if a mutator had to wait for the GC to get
+  // memory, which means the previous trigger was too late.
+  void RecordGc(uint64_t now_ns,
+                uint64_t duration_ns,
+                uint64_t max_pause_ns,
+                uint64_t bytes_allocated_before_gc,
+                uint64_t bytes_allocated_after_gc,
+                uint64_t live_bytes,
+                bool sticky,
+                bool mutator_blocked);
+
+  // Multiplier for the free space left after a GC.
+  double GetGrowthScale() const {
+    return growth_scale_;
+  }
+
+  // Bytes that should remain before the footprint limit when the next concurrent GC starts, or
+  // 0 if there is not enough data yet.
+  uint64_t GetConcurrentRemainingBytes() const;
+
+  // Whether a sticky GC should be picked over a non-sticky one when both are possible.
+  bool ShouldPreferSticky() const;
+
+  uint64_t GetAllocationRate() const {
+    return static_cast<uint64_t>(allocation_rate_);
+  }
+  uint64_t GetMarkingSpeed() const {
+    return static_cast<uint64_t>(marking_speed_);
+  }
+  double GetGcUtilization() const {
+    return gc_utilization_;
+  }
+
+  void Dump(std::ostream& os) const;
+
+ private:
+  static double Smooth(double average, double sample, bool first);
+  void UpdateGrowthScale();
+
+  const uint64_t pause_target_ns_;
+  const uint32_t cpu_percent_;
+
+  // Smoothed mutator allocation rate, in bytes per second.
+  double allocation_rate_;
+  // Smoothed bytes traced per second of GC.
+  double marking_speed_;
+  // Smoothed fraction of wall time spent in GC.
+  double gc_utilization_;
+  // Smoothed maximum pause of sticky and non-sticky GCs.
+  double sticky_pause_ns_;
+  double non_sticky_pause_ns_;
+
+  double growth_scale_;
+  double trigger_margin_;
+
+  // End time and heap size of the previous GC, to measure allocation between GCs and predict the
+  // duration of the next one.
+  uint64_t last_gc_end_ns_;
+  uint64_t last_bytes_allocated_after_gc_;
+
+  uint64_t gc_count_;
+  uint64_t sticky_gc_count_;
+  uint64_t non_sticky_gc_count_;
+  uint64_t blocked_gc_count_;
+
+  DISALLOW_COPY_AND_ASSIGN(GcPacer);
+};
+
+}  // namespace gc
+}  // namespace art
+
+#endif  // ART_RUNTIME_GC_GC_PACER_H_
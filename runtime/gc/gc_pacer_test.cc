@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "gc_pacer.h"
+
+#include "base/time_utils.h"
+#include "globals.h"
+#include "gtest/gtest.h"
+
+namespace art {
+namespace gc {
+
+// Simulates a steady application that allocates alloc_bytes between GCs spaced period_ns apart,
+// each GC taking gc_ns and leaving live_bytes allocated.
+static void RunSteadyGcs(GcPacer* pacer,
+                         size_t count,
+                         uint64_t period_ns,
+                         uint64_t gc_ns,
+                         uint64_t alloc_bytes,
+                         uint64_t live_bytes,
+                         bool mutator_blocked) {
+  static uint64_t now_ns = MsToNs(1000);
+  for (size_t i = 0; i < count; ++i) {
+    now_ns += period_ns;
+    pacer->RecordGc(now_ns,
+                    gc_ns,
+                    /* max_pause_ns */ MsToNs(1),
+                    live_bytes + alloc_bytes,
+                    live_bytes,
+                    live_bytes,
+                    /* sticky */ false,
+                    mutator_blocked);
+  }
+}
+
+TEST(GcPacerTest, Disabled) {
+  GcPacer pacer(0, 0);
+  EXPECT_FALSE(pacer.IsEnabled());
+  EXPECT_EQ(pacer.GetConcurrentRemainingBytes(), 0u);
+  EXPECT_FALSE(pacer.ShouldPreferSticky());
+}
+
+TEST(GcPacerTest, MeasuresAllocationRate) {
+  GcPacer pacer(MsToNs(10), 0);
+  // 10 MB allocated over 90 ms of mutator time, GC tracing 5 MB in 10 ms.
+  RunSteadyGcs(&pacer, 4, MsToNs(100), MsToNs(10), 10 * MB, 5 * MB, false);
+  const uint64_t rate = pacer.GetAllocationRate();
+  EXPECT_GT(rate, 100 * MB);
+  EXPECT_LT(rate, 120 * MB);
+  EXPECT_EQ(pacer.GetMarkingSpeed(), 500 * MB);
+  EXPECT_NEAR(pacer.GetGcUtilization(), 0.1, 0.01);
+  // The next GC lasts about 10 ms during which about 1.1 MB get allocated.
+  const uint64_t remaining = pacer.GetConcurrentRemainingBytes();
+  EXPECT_GT(remaining, 1 * MB);
+  EXPECT_LT(remaining, 2 * MB);
+}
+
+TEST(GcPacerTest, GrowsOverCpuBudget) {
+  GcPacer pacer(0, 5);
+  // GCs use about 20% of the time, four times the budget.
+  RunSteadyGcs(&pacer, 3, MsToNs(50), MsToNs(10), MB, MB, false);
+  EXPECT_GT(pacer.GetGrowthScale(), 1.0);
+  EXPECT_LE(pacer.GetGrowthScale(), GcPacer::kMaxGrowthScale);
+}
+
+TEST(GcPacerTest, ShrinksUnderCpuBudget) {
+  GcPacer pacer(0, 50);
+  RunSteadyGcs(&pacer, 3, MsToNs(1000), MsToNs(10), MB, MB, false);
+  EXPECT_LT(pacer.GetGrowthScale(), 1.0);
+  EXPECT_GE(pacer.GetGrowthScale(), GcPacer::kMinGrowthScale);
+}
+
+TEST(GcPacerTest, TriggersEarlierAfterBlocking) {
+  GcPacer pacer(MsToNs(5), 0);
+  RunSteadyGcs(&pacer, 3, MsToNs(100), MsToNs(10), 10 * MB, 5 * MB, false);
+  const uint64_t before = pacer.GetConcurrentRemainingBytes();
+  RunSteadyGcs(&pacer, 1, MsToNs(100), MsToNs(10), 10 * MB, 5 * MB, true);
+  EXPECT_GT(pacer.GetConcurrentRemainingBytes(), before);
+}
+
+TEST(GcPacerTest, PrefersStickyForLongFullPauses) {
+  GcPacer pacer(MsToNs(2), 0);
+  pacer.RecordGc(MsToNs(100), MsToNs(10), MsToNs(5), 2 * MB, MB, MB, false, false);
+  EXPECT_FALSE(pacer.ShouldPreferSticky());
+  pacer.RecordGc(MsToNs(200), MsToNs(2), MsToNs(1), 2 * MB, MB, MB, true, false);
+  EXPECT_TRUE(pacer.ShouldPreferSticky());
+}
+
+}  // namespace gc
+}  // namespace art
@@ -21,6 +21,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <vector>
+#include "barrier.h"
 #include "base/histogram-inl.h"
 #include "base/stl_util.h"
 #include "common_throws.h"
@@ -59,11 +60,12 @@
 #include "reflection.h"
 #include "runtime.h"
 #include "ScopedLocalRef.h"
-#include "scoped_thread_state_change.h"
+#include "scoped_thread_state_change-inl.h"
 #include "thread_list.h"
 #include "UniquePtr.h"
 #include "well_known_classes.h"
 #include "gc/gcprofiler.h"
+#include "gc/gcprofiler_stream.h"
 
 namespace art {
 
@@ -118,6 +120,22 @@ void RecordList::DumpRecords(std::ofstream& os) {
   }
 }
 
+// Stream the completed records of the list and release them.
+void RecordList::StreamRecords(GcProfileStreamWriter* writer, size_t keep_last) {
+  if (record_list_.size() <= keep_last) {
+    return;
+  }
+  const auto end = record_list_.end() - keep_last;
+  std::vector<uint8_t> payload;
+  for (auto iter = record_list_.begin(); iter != end; iter++) {
+    payload.clear();
+    (*iter)->Serialize(&payload);
+    writer->WriteRecord(record_type_, payload);
+    delete (*iter);
+  }
+  record_list_.erase(record_list_.begin(), end);
+}
+
 // Release Records in list and clear the list.
 void RecordList::ReleaseRecordsAndClear() {
   for (auto iter = record_list_.begin();
@@ -132,6 +150,11 @@ void RecordList::InsertRecord(ProfileRecord* record) {
   record_list_.push_back(record);
 }
 
+// Insert a record before the one at the index.
+void RecordList::InsertRecordAt(uint32_t index, ProfileRecord* record) {
+  record_list_.insert(record_list_.begin() + index, record);
+}
+
 // Get the last Record in list, it should be the currently using one.
 ProfileRecord* RecordList::GetLastRecord() {
   if (record_list_.size() == 0) {
@@ -222,25 +245,50 @@ void GCRecord::ConvertDataUnits() {
 
 // Dump GC records.
 void GCRecord::DumpRecord(std::ofstream& os) {
-  if (GcProfiler::DumpBinary()) {
-    // Dump binary raw data.
-    os.write(reinterpret_cast<char*>(this), sizeof(GCRecord));
-  } else {
-    ConvertDataUnits();
-    // Dump .csv format data.
-    os << "," << id_ << "," << timestamp_ << "," << reason_ << "," << pause_time_max_ << "," << mark_time_
-       << "," << sweep_time_ << "," << gc_time_ << "," << free_object_count_ << "," << free_bytes_
-       << "," << free_large_object_count_ << "," << free_large_object_bytes_ << "," << max_wait_time_
-       << "," << type_ << "," << max_allowed_footprint_ << "," << concurrent_start_bytes_
-       << "," << blocking_time_ << "," << allocated_size_before_gc_ << "," << allocated_size_after_gc_
-       << "," << total_object_count_in_alloc_stack_during_gc_ << "," << gc_throughput_bpns_
-       << "," << gc_throughput_npns_ << "," << footprint_size_before_gc_ << "," << footprint_size_after_gc_
-       << "," << main_space_size_before_gc_ << "," << main_space_size_after_gc_
-       << "," << los_space_size_before_gc_ << "," << los_space_size_after_gc_ << std::endl;
-  }
+  ConvertDataUnits();
+  // Dump .csv format data.
+  os << "," << id_ << "," << timestamp_ << "," << reason_ << "," << pause_time_max_ << "," << mark_time_
+     << "," << sweep_time_ << "," << gc_time_ << "," << free_object_count_ << "," << free_bytes_
+     << "," << free_large_object_count_ << "," << free_large_object_bytes_ << "," << max_wait_time_
+     << "," << type_ << "," << max_allowed_footprint_ << "," << concurrent_start_bytes_
+     << "," << blocking_time_ << "," << allocated_size_before_gc_ << "," << allocated_size_after_gc_
+     << "," << total_object_count_in_alloc_stack_during_gc_ << "," << gc_throughput_bpns_
+     << "," << gc_throughput_npns_ << "," << footprint_size_before_gc_ << "," << footprint_size_after_gc_
+     << "," << main_space_size_before_gc_ << "," << main_space_size_after_gc_
+     << "," << los_space_size_before_gc_ << "," << los_space_size_after_gc_ << std::endl;
   os.flush();
 }
 
+// Binary trace payload of a GC record.
+void GCRecord::Serialize(std::vector<uint8_t>* payload) {
+  GcProfileStreamWriter::Append<uint32_t>(payload, id_);
+  GcProfileStreamWriter::Append<uint32_t>(payload, reason_);
+  GcProfileStreamWriter::Append<uint32_t>(payload, type_);
+  GcProfileStreamWriter::Append<uint64_t>(payload, timestamp_);
+  GcProfileStreamWriter::Append<uint64_t>(payload, pause_time_max_);
+  GcProfileStreamWriter::Append<uint64_t>(payload, mark_time_);
+  GcProfileStreamWriter::Append<uint64_t>(payload, sweep_time_);
+  GcProfileStreamWriter::Append<uint64_t>(payload, gc_time_);
+  GcProfileStreamWriter::Append<uint64_t>(payload, max_wait_time_);
+  GcProfileStreamWriter::Append<uint64_t>(payload, blocking_time_);
+  GcProfileStreamWriter::Append<uint64_t>(payload, wasted_wait_time_after_gc_);
+  GcProfileStreamWriter::Append<uint32_t>(payload, free_bytes_);
+  GcProfileStreamWriter::Append<uint32_t>(payload, free_object_count_);
+  GcProfileStreamWriter::Append<uint32_t>(payload, free_large_object_bytes_);
+  GcProfileStreamWriter::Append<uint32_t>(payload, free_large_object_count_);
+  GcProfileStreamWriter::Append<uint32_t>(payload, max_allowed_footprint_);
+  GcProfileStreamWriter::Append<uint32_t>(payload, concurrent_start_bytes_);
+  GcProfileStreamWriter::Append<uint32_t>(payload, allocated_size_before_gc_);
+  GcProfileStreamWriter::Append<uint32_t>(payload, allocated_size_after_gc_);
+  GcProfileStreamWriter::Append<uint32_t>(payload, total_object_count_in_alloc_stack_during_gc_);
+  GcProfileStreamWriter::Append<uint32_t>(payload, footprint_size_before_gc_);
+  GcProfileStreamWriter::Append<uint32_t>(payload, footprint_size_after_gc_);
+  GcProfileStreamWriter::Append<uint32_t>(payload, main_space_size_before_gc_);
+  GcProfileStreamWriter::Append<uint32_t>(payload, main_space_size_after_gc_);
+  GcProfileStreamWriter::Append<uint32_t>(payload, los_space_size_before_gc_);
+  GcProfileStreamWriter::Append<uint32_t>(payload, los_space_size_after_gc_);
+}
+
 // Convert the data unit for inaccurate mode.
 void SuccAllocRecord::ConvertDataUnits() {
   if (GcProfiler::InaccurateMode()) {
@@ -251,33 +299,41 @@ void SuccAllocRecord::ConvertDataUnits() {
 
 // Dump succeed allocation info.
 void SuccAllocRecord::DumpRecord(std::ofstream& os) {
-  if (GcProfiler::DumpBinary()) {
-    os.write(reinterpret_cast<char*>(this), sizeof(SuccAllocRecord));
-  } else {
-    ConvertDataUnits();
-    os << " ," << gc_id_ << " ," << total_size_;
-    for (int i = 0; i < 12; i++) {
-      os << " ," << size_dist_[i];
-    }
-    os << std::endl;
+  ConvertDataUnits();
+  os << " ," << gc_id_ << " ," << total_size_;
+  for (int i = 0; i < 12; i++) {
+    os << " ," << size_dist_[i];
   }
+  os << std::endl;
   os.flush();
 }
+// Binary trace payload of a success allocation record.
+void SuccAllocRecord::Serialize(std::vector<uint8_t>* payload) {
+  GcProfileStreamWriter::Append<uint32_t>(payload, gc_id_);
+  GcProfileStreamWriter::Append<uint32_t>(payload, total_size_);
+  for (size_t i = 0; i < kNumSuccAllocSizeDist; ++i) {
+    GcProfileStreamWriter::Append<uint32_t>(payload, size_dist_[i]);
+  }
+}
+
 // Insert the size to distribution in allocation info record.
 // The size_dist_[] divided the object size into kNumSizeDistRegions.
 // It records the count of objects whose size is in coressponding region.
-void SuccAllocRecord::InsertSizeDist(uint32_t size) {
+size_t SuccAllocRecord::SizeDistIndex(uint32_t size) {
   if (size >= Heap::kDefaultLargeObjectThreshold) {
-    size_dist_[kNumSizeDistRegions]++;
-  } else {
-    uint32_t t = (size - 1) >> 4;
-    uint32_t i = 0;
-    while (t > 0) {
-      i++;
-      t = t >> 1;
-    }
-    size_dist_[i]++;
+    return kNumSizeDistRegions;
+  }
+  uint32_t t = (size - 1) >> 4;
+  size_t i = 0;
+  while (t > 0) {
+    i++;
+    t = t >> 1;
   }
+  return i;
+}
+
+void SuccAllocRecord::InsertSizeDist(uint32_t size) {
+  size_dist_[SizeDistIndex(size)]++;
 }
 
 // Fill success allocation info fields.
@@ -286,6 +342,71 @@ void SuccAllocRecord::FillFields(uint32_t byte_count) {
   InsertSizeDist(byte_count);
 }
 
+// Add a batch of allocations published by a thread.
+void SuccAllocRecord::AddSample(const SuccAllocSample& sample) {
+  total_size_ += sample.total_size;
+  for (size_t i = 0; i < kNumSuccAllocSizeDist; ++i) {
+    size_dist_[i] += sample.size_dist[i];
+  }
+}
+
+GcProfilerThreadBuffer::GcProfilerThreadBuffer() : head_(0), tail_(0), retired_(false) {
+  ResetPending(0, 0);
+}
+
+void GcProfilerThreadBuffer::ResetPending(uint32_t session, uint32_t gc_id) {
+  memset(&pending_, 0, sizeof(pending_));
+  pending_.session = session;
+  pending_.gc_id = gc_id;
+  pending_.large_object_type = Primitive::kPrimNot;
+}
+
+bool GcProfilerThreadBuffer::Publish(const SuccAllocSample& sample) {
+  const size_t head = head_.LoadRelaxed();
+  if (head - tail_.LoadAcquire() == kCapacity) {
+    return false;
+  }
+  samples_[head % kCapacity] = sample;
+  head_.StoreRelease(head + 1);
+  return true;
+}
+
+bool GcProfilerThreadBuffer::RecordAlloc(uint32_t session,
+                                         uint32_t gc_id,
+                                         uint32_t byte_count,
+                                         Primitive::Type large_object_type) {
+  if (pending_.session != session) {
+    // Left over from a previous profiling session.
+    ResetPending(session, gc_id);
+  } else if (pending_.gc_id != gc_id) {
+    if (pending_.count == 0 || Publish(pending_)) {
+      ResetPending(session, gc_id);
+    } else {
+      // The ring is full, keep summing rather than losing the allocations. They are attributed to
+      // the newer GC.
+      pending_.gc_id = gc_id;
+    }
+  }
+  ++pending_.count;
+  pending_.total_size += byte_count;
+  ++pending_.size_dist[SuccAllocRecord::SizeDistIndex(byte_count)];
+  bool recorded = true;
+  if (large_object_type != Primitive::kPrimNot) {
+    SuccAllocSample sample;
+    memset(&sample, 0, sizeof(sample));
+    sample.session = session;
+    sample.gc_id = gc_id;
+    sample.total_size = byte_count;
+    sample.large_object_type = large_object_type;
+    recorded = Publish(sample);
+  }
+  // When the ring is full the batch keeps growing until it can be published.
+  if (pending_.count >= kBatchSize && Publish(pending_)) {
+    ResetPending(session, gc_id);
+  }
+  return recorded;
+}
+
 // Convert the data unit for inaccurate mode.
 void FailAllocRecord::ConvertDataUnits() {
   if (GcProfiler::InaccurateMode()) {
@@ -296,15 +417,20 @@ void FailAllocRecord::ConvertDataUnits() {
 
 // Dump Record of fail allocation info.
 void FailAllocRecord::DumpRecord(std::ofstream& os) {
-  if (GcProfiler::DumpBinary()) {
-    os.write(reinterpret_cast<char*>(this), sizeof(FailAllocRecord));
-  } else {
-    ConvertDataUnits();
-    os << ", " << gc_id_ << ", " << size_ << ", " << phase_ << ", " << last_gc_type_ << ", " << type_ << std::endl;
-  }
+  ConvertDataUnits();
+  os << ", " << gc_id_ << ", " << size_ << ", " << phase_ << ", " << last_gc_type_ << ", " << type_ << std::endl;
   os.flush();
 }
 
+// Binary trace payload of a fail allocation record, the class descriptor takes the rest.
+void FailAllocRecord::Serialize(std::vector<uint8_t>* payload) {
+  GcProfileStreamWriter::Append<uint32_t>(payload, gc_id_);
+  GcProfileStreamWriter::Append<uint32_t>(payload, size_);
+  GcProfileStreamWriter::Append<uint32_t>(payload, phase_);
+  GcProfileStreamWriter::Append<uint32_t>(payload, last_gc_type_);
+  GcProfileStreamWriter::AppendString(payload, type_);
+}
+
 // Fill fail allocation info fields.
 void FailAllocRecord::FillFields(mirror::Class* klass,
                                  uint32_t bytes_allocated,
@@ -339,20 +465,24 @@ void LargeObjAllocRecord::ConvertDataUnits() {
 
 // Dump large object allocation info.
 void LargeObjAllocRecord::DumpRecord(std::ofstream& os) {
-  if (GcProfiler::DumpBinary()) {
-    os.write(reinterpret_cast<char*>(this), sizeof(LargeObjAllocRecord));
-  } else {
-    ConvertDataUnits();
-    os << " ," << gc_id_ << " ," << size_ << " ," << type_ << std::endl;
-  }
+  ConvertDataUnits();
+  os << " ," << gc_id_ << " ," << size_ << " ," << type_ << std::endl;
   os.flush();
 }
 
+// Binary trace payload of a large object record, the class descriptor takes the rest.
+void LargeObjAllocRecord::Serialize(std::vector<uint8_t>* payload) {
+  GcProfileStreamWriter::Append<uint32_t>(payload, gc_id_);
+  GcProfileStreamWriter::Append<uint32_t>(payload, size_);
+  GcProfileStreamWriter::AppendString(payload, type_);
+}
+
 // Fill large object allocation info.
-void LargeObjAllocRecord::FillFields(uint32_t gc_id, uint32_t byte_count, mirror::Class* klass) {
+void LargeObjAllocRecord::FillFields(uint32_t gc_id,
+                                     uint32_t byte_count,
+                                     const std::string& class_desc) {
   gc_id_ = gc_id;
   size_ = byte_count;
-  std::string class_desc = Runtime::Current()->GetHeap()->SafeGetClassDescriptor(klass);
   int length = class_desc.size() + 1;
   length = length <= 255 ? length : 255;
   strncpy(type_, class_desc.c_str(), length);
@@ -393,15 +523,18 @@ void AllocInfoRecord::ConvertDataUnits() {
   }
 }
 
+// Binary trace payload of the allocation info record.
+void AllocInfoRecord::Serialize(std::vector<uint8_t>* payload) {
+  GcProfileStreamWriter::Append<uint64_t>(payload, duration_);
+  GcProfileStreamWriter::Append<uint32_t>(payload, number_bytes_alloc_atomic_.LoadRelaxed());
+  GcProfileStreamWriter::Append<uint32_t>(payload, number_objects_alloc_.LoadRelaxed());
+}
+
 // Dump allocation record.
 void AllocInfoRecord::DumpRecord(std::ofstream& os) {
-  if (GcProfiler::DumpBinary()) {
-    os.write(reinterpret_cast<char*>(this), sizeof(AllocInfoRecord));
-  } else {
-    ConvertDataUnits();
-    os << ", " << duration_ << ", " << number_bytes_alloc_ << ", " << number_objects_alloc_
-       << ", " << throughput_bpns_ << ", " << throughput_npns_ << std::endl;
-  }
+  ConvertDataUnits();
+  os << ", " << duration_ << ", " << number_bytes_alloc_ << ", " << number_objects_alloc_
+     << ", " << throughput_bpns_ << ", " << throughput_npns_ << std::endl;
   os.flush();
 }
 
@@ -412,10 +545,13 @@ GcProfiler::GcProfiler()
             gc_id_(0),
             gc_prof_running_(false),
             prof_succ_allocation_(false),
-            data_dir_("data/local/tmp/gcprofile/") {
+            data_dir_("data/local/tmp/gcprofile/"),
+            session_(0),
+            current_gc_id_(0),
+            stream_file_size_(0) {
   gc_profiler_lock_ = new Mutex("Gcprofiling lock");
-  succ_record_lock_ = new Mutex("Successfull allocation record lock");
-  fail_record_lock_ = new Mutex("Fail allocation record lock");
+  succ_record_lock_ = new Mutex("Successfull allocation record lock", kGcProfilerRecordLock);
+  fail_record_lock_ = new Mutex("Fail allocation record lock", kGcProfilerRecordLock);
   // Build up the record lists for dump iteration.
   record_lists_.push_back(&gc_record_list_);
   record_lists_.push_back(&succ_record_list_);
@@ -448,24 +584,76 @@ void GcProfiler::Start() {
     return;
   }
   profile_duration_ = NsToMs(NanoTime());
+  // Samples still in the thread buffers belong to the previous session.
+  session_.FetchAndAddSequentiallyConsistent(1);
+  current_gc_id_.StoreRelaxed(0);
   gc_prof_running_ = true;
+  if (stream_file_size_ != 0) {
+    std::string error_msg;
+    stream_writer_.reset(GcProfileStreamWriter::Create(data_dir_, stream_file_size_, &error_msg));
+    if (stream_writer_ == nullptr) {
+      LOG(WARNING) << "GCProfile: " << error_msg << ", dumping a .csv file at stop instead";
+    }
+  }
 
   // Create allocation info record.
   CreateAllocInfoRecord();
+  MutexLock mu2(self, *succ_record_lock_);
   CreateSuccAllocRecord(0);
 }
 
+// Detaches the profiler buffer of a thread, so that its pending batch is drained with the
+// published samples and the buffer is deleted.
+class RetireThreadBufferClosure : public Closure {
+ public:
+  explicit RetireThreadBufferClosure(Barrier* barrier) : barrier_(barrier) {
+  }
+  virtual void Run(Thread* thread) OVERRIDE NO_THREAD_SAFETY_ANALYSIS {
+    GcProfilerThreadBuffer* buffer = thread->GetGcProfilerBuffer();
+    if (buffer != nullptr) {
+      thread->SetGcProfilerBuffer(nullptr);
+      buffer->Retire();
+    }
+    // If thread is a running mutator, then act on behalf of the stopping thread.
+    // See the code in ThreadList::RunCheckpoint.
+    barrier_->Pass(Thread::Current());
+  }
+
+ private:
+  Barrier* const barrier_;
+};
+
+// Retire the buffers of all live threads. Threads that allocate afterwards create new buffers.
+void GcProfiler::RetireThreadBuffers(Thread* self) {
+  Barrier barrier(0);
+  RetireThreadBufferClosure closure(&barrier);
+  ScopedThreadStateChange tsc(self, kWaitingForCheckPointsToRun);
+  size_t barrier_count = Runtime::Current()->GetThreadList()->RunCheckpoint(&closure);
+  if (barrier_count != 0) {
+    barrier.Increment(self, barrier_count);
+  }
+}
+
 // Stop GC profiling.
 void GcProfiler::Stop(bool drop_result) {
   Thread* self = Thread::Current();
+  if (gc_prof_running_) {
+    // Up to a batch of allocations per thread is not published yet. Retiring the buffers hands
+    // those batches to DrainThreadBuffers, which then deletes every buffer. This waits for the
+    // checkpoints, so do it before taking gc_profiler_lock_.
+    RetireThreadBuffers(self);
+  }
   MutexLock mu(self, *gc_profiler_lock_);
   // Return if gc profiling not running.
   if (!gc_prof_running_) {
     return;
   }
+  // Collect the allocations that the threads recorded since the last GC.
+  DrainThreadBuffers(self);
   // Don't need the result.
   if (drop_result) {
     ClearAndReleaseAllRecords();
+    stream_writer_.reset();
     gc_prof_running_ = false;
     return;
   }
@@ -473,7 +661,13 @@ void GcProfiler::Stop(bool drop_result) {
   profile_duration_ = NsToMs(NanoTime()) - profile_duration_;
   // Calculate throughput.
   CalculateAllocThroughput(profile_duration_);
-  DumpRecordLists();
+  if (stream_writer_ != nullptr) {
+    StreamCompletedRecords(self, /* all */ true);
+    LOG(INFO) << "GCProfile: streamed " << stream_writer_->GetRecordCount() << " records";
+    stream_writer_.reset();
+  } else {
+    DumpRecordLists();
+  }
   ClearAndReleaseAllRecords();
   LOG(INFO) << "GCProfile: Finish!";
   gc_prof_running_ = false;
@@ -485,10 +679,6 @@ void GcProfiler::DumpTitleLine(std::ofstream& out) {
   std::string size_unit = "bytes";
   std::string throughput_b_unit = "bytes/nanosecond";
   std::string throughput_n_unit = "count/nanosecond";
-  // Only need title in csv file
-  if (DumpBinary()) {
-    return;
-  }
   // Change data unit for inaccurate mode.
   if (InaccurateMode()) {
     time_unit = "milliseconds";
@@ -511,10 +701,6 @@ void GcProfiler::DumpRecordLists() {
   int err = 0;
   bool tried_data_path = false;
   struct stat buf;
-  // Using different suffix for different format.
-  if (DumpBinary()) {
-    suffix = "b";
-  }
   // Find the file path to save profile data. if data_dir not work, using app's private data path.
   do {
     // Try create output files.
@@ -558,28 +744,39 @@ void GcProfiler::DumpRecordLists() {
 
   for (auto it = record_lists_.begin();
        it != record_lists_.end(); it++) {
-    if (DumpBinary()) {
-      // Dump record type and list size when dump binary format.
-      uint32_t count = (*it)->Size();
-      if (count <= 0) {
-        continue;
-      }
-      RecordType record_type = (*it)->GetRecordType();
-      out_->write(reinterpret_cast<char*>(&count), sizeof(uint32_t));
-      out_->write(reinterpret_cast<char*>(&record_type), sizeof(uint32_t));
-      out_->flush();
-    } else {
-      // Dump Headers for record.
-      (*it)->DumpHeader(*out_);
-    }
+    // Dump Headers for record.
+    (*it)->DumpHeader(*out_);
     // Dump Records.
     (*it)->DumpRecords(*out_);
   }
   out_->close();
 }
 
+// Stream the completed records. The last GC and success allocation records are still updated
+// until the next GC starts, unless the whole profile is written.
+void GcProfiler::StreamCompletedRecords(Thread* self, bool all) {
+  if (stream_writer_ == nullptr) {
+    return;
+  }
+  const size_t keep_last = all ? 0u : 1u;
+  gc_record_list_.StreamRecords(stream_writer_.get(), keep_last);
+  {
+    MutexLock mu(self, *succ_record_lock_);
+    succ_record_list_.StreamRecords(stream_writer_.get(), keep_last);
+    large_object_alloc_record_list_.StreamRecords(stream_writer_.get(), 0u);
+  }
+  {
+    MutexLock mu(self, *fail_record_lock_);
+    fail_record_list_.StreamRecords(stream_writer_.get(), 0u);
+  }
+  if (all) {
+    alloc_info_record_list_.StreamRecords(stream_writer_.get(), 0u);
+  }
+}
+
 // Clear and release all records.
 void GcProfiler::ClearAndReleaseAllRecords() {
+  MutexLock mu(Thread::Current(), *succ_record_lock_);
   for (auto it = record_lists_.begin();
        it != record_lists_.end(); it++) {
     (*it)->ReleaseRecordsAndClear();
@@ -631,10 +828,20 @@ void GcProfiler::InsertNewGcRecord(const GcCause gc_cause, const collector::GcTy
       record->FillBasicInfo(gc_id_++, gc_cause, gc_type, gc_start_time_ns, footprint,
                             bytes_allocated, main_space_size, los_space_size);
       gc_record_list_.InsertRecord(reinterpret_cast<ProfileRecord*>(record));
+      Thread* self = Thread::Current();
       // Create success allocation record if necessory.
       if (prof_succ_allocation_) {
+        // Fold what the threads allocated before this GC into the previous records.
+        DrainThreadBuffers(self);
+        MutexLock mu(self, *succ_record_lock_);
         CreateSuccAllocRecord(record->GetGcId());
       }
+      current_gc_id_.StoreRelaxed(record->GetGcId());
+      if (stream_file_size_ != 0) {
+        // Records of the previous GCs are complete, free their memory.
+        MutexLock mu(self, *gc_profiler_lock_);
+        StreamCompletedRecords(self, /* all */ false);
+      }
     }
   }
 }
@@ -679,33 +886,102 @@ void GcProfiler::CreateSuccAllocRecord(uint32_t gc_id) {
   }
 }
 
-// Insert succ alloc record info in to current record.
-void GcProfiler::InsertSuccAllocRecord(uint32_t byte_count, mirror::Class* klass) {
+// Find the success allocation record of a GC, records are sorted by gc id. A thread may publish
+// a batch of an older GC after its record was streamed, the batch then gets a record of its own
+// rather than being counted for another GC, and the trace holds several records for the gc id.
+SuccAllocRecord* GcProfiler::FindOrCreateSuccAllocRecord(uint32_t gc_id) {
+  uint32_t i = succ_record_list_.Size();
+  for (; i != 0; --i) {
+    SuccAllocRecord* record =
+        reinterpret_cast<SuccAllocRecord*>(succ_record_list_.GetRecord(i - 1));
+    if (record->GetGcId() == gc_id) {
+      return record;
+    }
+    if (record->GetGcId() < gc_id) {
+      break;
+    }
+  }
+  SuccAllocRecord* record = new SuccAllocRecord();
+  record->SetGcId(gc_id);
+  succ_record_list_.InsertRecordAt(i, reinterpret_cast<ProfileRecord*>(record));
+  return record;
+}
+
+// Create the buffer that the thread publishes its allocations into.
+GcProfilerThreadBuffer* GcProfiler::CreateThreadBuffer(Thread* self) {
+  GcProfilerThreadBuffer* buffer = new GcProfilerThreadBuffer();
+  MutexLock mu(self, *succ_record_lock_);
+  thread_buffers_.push_back(buffer);
+  self->SetGcProfilerBuffer(buffer);
+  return buffer;
+}
+
+// Add a sample drained from a thread buffer to the records.
+void GcProfiler::AddSuccAllocSample(const SuccAllocSample& sample) {
+  if (sample.session != session_.LoadRelaxed()) {
+    return;
+  }
+  SuccAllocRecord* record = FindOrCreateSuccAllocRecord(sample.gc_id);
+  if (sample.count != 0) {
+    record->AddSample(sample);
+  } else {
+    std::string class_desc("[");
+    class_desc += Primitive::Descriptor(sample.large_object_type);
+    InsertLargeObjAllocRecord(record->GetGcId(), sample.total_size, class_desc);
+  }
+}
+
+// Drain all thread buffers, and delete the ones whose thread exited.
+void GcProfiler::DrainThreadBuffers(Thread* self) {
+  MutexLock mu(self, *succ_record_lock_);
+  auto visitor = [this](const SuccAllocSample& sample) NO_THREAD_SAFETY_ANALYSIS {
+    AddSuccAllocSample(sample);
+  };
+  for (auto it = thread_buffers_.begin(); it != thread_buffers_.end();) {
+    if ((*it)->Drain(visitor)) {
+      delete *it;
+      it = thread_buffers_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+// Insert succ alloc record info in to the thread buffer.
+void GcProfiler::InsertSuccAllocRecord(Thread* self, uint32_t byte_count, mirror::Class* klass) {
   if (gc_prof_running_) {
     if (prof_succ_allocation_ == false) {
       return;
     }
-    MutexLock mu(Thread::Current(), *succ_record_lock_);
-    // If no record in list, create one with gc id set to zero.
-    if (succ_record_list_.Size() == 0) {
-      CreateSuccAllocRecord(0);
+    GcProfilerThreadBuffer* buffer = self->GetGcProfilerBuffer();
+    if (UNLIKELY(buffer == nullptr)) {
+      buffer = CreateThreadBuffer(self);
     }
-    SuccAllocRecord* record = reinterpret_cast<SuccAllocRecord*>(succ_record_list_.GetLastRecord());
-    if (record != nullptr) {
-      record->FillFields(byte_count);
-      if (byte_count >= Heap::kDefaultLargeObjectThreshold && klass->IsPrimitiveArray()) {
-        InsertLargeObjAllocRecord(record->GetGcId(), byte_count, klass);
-      }
+    Primitive::Type large_object_type = Primitive::kPrimNot;
+    if (byte_count >= Heap::kDefaultLargeObjectThreshold && klass->IsPrimitiveArray()) {
+      large_object_type = klass->GetComponentType()->GetPrimitiveType();
+    }
+    const uint32_t session = session_.LoadRelaxed();
+    const uint32_t gc_id = current_gc_id_.LoadRelaxed();
+    if (UNLIKELY(!buffer->RecordAlloc(session, gc_id, byte_count, large_object_type))) {
+      // The ring is full of samples. Large objects are rare enough to take the lock.
+      MutexLock mu(self, *succ_record_lock_);
+      SuccAllocRecord* record = FindOrCreateSuccAllocRecord(gc_id);
+      std::string class_desc("[");
+      class_desc += Primitive::Descriptor(large_object_type);
+      InsertLargeObjAllocRecord(record->GetGcId(), byte_count, class_desc);
     }
   }
 }
 
 // Insert large object alloction info.
-void GcProfiler::InsertLargeObjAllocRecord(uint32_t gc_id, uint32_t byte_count, mirror::Class* klass) {
+void GcProfiler::InsertLargeObjAllocRecord(uint32_t gc_id,
+                                           uint32_t byte_count,
+                                           const std::string& class_desc) {
   if (gc_prof_running_) {
     LargeObjAllocRecord *record = new LargeObjAllocRecord();
     if (record != nullptr) {
-      record->FillFields(gc_id, byte_count, klass);
+      record->FillFields(gc_id, byte_count, class_desc);
       large_object_alloc_record_list_.InsertRecord(reinterpret_cast<ProfileRecord*>(record));
     }
   }
@@ -18,11 +18,17 @@
 #define ART_RUNTIME_GC_GCPROFILER_H_
 
 #include "gc/heap.h"
+#include "primitive.h"
 
 namespace art {
 
 namespace gc {
 
+class GcProfileStreamWriter;
+
+// Number of buckets of the allocation size distribution, the last one is for large objects.
+static constexpr size_t kNumSuccAllocSizeDist = 12;
+
 /* Allocation Fail until the following phases.
 * E.g. kFailUntilGCConcurrent means allocation succeed after Concurrent GC.
 */
@@ -70,6 +76,8 @@ class ProfileRecord {
   }
   // Used for InaccuratyMode.
   virtual void ConvertDataUnits() { }
+  // Append the binary trace payload of the record, in accurate units.
+  virtual void Serialize(std::vector<uint8_t>* payload) { UNUSED(payload); }
 };
 
 // Record for GC info.
@@ -121,6 +129,7 @@ class GCRecord : public ProfileRecord {
 
   void DumpRecord(std::ofstream& os);
   void ConvertDataUnits();
+  void Serialize(std::vector<uint8_t>* payload);
   uint32_t GetGcId() { return id_; }
 
  private:
@@ -154,21 +163,97 @@ class GCRecord : public ProfileRecord {
   uint32_t footprint_size_after_gc_;  // Footprint.
 };
 
+// Fixed size record that a mutator publishes through its GcProfilerThreadBuffer. It either sums
+// a batch of successful allocations or describes one large primitive array.
+struct SuccAllocSample {
+  // GcProfiler session, samples of an older session are discarded.
+  uint32_t session;
+  uint32_t gc_id;
+  // Number of allocations summed in size_dist, zero for a large object sample.
+  uint32_t count;
+  uint32_t total_size;
+  uint32_t size_dist[kNumSuccAllocSizeDist];
+  // Component type of a large primitive array.
+  Primitive::Type large_object_type;
+};
+
 // Successfully allocation record.
 class SuccAllocRecord : public ProfileRecord {
  private:
   uint32_t gc_id_;
   uint32_t total_size_;
-  uint32_t size_dist_[12];
+  uint32_t size_dist_[kNumSuccAllocSizeDist];
 
  public:
+  // Index of the size distribution bucket for an allocation of the given size.
+  static size_t SizeDistIndex(uint32_t size);
   // Insert the size distribution to allocinfo.
   void InsertSizeDist(uint32_t size);
   void DumpRecord(std::ofstream& os);
   void FillFields(uint32_t byte_count);
+  // Add a batch of allocations drained from a thread buffer.
+  void AddSample(const SuccAllocSample& sample);
   void SetGcId(uint32_t id) { gc_id_ = id; }
   uint32_t GetGcId() { return gc_id_; }
   void ConvertDataUnits();
+  void Serialize(std::vector<uint8_t>* payload);
+};
+
+// Per-thread single producer, single consumer ring of SuccAllocSample. The owning thread sums its
+// allocations into a pending batch and publishes full batches without locking or allocating. The
+// thread creating a GC record, or stopping the profiler, drains the published samples.
+class GcProfilerThreadBuffer {
+ public:
+  // Number of published samples the ring holds.
+  static constexpr size_t kCapacity = 64;
+  // Number of allocations summed in a batch before it is published.
+  static constexpr uint32_t kBatchSize = 64;
+
+  GcProfilerThreadBuffer();
+
+  // Called by the owning thread for every allocation. Returns false if a large object sample did
+  // not fit in the ring, in which case the caller has to record it some other way.
+  bool RecordAlloc(uint32_t session,
+                   uint32_t gc_id,
+                   uint32_t byte_count,
+                   Primitive::Type large_object_type);
+
+  // Called when the owning thread exits, or on its behalf when the profiler stops. The buffer then
+  // belongs to the GcProfiler, which drains the pending batch and deletes the buffer.
+  void Retire() {
+    retired_.StoreRelease(true);
+  }
+
+  // Called by the draining thread. Passes every published sample to the visitor and returns
+  // whether the owner retired, in which case its pending batch was visited as well.
+  template <typename Visitor>
+  bool Drain(const Visitor& visitor) {
+    const bool retired = retired_.LoadAcquire();
+    const size_t head = head_.LoadAcquire();
+    size_t tail = tail_.LoadRelaxed();
+    for (; tail != head; ++tail) {
+      visitor(samples_[tail % kCapacity]);
+    }
+    tail_.StoreRelease(tail);
+    if (retired && pending_.count != 0) {
+      visitor(pending_);
+    }
+    return retired;
+  }
+
+ private:
+  void ResetPending(uint32_t session, uint32_t gc_id);
+  bool Publish(const SuccAllocSample& sample);
+
+  // Only accessed by the owner, or by the drainer once the owner retired.
+  SuccAllocSample pending_;
+  SuccAllocSample samples_[kCapacity];
+  // Next slot the owner writes, and next slot the drainer reads. They only increase.
+  Atomic<size_t> head_;
+  Atomic<size_t> tail_;
+  Atomic<bool> retired_;
+
+  DISALLOW_COPY_AND_ASSIGN(GcProfilerThreadBuffer);
 };
 
 // Fail allocation record.
@@ -183,6 +268,7 @@ class FailAllocRecord : public ProfileRecord {
  public:
   void DumpRecord(std::ofstream& os);
   void ConvertDataUnits();
+  void Serialize(std::vector<uint8_t>* payload);
   void FillFields(mirror::Class* klass,
                   uint32_t bytes_allocated,
                   uint32_t max_allowed_footprint,
@@ -202,7 +288,8 @@ class LargeObjAllocRecord : public ProfileRecord {
  public:
   void DumpRecord(std::ofstream& os);
   void ConvertDataUnits();
-  void FillFields(uint32_t gc_id, uint32_t byte_count, mirror::Class* klass);
+  void Serialize(std::vector<uint8_t>* payload);
+  void FillFields(uint32_t gc_id, uint32_t byte_count, const std::string& class_desc);
 };
 
 // Allocation info.
@@ -221,6 +308,7 @@ class AllocInfoRecord : public ProfileRecord {
   void AddAllocInfo(uint32_t bytes_allocated);
   void DumpRecord(std::ofstream& os);
   void ConvertDataUnits();
+  void Serialize(std::vector<uint8_t>* payload);
   void CalculateAllocThroughput(uint64_t duration);
   AllocInfoRecord() : number_bytes_alloc_atomic_(0),
                       number_bytes_alloc_(0),
@@ -234,8 +322,12 @@ class AllocInfoRecord : public ProfileRecord {
 class RecordList {
  public:
   void DumpRecords(std::ofstream& os);
+  // Write all but the last keep_last records to the trace and release them.
+  void StreamRecords(GcProfileStreamWriter* writer, size_t keep_last);
   void InsertRecord(ProfileRecord* record);
+  void InsertRecordAt(uint32_t index, ProfileRecord* record);
   ProfileRecord* GetLastRecord();
+  ProfileRecord* GetRecord(uint32_t index) { return record_list_[index]; }
   void ReleaseRecordsAndClear();
   uint32_t Size() { return record_list_.size(); }
   void SetRecordType(RecordType record_type) {
@@ -256,9 +348,10 @@ class RecordList {
 class GcProfiler {
  public:
   // Start the profiling.
-  void Start() REQUIRES(!*gc_profiler_lock_);
+  void Start() REQUIRES(!*gc_profiler_lock_, !*succ_record_lock_);
   // Stop the profiling.
-  void Stop(bool dropResult) REQUIRES(!*gc_profiler_lock_);
+  void Stop(bool dropResult)
+      REQUIRES(!*gc_profiler_lock_, !*succ_record_lock_, !*fail_record_lock_);
   // Update the max waiting time and blocking time.
   void UpdateMaxWaitForGcTimeAndBlockingTime(uint64_t wait_time, bool update_wait_time = true,
                                              bool update_block_time = true);
@@ -271,7 +364,8 @@ class GcProfiler {
                          uint32_t bytes_allocated,
                          uint32_t footprint,
                          uint32_t main_space_size,
-                         uint32_t los_space_size);
+                         uint32_t los_space_size)
+      REQUIRES(!*gc_profiler_lock_, !*succ_record_lock_, !*fail_record_lock_);
   // Fill GCRecord fields.
   void FillGcRecordInfo(collector::GarbageCollector* collector,
                         uint32_t max_allowed_footprint,
@@ -305,9 +399,15 @@ class GcProfiler {
     data_dir_ = dir;
   }
   ~GcProfiler();
-  void InsertSuccAllocRecord(uint32_t byte_count, mirror::Class* klass)
+  // Record a successful allocation. This only takes a lock the first time a thread records an
+  // allocation, or when the thread buffer cannot hold a large object sample.
+  void InsertSuccAllocRecord(Thread* self, uint32_t byte_count, mirror::Class* klass)
       REQUIRES_SHARED(Locks::mutator_lock_)
       REQUIRES(!*succ_record_lock_);
+  // Called when a thread that recorded allocations exits.
+  void RetireThreadBuffer(GcProfilerThreadBuffer* buffer) {
+    buffer->Retire();
+  }
 
   void EnableSuccAllocProfile(bool enable) {
     prof_succ_allocation_ = enable;
@@ -321,9 +421,10 @@ class GcProfiler {
     return gc_prof_running_;
   }
 
-  // By default dump .csv file, leave binary options here for extension.
-  static bool DumpBinary() {
-    return dump_binary_format_;
+  // Stream the records to binary trace files of the given size as they complete instead of
+  // dumping a .csv file at Stop. Zero disables streaming.
+  void SetStreamFileSize(size_t size) {
+    stream_file_size_ = size;
   }
 
   // By default, inaccurate mode dump size as MB, time as ms.
@@ -346,8 +447,15 @@ class GcProfiler {
   GcProfiler& operator=(const GcProfiler&);
   // Lock for start/stop gc profiling.
   Mutex* gc_profiler_lock_;
-  // Lock for record success allocation.
+  // Lock for the success allocation records and the thread buffers.
   Mutex* succ_record_lock_;
+  // Incremented by every Start so that stale thread buffer samples are discarded.
+  Atomic<uint32_t> session_;
+  // Id of the last GC record, read by the allocating threads.
+  Atomic<uint32_t> current_gc_id_;
+  // Buffers of all threads that recorded allocations. Retired ones are deleted when drained, Stop
+  // retires all of them.
+  std::vector<GcProfilerThreadBuffer*> thread_buffers_ GUARDED_BY(*succ_record_lock_);
   // Lock for record fail allocation.
   Mutex* fail_record_lock_;
   // List of GCRecord.
@@ -359,18 +467,33 @@ class GcProfiler {
   RecordList large_object_alloc_record_list_;
   RecordList alloc_info_record_list_;
   std::vector<RecordList*> record_lists_;
-  // Dump result as .csv file.
-  static constexpr bool dump_binary_format_ = false;
+  // Size of each binary trace file, zero to dump a .csv file at Stop.
+  size_t stream_file_size_;
+  // Writer of the binary trace while streaming, guarded by gc_profiler_lock_.
+  std::unique_ptr<GcProfileStreamWriter> stream_writer_;
   // Dump time in ms and size in MB.
   static constexpr bool inaccurate_mode_ = true;
   // Dump title line for csv file.
   void DumpTitleLine(std::ofstream& out);
   // Dump all Record info.
   void DumpRecordLists();
+  // Write the records that cannot change any more to the trace, or all of them.
+  void StreamCompletedRecords(Thread* self, bool all)
+      REQUIRES(*gc_profiler_lock_, !*succ_record_lock_, !*fail_record_lock_);
   void ClearAndReleaseAllRecords();
   void CalculateAllocThroughput(uint64_t profile_duration);
-  void CreateSuccAllocRecord(uint32_t gc_id);
-  void InsertLargeObjAllocRecord(uint32_t gc_id, uint32_t byte_count, mirror::Class* klass);
+  void CreateSuccAllocRecord(uint32_t gc_id) REQUIRES(*succ_record_lock_);
+  SuccAllocRecord* FindOrCreateSuccAllocRecord(uint32_t gc_id) REQUIRES(*succ_record_lock_);
+  GcProfilerThreadBuffer* CreateThreadBuffer(Thread* self) REQUIRES(!*succ_record_lock_);
+  // Run a checkpoint that retires the buffer of every live thread.
+  void RetireThreadBuffers(Thread* self)
+      REQUIRES(!*gc_profiler_lock_, !Locks::thread_list_lock_,
+               !Locks::thread_suspend_count_lock_);
+  // Fold the samples published by all thread buffers into the record lists.
+  void DrainThreadBuffers(Thread* self) REQUIRES(!*succ_record_lock_);
+  void AddSuccAllocSample(const SuccAllocSample& sample) REQUIRES(*succ_record_lock_);
+  void InsertLargeObjAllocRecord(uint32_t gc_id, uint32_t byte_count, const std::string& class_desc)
+      REQUIRES(*succ_record_lock_);
   void CreateAllocInfoRecord();
   uint32_t GetCurrentGcId();
 };
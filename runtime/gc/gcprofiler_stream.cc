@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "gcprofiler_stream.h"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "android-base/stringprintf.h"
+
+#include "base/bit_utils.h"
+#include "base/logging.h"
+#include "base/unix_file/fd_file.h"
+#include "mem_map.h"
+#include "os.h"
+
+namespace art {
+namespace gc {
+
+using android::base::StringPrintf;
+
+constexpr uint32_t GcProfileStreamWriter::kMagic;
+constexpr uint16_t GcProfileStreamWriter::kVersion;
+constexpr size_t GcProfileStreamWriter::kHeaderSize;
+constexpr size_t GcProfileStreamWriter::kRecordHeaderSize;
+constexpr size_t GcProfileStreamWriter::kMaxFiles;
+
+GcProfileStreamWriter* GcProfileStreamWriter::Create(const std::string& dir,
+                                                     size_t file_size,
+                                                     std::string* error_msg) {
+  std::unique_ptr<GcProfileStreamWriter> writer(
+      new GcProfileStreamWriter(dir, RoundUp(file_size, kPageSize)));
+  if (!writer->OpenNextFile(error_msg)) {
+    return nullptr;
+  }
+  return writer.release();
+}
+
+GcProfileStreamWriter::GcProfileStreamWriter(const std::string& dir, size_t file_size)
+    : dir_(dir),
+      file_size_(file_size),
+      next_file_index_(0),
+      pos_(0),
+      record_count_(0) {
+}
+
+GcProfileStreamWriter::~GcProfileStreamWriter() {
+  CloseFile();
+}
+
+bool GcProfileStreamWriter::OpenNextFile(std::string* error_msg) {
+  const std::string file_name =
+      StringPrintf("%s/gc_trace_%d_%u.bin", dir_.c_str(), getpid(), next_file_index_);
+  std::unique_ptr<File> file(OS::CreateEmptyFile(file_name.c_str()));
+  if (file == nullptr) {
+    *error_msg = StringPrintf("Failed to create %s: %s", file_name.c_str(), strerror(errno));
+    return false;
+  }
+  if (file->SetLength(file_size_) != 0) {
+    *error_msg = StringPrintf("Failed to set the length of %s: %s",
+                              file_name.c_str(),
+                              strerror(errno));
+    file->Erase(/* unlink */ true);
+    return false;
+  }
+  std::unique_ptr<MemMap> map(MemMap::MapFile(file_size_,
+                                              PROT_READ | PROT_WRITE,
+                                              MAP_SHARED,
+                                              file->Fd(),
+                                              /* start */ 0,
+                                              /* low_4gb */ false,
+                                              file_name.c_str(),
+                                              error_msg));
+  if (map == nullptr) {
+    file->Erase(/* unlink */ true);
+    return false;
+  }
+  uint8_t* header = map->Begin();
+  const uint32_t magic = kMagic;
+  const uint16_t version = kVersion;
+  const uint16_t header_size = kHeaderSize;
+  const uint32_t pid = getpid();
+  memcpy(header, &magic, sizeof(magic));
+  memcpy(header + 4, &version, sizeof(version));
+  memcpy(header + 6, &header_size, sizeof(header_size));
+  memcpy(header + 8, &pid, sizeof(pid));
+  memcpy(header + 12, &next_file_index_, sizeof(next_file_index_));
+  file_ = std::move(file);
+  map_ = std::move(map);
+  pos_ = kHeaderSize;
+  ++next_file_index_;
+  file_names_.push_back(file_name);
+  // Keep the disk usage bounded by dropping the oldest records.
+  while (file_names_.size() > kMaxFiles) {
+    if (unlink(file_names_.front().c_str()) != 0) {
+      PLOG(WARNING) << "GCProfile: failed to delete " << file_names_.front();
+    }
+    file_names_.pop_front();
+  }
+  return true;
+}
+
+void GcProfileStreamWriter::CloseFile() {
+  if (file_ == nullptr) {
+    return;
+  }
+  map_.reset();
+  // The end marker is part of the zero filled tail, keep it when trimming the file.
+  const size_t used = std::min(pos_ + kRecordHeaderSize, file_size_);
+  if (file_->SetLength(used) != 0 || file_->FlushClose() != 0) {
+    PLOG(WARNING) << "GCProfile: failed to finish " << file_->GetPath();
+  }
+  file_.reset();
+}
+
+bool GcProfileStreamWriter::WriteRecord(uint32_t type, const std::vector<uint8_t>& payload) {
+  const size_t size = kRecordHeaderSize + payload.size();
+  // Leave room for the end marker.
+  if (size + kRecordHeaderSize > file_size_ - kHeaderSize) {
+    LOG(WARNING) << "GCProfile: dropping a record of " << size << " bytes";
+    return false;
+  }
+  if (file_ == nullptr || pos_ + size + kRecordHeaderSize > file_size_) {
+    CloseFile();
+    std::string error_msg;
+    if (!OpenNextFile(&error_msg)) {
+      LOG(WARNING) << "GCProfile: " << error_msg;
+      return false;
+    }
+  }
+  uint8_t* out = map_->Begin() + pos_;
+  const uint32_t payload_size = payload.size();
+  memcpy(out, &payload_size, sizeof(payload_size));
+  memcpy(out + 4, &type, sizeof(type));
+  memcpy(out + kRecordHeaderSize, payload.data(), payload.size());
+  pos_ += size;
+  ++record_count_;
+  return true;
+}
+
+}  // namespace gc
+}  // namespace art
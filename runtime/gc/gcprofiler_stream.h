@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_GC_GCPROFILER_STREAM_H_
+#define ART_RUNTIME_GC_GCPROFILER_STREAM_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/macros.h"
+#include "os.h"
+
+namespace art {
+
+class MemMap;
+
+namespace gc {
+
+// Writes GcProfiler records as they complete into memory mapped trace files, so that a long
+// profiling run does not keep its records in memory. The files are named
+// gc_trace_<pid>_<index>.bin. When a file is full the writer moves on to the next index and
+// deletes the oldest file beyond kMaxFiles, so the trace keeps the most recent records.
+//
+// Values are in native byte order, which is little endian on all supported ISAs. A file starts
+// with a header:
+//   u32 magic, u16 version, u16 header size, u32 pid, u32 file index
+// followed by records:
+//   u32 payload size, u32 record type (RecordType), payload
+// A zero payload size and type ends the file. tools/gcprofile-trace-decoder.py decodes the
+// payloads of every record type.
+class GcProfileStreamWriter {
+ public:
+  static constexpr uint32_t kMagic = 0x54504347;  // "GCPT"
+  static constexpr uint16_t kVersion = 1;
+  static constexpr size_t kHeaderSize = 16;
+  static constexpr size_t kRecordHeaderSize = 8;
+  // Number of trace files kept on disk.
+  static constexpr size_t kMaxFiles = 4;
+
+  // Returns null and sets error_msg if the first trace file cannot be created.
+  static GcProfileStreamWriter* Create(const std::string& dir,
+                                       size_t file_size,
+                                       std::string* error_msg);
+
+  // Trims the current file to the records written.
+  ~GcProfileStreamWriter();
+
+  // Append a record, moving to the next file if it does not fit. Returns false if the record is
+  // larger than a file or the next file cannot be created.
+  bool WriteRecord(uint32_t type, const std::vector<uint8_t>& payload);
+
+  size_t GetRecordCount() const {
+    return record_count_;
+  }
+
+  // Helpers for the record payloads.
+  template <typename T>
+  static void Append(std::vector<uint8_t>* payload, T value) {
+    const size_t pos = payload->size();
+    payload->resize(pos + sizeof(T));
+    memcpy(payload->data() + pos, &value, sizeof(T));
+  }
+  static void AppendString(std::vector<uint8_t>* payload, const char* str) {
+    payload->insert(payload->end(), str, str + strlen(str));
+  }
+
+ private:
+  GcProfileStreamWriter(const std::string& dir, size_t file_size);
+
+  bool OpenNextFile(std::string* error_msg);
+  void CloseFile();
+
+  const std::string dir_;
+  const size_t file_size_;
+  uint32_t next_file_index_;
+  std::unique_ptr<File> file_;
+  std::unique_ptr<MemMap> map_;
+  // Write position in the current file.
+  size_t pos_;
+  size_t record_count_;
+  // Names of the files on disk, oldest first.
+  std::deque<std::string> file_names_;
+
+  DISALLOW_COPY_AND_ASSIGN(GcProfileStreamWriter);
+};
+
+}  // namespace gc
+}  // namespace art
+
+#endif  // ART_RUNTIME_GC_GCPROFILER_STREAM_H_
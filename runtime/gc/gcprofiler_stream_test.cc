@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "gcprofiler_stream.h"
+
+#include <dirent.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "android-base/stringprintf.h"
+
+#include "base/unix_file/fd_file.h"
+#include "common_runtime_test.h"
+#include "os.h"
+
+namespace art {
+namespace gc {
+
+class GcProfileStreamTest : public CommonRuntimeTest {
+ protected:
+  std::vector<std::string> ListTraceFiles() {
+    std::vector<std::string> names;
+    DIR* dir = opendir(android_data_.c_str());
+    CHECK(dir != nullptr);
+    while (dirent* e = readdir(dir)) {
+      if (strncmp(e->d_name, "gc_trace_", 9) == 0) {
+        names.push_back(e->d_name);
+      }
+    }
+    closedir(dir);
+    std::sort(names.begin(), names.end());
+    return names;
+  }
+
+  std::string TraceFileName(uint32_t index) {
+    return android::base::StringPrintf("gc_trace_%d_%u.bin", getpid(), index);
+  }
+
+  std::vector<uint8_t> ReadTraceFile(const std::string& name) {
+    std::unique_ptr<File> file(OS::OpenFileForReading((android_data_ + "/" + name).c_str()));
+    CHECK(file != nullptr);
+    std::vector<uint8_t> data(file->GetLength());
+    CHECK(file->ReadFully(data.data(), data.size()));
+    return data;
+  }
+
+  template <typename T>
+  static T Read(const std::vector<uint8_t>& data, size_t offset) {
+    T value;
+    memcpy(&value, data.data() + offset, sizeof(T));
+    return value;
+  }
+};
+
+TEST_F(GcProfileStreamTest, WritesRecords) {
+  std::string error_msg;
+  std::unique_ptr<GcProfileStreamWriter> writer(
+      GcProfileStreamWriter::Create(android_data_, kPageSize, &error_msg));
+  ASSERT_TRUE(writer != nullptr) << error_msg;
+  std::vector<uint8_t> payload;
+  GcProfileStreamWriter::Append<uint32_t>(&payload, 42u);
+  GcProfileStreamWriter::Append<uint64_t>(&payload, 1234567890123u);
+  GcProfileStreamWriter::AppendString(&payload, "[B");
+  EXPECT_TRUE(writer->WriteRecord(3u, payload));
+  EXPECT_EQ(writer->GetRecordCount(), 1u);
+  writer.reset();
+
+  ASSERT_EQ(ListTraceFiles(), std::vector<std::string>{TraceFileName(0)});
+  std::vector<uint8_t> data = ReadTraceFile(TraceFileName(0));
+  // The file is trimmed to the header, the record and the end marker.
+  const size_t record_end = GcProfileStreamWriter::kHeaderSize +
+      GcProfileStreamWriter::kRecordHeaderSize + payload.size();
+  ASSERT_EQ(data.size(), record_end + GcProfileStreamWriter::kRecordHeaderSize);
+  EXPECT_EQ(Read<uint32_t>(data, 0), GcProfileStreamWriter::kMagic);
+  EXPECT_EQ(Read<uint16_t>(data, 4), GcProfileStreamWriter::kVersion);
+  EXPECT_EQ(Read<uint16_t>(data, 6), GcProfileStreamWriter::kHeaderSize);
+  EXPECT_EQ(Read<uint32_t>(data, 8), static_cast<uint32_t>(getpid()));
+  EXPECT_EQ(Read<uint32_t>(data, 12), 0u);
+  const size_t record = GcProfileStreamWriter::kHeaderSize;
+  EXPECT_EQ(Read<uint32_t>(data, record), payload.size());
+  EXPECT_EQ(Read<uint32_t>(data, record + 4), 3u);
+  EXPECT_EQ(Read<uint32_t>(data, record + 8), 42u);
+  EXPECT_EQ(Read<uint64_t>(data, record + 12), 1234567890123u);
+  EXPECT_EQ(memcmp(data.data() + record + 20, "[B", 2), 0);
+  EXPECT_EQ(Read<uint64_t>(data, record_end), 0u);
+}
+
+TEST_F(GcProfileStreamTest, RotatesFiles) {
+  std::string error_msg;
+  std::unique_ptr<GcProfileStreamWriter> writer(
+      GcProfileStreamWriter::Create(android_data_, kPageSize, &error_msg));
+  ASSERT_TRUE(writer != nullptr) << error_msg;
+  // Three records fit in a file.
+  std::vector<uint8_t> payload(kPageSize / 4, 0xab);
+  const size_t kRecords = 3 * (GcProfileStreamWriter::kMaxFiles + 2);
+  for (size_t i = 0; i < kRecords; ++i) {
+    EXPECT_TRUE(writer->WriteRecord(0u, payload));
+  }
+  // Records that cannot fit in any file are dropped.
+  EXPECT_FALSE(writer->WriteRecord(0u, std::vector<uint8_t>(kPageSize)));
+  EXPECT_EQ(writer->GetRecordCount(), kRecords);
+  writer.reset();
+
+  // Only the newest files are kept.
+  std::vector<std::string> expected;
+  for (size_t i = 2; i < GcProfileStreamWriter::kMaxFiles + 2; ++i) {
+    expected.push_back(TraceFileName(i));
+  }
+  std::sort(expected.begin(), expected.end());
+  EXPECT_EQ(ListTraceFiles(), expected);
+  std::vector<uint8_t> data = ReadTraceFile(TraceFileName(GcProfileStreamWriter::kMaxFiles + 1));
+  EXPECT_EQ(Read<uint32_t>(data, 12), GcProfileStreamWriter::kMaxFiles + 1);
+}
+
+}  // namespace gc
+}  // namespace art
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "gcprofiler.h"
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace art {
+namespace gc {
+
+// Drains the buffer and returns the samples, with the sum of their allocation counts.
+static std::vector<SuccAllocSample> DrainSamples(GcProfilerThreadBuffer* buffer,
+                                                 uint32_t* total_count,
+                                                 bool* retired) {
+  std::vector<SuccAllocSample> samples;
+  *total_count = 0;
+  *retired = buffer->Drain([&](const SuccAllocSample& sample) {
+    samples.push_back(sample);
+    *total_count += sample.count;
+  });
+  return samples;
+}
+
+TEST(GcProfilerThreadBufferTest, PublishesFullBatches) {
+  GcProfilerThreadBuffer buffer;
+  for (uint32_t i = 0; i < GcProfilerThreadBuffer::kBatchSize * 2 + 1; ++i) {
+    EXPECT_TRUE(buffer.RecordAlloc(1, 0, 32, Primitive::kPrimNot));
+  }
+  uint32_t count;
+  bool retired;
+  std::vector<SuccAllocSample> samples = DrainSamples(&buffer, &count, &retired);
+  EXPECT_FALSE(retired);
+  ASSERT_EQ(samples.size(), 2u);
+  EXPECT_EQ(count, GcProfilerThreadBuffer::kBatchSize * 2);
+  EXPECT_EQ(samples[0].total_size, GcProfilerThreadBuffer::kBatchSize * 32);
+  EXPECT_EQ(samples[0].size_dist[SuccAllocRecord::SizeDistIndex(32)],
+            GcProfilerThreadBuffer::kBatchSize);
+  // Nothing is drained twice.
+  samples = DrainSamples(&buffer, &count, &retired);
+  EXPECT_TRUE(samples.empty());
+}
+
+TEST(GcProfilerThreadBufferTest, PublishesOnGcChange) {
+  GcProfilerThreadBuffer buffer;
+  buffer.RecordAlloc(1, 0, 16, Primitive::kPrimNot);
+  buffer.RecordAlloc(1, 0, 16, Primitive::kPrimNot);
+  buffer.RecordAlloc(1, 1, 16, Primitive::kPrimNot);
+  uint32_t count;
+  bool retired;
+  std::vector<SuccAllocSample> samples = DrainSamples(&buffer, &count, &retired);
+  ASSERT_EQ(samples.size(), 1u);
+  EXPECT_EQ(samples[0].gc_id, 0u);
+  EXPECT_EQ(samples[0].count, 2u);
+  // The pending batch of the exited thread is drained with the rest.
+  buffer.Retire();
+  samples = DrainSamples(&buffer, &count, &retired);
+  EXPECT_TRUE(retired);
+  ASSERT_EQ(samples.size(), 1u);
+  EXPECT_EQ(samples[0].gc_id, 1u);
+  EXPECT_EQ(samples[0].count, 1u);
+}
+
+TEST(GcProfilerThreadBufferTest, FullRingKeepsCounts) {
+  GcProfilerThreadBuffer buffer;
+  const uint32_t allocs =
+      GcProfilerThreadBuffer::kBatchSize * (GcProfilerThreadBuffer::kCapacity + 3);
+  for (uint32_t i = 0; i < allocs; ++i) {
+    buffer.RecordAlloc(1, 0, 64, Primitive::kPrimNot);
+  }
+  // Large objects do not fit any more and are left to the caller.
+  EXPECT_FALSE(buffer.RecordAlloc(1, 0, 16 * KB, Primitive::kPrimByte));
+  buffer.Retire();
+  uint32_t count;
+  bool retired;
+  std::vector<SuccAllocSample> samples = DrainSamples(&buffer, &count, &retired);
+  EXPECT_EQ(samples.size(), GcProfilerThreadBuffer::kCapacity + 1);
+  EXPECT_EQ(count, allocs + 1);
+}
+
+TEST(GcProfilerThreadBufferTest, LargeObjectSample) {
+  GcProfilerThreadBuffer buffer;
+  EXPECT_TRUE(buffer.RecordAlloc(1, 3, 16 * KB, Primitive::kPrimInt));
+  uint32_t count;
+  bool retired;
+  std::vector<SuccAllocSample> samples = DrainSamples(&buffer, &count, &retired);
+  ASSERT_EQ(samples.size(), 1u);
+  EXPECT_EQ(samples[0].count, 0u);
+  EXPECT_EQ(samples[0].gc_id, 3u);
+  EXPECT_EQ(samples[0].total_size, 16 * KB);
+  EXPECT_EQ(samples[0].large_object_type, Primitive::kPrimInt);
+}
+
+}  // namespace gc
+}  // namespace art
@@ -24,6 +24,8 @@
 #include "gc/accounting/atomic_stack.h"
 #include "gc/accounting/card_table-inl.h"
 #include "gc/allocation_record.h"
+#include "gc/allocation_sampler.h"
+#include "gc/allocation_site_tracker.h"
 #include "gc/collector/semi_space.h"
 #include "gc/space/bump_pointer_space-inl.h"
 #include "gc/space/dlmalloc_space-inl.h"
@@ -114,6 +116,9 @@ inline mirror::Object* Heap::AllocObjectWithAllocator(Thread* self,
   } else {
     // bytes allocated that takes bulk thread-local buffer allocations into account.
     size_t bytes_tl_bulk_allocated = 0;
+    if (UNLIKELY(allocation_sampler_ != nullptr)) {
+      self->GetAllocSampling()->charged = false;
+    }
     obj = TryToAllocate<kInstrumented, false>(self, allocator, byte_count, &bytes_allocated,
                                               &usable_size, &bytes_tl_bulk_allocated);
     if (UNLIKELY(obj == nullptr)) {
@@ -144,7 +149,7 @@ inline mirror::Object* Heap::AllocObjectWithAllocator(Thread* self,
     if (Runtime::Current()->EnabledGcProfile()) {
       GcProfiler* gcProfiler = GcProfiler::GetInstance();
       if (obj != nullptr && gcProfiler->ProfileSuccAllocInfo()) {
-        gcProfiler->InsertSuccAllocRecord(byte_count, klass.Ptr());
+        gcProfiler->InsertSuccAllocRecord(self, byte_count, klass.Ptr());
       }
     }
     DCHECK_GT(bytes_allocated, 0u);
@@ -176,6 +181,23 @@ inline mirror::Object* Heap::AllocObjectWithAllocator(Thread* self,
       // Only trace when we get an increase in the number of bytes allocated. This happens when
       // obtaining a new TLAB and isn't often enough to hurt performance according to golem.
       TraceHeapSize(new_num_bytes_allocated + bytes_tl_bulk_allocated);
+      // A TLAB refill is also a cheap sampling point for the allocation sites.
+      if (UNLIKELY(allocation_site_tracker_ != nullptr) && IsTLABAllocator(allocator)) {
+        allocation_site_tracker_->ObjectAllocated(self, &obj, bytes_allocated);
+      }
+    }
+    if (UNLIKELY(allocation_sampler_ != nullptr)) {
+      // AllocWithNewTLAB charged a TLAB refill or an idle thread's shared region allocation
+      // already. Charge the other bulk allocations, which cover the RosAlloc thread-local runs,
+      // and the allocations outside of a buffer here.
+      if (!self->GetAllocSampling()->charged && bytes_tl_bulk_allocated > 0) {
+        allocation_sampler_->ChargeAllocation(self,
+                                              std::min(bytes_allocated, bytes_tl_bulk_allocated),
+                                              bytes_tl_bulk_allocated);
+      }
+      if (AllocationSampler::TakeSample(self)) {
+        allocation_sampler_->RecordSample(self, &obj, bytes_allocated);
+      }
     }
   }
   if (kIsDebugBuild && Runtime::Current()->IsStarted()) {
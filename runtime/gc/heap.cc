@@ -16,8 +16,10 @@
 
 #include "heap.h"
 
+#include <algorithm>
 #include <limits>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
 #include "android-base/stringprintf.h"
@@ -45,12 +47,14 @@
 #include "gc/accounting/read_barrier_table.h"
 #include "gc/accounting/remembered_set.h"
 #include "gc/accounting/space_bitmap-inl.h"
+#include "gc/class_histogram.h"
 #include "gc/collector/concurrent_copying.h"
 #include "gc/collector/mark_compact.h"
 #include "gc/collector/mark_sweep.h"
 #include "gc/collector/partial_mark_sweep.h"
 #include "gc/collector/semi_space.h"
 #include "gc/collector/sticky_mark_sweep.h"
+#include "gc/gc_pacer.h"
 #include "gc/reference_processor.h"
 #include "gc/scoped_gc_critical_section.h"
 #include "gc/space/bump_pointer_space.h"
@@ -85,6 +89,7 @@
 #include "runtime.h"
 #include "scoped_thread_state_change-inl.h"
 #include "thread_list.h"
+#include "utils.h"
 #include "verify_object-inl.h"
 #include "well_known_classes.h"
 #include "gc/gcprofiler.h"
@@ -106,6 +111,8 @@ static constexpr size_t kMaxConcurrentRemainingBytes = 512 * KB;
 // relative to partial/full GC. This may be desirable since sticky GCs interfere less with mutator
 // threads (lower pauses, use less memory bandwidth).
 static constexpr double kStickyGcThroughputAdjustment = 1.0;
+// Fraction of the footprint the old generation may fill before a generational CC runs a full GC.
+static constexpr double kGenerationalCCOldGenOccupancyThreshold = 0.75;
 // Whether or not we compact the zygote in PreZygoteFork.
 static constexpr bool kCompactZygote = kMovingCollector;
 // How many reserve entries are at the end of the allocation stack, these are only needed if the
@@ -146,6 +153,15 @@ static constexpr bool kLogAllGCs = false;
 static constexpr size_t kPartialTlabSize = 16 * KB;
 static constexpr bool kUsePartialTlabs = true;
 
+// Adaptive TLAB sizing aims for each thread to refill its TLAB about this many times between
+// two GCs.
+static constexpr size_t kTlabTargetRefillsPerGc = 32;
+static constexpr size_t kMinAdaptiveTlabSize = 4 * KB;
+static constexpr size_t kMaxAdaptiveTlabSize = 256 * KB;
+// A thread that took less than this much TLAB space in the previous and the current epoch
+// allocates from the shared region instead of pinning a region TLAB.
+static constexpr size_t kIdleThreadTlabBytes = 2 * kMinAdaptiveTlabSize;
+
 #if defined(__LP64__) || !defined(ADDRESS_SANITIZER)
 // 300 MB (0x12c00000) - (default non-moving space capacity).
 static uint8_t* const kPreferredAllocSpaceBegin =
@@ -176,6 +192,7 @@ Heap::Heap(size_t initial_size,
            const InstructionSet image_instruction_set,
            CollectorType foreground_collector_type,
            CollectorType background_collector_type,
+           bool use_generational_cc,
            space::LargeObjectSpaceType large_object_space_type,
            size_t large_object_threshold,
            size_t parallel_gc_threads,
@@ -185,6 +202,11 @@ Heap::Heap(size_t initial_size,
            size_t long_gc_log_threshold,
            bool ignore_max_footprint,
            bool use_tlab,
+           bool numa_aware_regions,
+           bool gc_worker_numa_affinity,
+           uint64_t gc_pause_target,
+           unsigned int gc_cpu_percent,
+           bool use_huge_pages,
            bool verify_pre_gc_heap,
            bool verify_pre_sweeping_heap,
            bool verify_post_gc_heap,
@@ -209,6 +231,7 @@ Heap::Heap(size_t initial_size,
       foreground_collector_type_(foreground_collector_type),
       background_collector_type_(background_collector_type),
       desired_collector_type_(foreground_collector_type_),
+      use_generational_cc_(use_generational_cc),
       pending_task_lock_(nullptr),
       parallel_gc_threads_(parallel_gc_threads),
       conc_gc_threads_(conc_gc_threads),
@@ -276,11 +299,22 @@ Heap::Heap(size_t initial_size,
       tlab_alloc_threshold_(tlab_alloc_threshold),
       bump_space_capacity_(bump_space_capacity),
 	  moving_gc_count_(0),
+      gcs_started_(0),
+      tlab_sizing_epoch_(0),
+      tlab_refills_(0),
+      tlab_expansions_(0),
+      tlab_idle_thread_allocations_(0),
+      tlabs_retired_(0),
+      tlab_retired_unused_bytes_(0),
       semi_space_collector_(nullptr),
       mark_compact_collector_(nullptr),
       concurrent_copying_collector_(nullptr),
+      young_concurrent_copying_collector_(nullptr),
+      active_concurrent_copying_collector_(nullptr),
       is_running_on_memory_tool_(Runtime::Current()->IsRunningOnMemoryTool()),
       use_tlab_(use_tlab),
+      numa_aware_regions_(numa_aware_regions),
+      gc_worker_numa_affinity_(gc_worker_numa_affinity),
       main_space_backup_(nullptr),
       min_interval_homogeneous_space_compaction_by_oom_(
           min_interval_homogeneous_space_compaction_by_oom),
@@ -481,9 +515,12 @@ Heap::Heap(size_t initial_size,
     CHECK(separate_non_moving_space);
     MemMap* region_space_mem_map = space::RegionSpace::CreateMemMap(kRegionSpaceName,
                                                                     capacity_ * 2,
-                                                                    request_begin);
+                                                                    request_begin,
+                                                                    use_huge_pages);
     CHECK(region_space_mem_map != nullptr) << "No region space mem map";
-    region_space_ = space::RegionSpace::Create(kRegionSpaceName, region_space_mem_map);
+    region_space_ = space::RegionSpace::Create(kRegionSpaceName,
+                                               region_space_mem_map,
+                                               numa_aware_regions_);
     AddSpace(region_space_);
   } else if (IsMovingGc(foreground_collector_type_) &&
       foreground_collector_type_ != kCollectorTypeGSS &&
@@ -536,10 +573,11 @@ Heap::Heap(size_t initial_size,
   // Allocate the large object space.
   if (large_object_space_type == space::LargeObjectSpaceType::kFreeList) {
     large_object_space_ = space::FreeListSpace::Create("free list large object space", nullptr,
-                                                       capacity_);
+                                                       capacity_, use_huge_pages);
     CHECK(large_object_space_ != nullptr) << "Failed to create large object space";
   } else if (large_object_space_type == space::LargeObjectSpaceType::kMap) {
-    large_object_space_ = space::LargeObjectMapSpace::Create("mem map large object space");
+    large_object_space_ = space::LargeObjectMapSpace::Create("mem map large object space",
+                                                             use_huge_pages);
     CHECK(large_object_space_ != nullptr) << "Failed to create large object space";
   } else {
     // Disable the large object space by making the cutoff excessively large.
@@ -620,6 +658,9 @@ Heap::Heap(size_t initial_size,
   thread_flip_cond_.reset(new ConditionVariable("GC thread flip condition variable",
                                                 *thread_flip_lock_));
   task_processor_.reset(new TaskProcessor());
+  if (gc_pause_target != 0 || gc_cpu_percent != 0) {
+    gc_pacer_.reset(new GcPacer(gc_pause_target, gc_cpu_percent));
+  }
   reference_processor_.reset(new ReferenceProcessor());
   pending_task_lock_ = new Mutex("Pending task lock");
   if (ignore_max_footprint_) {
@@ -660,11 +701,22 @@ Heap::Heap(size_t initial_size,
     }
     if (MayUseCollector(kCollectorTypeCC)) {
       concurrent_copying_collector_ = new collector::ConcurrentCopying(this,
+                                                                       /*young_gen*/ false,
                                                                        "",
                                                                        measure_gc_performance);
       DCHECK(region_space_ != nullptr);
       concurrent_copying_collector_->SetRegionSpace(region_space_);
       garbage_collectors_.push_back(concurrent_copying_collector_);
+      if (use_generational_cc_) {
+        young_concurrent_copying_collector_ = new collector::ConcurrentCopying(
+            this,
+            /*young_gen*/ true,
+            "young",
+            measure_gc_performance);
+        young_concurrent_copying_collector_->SetRegionSpace(region_space_);
+        garbage_collectors_.push_back(young_concurrent_copying_collector_);
+      }
+      active_concurrent_copying_collector_ = concurrent_copying_collector_;
     }
     if (MayUseCollector(kCollectorTypeMC)) {
       mark_compact_collector_ = new collector::MarkCompact(this);
@@ -996,6 +1048,10 @@ void Heap::CreateThreadPool() {
   const size_t num_threads = std::max(parallel_gc_threads_, conc_gc_threads_);
   if (num_threads != 0) {
     thread_pool_.reset(new ThreadPool("Heap thread pool", num_threads));
+    const size_t num_numa_nodes = GetNumaNodeCount();
+    if (gc_worker_numa_affinity_ && num_numa_nodes > 1) {
+      thread_pool_->SetNumaAffinity(num_numa_nodes);
+    }
   }
 }
 
@@ -1159,6 +1215,27 @@ void Heap::DumpGcPerformanceInfo(std::ostream& os) {
   if (kDumpRosAllocStatsOnSigQuit && rosalloc_space_ != nullptr) {
     rosalloc_space_->DumpStats(os);
   }
+  const uint64_t tlabs_retired = tlabs_retired_.LoadRelaxed();
+  if (tlab_refills_.LoadRelaxed() != 0 || tlabs_retired != 0) {
+    os << "TLAB refills " << tlab_refills_.LoadRelaxed()
+       << " expansions " << tlab_expansions_.LoadRelaxed()
+       << " idle thread allocations " << tlab_idle_thread_allocations_.LoadRelaxed() << "\n";
+    const uint64_t unused_bytes = tlab_retired_unused_bytes_.LoadRelaxed();
+    os << "TLABs retired " << tlabs_retired << " with " << PrettySize(unused_bytes) << " unused";
+    if (tlabs_retired != 0) {
+      os << " (" << PrettySize(unused_bytes / tlabs_retired) << " per TLAB)";
+    }
+    os << "\n";
+  }
+  if (region_space_ != nullptr) {
+    region_space_->DumpNumaStats(os);
+  }
+  if (gc_pacer_ != nullptr) {
+    gc_pacer_->Dump(os);
+  }
+  if (idle_detector_ != nullptr) {
+    idle_detector_->Dump(os);
+  }
 
   os << "Registered native bytes allocated: "
      << old_native_bytes_allocated_.LoadRelaxed() + new_native_bytes_allocated_.LoadRelaxed()
@@ -1178,6 +1255,11 @@ void Heap::ResetGcPerformanceInfo() {
   blocking_gc_time_ = 0;
   gc_count_last_window_ = 0;
   blocking_gc_count_last_window_ = 0;
+  tlab_refills_.StoreRelaxed(0);
+  tlab_expansions_.StoreRelaxed(0);
+  tlab_idle_thread_allocations_.StoreRelaxed(0);
+  tlabs_retired_.StoreRelaxed(0);
+  tlab_retired_unused_bytes_.StoreRelaxed(0);
   last_update_time_gc_count_rate_histograms_ =  // Round down by the window duration.
       (NanoTime() / kGcCountRateHistogramWindowDuration) * kGcCountRateHistogramWindowDuration;
   {
@@ -1378,8 +1460,7 @@ void Heap::DoPendingCollectorTransition() {
   }
 }
 
-void Heap::Trim(Thread* self) {
-  Runtime* const runtime = Runtime::Current();
+void Heap::DeflateMonitors(Thread* self) {
   if (!CareAboutPauseTimes()) {
     // Deflate the monitors, this can cause a pause but shouldn't matter since we don't care
     // about pauses.
@@ -1388,14 +1469,66 @@ void Heap::Trim(Thread* self) {
     ScopedGCCriticalSection gcs(self, kGcCauseTrim, kCollectorTypeHeapTrim);
     ScopedSuspendAll ssa(__FUNCTION__);
     uint64_t start_time = NanoTime();
-    size_t count = runtime->GetMonitorList()->DeflateMonitors();
+    size_t count = Runtime::Current()->GetMonitorList()->DeflateMonitors();
     VLOG(heap) << "Deflating " << count << " monitors took "
         << PrettyDuration(NanoTime() - start_time);
   }
+}
+
+void Heap::Trim(Thread* self) {
+  DeflateMonitors(self);
   TrimIndirectReferenceTables(self);
   TrimSpaces(self);
   // Trim arenas that may have been used by JIT or verifier.
-  runtime->GetArenaPool()->TrimMaps();
+  Runtime::Current()->GetArenaPool()->TrimMaps();
+}
+
+void Heap::EnableIdleTrim(uint64_t idle_delay_ns, uint32_t cpu_percent) {
+  CHECK(idle_detector_ == nullptr);
+  CHECK_NE(idle_delay_ns, 0u);
+  idle_detector_.reset(new IdleDetector(idle_delay_ns, cpu_percent));
+}
+
+IdleDetector::Sample Heap::SampleIdleState() const {
+  return IdleDetector::Sample { NanoTime(), GetBytesAllocatedEver(), ProcessCpuNanoTime() };
+}
+
+void Heap::IdleTrim(Thread* self, const IdleDetector::Sample& start, uint32_t busy_periods) {
+  if (!idle_detector_->IsIdle(start, SampleIdleState())) {
+    idle_detector_->RecordBusy();
+    // Observe the next period, or wait for the next GC if the process keeps being busy.
+    if (idle_detector_->ShouldRetry(busy_periods + 1)) {
+      RequestTrim(self, busy_periods + 1);
+    }
+    return;
+  }
+  ScopedTrace trace(__FUNCTION__);
+  // Only the concurrent copying collector compacts with short pauses. Homogeneous space
+  // compaction suspends the mutators for the whole copy and is left to the background transition.
+  if (collector_type_ == kCollectorTypeCC &&
+      idle_detector_->ShouldCompact(GetBytesAllocatedEver())) {
+    if (CollectGarbageInternal(collector::kGcTypeFull,
+                               kGcCauseIdle,
+                               /*clear_soft_references*/false) != collector::kGcTypeNone) {
+      idle_detector_->RecordCompaction(GetBytesAllocatedEver());
+      // The GC requested a trim, which releases the freed memory if the process is still idle
+      // after the next period.
+      return;
+    }
+  }
+  DeflateMonitors(self);
+  TrimIndirectReferenceTables(self);
+  bool completed = false;
+  if (!idle_detector_->HasResumed(start, GetBytesAllocatedEver()) && TrimSpaces(self, &start)) {
+    // Trim arenas that may have been used by JIT or verifier.
+    Runtime::Current()->GetArenaPool()->TrimMaps();
+    completed = true;
+  }
+  idle_detector_->RecordTrim(completed);
+  if (!completed && idle_detector_->ShouldRetry(busy_periods + 1)) {
+    // The mutators allocate again, retry once they are idle.
+    RequestTrim(self, busy_periods + 1);
+  }
 }
 
 class TrimIndirectReferenceTableClosure : public Closure {
@@ -1449,7 +1582,7 @@ void Heap::UnblockGC(Thread* self) {
   FinishGC(self, collector::kGcTypeNone);
 }
 
-void Heap::TrimSpaces(Thread* self) {
+bool Heap::TrimSpaces(Thread* self, const IdleDetector::Sample* idle_start) {
   // Pretend we are doing a GC to prevent background compaction from deleting the space we are
   // trimming.
   StartGC(self, kGcCauseTrim, kCollectorTypeHeapTrim);
@@ -1459,9 +1592,15 @@ void Heap::TrimSpaces(Thread* self) {
   uint64_t total_alloc_space_allocated = 0;
   uint64_t total_alloc_space_size = 0;
   uint64_t managed_reclaimed = 0;
+  bool interrupted = false;
   {
     ScopedObjectAccess soa(self);
     for (const auto& space : continuous_spaces_) {
+      if (idle_start != nullptr &&
+          idle_detector_->HasResumed(*idle_start, GetBytesAllocatedEver())) {
+        interrupted = true;
+        break;
+      }
       if (space->IsMallocSpace()) {
         gc::space::MallocSpace* malloc_space = space->AsMallocSpace();
         if (malloc_space->IsRosAllocSpace() || !CareAboutPauseTimes()) {
@@ -1473,6 +1612,15 @@ void Heap::TrimSpaces(Thread* self) {
       }
     }
   }
+  if (interrupted) {
+    // A mutator needing a GC would wait for the trim, leave the rest to the next idle period.
+    FinishGC(self, collector::kGcTypeNone);
+    VLOG(heap) << "Idle heap trim interrupted after " << PrettyDuration(NanoTime() - start_ns);
+    return false;
+  }
+  if (large_object_space_ != nullptr) {
+    large_object_space_->ReleaseCachedBlocks(self);
+  }
   total_alloc_space_allocated = GetBytesAllocated();
   if (large_object_space_ != nullptr) {
     total_alloc_space_allocated -= large_object_space_->GetBytesAllocated();
@@ -1492,6 +1640,7 @@ void Heap::TrimSpaces(Thread* self) {
   VLOG(heap) << "Heap trim of managed (duration=" << PrettyDuration(gc_heap_end_ns - start_ns)
       << ", advised=" << PrettySize(managed_reclaimed) << ") heap. Managed heap utilization of "
       << static_cast<int>(100 * managed_utilization) << "%.";
+  return true;
 }
 
 bool Heap::IsValidObjectAddress(const void* addr) const {
@@ -2023,6 +2172,22 @@ void Heap::CountInstances(const std::vector<Handle<mirror::Class>>& classes,
   VisitObjects(instance_counter);
 }
 
+void Heap::GetClassHistogram(ClassHistogram* histogram) {
+  // The descriptor of each class is looked up once. Classes may move once the walk is over, so
+  // the entries are found during the walk.
+  std::unordered_map<mirror::Class*, ClassHistogram::Entry*> entries;
+  auto class_counter = [&](mirror::Object* obj) REQUIRES_SHARED(Locks::mutator_lock_) {
+    mirror::Class* klass = obj->GetClass();
+    auto it = entries.find(klass);
+    if (it == entries.end()) {
+      it = entries.emplace(klass, histogram->GetOrCreateEntry(klass->PrettyDescriptor())).first;
+    }
+    ++it->second->instances;
+    it->second->bytes += obj->SizeOf();
+  };
+  VisitObjects(class_counter);
+}
+
 void Heap::GetInstances(VariableSizedHandleScope& scope,
                         Handle<mirror::Class> h_class,
                         int32_t max_count,
@@ -2333,6 +2498,9 @@ void Heap::ChangeCollector(CollectorType collector_type) {
     gc_plan_.clear();
     switch (collector_type_) {
       case kCollectorTypeCC: {
+        if (use_generational_cc_) {
+          gc_plan_.push_back(collector::kGcTypeSticky);
+        }
         gc_plan_.push_back(collector::kGcTypeFull);
         if (use_tlab_) {
           ChangeAllocator(kAllocatorTypeRegionTLAB);
@@ -2643,6 +2811,7 @@ void Heap::PreZygoteFork() {
     }
   }
   AddModUnionTable(mod_union_table);
+  large_object_space_->ReleaseCachedBlocks(self);
   large_object_space_->SetAllLargeObjectsAsZygoteObjects(self);
   if (collector::SemiSpace::kUseRememberedSet) {
     // Add a new remembered set for the post-zygote non-moving space.
@@ -2845,7 +3014,13 @@ collector::GcType Heap::CollectGarbageInternal(collector::GcType gc_type,
         }
         break;
       case kCollectorTypeCC:
-        collector = concurrent_copying_collector_;
+        // Read barriers and thread-local mark stacks go to the collector about to run.
+        if (use_generational_cc_ && gc_type == collector::kGcTypeSticky) {
+          active_concurrent_copying_collector_ = young_concurrent_copying_collector_;
+        } else {
+          active_concurrent_copying_collector_ = concurrent_copying_collector_;
+        }
+        collector = active_concurrent_copying_collector_;
         break;
       case kCollectorTypeMC:
         mark_compact_collector_->SetSpace(bump_pointer_space_);
@@ -2854,7 +3029,8 @@ collector::GcType Heap::CollectGarbageInternal(collector::GcType gc_type,
       default:
         LOG(FATAL) << "Invalid collector type " << static_cast<size_t>(collector_type_);
     }
-    if (collector != mark_compact_collector_ && collector != concurrent_copying_collector_) {
+    if (collector != mark_compact_collector_ && collector != concurrent_copying_collector_ &&
+        collector != young_concurrent_copying_collector_) {
       temp_space_->GetMemMap()->Protect(PROT_READ | PROT_WRITE);
       if (kIsDebugBuild) {
         // Try to read each page of the memory map in case mprotect didn't work properly b/19894268.
@@ -2862,7 +3038,8 @@ collector::GcType Heap::CollectGarbageInternal(collector::GcType gc_type,
       }
       CHECK(temp_space_->IsEmpty());
     }
-    if (collector_type_ != kCollectorTypeGenCopying) {
+    if (collector_type_ != kCollectorTypeGenCopying &&
+        collector != young_concurrent_copying_collector_) {
       gc_type = collector::kGcTypeFull;  // TODO: Not hard code this in.
     }
   } else if (current_allocator_ == kAllocatorTypeRosAlloc ||
@@ -2995,6 +3172,7 @@ void Heap::FinishGC(Thread* self, collector::GcType gc_type) {
 
     // Update stats.
     ++gc_count_last_window_;
+    tlab_sizing_epoch_.FetchAndAddRelaxed(1);
     if (running_collection_is_blocking_) {
       // If the currently running collection was a blocking one,
       // increment the counters and reset the flag.
@@ -3756,6 +3934,28 @@ void Heap::DumpForSigQuit(std::ostream& os) {
   os << "Heap: " << GetPercentFree() << "% free, " << PrettySize(GetBytesAllocated()) << "/"
      << PrettySize(GetTotalMemory()) << "; " << GetObjectsAllocated() << " objects\n";
   DumpGcPerformanceInfo(os);
+  if (allocation_sampler_ != nullptr) {
+    allocation_sampler_->Dump(os);
+  }
+  if (allocation_site_tracker_ != nullptr) {
+    allocation_site_tracker_->Dump(os);
+  }
+  if (Runtime::Current()->GetDumpClassHistogramOnSigQuit()) {
+    static constexpr size_t kMaxClassesInSigQuitDump = 20;
+    std::unique_ptr<ClassHistogram> histogram(new ClassHistogram());
+    {
+      ScopedObjectAccess soa(Thread::Current());
+      GetClassHistogram(histogram.get());
+    }
+    histogram->Dump(os, kMaxClassesInSigQuitDump);
+    if (last_sigquit_class_histogram_ != nullptr) {
+      ClassHistogram difference(*histogram);
+      difference.Subtract(*last_sigquit_class_histogram_);
+      os << "Since the last SIGQUIT dump, ";
+      difference.Dump(os, kMaxClassesInSigQuitDump);
+    }
+    last_sigquit_class_histogram_ = std::move(histogram);
+  }
 }
 
 size_t Heap::GetPercentFree() {
@@ -3814,8 +4014,32 @@ void Heap::GrowForUtilization(collector::GarbageCollector* collector_ran,
   TraceHeapSize(bytes_allocated);
   uint64_t target_size;
   collector::GcType gc_type = collector_ran->GetGcType();
-  const double multiplier = HeapGrowthMultiplier();  // Use the multiplier to grow more for
-  // foreground.
+  const bool use_pacer = gc_pacer_ != nullptr && bytes_allocated_before_gc != 0;
+  if (use_pacer) {
+    const std::vector<uint64_t>& pause_times = current_gc_iteration_.GetPauseTimes();
+    const uint64_t max_pause = pause_times.empty()
+        ? 0u
+        : *std::max_element(pause_times.begin(), pause_times.end());
+    const int64_t freed_bytes = current_gc_iteration_.GetFreedBytes() +
+        current_gc_iteration_.GetFreedLargeObjectBytes();
+    const uint64_t live_bytes = static_cast<uint64_t>(
+        std::max<int64_t>(static_cast<int64_t>(bytes_allocated_before_gc) - freed_bytes, 0));
+    // A GC for alloc means a mutator was stuck waiting for memory.
+    gc_pacer_->RecordGc(NanoTime(),
+                        current_gc_iteration_.GetDurationNs(),
+                        max_pause,
+                        bytes_allocated_before_gc,
+                        bytes_allocated,
+                        live_bytes,
+                        gc_type == collector::kGcTypeSticky,
+                        current_gc_iteration_.GetGcCause() == kGcCauseForAlloc);
+  }
+  // Use the multiplier to grow more for foreground, and the pacer scale to grow more when GCs use
+  // more than their CPU budget.
+  double multiplier = HeapGrowthMultiplier();
+  if (use_pacer) {
+    multiplier *= gc_pacer_->GetGrowthScale();
+  }
   const uint64_t adjusted_min_free = static_cast<uint64_t>(min_free_ * multiplier);
   const uint64_t adjusted_max_free = static_cast<uint64_t>(max_free_ * multiplier);
   if (gc_type != collector::kGcTypeSticky) {
@@ -3828,20 +4052,35 @@ void Heap::GrowForUtilization(collector::GarbageCollector* collector_ran,
     next_gc_type_ = collector::kGcTypeSticky;
   } else {
     collector::GcType non_sticky_gc_type = NonStickyGcType();
-    // Find what the next non sticky collector will be.
-    collector::GarbageCollector* non_sticky_collector = FindCollectorByGcType(non_sticky_gc_type);
-    // If the throughput of the current sticky GC >= throughput of the non sticky collector, then
-    // do another sticky collection next.
-    // We also check that the bytes allocated aren't over the footprint limit in order to prevent a
-    // pathological case where dead objects which aren't reclaimed by sticky could get accumulated
-    // if the sticky GC throughput always remained >= the full/partial throughput.
-    if (current_gc_iteration_.GetEstimatedThroughput() * kStickyGcThroughputAdjustment >=
-        non_sticky_collector->GetEstimatedMeanThroughput() &&
-        non_sticky_collector->NumberOfIterations() > 0 &&
-        bytes_allocated <= max_allowed_footprint_) {
-      next_gc_type_ = collector::kGcTypeSticky;
+    if (collector_type_ == kCollectorTypeCC) {
+      // A young-generation CC leaves the old generation allocated. Collect the whole heap once it
+      // fills most of the footprint.
+      if (bytes_allocated <= max_allowed_footprint_ * kGenerationalCCOldGenOccupancyThreshold) {
+        next_gc_type_ = collector::kGcTypeSticky;
+      } else {
+        next_gc_type_ = non_sticky_gc_type;
+      }
     } else {
-      next_gc_type_ = non_sticky_gc_type;
+      // Find what the next non sticky collector will be.
+      collector::GarbageCollector* non_sticky_collector =
+          FindCollectorByGcType(non_sticky_gc_type);
+      // If the throughput of the current sticky GC >= throughput of the non sticky collector,
+      // then do another sticky collection next.
+      // We also check that the bytes allocated aren't over the footprint limit in order to
+      // prevent a pathological case where dead objects which aren't reclaimed by sticky could get
+      // accumulated if the sticky GC throughput always remained >= the full/partial throughput.
+      // With a pause target, also stay sticky while the non sticky collector pauses too long.
+      const bool throughput_prefers_sticky =
+          current_gc_iteration_.GetEstimatedThroughput() * kStickyGcThroughputAdjustment >=
+          non_sticky_collector->GetEstimatedMeanThroughput() &&
+          non_sticky_collector->NumberOfIterations() > 0;
+      const bool pacer_prefers_sticky = use_pacer && gc_pacer_->ShouldPreferSticky();
+      if ((throughput_prefers_sticky || pacer_prefers_sticky) &&
+          bytes_allocated <= max_allowed_footprint_) {
+        next_gc_type_ = collector::kGcTypeSticky;
+      } else {
+        next_gc_type_ = non_sticky_gc_type;
+      }
     }
     // If we have freed enough memory, shrink the heap back down.
     if (bytes_allocated + adjusted_max_free < max_allowed_footprint_) {
@@ -3868,6 +4107,13 @@ void Heap::GrowForUtilization(collector::GarbageCollector* collector_ran,
       // Estimate how many remaining bytes we will have when we need to start the next GC.
       size_t remaining_bytes = bytes_allocated_during_gc * gc_duration_seconds;
       remaining_bytes = std::min(remaining_bytes, kMaxConcurrentRemainingBytes);
+      if (use_pacer && gc_pacer_->GetConcurrentRemainingBytes() != 0) {
+        // The pacer predicts the allocation during the next GC from the measured allocation rate
+        // and marking speed, so it is not bounded by kMaxConcurrentRemainingBytes.
+        remaining_bytes = static_cast<size_t>(
+            std::min(gc_pacer_->GetConcurrentRemainingBytes(),
+                     static_cast<uint64_t>(max_allowed_footprint_)));
+      }
       remaining_bytes = std::max(remaining_bytes, kMinConcurrentRemainingBytes);
       if (UNLIKELY(remaining_bytes > max_allowed_footprint_)) {
         // A never going to happen situation that from the estimated allocation rate we will exceed
@@ -3893,7 +4139,8 @@ void Heap::GrowForUtilization(collector::GarbageCollector* collector_ran,
       // Default and 0: The new heuristics
       // Any other positive number: Old heuristics
       // In other words, all values are handled correctly and gracefully and there is a correct default behavior.
-      if (concurrent_gc_cycle_start_ == 0) {
+      // The GC pacer, when enabled, replaces the deferral with its own measured trigger.
+      if (concurrent_gc_cycle_start_ == 0 && !use_pacer) {
         concurrent_start_bytes_ = std::max(comp_concurrent_start_bytes,
                                            growth_limit_ / concurrent_gc_start_factor_);
       } else {
@@ -4127,12 +4374,25 @@ void Heap::RequestCollectorTransition(CollectorType desired_collector_type, uint
 
 class Heap::HeapTrimTask : public HeapTask {
  public:
-  explicit HeapTrimTask(uint64_t delta_time) : HeapTask(NanoTime() + delta_time) { }
+  HeapTrimTask(uint64_t delta_time, const IdleDetector::Sample& idle_start, uint32_t busy_periods)
+      : HeapTask(NanoTime() + delta_time), idle_start_(idle_start), busy_periods_(busy_periods) { }
   virtual void Run(Thread* self) OVERRIDE {
     gc::Heap* heap = Runtime::Current()->GetHeap();
-    heap->Trim(self);
-    heap->ClearPendingTrim(self);
+    if (heap->idle_detector_ != nullptr) {
+      // Cleared first since the idle trim may request the next one.
+      heap->ClearPendingTrim(self);
+      heap->IdleTrim(self, idle_start_, busy_periods_);
+    } else {
+      heap->Trim(self);
+      heap->ClearPendingTrim(self);
+    }
   }
+
+ private:
+  // The state at the request, the start of the period that must be idle.
+  const IdleDetector::Sample idle_start_;
+  // Busy observation periods in a row before this one.
+  const uint32_t busy_periods_;
 };
 
 void Heap::ClearPendingTrim(Thread* self) {
@@ -4140,7 +4400,7 @@ void Heap::ClearPendingTrim(Thread* self) {
   pending_heap_trim_ = nullptr;
 }
 
-void Heap::RequestTrim(Thread* self) {
+void Heap::RequestTrim(Thread* self, uint32_t busy_periods) {
   if (!CanAddHeapTask(self)) {
     return;
   }
@@ -4163,7 +4423,11 @@ void Heap::RequestTrim(Thread* self) {
       // Already have a heap trim request in task processor, ignore this request.
       return;
     }
-    added_task = new HeapTrimTask(kHeapTrimWait);
+    // With idle trimming, the task checks that the process was idle over the delay and
+    // otherwise observes another one.
+    const uint64_t delta_time =
+        idle_detector_ != nullptr ? idle_detector_->GetIdleDelay() : kHeapTrimWait;
+    added_task = new HeapTrimTask(delta_time, SampleIdleState(), busy_periods);
     pending_heap_trim_ = added_task;
   }
   task_processor_->AddTask(self, added_task);
@@ -4369,6 +4633,36 @@ void Heap::VisitAllocationRecords(RootVisitor* visitor) const {
       GetAllocationRecords()->VisitRoots(visitor);
     }
   }
+  if (allocation_sampler_ != nullptr) {
+    allocation_sampler_->VisitRoots(visitor);
+  }
+}
+
+void Heap::EnableAllocationSampling(size_t interval) {
+  CHECK(allocation_sampler_ == nullptr);
+  // The allocation slow path counts the bytes at each TLAB refill, the entrypoints stay as they
+  // are.
+  allocation_sampler_.reset(new AllocationSampler(interval));
+}
+
+void Heap::EnableAllocationSiteTracking() {
+  CHECK(allocation_site_tracker_ == nullptr);
+  if (collector_type_ != kCollectorTypeCC) {
+    LOG(WARNING) << "Allocation site tracking requires the concurrent copying collector";
+    return;
+  }
+  allocation_site_tracker_.reset(new AllocationSiteTracker());
+  Runtime::Current()->AddSystemWeakHolder(allocation_site_tracker_.get());
+}
+
+AllocatorType Heap::GetPretenureAllocator() const {
+  // The footprint is cheap to read unlike the allocated bytes, and the non-moving allocation takes
+  // the same lock anyway.
+  if (non_moving_space_ != nullptr &&
+      non_moving_space_->GetFootprint() < non_moving_space_->Capacity() / 2) {
+    return current_non_moving_allocator_;
+  }
+  return current_allocator_;
 }
 
 void Heap::SweepAllocationRecords(IsMarkedVisitor* visitor) const {
@@ -4496,6 +4790,11 @@ void Heap::GCProfileSetDir(const std::string& dir) {
   gc_profiler->SetDir(dir);
 }
 
+void Heap::GCProfileSetStreamSize(size_t file_size) {
+  GcProfiler *gc_profiler = GcProfiler::GetInstance();
+  gc_profiler->SetStreamFileSize(file_size);
+}
+
 void Heap::GCProfileStart() {
   GcProfiler *gc_profiler = GcProfiler::GetInstance();
   gc_profiler->Start();
@@ -4553,19 +4852,28 @@ mirror::Object* Heap::AllocWithNewTLAB(Thread* self,
     // There is enough space if we grow the TLAB. Lets do that. This increases the
     // TLAB bytes.
     const size_t min_expand_size = alloc_size - self->TlabSize();
-    const size_t expand_bytes = std::max(
+    const size_t chunk_size = NextTlabSize(self, kPartialTlabSize, space::RegionSpace::kRegionSize);
+    size_t expand_bytes = std::max(
         min_expand_size,
-        std::min(self->TlabRemainingCapacity() - self->TlabSize(), kPartialTlabSize));
+        std::min(self->TlabRemainingCapacity() - self->TlabSize(), chunk_size));
     if (UNLIKELY(IsOutOfMemoryOnAllocation(allocator_type, expand_bytes, grow))) {
       return nullptr;
     }
+    if (UNLIKELY(allocation_sampler_ != nullptr)) {
+      // Stop short of the sample point, the allocation crossing it comes back here.
+      expand_bytes = allocation_sampler_->ChargeAllocation(self, min_expand_size, expand_bytes);
+    }
     *bytes_tl_bulk_allocated = expand_bytes;
     self->ExpandTlab(expand_bytes);
+    RecordTlabRefill(self, expand_bytes, /*expansion*/ true);
     DCHECK_LE(alloc_size, self->TlabSize());
   } else if (allocator_type == kAllocatorTypeTLAB) {
     DCHECK(bump_pointer_space_ != nullptr);
     const bool bypass_tlab = tlab_alloc_threshold_ < alloc_size;
-    size_t new_tlab_size = alloc_size + (bypass_tlab ? 0u : tlab_size_);
+    size_t new_tlab_size = alloc_size;
+    if (!bypass_tlab) {
+      new_tlab_size += NextTlabSize(self, tlab_size_, std::max(tlab_size_, kMaxAdaptiveTlabSize));
+    }
     if (UNLIKELY(GetBytesAllocated() + new_tlab_size > growth_limit_)) {
       size_t max_bytes_available = GetFreeMemoryUntilOOME();
       if (max_bytes_available >= alloc_size) {
@@ -4586,6 +4894,9 @@ mirror::Object* Heap::AllocWithNewTLAB(Thread* self,
       }
       return ret;
     } else {
+      if (UNLIKELY(allocation_sampler_ != nullptr)) {
+        new_tlab_size = allocation_sampler_->ChargeAllocation(self, alloc_size, new_tlab_size);
+      }
       // Try allocating a new thread local buffer, if the allocation fails the space must be
       // full so return null.
       if (!bump_pointer_space_->AllocNewTlab(self, new_tlab_size)) {
@@ -4607,6 +4918,7 @@ mirror::Object* Heap::AllocWithNewTLAB(Thread* self,
         }
       }
       *bytes_tl_bulk_allocated = new_tlab_size;
+      RecordTlabRefill(self, new_tlab_size, /*expansion*/ false);
     }
   } else {
     DCHECK(allocator_type == kAllocatorTypeRegionTLAB);
@@ -4616,9 +4928,32 @@ mirror::Object* Heap::AllocWithNewTLAB(Thread* self,
       if (LIKELY(!IsOutOfMemoryOnAllocation(allocator_type,
                                             space::RegionSpace::kRegionSize,
                                             grow))) {
-        const size_t new_tlab_size = kUsePartialTlabs
-            ? std::max(alloc_size, kPartialTlabSize)
+        if (kUsePartialTlabs && IsTlabIdleThread(self)) {
+          // Rarely allocating threads share the current region instead of each pinning a
+          // mostly empty region until the next GC.
+          mirror::Object* ret = region_space_->AllocNonvirtual<false>(alloc_size,
+                                                                      bytes_allocated,
+                                                                      usable_size,
+                                                                      bytes_tl_bulk_allocated);
+          if (ret != nullptr) {
+            if (UNLIKELY(allocation_sampler_ != nullptr)) {
+              // Charge the shared region allocation like a refill of exactly the object.
+              allocation_sampler_->ChargeAllocation(self,
+                                                    *bytes_tl_bulk_allocated,
+                                                    *bytes_tl_bulk_allocated);
+            }
+            tlab_idle_thread_allocations_.FetchAndAddRelaxed(1);
+            self->GetTlabSizing()->epoch_bytes += alloc_size;
+            return ret;
+          }
+        }
+        size_t new_tlab_size = kUsePartialTlabs
+            ? std::max(alloc_size,
+                       NextTlabSize(self, kPartialTlabSize, space::RegionSpace::kRegionSize))
             : gc::space::RegionSpace::kRegionSize;
+        if (UNLIKELY(allocation_sampler_ != nullptr)) {
+          new_tlab_size = allocation_sampler_->ChargeAllocation(self, alloc_size, new_tlab_size);
+        }
         // Try to allocate a tlab.
         if (!region_space_->AllocNewTlab(self, new_tlab_size)) {
           // Failed to allocate a tlab. Try non-tlab.
@@ -4628,6 +4963,7 @@ mirror::Object* Heap::AllocWithNewTLAB(Thread* self,
                                                        bytes_tl_bulk_allocated);
         }
         *bytes_tl_bulk_allocated = new_tlab_size;
+        RecordTlabRefill(self, new_tlab_size, /*expansion*/ false);
         // Fall-through to using the TLAB below.
       } else {
         // Check OOME for a non-tlab allocation.
@@ -4659,6 +4995,55 @@ mirror::Object* Heap::AllocWithNewTLAB(Thread* self,
   return ret;
 }
 
+// Start a new sizing epoch for a thread after a GC. The desired size moves halfway towards the
+// size that would have let the thread allocate what it did in the last epoch in
+// kTlabTargetRefillsPerGc refills.
+static void StartTlabSizingEpoch(Thread::TlabSizing* sizing, uint32_t epoch) {
+  const size_t target_size = sizing->epoch_bytes / kTlabTargetRefillsPerGc;
+  sizing->desired_size = std::max((sizing->desired_size + target_size) / 2, kMinAdaptiveTlabSize);
+  sizing->epoch = epoch;
+  sizing->epoch_bytes = 0;
+  sizing->epoch_refills = 0;
+}
+
+size_t Heap::NextTlabSize(Thread* self, size_t default_size, size_t max_size) {
+  Thread::TlabSizing* sizing = self->GetTlabSizing();
+  const uint32_t epoch = tlab_sizing_epoch_.LoadRelaxed();
+  if (sizing->desired_size == 0) {
+    sizing->desired_size = default_size;
+    sizing->epoch = epoch;
+  } else if (sizing->epoch != epoch) {
+    StartTlabSizingEpoch(sizing, epoch);
+  } else if (sizing->epoch_refills >= kTlabTargetRefillsPerGc &&
+             sizing->epoch_refills % kTlabTargetRefillsPerGc == 0) {
+    // The thread used up its refill budget for this epoch, grow without waiting for a GC.
+    sizing->desired_size *= 2;
+  }
+  sizing->desired_size = std::min(std::max(sizing->desired_size, kMinAdaptiveTlabSize), max_size);
+  return RoundUp(sizing->desired_size, kObjectAlignment);
+}
+
+bool Heap::IsTlabIdleThread(Thread* self) {
+  Thread::TlabSizing* sizing = self->GetTlabSizing();
+  if (sizing->desired_size == 0) {
+    // No allocation history yet.
+    return false;
+  }
+  const uint32_t epoch = tlab_sizing_epoch_.LoadRelaxed();
+  if (sizing->epoch != epoch) {
+    StartTlabSizingEpoch(sizing, epoch);
+  }
+  return sizing->desired_size <= kMinAdaptiveTlabSize &&
+      sizing->epoch_bytes < kIdleThreadTlabBytes;
+}
+
+void Heap::RecordTlabRefill(Thread* self, size_t tlab_bytes, bool expansion) {
+  Thread::TlabSizing* sizing = self->GetTlabSizing();
+  sizing->epoch_bytes += tlab_bytes;
+  ++sizing->epoch_refills;
+  (expansion ? tlab_expansions_ : tlab_refills_).FetchAndAddRelaxed(1);
+}
+
 const Verification* Heap::GetVerification() const {
   return verification_.get();
 }
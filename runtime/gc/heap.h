@@ -31,6 +31,7 @@
 #include "gc/collector/gc_type.h"
 #include "gc/collector/iteration.h"
 #include "gc/collector_type.h"
+#include "gc/idle_detector.h"
 #include "gc/space/large_object_space.h"
 #include "globals.h"
 #include "handle.h"
@@ -61,6 +62,10 @@ namespace gc {
 
 class AllocationListener;
 class AllocRecordObjectMap;
+class AllocationSampler;
+class AllocationSiteTracker;
+class ClassHistogram;
+class GcPacer;
 class GcPauseListener;
 class ReferenceProcessor;
 class TaskProcessor;
@@ -79,6 +84,7 @@ namespace accounting {
 namespace collector {
   class ConcurrentCopying;
   class GarbageCollector;
+  class GenerationalConcurrentCopyingTest;
   class MarkCompact;
   class MarkSweep;
   class SemiSpace;
@@ -180,6 +186,7 @@ class Heap {
        InstructionSet image_instruction_set,
        CollectorType foreground_collector_type,
        CollectorType background_collector_type,
+       bool use_generational_cc,
        space::LargeObjectSpaceType large_object_space_type,
        size_t large_object_threshold,
        size_t parallel_gc_threads,
@@ -189,6 +196,11 @@ class Heap {
        size_t long_gc_threshold,
        bool ignore_max_footprint,
        bool use_tlab,
+       bool numa_aware_regions,
+       bool gc_worker_numa_affinity,
+       uint64_t gc_pause_target,
+       unsigned int gc_cpu_percent,
+       bool use_huge_pages,
        bool verify_pre_gc_heap,
        bool verify_pre_sweeping_heap,
        bool verify_post_gc_heap,
@@ -263,6 +275,11 @@ class Heap {
     return current_non_moving_allocator_;
   }
 
+  // Allocator of the pretenured allocation sites. Falls back to the current allocator once the
+  // non-moving space grew to half its capacity, the rest is kept for the objects that must not
+  // move.
+  AllocatorType GetPretenureAllocator() const;
+
   // Visit all of the live objects in the heap.
   template <typename Visitor>
   ALWAYS_INLINE void VisitObjects(Visitor&& visitor)
@@ -357,6 +374,13 @@ class Heap {
       REQUIRES(!Locks::heap_bitmap_lock_, !*gc_complete_lock_)
       REQUIRES_SHARED(Locks::mutator_lock_);
 
+  // Count the live objects and their sizes per class in a single walk of the heap. Implements the
+  // SIGQUIT class histogram. Under the concurrent copying collector all threads stay suspended
+  // for the whole walk, see VisitObjects.
+  void GetClassHistogram(ClassHistogram* histogram)
+      REQUIRES(!Locks::heap_bitmap_lock_, !*gc_complete_lock_)
+      REQUIRES_SHARED(Locks::mutator_lock_);
+
   // Implements JDWP RT_Instances.
   void GetInstances(VariableSizedHandleScope& scope,
                     Handle<mirror::Class> c,
@@ -593,6 +617,11 @@ class Heap {
   // Deflate monitors, ... and trim the spaces.
   void Trim(Thread* self) REQUIRES(!*gc_complete_lock_);
 
+  // Trim, and with the concurrent copying collector compact, the heap once the process has been
+  // idle for idle_delay_ns instead of at a fixed delay after the GCs, see IdleDetector. Called at
+  // startup, idle trimming stays enabled until the heap is deleted.
+  void EnableIdleTrim(uint64_t idle_delay_ns, uint32_t cpu_percent);
+
   void RevokeThreadLocalBuffers(Thread* thread, bool record_free = true)
       REQUIRES_SHARED(Locks::mutator_lock_);
   void RevokeRosAllocThreadLocalBuffers(Thread* thread);
@@ -718,6 +747,12 @@ class Heap {
       REQUIRES(!*gc_complete_lock_);
   void ResetGcPerformanceInfo() REQUIRES(!*gc_complete_lock_);
 
+  // Called when a thread gives up its TLAB with unused_bytes of capacity left in it.
+  void RecordTlabRetirement(size_t unused_bytes) {
+    tlabs_retired_.FetchAndAddRelaxed(1);
+    tlab_retired_unused_bytes_.FetchAndAddRelaxed(unused_bytes);
+  }
+
   // Thread pool.
   void CreateThreadPool();
   void DeleteThreadPool();
@@ -755,8 +790,16 @@ class Heap {
     return zygote_space_ != nullptr;
   }
 
+  // The concurrent copying collector that runs, or last ran. It is the young-generation one for
+  // sticky collections in the generational mode.
   collector::ConcurrentCopying* ConcurrentCopyingCollector() {
-    return concurrent_copying_collector_;
+    return active_concurrent_copying_collector_;
+  }
+
+  // Whether the concurrent copying collector runs young-generation collections between the full
+  // ones.
+  bool UseGenerationalCC() const {
+    return use_generational_cc_;
   }
 
   CollectorType CurrentCollectorType() {
@@ -781,8 +824,19 @@ class Heap {
     return moving_gc_count_.LoadSequentiallyConsistent();
   }
 
-  // Request an asynchronous trim.
-  void RequestTrim(Thread* self) REQUIRES(!*pending_task_lock_);
+  // Number of the collection that is running, or of the last one if none is. Objects allocated
+  // while a collection runs may be treated as live by it regardless of their reachability.
+  uint32_t GetCurrentGcNum() const {
+    return gcs_started_.LoadSequentiallyConsistent();
+  }
+
+  void IncrementGcsStarted() {
+    gcs_started_.FetchAndAddSequentiallyConsistent(1);
+  }
+
+  // Request an asynchronous trim. With idle trimming, busy_periods is the number of observation
+  // periods in a row that were busy, which only the trim task itself passes when it retries.
+  void RequestTrim(Thread* self, uint32_t busy_periods = 0) REQUIRES(!*pending_task_lock_);
 
   // Request asynchronous GC.
   void RequestConcurrentGC(Thread* self, GcCause cause, bool force_full)
@@ -822,6 +876,22 @@ class Heap {
   void SetAllocationRecords(AllocRecordObjectMap* records)
       REQUIRES(Locks::alloc_tracker_lock_);
 
+  // Sample about one allocation every interval bytes, see AllocationSampler. Called at startup,
+  // the sampler stays enabled until the heap is deleted.
+  void EnableAllocationSampling(size_t interval);
+
+  AllocationSampler* GetAllocationSampler() const {
+    return allocation_sampler_.get();
+  }
+
+  // Track the survival of the new-instance sites so that the JIT can pretenure them, see
+  // AllocationSiteTracker. Only the concurrent copying collector is supported.
+  void EnableAllocationSiteTracking();
+
+  AllocationSiteTracker* GetAllocationSiteTracker() const {
+    return allocation_site_tracker_.get();
+  }
+
   void VisitAllocationRecords(RootVisitor* visitor) const
       REQUIRES_SHARED(Locks::mutator_lock_)
       REQUIRES(!Locks::alloc_tracker_lock_);
@@ -850,6 +920,7 @@ class Heap {
   size_t GetThresholdAge();
   void SetThresholdAge(size_t age);
   void GCProfileSetDir(const std::string& dir);
+  void GCProfileSetStreamSize(size_t file_size);
   void GCProfileStart();
   void GCProfileEnd(bool drop_result);
   void GCProfileEnableSuccAllocProfile(bool enable);
@@ -1002,6 +1073,18 @@ class Heap {
                                    size_t* bytes_tl_bulk_allocated)
       REQUIRES_SHARED(Locks::mutator_lock_);
 
+  // Returns the TLAB size to request for self's next refill, adapted to the rate at which it
+  // allocated since the previous GCs. Starts at default_size and stays within
+  // [kMinAdaptiveTlabSize, max_size].
+  size_t NextTlabSize(Thread* self, size_t default_size, size_t max_size);
+
+  // Whether self allocates so little that it should share the current region rather than pin a
+  // region of its own as TLAB.
+  bool IsTlabIdleThread(Thread* self);
+
+  // Account a refill of tlab_bytes towards self's allocation rate.
+  void RecordTlabRefill(Thread* self, size_t tlab_bytes, bool expansion);
+
   void ThrowOutOfMemoryError(Thread* self, size_t byte_count, AllocatorType allocator_type)
       REQUIRES_SHARED(Locks::mutator_lock_);
 
@@ -1115,8 +1198,21 @@ class Heap {
         collector_type_ == kCollectorTypeGenCopying;
   }
 
-  // Trim the managed and native spaces by releasing unused memory back to the OS.
-  void TrimSpaces(Thread* self) REQUIRES(!*gc_complete_lock_);
+  // Trim the managed and native spaces by releasing unused memory back to the OS. With an idle
+  // start sample, gives up between the spaces once the mutators allocate again and returns false.
+  bool TrimSpaces(Thread* self, const IdleDetector::Sample* idle_start = nullptr)
+      REQUIRES(!*gc_complete_lock_);
+
+  // Deflate the monitors with the mutators suspended, unless we care about pause times.
+  void DeflateMonitors(Thread* self) REQUIRES(!*gc_complete_lock_);
+
+  IdleDetector::Sample SampleIdleState() const;
+
+  // Run by the heap trim task when idle trimming is enabled. Requests a new trim if the process
+  // was not idle, or stopped being idle before the trim completed, unless busy_periods earlier
+  // periods in a row already were. Then the next GC requests the trim.
+  void IdleTrim(Thread* self, const IdleDetector::Sample& start, uint32_t busy_periods)
+      REQUIRES(!*gc_complete_lock_, !*pending_task_lock_);
 
   // Trim 0 pages at the end of reference tables.
   void TrimIndirectReferenceTables(Thread* self);
@@ -1210,6 +1306,8 @@ class Heap {
   CollectorType background_collector_type_;
   // Desired collector type, heap trimming daemon transitions the heap if it is != collector_type_.
   CollectorType desired_collector_type_;
+  // True if the concurrent copying collector is generational, see UseGenerationalCC().
+  const bool use_generational_cc_;
 
   // Lock which guards pending tasks.
   Mutex* pending_task_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
@@ -1272,6 +1370,14 @@ class Heap {
   // Task processor, proxies heap trim requests to the daemon threads.
   std::unique_ptr<TaskProcessor> task_processor_;
 
+  // Adjusts heap growth and the concurrent GC trigger to the pause target and GC CPU budget.
+  // Null when neither is set.
+  std::unique_ptr<GcPacer> gc_pacer_;
+
+  // Decides when to run the heap trim task, null unless enabled with -XX:IdleTrimDelayMs. Only
+  // used by the heap task daemon once enabled.
+  std::unique_ptr<IdleDetector> idle_detector_;
+
   // Collector type of the running GC.
   volatile CollectorType collector_type_running_ GUARDED_BY(gc_complete_lock_);
 
@@ -1459,14 +1565,35 @@ class Heap {
   // if it is odd, means a moving gc is going on.
   Atomic<size_t> moving_gc_count_;
 
+  // Number of collections that started running, see GetCurrentGcNum.
+  Atomic<uint32_t> gcs_started_;
+
+  // The number of completed GCs, used to split each thread's allocation rate into epochs for
+  // adaptive TLAB sizing.
+  Atomic<uint32_t> tlab_sizing_epoch_;
+
+  // TLAB statistics for the GC performance dump.
+  Atomic<uint64_t> tlab_refills_;
+  Atomic<uint64_t> tlab_expansions_;
+  Atomic<uint64_t> tlab_idle_thread_allocations_;
+  Atomic<uint64_t> tlabs_retired_;
+  Atomic<uint64_t> tlab_retired_unused_bytes_;
+
   std::vector<collector::GarbageCollector*> garbage_collectors_;
   collector::SemiSpace* semi_space_collector_;
   collector::MarkCompact* mark_compact_collector_;
   collector::ConcurrentCopying* concurrent_copying_collector_;
+  collector::ConcurrentCopying* young_concurrent_copying_collector_;
+  collector::ConcurrentCopying* active_concurrent_copying_collector_;
 
   const bool is_running_on_memory_tool_;
   const bool use_tlab_;
 
+  // Whether the region space keeps one region stripe per NUMA node.
+  const bool numa_aware_regions_;
+  // Whether the heap thread pool workers are pinned to NUMA nodes.
+  const bool gc_worker_numa_affinity_;
+
   // Pointer to the space which becomes the new main space when we do homogeneous space compaction.
   // Use unique_ptr since the space is only added during the homogeneous compaction phase.
   std::unique_ptr<space::MallocSpace> main_space_backup_;
@@ -1528,6 +1655,17 @@ class Heap {
   Atomic<bool> alloc_tracking_enabled_;
   std::unique_ptr<AllocRecordObjectMap> allocation_records_;
 
+  // Sampling allocation profiler, null unless enabled with -XX:AllocSampleInterval.
+  std::unique_ptr<AllocationSampler> allocation_sampler_;
+
+  // Survival profile of the allocation sites, null unless enabled with
+  // -XX:PretenureAllocationSites.
+  std::unique_ptr<AllocationSiteTracker> allocation_site_tracker_;
+
+  // Class histogram of the last SIGQUIT dump, which the next one is compared with. Only used by
+  // the signal catcher thread.
+  std::unique_ptr<ClassHistogram> last_sigquit_class_histogram_;
+
   // GC stress related data structures.
   Mutex* backtrace_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
   // Debugging variables, seen backtraces vs unique backtraces.
@@ -1554,6 +1692,7 @@ class Heap {
   friend class collector::GarbageCollector;
   friend class collector::MarkCompact;
   friend class collector::ConcurrentCopying;
+  friend class collector::GenerationalConcurrentCopyingTest;  // For CollectGarbageInternal.
   friend class collector::MarkSweep;
   friend class collector::SemiSpace;
   friend class ReferenceQueue;
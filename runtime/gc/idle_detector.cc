@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "idle_detector.h"
+
+#include <algorithm>
+#include <ostream>
+
+#include "base/time_utils.h"
+
+namespace art {
+namespace gc {
+
+constexpr uint64_t IdleDetector::kAllocationSlack;
+constexpr uint32_t IdleDetector::kMaxBusyPeriods;
+
+IdleDetector::IdleDetector(uint64_t idle_delay_ns, uint32_t cpu_percent)
+    : idle_delay_ns_(idle_delay_ns),
+      cpu_percent_(std::min(cpu_percent, 100u)),
+      busy_count_(0),
+      completed_trim_count_(0),
+      interrupted_trim_count_(0),
+      compaction_count_(0),
+      last_compaction_bytes_allocated_ever_(0) {
+}
+
+bool IdleDetector::IsIdle(const Sample& start, const Sample& now) const {
+  const uint64_t elapsed_ns = now.time_ns - start.time_ns;
+  if (now.time_ns < start.time_ns || elapsed_ns < idle_delay_ns_) {
+    return false;
+  }
+  if (HasResumed(start, now.bytes_allocated_ever)) {
+    return false;
+  }
+  // The CPU time is that of all the threads of the process, compared with one CPU.
+  const uint64_t cpu_ns = now.process_cpu_ns - start.process_cpu_ns;
+  return cpu_ns * 100 <= elapsed_ns * cpu_percent_;
+}
+
+void IdleDetector::Dump(std::ostream& os) const {
+  os << "Idle trim after " << PrettyDuration(idle_delay_ns_) << " below " << cpu_percent_
+     << "% CPU: " << completed_trim_count_ << " completed, " << interrupted_trim_count_
+     << " interrupted, " << compaction_count_ << " compactions, " << busy_count_
+     << " busy periods\n";
+}
+
+}  // namespace gc
+}  // namespace art
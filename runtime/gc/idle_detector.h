@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_GC_IDLE_DETECTOR_H_
+#define ART_RUNTIME_GC_IDLE_DETECTOR_H_
+
+#include <iosfwd>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "base/macros.h"
+#include "globals.h"
+
+namespace art {
+namespace gc {
+
+// Decides when the process is idle enough for the heap to trim and compact without competing
+// with the mutators. The process is idle over a period of at least the idle delay in which it
+// allocated almost nothing and used little CPU. The samples are taken by the heap task daemon,
+// the only user besides dumps, which may race and see stale counts.
+class IdleDetector {
+ public:
+  // Allocation below this many bytes still counts as idle, so that a timer or a binder thread
+  // waking up does not defer the trim forever.
+  static constexpr uint64_t kAllocationSlack = 64 * KB;
+
+  // Observation periods in a row that may be busy or end in an interrupted trim before the heap
+  // stops observing and waits for the next GC to request a trim. A busy process would otherwise
+  // wake the heap task daemon every idle delay for as long as it runs.
+  static constexpr uint32_t kMaxBusyPeriods = 4;
+
+  struct Sample {
+    uint64_t time_ns;
+    uint64_t bytes_allocated_ever;
+    uint64_t process_cpu_ns;
+  };
+
+  // cpu_percent is the share of one CPU the process may use and still be idle.
+  IdleDetector(uint64_t idle_delay_ns, uint32_t cpu_percent);
+
+  uint64_t GetIdleDelay() const {
+    return idle_delay_ns_;
+  }
+
+  // Whether the process was idle between the two samples.
+  bool IsIdle(const Sample& start, const Sample& now) const;
+
+  // Whether the mutators allocated again since the start of an idle period. Checked between the
+  // steps of an idle trim, which gives up as soon as they do.
+  bool HasResumed(const Sample& start, uint64_t bytes_allocated_ever) const {
+    return bytes_allocated_ever > start.bytes_allocated_ever + kAllocationSlack;
+  }
+
+  // Whether the mutators allocated since the last idle compaction. Compacting an unchanged heap
+  // again would only copy the same objects.
+  bool ShouldCompact(uint64_t bytes_allocated_ever) const {
+    return compaction_count_ == 0 ||
+        bytes_allocated_ever > last_compaction_bytes_allocated_ever_ + kAllocationSlack;
+  }
+
+  // Whether to observe another period after busy_periods busy or interrupted ones in a row.
+  bool ShouldRetry(uint32_t busy_periods) const {
+    return busy_periods < kMaxBusyPeriods;
+  }
+
+  void RecordBusy() {
+    ++busy_count_;
+  }
+  void RecordTrim(bool completed) {
+    ++(completed ? completed_trim_count_ : interrupted_trim_count_);
+  }
+  void RecordCompaction(uint64_t bytes_allocated_ever) {
+    ++compaction_count_;
+    last_compaction_bytes_allocated_ever_ = bytes_allocated_ever;
+  }
+
+  void Dump(std::ostream& os) const;
+
+ private:
+  const uint64_t idle_delay_ns_;
+  const uint32_t cpu_percent_;
+
+  // Observation periods that were not idle.
+  uint64_t busy_count_;
+  uint64_t completed_trim_count_;
+  uint64_t interrupted_trim_count_;
+  uint64_t compaction_count_;
+  uint64_t last_compaction_bytes_allocated_ever_;
+
+  DISALLOW_COPY_AND_ASSIGN(IdleDetector);
+};
+
+}  // namespace gc
+}  // namespace art
+
+#endif  // ART_RUNTIME_GC_IDLE_DETECTOR_H_
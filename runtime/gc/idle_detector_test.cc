@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "idle_detector.h"
+
+#include "base/time_utils.h"
+#include "globals.h"
+#include "gtest/gtest.h"
+
+namespace art {
+namespace gc {
+
+static IdleDetector::Sample MakeSample(uint64_t time_ms, uint64_t bytes, uint64_t cpu_ms) {
+  return IdleDetector::Sample { MsToNs(time_ms), bytes, MsToNs(cpu_ms) };
+}
+
+TEST(IdleDetectorTest, WaitsForTheIdleDelay) {
+  IdleDetector detector(MsToNs(500), 10);
+  const IdleDetector::Sample start = MakeSample(1000, 10 * MB, 100);
+  EXPECT_FALSE(detector.IsIdle(start, MakeSample(1400, 10 * MB, 100)));
+  EXPECT_TRUE(detector.IsIdle(start, MakeSample(1500, 10 * MB, 100)));
+  // A clock going backwards is not idleness.
+  EXPECT_FALSE(detector.IsIdle(start, MakeSample(900, 10 * MB, 100)));
+}
+
+TEST(IdleDetectorTest, AllocationEndsIdleness) {
+  IdleDetector detector(MsToNs(500), 10);
+  const IdleDetector::Sample start = MakeSample(1000, 10 * MB, 100);
+  const uint64_t slack = IdleDetector::kAllocationSlack;
+  EXPECT_TRUE(detector.IsIdle(start, MakeSample(2000, 10 * MB + slack, 100)));
+  EXPECT_FALSE(detector.IsIdle(start, MakeSample(2000, 10 * MB + slack + 1, 100)));
+  EXPECT_FALSE(detector.HasResumed(start, 10 * MB + slack));
+  EXPECT_TRUE(detector.HasResumed(start, 10 * MB + slack + 1));
+}
+
+TEST(IdleDetectorTest, CpuUseEndsIdleness) {
+  IdleDetector detector(MsToNs(500), 10);
+  const IdleDetector::Sample start = MakeSample(1000, 10 * MB, 100);
+  // 100 ms of CPU over one second is 10% of one CPU.
+  EXPECT_TRUE(detector.IsIdle(start, MakeSample(2000, 10 * MB, 200)));
+  EXPECT_FALSE(detector.IsIdle(start, MakeSample(2000, 10 * MB, 201)));
+}
+
+TEST(IdleDetectorTest, StopsRetryingABusyProcess) {
+  IdleDetector detector(MsToNs(500), 10);
+  EXPECT_TRUE(detector.ShouldRetry(0));
+  EXPECT_TRUE(detector.ShouldRetry(IdleDetector::kMaxBusyPeriods - 1));
+  EXPECT_FALSE(detector.ShouldRetry(IdleDetector::kMaxBusyPeriods));
+}
+
+TEST(IdleDetectorTest, CompactsOnlyAChangedHeap) {
+  IdleDetector detector(MsToNs(500), 10);
+  EXPECT_TRUE(detector.ShouldCompact(10 * MB));
+  detector.RecordCompaction(10 * MB);
+  EXPECT_FALSE(detector.ShouldCompact(10 * MB + IdleDetector::kAllocationSlack));
+  EXPECT_TRUE(detector.ShouldCompact(11 * MB));
+}
+
+}  // namespace gc
+}  // namespace art
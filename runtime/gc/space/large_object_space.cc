@@ -20,6 +20,7 @@
 
 #include <memory>
 
+#include "base/bit_utils.h"
 #include "base/logging.h"
 #include "base/memory_tool.h"
 #include "base/mutex-inl.h"
@@ -39,7 +40,8 @@ namespace space {
 
 class MemoryToolLargeObjectMapSpace FINAL : public LargeObjectMapSpace {
  public:
-  explicit MemoryToolLargeObjectMapSpace(const std::string& name) : LargeObjectMapSpace(name) {
+  MemoryToolLargeObjectMapSpace(const std::string& name, bool use_huge_pages)
+      : LargeObjectMapSpace(name, use_huge_pages) {
   }
 
   ~MemoryToolLargeObjectMapSpace() OVERRIDE {
@@ -120,15 +122,16 @@ void LargeObjectSpace::CopyLiveToMarked() {
   mark_bitmap_->CopyFrom(live_bitmap_.get());
 }
 
-LargeObjectMapSpace::LargeObjectMapSpace(const std::string& name)
+LargeObjectMapSpace::LargeObjectMapSpace(const std::string& name, bool use_huge_pages)
     : LargeObjectSpace(name, nullptr, nullptr),
+      use_huge_pages_(use_huge_pages),
       lock_("large object map space lock", kAllocSpaceLock) {}
 
-LargeObjectMapSpace* LargeObjectMapSpace::Create(const std::string& name) {
+LargeObjectMapSpace* LargeObjectMapSpace::Create(const std::string& name, bool use_huge_pages) {
   if (Runtime::Current()->IsRunningOnMemoryTool()) {
-    return new MemoryToolLargeObjectMapSpace(name);
+    return new MemoryToolLargeObjectMapSpace(name, use_huge_pages);
   } else {
-    return new LargeObjectMapSpace(name);
+    return new LargeObjectMapSpace(name, use_huge_pages);
   }
 }
 
@@ -137,11 +140,17 @@ mirror::Object* LargeObjectMapSpace::Alloc(Thread* self, size_t num_bytes,
                                            size_t* bytes_tl_bulk_allocated) {
   std::string error_msg;
   MemMap* mem_map = MemMap::MapAnonymous("large object space allocation", nullptr, num_bytes,
-                                         PROT_READ | PROT_WRITE, true, false, &error_msg);
+                                         PROT_READ | PROT_WRITE, true, false, &error_msg,
+                                         /* use_ashmem */ !use_huge_pages_);
   if (UNLIKELY(mem_map == nullptr)) {
     LOG(WARNING) << "Large object allocation failed: " << error_msg;
     return nullptr;
   }
+  if (use_huge_pages_ && num_bytes >= MemMap::kHugePageSize) {
+    // Only the huge page aligned middle of the object can use huge pages, which is good enough
+    // for the arrays large enough to matter.
+    mem_map->AdviseHugePages();
+  }
   mirror::Object* const obj = reinterpret_cast<mirror::Object*>(mem_map->Begin());
   MutexLock mu(self, lock_);
   large_objects_.Put(obj, LargeObject {mem_map, false /* not zygote */});
@@ -159,10 +168,7 @@ mirror::Object* LargeObjectMapSpace::Alloc(Thread* self, size_t num_bytes,
   }
   DCHECK(bytes_tl_bulk_allocated != nullptr);
   *bytes_tl_bulk_allocated = allocation_size;
-  num_bytes_allocated_ += allocation_size;
-  total_bytes_allocated_ += allocation_size;
-  ++num_objects_allocated_;
-  ++total_objects_allocated_;
+  RecordAllocation(allocation_size);
   return obj;
 }
 
@@ -189,11 +195,8 @@ size_t LargeObjectMapSpace::Free(Thread* self, mirror::Object* ptr) {
     LOG(FATAL) << "Attempted to free large object " << ptr << " which was not live";
   }
   MemMap* mem_map = it->second.mem_map;
-  const size_t map_size = mem_map->BaseSize();
-  DCHECK_GE(num_bytes_allocated_, map_size);
-  size_t allocation_size = map_size;
-  num_bytes_allocated_ -= allocation_size;
-  --num_objects_allocated_;
+  const size_t allocation_size = mem_map->BaseSize();
+  RecordFree(allocation_size);
   delete mem_map;
   large_objects_.erase(it);
   return allocation_size;
@@ -276,7 +279,13 @@ class AllocationInfo {
   void SetZygoteObject() {
     alloc_size_ |= kFlagZygote;
   }
-  // Return true if this is a zygote large object.
+  // Return true if the block is in a size class cache of the space.
+  bool IsCached() const {
+    return (alloc_size_ & kFlagCached) != 0;
+  }
+  void SetCached() {
+    alloc_size_ |= kFlagCached;
+  }
   // Finds and returns the next non free allocation info after ourself.
   AllocationInfo* GetNextInfo() {
     return this + AlignSize();
@@ -312,7 +321,9 @@ class AllocationInfo {
  private:
   static constexpr uint32_t kFlagFree = 0x80000000;  // If block is free.
   static constexpr uint32_t kFlagZygote = 0x40000000;  // If the large object is a zygote object.
-  static constexpr uint32_t kFlagsMask = ~(kFlagFree | kFlagZygote);  // Combined flags for masking.
+  static constexpr uint32_t kFlagCached = 0x20000000;  // If the block is cached for reuse.
+  // Combined flags for masking.
+  static constexpr uint32_t kFlagsMask = ~(kFlagFree | kFlagZygote | kFlagCached);
   // Contains the size of the previous free block with kAlignment as the unit. If 0 then the
   // allocation before us is not free.
   // These variables are undefined in the middle of allocations / free blocks.
@@ -321,6 +332,10 @@ class AllocationInfo {
   uint32_t alloc_size_;
 };
 
+constexpr size_t FreeListSpace::kAlignment;
+constexpr size_t FreeListSpace::kMaxCachedPages;
+constexpr size_t FreeListSpace::kCacheCapacityDivisor;
+
 size_t FreeListSpace::GetSlotIndexForAllocationInfo(const AllocationInfo* info) const {
   DCHECK_GE(info, allocation_info_);
   DCHECK_LT(info, reinterpret_cast<AllocationInfo*>(allocation_info_map_->End()));
@@ -344,19 +359,38 @@ inline bool FreeListSpace::SortByPrevFree::operator()(const AllocationInfo* a,
   return reinterpret_cast<uintptr_t>(a) < reinterpret_cast<uintptr_t>(b);
 }
 
-FreeListSpace* FreeListSpace::Create(const std::string& name, uint8_t* requested_begin, size_t size) {
+FreeListSpace* FreeListSpace::Create(const std::string& name,
+                                     uint8_t* requested_begin,
+                                     size_t size,
+                                     bool use_huge_pages) {
   CHECK_EQ(size % kAlignment, 0U);
   std::string error_msg;
-  MemMap* mem_map = MemMap::MapAnonymous(name.c_str(), requested_begin, size,
-                                         PROT_READ | PROT_WRITE, true, false, &error_msg);
+  // With huge pages, map an extra huge page so that the space can start on a huge page boundary.
+  const size_t map_size = use_huge_pages
+      ? RoundUp(size, MemMap::kHugePageSize) + MemMap::kHugePageSize
+      : size;
+  MemMap* mem_map = MemMap::MapAnonymous(name.c_str(), requested_begin, map_size,
+                                         PROT_READ | PROT_WRITE, true, false, &error_msg,
+                                         /* use_ashmem */ !use_huge_pages);
   CHECK(mem_map != nullptr) << "Failed to allocate large object space mem map: " << error_msg;
+  if (use_huge_pages) {
+    if (!IsAlignedParam(mem_map->Begin(), MemMap::kHugePageSize)) {
+      mem_map->AlignBy(MemMap::kHugePageSize);
+    }
+    mem_map->SetSize(size);
+    if (!mem_map->AdviseHugePages()) {
+      LOG(WARNING) << "Could not back " << name << " with huge pages";
+    }
+  }
   return new FreeListSpace(name, mem_map, mem_map->Begin(), mem_map->End());
 }
 
 FreeListSpace::FreeListSpace(const std::string& name, MemMap* mem_map, uint8_t* begin, uint8_t* end)
     : LargeObjectSpace(name, begin, end),
       mem_map_(mem_map),
-      lock_("free list space lock", kAllocSpaceLock) {
+      lock_("free list space lock", kAllocSpaceLock),
+      cached_bytes_(0),
+      max_cached_bytes_((end - begin) / kCacheCapacityDivisor) {
   const size_t space_capacity = end - begin;
   free_end_ = space_capacity;
   CHECK_ALIGNED(space_capacity, kAlignment);
@@ -379,7 +413,7 @@ void FreeListSpace::Walk(DlMallocSpace::WalkCallback callback, void* arg) {
   AllocationInfo* cur_info = &allocation_info_[0];
   const AllocationInfo* end_info = GetAllocationInfoForAddress(free_end_start);
   while (cur_info < end_info) {
-    if (!cur_info->IsFree()) {
+    if (!cur_info->IsFree() && !cur_info->IsCached()) {
       size_t alloc_size = cur_info->ByteSize();
       uint8_t* byte_start = reinterpret_cast<uint8_t*>(GetAddressForAllocationInfo(cur_info));
       uint8_t* byte_end = byte_start + alloc_size;
@@ -400,15 +434,26 @@ void FreeListSpace::RemoveFreePrev(AllocationInfo* info) {
 }
 
 size_t FreeListSpace::Free(Thread* self, mirror::Object* obj) {
-  MutexLock mu(self, lock_);
   DCHECK(Contains(obj)) << reinterpret_cast<void*>(Begin()) << " " << obj << " "
                         << reinterpret_cast<void*>(End());
   DCHECK_ALIGNED(obj, kAlignment);
   AllocationInfo* info = GetAllocationInfoForAddress(reinterpret_cast<uintptr_t>(obj));
   DCHECK(!info->IsFree());
+  DCHECK(!info->IsCached());
   const size_t allocation_size = info->ByteSize();
   DCHECK_GT(allocation_size, 0U);
   DCHECK_ALIGNED(allocation_size, kAlignment);
+  RecordFree(allocation_size);
+  if (!AddToCache(self, info)) {
+    MutexLock mu(self, lock_);
+    FreeLocked(info);
+  }
+  return allocation_size;
+}
+
+void FreeListSpace::FreeLocked(AllocationInfo* info) {
+  const size_t allocation_size = info->ByteSize();
+  mirror::Object* obj = reinterpret_cast<mirror::Object*>(GetAddressForAllocationInfo(info));
   info->SetByteSize(allocation_size, true);  // Mark as free.
   // Look at the next chunk.
   AllocationInfo* next_info = info->GetNextInfo();
@@ -447,15 +492,104 @@ size_t FreeListSpace::Free(Thread* self, mirror::Object* obj) {
     info->SetByteSize(new_free_size, true);
     DCHECK_EQ(info->GetNextInfo(), new_free_info);
   }
-  --num_objects_allocated_;
-  DCHECK_LE(allocation_size, num_bytes_allocated_);
-  num_bytes_allocated_ -= allocation_size;
   madvise(obj, allocation_size, MADV_DONTNEED);
   if (kIsDebugBuild) {
     // Can't disallow reads since we use them to find next chunks during coalescing.
     mprotect(obj, allocation_size, PROT_READ);
   }
-  return allocation_size;
+}
+
+bool FreeListSpace::AddToCache(Thread* self, AllocationInfo* info) {
+  const size_t allocation_size = info->ByteSize();
+  const size_t pages = allocation_size / kAlignment;
+  if (pages > kMaxCachedPages) {
+    return false;
+  }
+  if (cached_bytes_.FetchAndAddRelaxed(allocation_size) + allocation_size > max_cached_bytes_) {
+    cached_bytes_.FetchAndSubRelaxed(allocation_size);
+    return false;
+  }
+  uint8_t* const block = reinterpret_cast<uint8_t*>(GetAddressForAllocationInfo(info));
+  {
+    // Walk() and Dump() read the flags under lock_. The release of the push below publishes the
+    // flag to the thread that pops the block.
+    MutexLock mu(self, lock_);
+    info->SetCached();
+  }
+#ifdef MADV_FREE
+  // The first page holds the stack link and must keep its contents. Kernels without MADV_FREE
+  // fail the call and the pages stay resident until reused.
+  if (allocation_size > kAlignment) {
+    madvise(block + kAlignment, allocation_size - kAlignment, MADV_FREE);
+  }
+#endif
+  Atomic<uint32_t>* const link = reinterpret_cast<Atomic<uint32_t>*>(block);
+  const uint32_t slot = GetSlotIndexForAllocationInfo(info) + 1;
+  Atomic<uint64_t>& head = cache_heads_[pages];
+  uint64_t old_head;
+  uint64_t new_head;
+  do {
+    old_head = head.LoadRelaxed();
+    link->StoreRelaxed(Low32Bits(old_head));
+    new_head = (static_cast<uint64_t>(High32Bits(old_head) + 1) << 32) | slot;
+  } while (!head.CompareExchangeWeakRelease(old_head, new_head));
+  return true;
+}
+
+AllocationInfo* FreeListSpace::PopCachedBlock(size_t pages) {
+  Atomic<uint64_t>& head = cache_heads_[pages];
+  while (true) {
+    const uint64_t old_head = head.LoadAcquire();
+    const uint32_t slot = Low32Bits(old_head);
+    if (slot == 0) {
+      return nullptr;
+    }
+    // The block may be popped and reused concurrently, in which case the link read here is
+    // garbage but the version check of the exchange fails.
+    Atomic<uint32_t>* const link =
+        reinterpret_cast<Atomic<uint32_t>*>(GetAllocationAddressForSlot(slot - 1));
+    const uint64_t new_head =
+        (static_cast<uint64_t>(High32Bits(old_head) + 1) << 32) | link->LoadRelaxed();
+    if (head.CompareExchangeWeakAcquire(old_head, new_head)) {
+      AllocationInfo* info = &allocation_info_[slot - 1];
+      DCHECK(info->IsCached());
+      DCHECK_EQ(info->AlignSize(), pages);
+      cached_bytes_.FetchAndSubRelaxed(info->ByteSize());
+      return info;
+    }
+  }
+}
+
+AllocationInfo* FreeListSpace::AllocFromCache(Thread* self, size_t allocation_size) {
+  const size_t pages = allocation_size / kAlignment;
+  if (pages > kMaxCachedPages) {
+    return nullptr;
+  }
+  AllocationInfo* info = PopCachedBlock(pages);
+  if (info != nullptr) {
+    // The block holds the previous object, except for the pages that the kernel reclaimed. Clear
+    // it while Walk() still skips it as cached.
+    memset(reinterpret_cast<void*>(GetAddressForAllocationInfo(info)), 0, allocation_size);
+    // Clears the cached and zygote flags.
+    MutexLock mu(self, lock_);
+    info->SetByteSize(allocation_size, false);
+  }
+  return info;
+}
+
+void FreeListSpace::ReleaseCachedBlocksLocked() {
+  for (size_t pages = 1; pages <= kMaxCachedPages; ++pages) {
+    AllocationInfo* info;
+    while ((info = PopCachedBlock(pages)) != nullptr) {
+      info->SetByteSize(info->ByteSize(), false);
+      FreeLocked(info);
+    }
+  }
+}
+
+void FreeListSpace::ReleaseCachedBlocks(Thread* self) {
+  MutexLock mu(self, lock_);
+  ReleaseCachedBlocksLocked();
 }
 
 size_t FreeListSpace::AllocationSize(mirror::Object* obj, size_t* usable_size) {
@@ -471,8 +605,32 @@ size_t FreeListSpace::AllocationSize(mirror::Object* obj, size_t* usable_size) {
 
 mirror::Object* FreeListSpace::Alloc(Thread* self, size_t num_bytes, size_t* bytes_allocated,
                                      size_t* usable_size, size_t* bytes_tl_bulk_allocated) {
-  MutexLock mu(self, lock_);
   const size_t allocation_size = RoundUp(num_bytes, kAlignment);
+  AllocationInfo* new_info = AllocFromCache(self, allocation_size);
+  if (new_info == nullptr) {
+    MutexLock mu(self, lock_);
+    new_info = AllocLocked(allocation_size);
+    if (new_info == nullptr && cached_bytes_.LoadRelaxed() != 0) {
+      // The cached blocks may coalesce into a large enough one.
+      ReleaseCachedBlocksLocked();
+      new_info = AllocLocked(allocation_size);
+    }
+    if (new_info == nullptr) {
+      return nullptr;
+    }
+  }
+  DCHECK(bytes_allocated != nullptr);
+  *bytes_allocated = allocation_size;
+  if (usable_size != nullptr) {
+    *usable_size = allocation_size;
+  }
+  DCHECK(bytes_tl_bulk_allocated != nullptr);
+  *bytes_tl_bulk_allocated = allocation_size;
+  RecordAllocation(allocation_size);
+  return reinterpret_cast<mirror::Object*>(GetAddressForAllocationInfo(new_info));
+}
+
+AllocationInfo* FreeListSpace::AllocLocked(size_t allocation_size) {
   AllocationInfo temp_info;
   temp_info.SetPrevFreeBytes(allocation_size);
   temp_info.SetByteSize(0, false);
@@ -503,18 +661,6 @@ mirror::Object* FreeListSpace::Alloc(Thread* self, size_t num_bytes, size_t* byt
       return nullptr;
     }
   }
-  DCHECK(bytes_allocated != nullptr);
-  *bytes_allocated = allocation_size;
-  if (usable_size != nullptr) {
-    *usable_size = allocation_size;
-  }
-  DCHECK(bytes_tl_bulk_allocated != nullptr);
-  *bytes_tl_bulk_allocated = allocation_size;
-  // Need to do these inside of the lock.
-  ++num_objects_allocated_;
-  ++total_objects_allocated_;
-  num_bytes_allocated_ += allocation_size;
-  total_bytes_allocated_ += allocation_size;
   mirror::Object* obj = reinterpret_cast<mirror::Object*>(GetAddressForAllocationInfo(new_info));
   // We always put our object at the start of the free block, there cannot be another free block
   // before it.
@@ -523,7 +669,7 @@ mirror::Object* FreeListSpace::Alloc(Thread* self, size_t num_bytes, size_t* byt
   }
   new_info->SetPrevFreeBytes(0);
   new_info->SetByteSize(allocation_size, false);
-  return obj;
+  return new_info;
 }
 
 void FreeListSpace::Dump(std::ostream& os) const {
@@ -541,6 +687,9 @@ void FreeListSpace::Dump(std::ostream& os) const {
     if (cur_info->IsFree()) {
       os << "Free block at address: " << reinterpret_cast<const void*>(address)
          << " of length " << size << " bytes\n";
+    } else if (cur_info->IsCached()) {
+      os << "Cached block at address: " << reinterpret_cast<const void*>(address)
+         << " of length " << size << " bytes\n";
     } else {
       os << "Large object at address: " << reinterpret_cast<const void*>(address)
          << " of length " << size << " bytes\n";
@@ -565,7 +714,7 @@ void FreeListSpace::SetAllLargeObjectsAsZygoteObjects(Thread* self) {
   for (AllocationInfo* cur_info = GetAllocationInfoForAddress(reinterpret_cast<uintptr_t>(Begin())),
       *end_info = GetAllocationInfoForAddress(free_end_start); cur_info < end_info;
       cur_info = cur_info->GetNextInfo()) {
-    if (!cur_info->IsFree()) {
+    if (!cur_info->IsFree() && !cur_info->IsCached()) {
       cur_info->SetZygoteObject();
     }
   }
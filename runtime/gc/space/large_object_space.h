@@ -17,6 +17,7 @@
 #ifndef ART_RUNTIME_GC_SPACE_LARGE_OBJECT_SPACE_H_
 #define ART_RUNTIME_GC_SPACE_LARGE_OBJECT_SPACE_H_
 
+#include "atomic.h"
 #include "base/allocator.h"
 #include "dlmalloc_space.h"
 #include "safe_map.h"
@@ -49,16 +50,16 @@ class LargeObjectSpace : public DiscontinuousSpace, public AllocSpace {
   virtual ~LargeObjectSpace() {}
 
   uint64_t GetBytesAllocated() OVERRIDE {
-    return num_bytes_allocated_;
+    return num_bytes_allocated_.LoadRelaxed();
   }
   uint64_t GetObjectsAllocated() OVERRIDE {
-    return num_objects_allocated_;
+    return num_objects_allocated_.LoadRelaxed();
   }
   uint64_t GetTotalBytesAllocated() const {
-    return total_bytes_allocated_;
+    return total_bytes_allocated_.LoadRelaxed();
   }
   uint64_t GetTotalObjectsAllocated() const {
-    return total_objects_allocated_;
+    return total_objects_allocated_.LoadRelaxed();
   }
   size_t FreeList(Thread* self, size_t num_ptrs, mirror::Object** ptrs) OVERRIDE;
   // LargeObjectSpaces don't have thread local state.
@@ -103,6 +104,8 @@ class LargeObjectSpace : public DiscontinuousSpace, public AllocSpace {
   // Called when we create the zygote space, mark all existing large objects as zygote large
   // objects.
   virtual void SetAllLargeObjectsAsZygoteObjects(Thread* self) = 0;
+  // Return the freed blocks kept for reuse to the space, called when trimming the heap.
+  virtual void ReleaseCachedBlocks(Thread* self ATTRIBUTE_UNUSED) {}
 
   // GetRangeAtomic returns Begin() and End() atomically, that is, it never returns Begin() and
   // End() from different allocations.
@@ -112,11 +115,24 @@ class LargeObjectSpace : public DiscontinuousSpace, public AllocSpace {
   explicit LargeObjectSpace(const std::string& name, uint8_t* begin, uint8_t* end);
   static void SweepCallback(size_t num_ptrs, mirror::Object** ptrs, void* arg);
 
-  // Approximate number of bytes which have been allocated into the space.
-  uint64_t num_bytes_allocated_;
-  uint64_t num_objects_allocated_;
-  uint64_t total_bytes_allocated_;
-  uint64_t total_objects_allocated_;
+  void RecordAllocation(size_t allocation_size) {
+    num_bytes_allocated_.FetchAndAddRelaxed(allocation_size);
+    total_bytes_allocated_.FetchAndAddRelaxed(allocation_size);
+    num_objects_allocated_.FetchAndAddRelaxed(1);
+    total_objects_allocated_.FetchAndAddRelaxed(1);
+  }
+  void RecordFree(size_t allocation_size) {
+    DCHECK_GE(num_bytes_allocated_.LoadRelaxed(), allocation_size);
+    num_bytes_allocated_.FetchAndSubRelaxed(allocation_size);
+    num_objects_allocated_.FetchAndSubRelaxed(1);
+  }
+
+  // Approximate number of bytes which have been allocated into the space. Atomic since the free
+  // list space allocates and frees cached blocks without its lock.
+  Atomic<uint64_t> num_bytes_allocated_;
+  Atomic<uint64_t> num_objects_allocated_;
+  Atomic<uint64_t> total_bytes_allocated_;
+  Atomic<uint64_t> total_objects_allocated_;
   // Begin and end, may change as more large objects are allocated.
   uint8_t* begin_;
   uint8_t* end_;
@@ -131,8 +147,9 @@ class LargeObjectSpace : public DiscontinuousSpace, public AllocSpace {
 class LargeObjectMapSpace : public LargeObjectSpace {
  public:
   // Creates a large object space. Allocations into the large object space use memory maps instead
-  // of malloc.
-  static LargeObjectMapSpace* Create(const std::string& name);
+  // of malloc. If use_huge_pages is true, allocations of at least a huge page are advised to use
+  // transparent huge pages.
+  static LargeObjectMapSpace* Create(const std::string& name, bool use_huge_pages = false);
   // Return the storage space required by obj.
   size_t AllocationSize(mirror::Object* obj, size_t* usable_size) REQUIRES(!lock_);
   mirror::Object* Alloc(Thread* self, size_t num_bytes, size_t* bytes_allocated,
@@ -150,12 +167,14 @@ class LargeObjectMapSpace : public LargeObjectSpace {
     MemMap* mem_map;
     bool is_zygote;
   };
-  explicit LargeObjectMapSpace(const std::string& name);
+  LargeObjectMapSpace(const std::string& name, bool use_huge_pages);
   virtual ~LargeObjectMapSpace() {}
 
   bool IsZygoteLargeObject(Thread* self, mirror::Object* obj) const OVERRIDE REQUIRES(!lock_);
   void SetAllLargeObjectsAsZygoteObjects(Thread* self) OVERRIDE REQUIRES(!lock_);
 
+  const bool use_huge_pages_;
+
   // Used to ensure mutual exclusion when the allocation spaces data structures are being modified.
   mutable Mutex lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
   AllocationTrackingSafeMap<mirror::Object*, LargeObject, kAllocatorTagLOSMaps> large_objects_
@@ -163,12 +182,28 @@ class LargeObjectMapSpace : public LargeObjectSpace {
 };
 
 // A continuous large object space with a free-list to handle holes.
+//
+// Freed blocks of up to kMaxCachedPages pages are first kept in per page count caches instead of
+// being coalesced, and reused whole by allocations of the same page count. The caches are
+// lock-free stacks, so that services churning buffers of a few common sizes allocate and free
+// without searching or coalescing the free blocks. The cached flag of the allocation info still
+// changes under lock_, which Walk() and Dump() rely on, but only for that flip. Cached pages past
+// the first are advised with MADV_FREE so the kernel may reclaim them under pressure, and are
+// zeroed when reused. At most 1 / kCacheCapacityDivisor of the space is cached; when an
+// allocation does not fit, the caches are returned to the free list for coalescing first.
 class FreeListSpace FINAL : public LargeObjectSpace {
  public:
   static constexpr size_t kAlignment = kPageSize;
+  static constexpr size_t kMaxCachedPages = MB / kAlignment;
+  static constexpr size_t kCacheCapacityDivisor = 16;
 
   virtual ~FreeListSpace();
-  static FreeListSpace* Create(const std::string& name, uint8_t* requested_begin, size_t capacity);
+  // If use_huge_pages is true, the space is aligned to MemMap::kHugePageSize and advised to use
+  // transparent huge pages.
+  static FreeListSpace* Create(const std::string& name,
+                               uint8_t* requested_begin,
+                               size_t capacity,
+                               bool use_huge_pages = false);
   size_t AllocationSize(mirror::Object* obj, size_t* usable_size) OVERRIDE
       REQUIRES(lock_);
   mirror::Object* Alloc(Thread* self, size_t num_bytes, size_t* bytes_allocated,
@@ -180,6 +215,12 @@ class FreeListSpace FINAL : public LargeObjectSpace {
 
   std::pair<uint8_t*, uint8_t*> GetBeginEndAtomic() const OVERRIDE REQUIRES(!lock_);
 
+  size_t GetCachedBytes() const {
+    return cached_bytes_.LoadRelaxed();
+  }
+  // Return the cached blocks to the free list.
+  void ReleaseCachedBlocks(Thread* self) OVERRIDE REQUIRES(!lock_);
+
  protected:
   FreeListSpace(const std::string& name, MemMap* mem_map, uint8_t* begin, uint8_t* end);
   size_t GetSlotIndexForAddress(uintptr_t address) const {
@@ -197,6 +238,13 @@ class FreeListSpace FINAL : public LargeObjectSpace {
   }
   // Removes header from the free blocks set by finding the corresponding iterator and erasing it.
   void RemoveFreePrev(AllocationInfo* info) REQUIRES(lock_);
+  AllocationInfo* AllocLocked(size_t allocation_size) REQUIRES(lock_);
+  void FreeLocked(AllocationInfo* info) REQUIRES(lock_);
+  void ReleaseCachedBlocksLocked() REQUIRES(lock_);
+  // Lock-free size class caches, see the class comment.
+  AllocationInfo* AllocFromCache(Thread* self, size_t allocation_size) REQUIRES(!lock_);
+  bool AddToCache(Thread* self, AllocationInfo* info) REQUIRES(!lock_);
+  AllocationInfo* PopCachedBlock(size_t pages);
   bool IsZygoteLargeObject(Thread* self, mirror::Object* obj) const OVERRIDE;
   void SetAllLargeObjectsAsZygoteObjects(Thread* self) OVERRIDE REQUIRES(!lock_);
 
@@ -218,6 +266,13 @@ class FreeListSpace FINAL : public LargeObjectSpace {
   // Free bytes at the end of the space.
   size_t free_end_ GUARDED_BY(lock_);
   FreeBlocks free_blocks_ GUARDED_BY(lock_);
+
+  // Heads of the cached block stacks indexed by page count. The low 32 bits hold the slot index
+  // of the top block plus one, 0 if the stack is empty, and the high 32 bits a version number
+  // against ABA. Each cached block stores the next slot index plus one in its first word.
+  Atomic<uint64_t> cache_heads_[kMaxCachedPages + 1];
+  Atomic<size_t> cached_bytes_;
+  const size_t max_cached_bytes_;
 };
 
 }  // namespace space
@@ -181,6 +181,54 @@ TEST_F(LargeObjectSpaceTest, RaceTest) {
   RaceTest();
 }
 
+static void CountObjectsCallback(void* start, void* end ATTRIBUTE_UNUSED, size_t num_bytes,
+                                 void* arg) {
+  if (start != nullptr && num_bytes != 0) {
+    ++*reinterpret_cast<size_t*>(arg);
+  }
+}
+
+static size_t CountWalkedObjects(FreeListSpace* los) {
+  size_t count = 0;
+  los->Walk(CountObjectsCallback, &count);
+  return count;
+}
+
+TEST_F(LargeObjectSpaceTest, FreeListCacheTest) {
+  Thread* const self = Thread::Current();
+  std::unique_ptr<FreeListSpace> los(
+      FreeListSpace::Create("large object space", nullptr, 128 * MB));
+  const size_t kSize = 16 * KB;
+  size_t bytes_allocated = 0;
+  size_t bytes_tl_bulk_allocated = 0;
+  mirror::Object* obj = los->Alloc(self, kSize, &bytes_allocated, nullptr,
+                                   &bytes_tl_bulk_allocated);
+  ASSERT_TRUE(obj != nullptr);
+  memset(obj, 0xAB, kSize);
+  EXPECT_EQ(kSize, los->Free(self, obj));
+  EXPECT_EQ(kSize, los->GetCachedBytes());
+  EXPECT_EQ(0U, los->GetBytesAllocated());
+  // A cached block is not an object.
+  EXPECT_EQ(0U, CountWalkedObjects(los.get()));
+
+  // The freed block is reused for the next allocation of the same size, zeroed.
+  mirror::Object* obj2 = los->Alloc(self, kSize, &bytes_allocated, nullptr,
+                                    &bytes_tl_bulk_allocated);
+  ASSERT_EQ(obj, obj2);
+  EXPECT_EQ(0U, los->GetCachedBytes());
+  EXPECT_EQ(kSize, los->GetBytesAllocated());
+  EXPECT_EQ(1U, los->GetObjectsAllocated());
+  EXPECT_EQ(1U, CountWalkedObjects(los.get()));
+  for (size_t i = 0; i < kSize; ++i) {
+    ASSERT_EQ(0U, reinterpret_cast<const uint8_t*>(obj2)[i]);
+  }
+
+  los->Free(self, obj2);
+  los->ReleaseCachedBlocks(self);
+  EXPECT_EQ(0U, los->GetCachedBytes());
+  EXPECT_EQ(0U, los->GetObjectsAllocated());
+}
+
 }  // namespace space
 }  // namespace gc
 }  // namespace art
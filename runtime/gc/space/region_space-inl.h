@@ -18,6 +18,8 @@
 #define ART_RUNTIME_GC_SPACE_REGION_SPACE_INL_H_
 
 #include "region_space.h"
+
+#include "gc/accounting/card_table-inl.h"
 #include "thread-current-inl.h"
 
 namespace art {
@@ -43,35 +45,37 @@ inline mirror::Object* RegionSpace::AllocThreadUnsafe(Thread* self, size_t num_b
 template<bool kForEvac>
 inline mirror::Object* RegionSpace::AllocNonvirtual(size_t num_bytes, size_t* bytes_allocated,
                                                     size_t* usable_size,
-                                                    size_t* bytes_tl_bulk_allocated) {
+                                                    size_t* bytes_tl_bulk_allocated,
+                                                    uint32_t numa_node) {
   DCHECK_ALIGNED(num_bytes, kAlignment);
+  DCHECK_LT(numa_node, num_numa_nodes_);
   mirror::Object* obj;
   if (LIKELY(num_bytes <= kRegionSize)) {
     // Non-large object.
-    obj = (kForEvac ? evac_region_ : current_region_)->Alloc(num_bytes,
-                                                             bytes_allocated,
-                                                             usable_size,
-                                                             bytes_tl_bulk_allocated);
+    obj = (kForEvac ? evac_regions_[numa_node] : current_region_)->Alloc(num_bytes,
+                                                                         bytes_allocated,
+                                                                         usable_size,
+                                                                         bytes_tl_bulk_allocated);
     if (LIKELY(obj != nullptr)) {
       return obj;
     }
     MutexLock mu(Thread::Current(), region_lock_);
     // Retry with current region since another thread may have updated it.
-    obj = (kForEvac ? evac_region_ : current_region_)->Alloc(num_bytes,
-                                                             bytes_allocated,
-                                                             usable_size,
-                                                             bytes_tl_bulk_allocated);
+    obj = (kForEvac ? evac_regions_[numa_node] : current_region_)->Alloc(num_bytes,
+                                                                         bytes_allocated,
+                                                                         usable_size,
+                                                                         bytes_tl_bulk_allocated);
     if (LIKELY(obj != nullptr)) {
       return obj;
     }
-    Region* r = AllocateRegion(kForEvac);
+    Region* r = AllocateRegion(kForEvac, numa_node);
     if (LIKELY(r != nullptr)) {
       obj = r->Alloc(num_bytes, bytes_allocated, usable_size, bytes_tl_bulk_allocated);
       CHECK(obj != nullptr);
       // Do our allocation before setting the region, this makes sure no threads race ahead
       // and fill in the region before we allocate the object. b/63153464
       if (kForEvac) {
-        evac_region_ = r;
+        evac_regions_[numa_node] = r;
       } else {
         current_region_ = r;
       }
@@ -231,6 +235,60 @@ void RegionSpace::WalkInternal(Visitor&& visitor) {
   }
 }
 
+template <typename Visitor>
+void RegionSpace::VisitOldObjectsOnCards(accounting::CardTable* card_table,
+                                         uint8_t minimum_age,
+                                         Visitor&& visitor) {
+  auto has_dirty_card = [card_table, minimum_age](const uint8_t* begin, const uint8_t* end) {
+    const uint8_t* const last_card = card_table->CardFromAddr(end - 1);
+    for (const uint8_t* card = card_table->CardFromAddr(begin); card <= last_card; ++card) {
+      if (*card >= minimum_age) {
+        return true;
+      }
+    }
+    return false;
+  };
+  for (Region* r : old_regions_) {
+    DCHECK(r->IsInToSpace() && !r->IsNewlyAllocated());
+    uint8_t* pos = r->Begin();
+    uint8_t* top = r->Top();
+    // Most old regions are not written to between two collections; skip them quickly.
+    if (pos == top || !has_dirty_card(pos, top)) {
+      continue;
+    }
+    if (r->IsLarge()) {
+      visitor(reinterpret_cast<mirror::Object*>(pos));
+      continue;
+    }
+    auto visit_if_dirty = [this, &has_dirty_card, &visitor](mirror::Object* obj)
+        REQUIRES_SHARED(Locks::mutator_lock_) {
+      if (has_dirty_card(reinterpret_cast<uint8_t*>(obj),
+                         reinterpret_cast<uint8_t*>(GetNextObject(obj)))) {
+        visitor(obj);
+      }
+    };
+    // Regions that survived unevacuated keep their mark bitmap until the next full collection,
+    // which tells the live objects apart from the dead ones.
+    const bool need_bitmap =
+        r->LiveBytes() != static_cast<size_t>(-1) &&
+        r->LiveBytes() != static_cast<size_t>(top - pos);
+    if (need_bitmap) {
+      GetLiveBitmap()->VisitMarkedRange(reinterpret_cast<uintptr_t>(pos),
+                                        reinterpret_cast<uintptr_t>(top),
+                                        visit_if_dirty);
+    } else {
+      while (pos < top) {
+        mirror::Object* obj = reinterpret_cast<mirror::Object*>(pos);
+        if (obj->GetClass<kDefaultVerifyFlags, kWithoutReadBarrier>() == nullptr) {
+          break;
+        }
+        visit_if_dirty(obj);
+        pos = reinterpret_cast<uint8_t*>(GetNextObject(obj));
+      }
+    }
+  }
+}
+
 inline mirror::Object* RegionSpace::GetNextObject(mirror::Object* obj) {
   const uintptr_t position = reinterpret_cast<uintptr_t>(obj) + obj->SizeOf();
   return reinterpret_cast<mirror::Object*>(RoundUp(position, kAlignment));
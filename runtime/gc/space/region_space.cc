@@ -20,6 +20,12 @@
 #include "mirror/object-inl.h"
 #include "mirror/class-inl.h"
 #include "thread_list.h"
+#include "utils.h"
+
+#if defined(__linux__)
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#endif
 
 namespace art {
 namespace gc {
@@ -34,20 +40,27 @@ static constexpr uint kEvaculateLivePercentThreshold = 75U;
 static constexpr bool kProtectClearedRegions = kIsTargetBuild;
 
 MemMap* RegionSpace::CreateMemMap(const std::string& name, size_t capacity,
-                                  uint8_t* requested_begin) {
+                                  uint8_t* requested_begin, bool use_huge_pages) {
   CHECK_ALIGNED(capacity, kRegionSize);
   std::string error_msg;
-  // Ask for the capacity of an additional kRegionSize so that we can align the map by kRegionSize
-  // even if we get unaligned base address. This is necessary for the ReadBarrierTable to work.
+  // Huge pages need the map aligned to the huge page size, otherwise the first and last few
+  // regions of every huge page sized chunk would stay on small pages.
+  const size_t alignment = (use_huge_pages && MemMap::kHugePageSize > kRegionSize)
+      ? MemMap::kHugePageSize
+      : kRegionSize;
+  const size_t map_size = RoundUp(capacity, alignment) + alignment;
+  // Ask for the capacity of an additional alignment so that we can align the map by it even if
+  // we get unaligned base address. This is necessary for the ReadBarrierTable to work.
   std::unique_ptr<MemMap> mem_map;
   while (true) {
     mem_map.reset(MemMap::MapAnonymous(name.c_str(),
                                        requested_begin,
-                                       capacity + kRegionSize,
+                                       map_size,
                                        PROT_READ | PROT_WRITE,
                                        true,
                                        false,
-                                       &error_msg));
+                                       &error_msg,
+                                       /* use_ashmem */ !use_huge_pages));
     if (mem_map.get() != nullptr || requested_begin == nullptr) {
       break;
     }
@@ -60,31 +73,35 @@ MemMap* RegionSpace::CreateMemMap(const std::string& name, size_t capacity,
     MemMap::DumpMaps(LOG_STREAM(ERROR));
     return nullptr;
   }
-  CHECK_EQ(mem_map->Size(), capacity + kRegionSize);
+  CHECK_EQ(mem_map->Size(), map_size);
   CHECK_EQ(mem_map->Begin(), mem_map->BaseBegin());
   CHECK_EQ(mem_map->Size(), mem_map->BaseSize());
-  if (IsAlignedParam(mem_map->Begin(), kRegionSize)) {
-    // Got an aligned map. Since we requested a map that's kRegionSize larger. Shrink by
-    // kRegionSize at the end.
+  if (!IsAlignedParam(mem_map->Begin(), alignment)) {
+    // Got an unaligned map. Align the both ends, which drops the extra alignment.
+    mem_map->AlignBy(alignment);
+  }
+  if (mem_map->Size() != capacity) {
+    // Shrink the rest of the extra space at the end.
     mem_map->SetSize(capacity);
-  } else {
-    // Got an unaligned map. Align the both ends.
-    mem_map->AlignBy(kRegionSize);
   }
   CHECK_ALIGNED(mem_map->Begin(), kRegionSize);
   CHECK_ALIGNED(mem_map->End(), kRegionSize);
   CHECK_EQ(mem_map->Size(), capacity);
+  if (use_huge_pages && !mem_map->AdviseHugePages()) {
+    LOG(WARNING) << "Could not back " << name << " with huge pages";
+  }
   return mem_map.release();
 }
 
-RegionSpace* RegionSpace::Create(const std::string& name, MemMap* mem_map) {
-  return new RegionSpace(name, mem_map);
+RegionSpace* RegionSpace::Create(const std::string& name, MemMap* mem_map, bool numa_aware) {
+  return new RegionSpace(name, mem_map, numa_aware);
 }
 
-RegionSpace::RegionSpace(const std::string& name, MemMap* mem_map)
+RegionSpace::RegionSpace(const std::string& name, MemMap* mem_map, bool numa_aware)
     : ContinuousMemMapAllocSpace(name, mem_map, mem_map->Begin(), mem_map->End(), mem_map->End(),
                                  kGcRetentionPolicyAlwaysCollect),
-      region_lock_("Region lock", kRegionSpaceRegionLock), time_(1U) {
+      region_lock_("Region lock", kRegionSpaceRegionLock), time_(1U),
+      num_numa_nodes_(1U), num_remote_tlab_regions_(0U), num_remote_evac_regions_(0U) {
   size_t mem_map_size = mem_map->Size();
   CHECK_ALIGNED(mem_map_size, kRegionSize);
   CHECK_ALIGNED(mem_map->Begin(), kRegionSize);
@@ -110,14 +127,47 @@ RegionSpace::RegionSpace(const std::string& name, MemMap* mem_map)
     }
     CHECK_EQ(regions_[num_regions_ - 1].End(), Limit());
   }
+  if (numa_aware) {
+    size_t max_numa_nodes = kMaxNumaNodes;
+    num_numa_nodes_ = std::min(std::min(art::GetNumaNodeCount(), max_numa_nodes), num_regions_);
+  }
+  regions_per_numa_node_ = num_regions_ / num_numa_nodes_;
+  if (num_numa_nodes_ > 1) {
+    BindNumaStripes();
+  }
   DCHECK(!full_region_.IsFree());
   DCHECK(full_region_.IsAllocated());
   current_region_ = &full_region_;
-  evac_region_ = nullptr;
+  std::fill_n(evac_regions_, kMaxNumaNodes, nullptr);
   size_t ignored;
   DCHECK(full_region_.Alloc(kAlignment, &ignored, nullptr, &ignored) == nullptr);
 }
 
+void RegionSpace::BindNumaStripes() {
+#if defined(__linux__) && defined(__NR_mbind)
+  for (size_t node = 0; node < num_numa_nodes_; ++node) {
+    uint8_t* stripe_begin = regions_[node * regions_per_numa_node_].Begin();
+    uint8_t* stripe_end = (node + 1 == num_numa_nodes_)
+        ? Limit()
+        : regions_[(node + 1) * regions_per_numa_node_].Begin();
+    unsigned long node_mask = 1UL << node;  // NOLINT [runtime/int]
+    // A preferred (rather than bound) policy falls back to other nodes when this one is full.
+    if (syscall(__NR_mbind, stripe_begin, stripe_end - stripe_begin, MPOL_PREFERRED, &node_mask,
+                kMaxNumaNodes + 1, 0) != 0) {
+      PLOG(WARNING) << "Failed to bind " << GetName() << " stripe to NUMA node " << node;
+      return;
+    }
+  }
+#endif
+}
+
+uint32_t RegionSpace::CurrentNumaNode() const {
+  if (num_numa_nodes_ == 1) {
+    return 0;
+  }
+  return std::min<uint32_t>(GetCurrentNumaNode(), num_numa_nodes_ - 1);
+}
+
 size_t RegionSpace::FromSpaceSize() {
   uint64_t num_regions = 0;
   MutexLock mu(Thread::Current(), region_lock_);
@@ -154,14 +204,20 @@ size_t RegionSpace::ToSpaceSize() {
   return num_regions * kRegionSize;
 }
 
-inline bool RegionSpace::Region::ShouldBeEvacuated() {
+inline bool RegionSpace::Region::ShouldBeEvacuated(EvacMode evac_mode) {
   DCHECK((IsAllocated() || IsLarge()) && IsInToSpace());
+  if (evac_mode == EvacMode::kEvacModeForceAll) {
+    return true;
+  }
   // if the region was allocated after the start of the
   // previous GC or the live ratio is below threshold, evacuate
   // it.
   bool result;
   if (is_newly_allocated_) {
     result = true;
+  } else if (evac_mode == EvacMode::kEvacModeNewlyAllocated) {
+    // Old regions are not collected by a young-generation GC.
+    result = false;
   } else {
     bool is_live_percent_valid = live_bytes_ != static_cast<size_t>(-1);
     if (is_live_percent_valid) {
@@ -188,14 +244,16 @@ inline bool RegionSpace::Region::ShouldBeEvacuated() {
 }
 
 // Determine which regions to evacuate and mark them as
-// from-space. Mark the rest as unevacuated from-space.
-void RegionSpace::SetFromSpace(accounting::ReadBarrierTable* rb_table, bool force_evacuate_all) {
+// from-space. Mark the rest as unevacuated from-space, or leave
+// them in the to-space for a young-generation GC.
+void RegionSpace::SetFromSpace(accounting::ReadBarrierTable* rb_table, EvacMode evac_mode) {
   ++time_;
   if (kUseTableLookupReadBarrier) {
     DCHECK(rb_table->IsAllCleared());
     rb_table->SetAll();
   }
   MutexLock mu(Thread::Current(), region_lock_);
+  const bool young_gen = evac_mode == EvacMode::kEvacModeNewlyAllocated;
   size_t num_expected_large_tails = 0;
   bool prev_large_evacuated = false;
   VerifyNonFreeRegionLimit();
@@ -212,10 +270,12 @@ void RegionSpace::SetFromSpace(accounting::ReadBarrierTable* rb_table, bool forc
         DCHECK((state == RegionState::kRegionStateAllocated ||
                 state == RegionState::kRegionStateLarge) &&
                type == RegionType::kRegionTypeToSpace);
-        bool should_evacuate = force_evacuate_all || r->ShouldBeEvacuated();
+        bool should_evacuate = r->ShouldBeEvacuated(evac_mode);
         if (should_evacuate) {
           r->SetAsFromSpace();
           DCHECK(r->IsInFromSpace());
+        } else if (young_gen) {
+          KeepOldRegionInToSpace(r, rb_table);
         } else {
           r->SetAsUnevacFromSpace();
           DCHECK(r->IsInUnevacFromSpace());
@@ -232,6 +292,8 @@ void RegionSpace::SetFromSpace(accounting::ReadBarrierTable* rb_table, bool forc
         if (prev_large_evacuated) {
           r->SetAsFromSpace();
           DCHECK(r->IsInFromSpace());
+        } else if (young_gen) {
+          KeepOldRegionInToSpace(r, rb_table);
         } else {
           r->SetAsUnevacFromSpace();
           DCHECK(r->IsInUnevacFromSpace());
@@ -248,7 +310,30 @@ void RegionSpace::SetFromSpace(accounting::ReadBarrierTable* rb_table, bool forc
   }
   DCHECK_EQ(num_expected_large_tails, 0U);
   current_region_ = &full_region_;
-  evac_region_ = &full_region_;
+  std::fill_n(evac_regions_, kMaxNumaNodes, &full_region_);
+}
+
+void RegionSpace::RecordOldRegions() {
+  MutexLock mu(Thread::Current(), region_lock_);
+  old_regions_.clear();
+  for (size_t i = 0; i < non_free_region_index_limit_; ++i) {
+    Region* r = &regions_[i];
+    // The head of an old large object stands for its tail regions.
+    if (!r->IsFree() && !r->IsLargeTail() && !r->IsNewlyAllocated()) {
+      DCHECK(r->IsInToSpace());
+      old_regions_.push_back(r);
+    }
+  }
+}
+
+// An old region survives a young-generation GC in place: it is neither evacuated nor marked, so
+// its objects keep their to-space status.
+inline void RegionSpace::KeepOldRegionInToSpace(Region* r, accounting::ReadBarrierTable* rb_table) {
+  DCHECK(!r->IsNewlyAllocated());
+  DCHECK(r->IsInToSpace());
+  if (kUseTableLookupReadBarrier) {
+    rb_table->Clear(r->Begin(), r->End());
+  }
 }
 
 static void ZeroAndProtectRegion(uint8_t* begin, uint8_t* end) {
@@ -349,7 +434,7 @@ void RegionSpace::ClearFromSpace(uint64_t* cleared_bytes, uint64_t* cleared_obje
   ZeroAndReleasePages(clear_block_begin, clear_block_end - clear_block_begin);
   // Update non_free_region_index_limit_.
   SetNonFreeRegionLimit(new_non_free_region_index_limit);
-  evac_region_ = nullptr;
+  std::fill_n(evac_regions_, kMaxNumaNodes, nullptr);
 }
 
 void RegionSpace::LogFragmentationAllocFailure(std::ostream& os,
@@ -403,7 +488,7 @@ void RegionSpace::Clear() {
   }
   SetNonFreeRegionLimit(0);
   current_region_ = &full_region_;
-  evac_region_ = &full_region_;
+  std::fill_n(evac_regions_, kMaxNumaNodes, &full_region_);
 }
 
 void RegionSpace::Dump(std::ostream& os) const {
@@ -452,6 +537,16 @@ void RegionSpace::DumpNonFreeRegions(std::ostream& os) {
   }
 }
 
+void RegionSpace::DumpNumaStats(std::ostream& os) {
+  if (num_numa_nodes_ == 1) {
+    return;
+  }
+  MutexLock mu(Thread::Current(), region_lock_);
+  os << GetName() << " NUMA nodes " << num_numa_nodes_
+     << ", remote TLAB regions " << num_remote_tlab_regions_
+     << ", remote evacuation regions " << num_remote_evac_regions_ << "\n";
+}
+
 void RegionSpace::RecordAlloc(mirror::Object* ref) {
   CHECK(ref != nullptr);
   Region* r = RefToRegion(ref);
@@ -463,7 +558,7 @@ bool RegionSpace::AllocNewTlab(Thread* self, size_t min_bytes) {
   RevokeThreadLocalBuffersLocked(self);
   // Retain sufficient free regions for full evacuation.
 
-  Region* r = AllocateRegion(/*for_evac*/ false);
+  Region* r = AllocateRegion(/*for_evac*/ false, CurrentNumaNode());
   if (r != nullptr) {
     r->is_a_tlab_ = true;
     r->thread_ = self;
@@ -564,11 +659,17 @@ void RegionSpace::Region::Clear(bool zero_and_release_pages) {
   thread_ = nullptr;
 }
 
-RegionSpace::Region* RegionSpace::AllocateRegion(bool for_evac) {
+RegionSpace::Region* RegionSpace::AllocateRegion(bool for_evac, uint32_t numa_node) {
   if (!for_evac && (num_non_free_regions_ + 1) * 2 > num_regions_) {
     return nullptr;
   }
-  for (size_t i = 0; i < num_regions_; ++i) {
+  // Search the stripe of the requested node first, then wrap around into the other nodes'.
+  const size_t first = numa_node * regions_per_numa_node_;
+  for (size_t n = 0; n < num_regions_; ++n) {
+    size_t i = first + n;
+    if (i >= num_regions_) {
+      i -= num_regions_;
+    }
     Region* r = &regions_[i];
     if (r->IsFree()) {
       r->Unfree(this, time_);
@@ -577,6 +678,9 @@ RegionSpace::Region* RegionSpace::AllocateRegion(bool for_evac) {
         // Evac doesn't count as newly allocated.
         r->SetNewlyAllocated();
       }
+      if (NumaNodeOfRegion(r) != numa_node) {
+        ++(for_evac ? num_remote_evac_regions_ : num_remote_tlab_regions_);
+      }
       return r;
     }
   }
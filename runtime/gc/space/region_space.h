@@ -17,6 +17,8 @@
 #ifndef ART_RUNTIME_GC_SPACE_REGION_SPACE_H_
 #define ART_RUNTIME_GC_SPACE_REGION_SPACE_H_
 
+#include <vector>
+
 #include "base/macros.h"
 #include "base/mutex.h"
 #include "space.h"
@@ -26,6 +28,7 @@ namespace art {
 namespace gc {
 
 namespace accounting {
+class CardTable;
 class ReadBarrierTable;
 }  // namespace accounting
 
@@ -43,8 +46,15 @@ class RegionSpace FINAL : public ContinuousMemMapAllocSpace {
   // Create a region space mem map with the requested sizes. The requested base address is not
   // guaranteed to be granted, if it is required, the caller should call Begin on the returned
   // space to confirm the request was granted.
-  static MemMap* CreateMemMap(const std::string& name, size_t capacity, uint8_t* requested_begin);
-  static RegionSpace* Create(const std::string& name, MemMap* mem_map);
+  // If use_huge_pages is true, the map is aligned to MemMap::kHugePageSize and advised to use
+  // transparent huge pages. Freed regions are still released individually.
+  static MemMap* CreateMemMap(const std::string& name,
+                              size_t capacity,
+                              uint8_t* requested_begin,
+                              bool use_huge_pages = false);
+  // If numa_aware is true and the machine has more than one NUMA node, the regions are split into
+  // one contiguous stripe per node and each stripe prefers to be backed by its node's memory.
+  static RegionSpace* Create(const std::string& name, MemMap* mem_map, bool numa_aware = false);
 
   // Allocate num_bytes, returns null if the space is full.
   mirror::Object* Alloc(Thread* self, size_t num_bytes, size_t* bytes_allocated,
@@ -54,11 +64,13 @@ class RegionSpace FINAL : public ContinuousMemMapAllocSpace {
   mirror::Object* AllocThreadUnsafe(Thread* self, size_t num_bytes, size_t* bytes_allocated,
                                     size_t* usable_size, size_t* bytes_tl_bulk_allocated)
       OVERRIDE REQUIRES(Locks::mutator_lock_) REQUIRES(!region_lock_);
-  // The main allocation routine.
+  // The main allocation routine. Evacuation allocates into a region of the given NUMA node when
+  // one is free.
   template<bool kForEvac>
   ALWAYS_INLINE mirror::Object* AllocNonvirtual(size_t num_bytes, size_t* bytes_allocated,
                                                 size_t* usable_size,
-                                                size_t* bytes_tl_bulk_allocated)
+                                                size_t* bytes_tl_bulk_allocated,
+                                                uint32_t numa_node = 0)
       REQUIRES(!region_lock_);
   // Allocate/free large objects (objects that are larger than the region size.)
   template<bool kForEvac>
@@ -94,6 +106,8 @@ class RegionSpace FINAL : public ContinuousMemMapAllocSpace {
   void Dump(std::ostream& os) const;
   void DumpRegions(std::ostream& os) REQUIRES(!region_lock_);
   void DumpNonFreeRegions(std::ostream& os) REQUIRES(!region_lock_);
+  // Dump how many regions were handed out from a NUMA node other than the requested one.
+  void DumpNumaStats(std::ostream& os) REQUIRES(!region_lock_);
 
   size_t RevokeThreadLocalBuffers(Thread* thread) REQUIRES(!region_lock_);
   void RevokeThreadLocalBuffersLocked(Thread* thread) REQUIRES(region_lock_);
@@ -173,6 +187,21 @@ class RegionSpace FINAL : public ContinuousMemMapAllocSpace {
   static constexpr size_t kAlignment = kObjectAlignment;
   // The region size.
   static constexpr size_t kRegionSize = 256 * KB;
+  // The maximum number of NUMA nodes that get their own region stripe. Nodes beyond this share
+  // the last stripe.
+  static constexpr size_t kMaxNumaNodes = 8;
+
+  size_t GetNumaNodeCount() const {
+    return num_numa_nodes_;
+  }
+
+  // Returns the NUMA node whose stripe holds ref, which must be in this space.
+  uint32_t NumaNodeOf(mirror::Object* ref) {
+    return NumaNodeOfRegion(RefToRegionUnlocked(ref));
+  }
+
+  // Returns the NUMA node the calling thread runs on, clamped to the stripes of this space.
+  uint32_t CurrentNumaNode() const;
 
   bool IsInFromSpace(mirror::Object* ref) {
     if (HasAddress(ref)) {
@@ -214,9 +243,34 @@ class RegionSpace FINAL : public ContinuousMemMapAllocSpace {
     return RegionType::kRegionTypeNone;
   }
 
-  void SetFromSpace(accounting::ReadBarrierTable* rb_table, bool force_evacuate_all)
+  // Which regions SetFromSpace() picks for evacuation.
+  enum class EvacMode {
+    // Only the regions allocated since the last GC (young-generation collection). The other
+    // non-free regions stay in the to-space and are treated as live.
+    kEvacModeNewlyAllocated,
+    // Newly allocated regions and the regions whose live ratio is below the threshold.
+    kEvacModeLivePercentNewlyAllocated,
+    // All non-free regions.
+    kEvacModeForceAll,
+  };
+
+  void SetFromSpace(accounting::ReadBarrierTable* rb_table, EvacMode evac_mode)
       REQUIRES(!region_lock_);
 
+  // Record the old regions, the non-free regions allocated before the last collection, for
+  // VisitOldObjectsOnCards(). Called by a young-generation GC before it sets the from-space. Only
+  // the GC creates or frees old regions, so the set holds until the GC reclaims the from-space.
+  void RecordOldRegions() REQUIRES(!region_lock_);
+
+  // Visit the objects of the recorded old regions that lie on cards at least minimum_age. In a
+  // young-generation collection these are the old objects that may refer to the from-space. The
+  // old regions are not allocated into, so this may run concurrently with the mutators.
+  template <typename Visitor>
+  ALWAYS_INLINE void VisitOldObjectsOnCards(accounting::CardTable* card_table,
+                                            uint8_t minimum_age,
+                                            Visitor&& visitor)
+      REQUIRES_SHARED(Locks::mutator_lock_);
+
   size_t FromSpaceSize() REQUIRES(!region_lock_);
   size_t UnevacFromSpaceSize() REQUIRES(!region_lock_);
   size_t ToSpaceSize() REQUIRES(!region_lock_);
@@ -227,6 +281,12 @@ class RegionSpace FINAL : public ContinuousMemMapAllocSpace {
     reg->AddLiveBytes(alloc_size);
   }
 
+  // Same as AddLiveBytes, for when several GC threads may add to the same region.
+  void AtomicAddLiveBytes(mirror::Object* ref, size_t alloc_size) {
+    Region* reg = RefToRegionUnlocked(ref);
+    reg->AtomicAddLiveBytes(alloc_size);
+  }
+
   void AssertAllRegionLiveBytesZeroOrCleared() REQUIRES(!region_lock_) {
     if (kIsDebugBuild) {
       MutexLock mu(Thread::Current(), region_lock_);
@@ -246,7 +306,7 @@ class RegionSpace FINAL : public ContinuousMemMapAllocSpace {
   }
 
  private:
-  RegionSpace(const std::string& name, MemMap* mem_map);
+  RegionSpace(const std::string& name, MemMap* mem_map, bool numa_aware);
 
   template<bool kToSpaceOnly, typename Visitor>
   ALWAYS_INLINE void WalkInternal(Visitor&& visitor) NO_THREAD_SAFETY_ANALYSIS;
@@ -382,7 +442,7 @@ class RegionSpace FINAL : public ContinuousMemMapAllocSpace {
       type_ = RegionType::kRegionTypeToSpace;
     }
 
-    ALWAYS_INLINE bool ShouldBeEvacuated();
+    ALWAYS_INLINE bool ShouldBeEvacuated(EvacMode evac_mode);
 
     void AddLiveBytes(size_t live_bytes) {
       DCHECK(IsInUnevacFromSpace());
@@ -394,6 +454,15 @@ class RegionSpace FINAL : public ContinuousMemMapAllocSpace {
       DCHECK_LE(live_bytes_, BytesAllocated());
     }
 
+    void AtomicAddLiveBytes(size_t live_bytes) {
+      DCHECK(IsInUnevacFromSpace());
+      DCHECK(!IsLargeTail());
+      DCHECK_NE(live_bytes_, static_cast<size_t>(-1));
+      reinterpret_cast<Atomic<size_t>*>(&live_bytes_)->FetchAndAddSequentiallyConsistent(
+          IsLarge() ? Top() - begin_ : live_bytes);
+      DCHECK_LE(live_bytes_, BytesAllocated());
+    }
+
     bool AllAllocatedBytesAreLive() const {
       return LiveBytes() == static_cast<size_t>(Top() - Begin());
     }
@@ -518,7 +587,14 @@ class RegionSpace FINAL : public ContinuousMemMapAllocSpace {
     }
   }
 
-  Region* AllocateRegion(bool for_evac) REQUIRES(region_lock_);
+  // Allocate a free region, preferring the stripe of the given NUMA node.
+  Region* AllocateRegion(bool for_evac, uint32_t numa_node = 0) REQUIRES(region_lock_);
+  uint32_t NumaNodeOfRegion(const Region* r) const {
+    return std::min<uint32_t>(r->Idx() / regions_per_numa_node_, num_numa_nodes_ - 1);
+  }
+  void BindNumaStripes();
+  void KeepOldRegionInToSpace(Region* r, accounting::ReadBarrierTable* rb_table)
+      REQUIRES(region_lock_);
 
   Mutex region_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
 
@@ -532,8 +608,18 @@ class RegionSpace FINAL : public ContinuousMemMapAllocSpace {
   // true.
   size_t non_free_region_index_limit_ GUARDED_BY(region_lock_);
   Region* current_region_;         // The region that's being allocated currently.
-  Region* evac_region_;            // The region that's being evacuated to currently.
+  Region* evac_regions_[kMaxNumaNodes];
+                                   // The regions that are being evacuated to currently, one
+                                   // per NUMA node.
+  size_t num_numa_nodes_;          // The number of NUMA stripes, 1 if not NUMA aware.
+  size_t regions_per_numa_node_;   // The number of regions in each NUMA stripe.
+  // The number of regions handed out from another node's stripe because the requested one was
+  // exhausted, for TLABs and for evacuation.
+  uint64_t num_remote_tlab_regions_ GUARDED_BY(region_lock_);
+  uint64_t num_remote_evac_regions_ GUARDED_BY(region_lock_);
   Region full_region_;             // The dummy/sentinel region that looks full.
+  // The old regions recorded by RecordOldRegions(). Only used by the GC thread.
+  std::vector<Region*> old_regions_;
 
   // Mark bitmap used by the GC.
   std::unique_ptr<accounting::ContinuousSpaceBitmap> mark_bitmap_;
@@ -16,6 +16,11 @@
 
 #include "space_test.h"
 
+#include <set>
+
+#include "gc/allocator/rosalloc-inl.h"
+#include "thread_pool.h"
+
 namespace art {
 namespace gc {
 namespace space {
@@ -28,6 +33,83 @@ MallocSpace* CreateRosAllocSpace(const std::string& name, size_t initial_size, s
 
 TEST_SPACE_CREATE_FN_RANDOM(RosAllocSpace, CreateRosAllocSpace)
 
+// Fills a vector with allocations of random sizes in all the thread-local size brackets and adds
+// up the bytes allocated.
+class RosAllocFillTask : public SelfDeletingTask {
+ public:
+  RosAllocFillTask(allocator::RosAlloc* rosalloc,
+                   uint32_t seed,
+                   std::vector<void*>* ptrs,
+                   size_t* bytes_allocated)
+      : rosalloc_(rosalloc), seed_(seed), ptrs_(ptrs), bytes_allocated_(bytes_allocated) {}
+
+  void Run(Thread* self) OVERRIDE NO_THREAD_SAFETY_ANALYSIS {
+    for (void*& ptr : *ptrs_) {
+      seed_ = seed_ * 1103515245 + 12345;
+      const size_t size = 1 + (seed_ >> 8) % allocator::RosAlloc::kMaxThreadLocalBracketSize;
+      size_t bytes_allocated;
+      size_t usable_size;
+      size_t bytes_tl_bulk_allocated;
+      ptr = rosalloc_->Alloc<true>(self, size, &bytes_allocated, &usable_size,
+                                   &bytes_tl_bulk_allocated);
+      if (ptr != nullptr) {
+        *bytes_allocated_ += bytes_allocated;
+      }
+    }
+  }
+
+ private:
+  allocator::RosAlloc* const rosalloc_;
+  uint32_t seed_;
+  std::vector<void*>* const ptrs_;
+  size_t* const bytes_allocated_;
+};
+
+// Allocates from several threads at once, each from its own thread-local runs, and checks that no
+// two threads got the same slot and that bulk freeing everything gives back every byte allocated.
+static void RunParallelAllocTest(MallocSpace* space) NO_THREAD_SAFETY_ANALYSIS {
+  static constexpr size_t kMaxThreads = 4;
+  static constexpr size_t kAllocsPerThread = 8 * KB;
+  allocator::RosAlloc* rosalloc = down_cast<RosAllocSpace*>(space)->GetRosAlloc();
+  Thread* const self = Thread::Current();
+  ThreadPool thread_pool("RosAlloc test thread pool", kMaxThreads - 1);
+  for (size_t thread_count = 1; thread_count <= kMaxThreads; thread_count *= 2) {
+    std::vector<std::vector<void*>> ptrs(thread_count, std::vector<void*>(kAllocsPerThread));
+    std::vector<size_t> bytes_allocated(thread_count, 0u);
+    for (size_t i = 0; i < thread_count; ++i) {
+      thread_pool.AddTask(self,
+                          new RosAllocFillTask(rosalloc, i + 1, &ptrs[i], &bytes_allocated[i]));
+    }
+    thread_pool.SetMaxActiveWorkers(thread_count - 1);
+    thread_pool.StartWorkers(self);
+    thread_pool.Wait(self, true, true);
+    thread_pool.StopWorkers(self);
+
+    std::vector<void*> all_ptrs;
+    size_t total_bytes_allocated = 0;
+    for (size_t i = 0; i < thread_count; ++i) {
+      for (void* ptr : ptrs[i]) {
+        ASSERT_TRUE(ptr != nullptr);
+        all_ptrs.push_back(ptr);
+      }
+      total_bytes_allocated += bytes_allocated[i];
+    }
+    std::set<void*> unique_ptrs(all_ptrs.begin(), all_ptrs.end());
+    EXPECT_EQ(unique_ptrs.size(), all_ptrs.size()) << thread_count;
+    const size_t freed_bytes = rosalloc->BulkFree(self, all_ptrs.data(), all_ptrs.size());
+    EXPECT_EQ(freed_bytes, total_bytes_allocated) << thread_count;
+  }
+  space->RevokeAllThreadLocalBuffers();
+}
+
+TEST_F(RosAllocSpaceRandomTest, ParallelAlloc) {
+  static constexpr size_t kSpaceSize = 64 * MB;
+  MallocSpace* space = CreateRosAllocSpace("parallel", kSpaceSize, kSpaceSize, kSpaceSize, nullptr);
+  ASSERT_TRUE(space != nullptr);
+  AddSpace(space);
+  RunParallelAllocTest(space);
+}
+
 
 }  // namespace space
 }  // namespace gc
@@ -34,6 +34,10 @@ class AbstractSystemWeakHolder {
   virtual void Broadcast(bool broadcast_for_checkpoint) = 0;
 
   virtual void Sweep(IsMarkedVisitor* visitor) REQUIRES_SHARED(Locks::mutator_lock_) = 0;
+
+  // Called by the GC before it blocks weak accesses. Until the holder has been swept again,
+  // accesses must wait for the GC to re-enable them.
+  virtual void MarkUnswept() = 0;
 };
 
 class SystemWeakHolder : public AbstractSystemWeakHolder {
@@ -41,7 +45,8 @@ class SystemWeakHolder : public AbstractSystemWeakHolder {
   explicit SystemWeakHolder(LockLevel level)
       : allow_disallow_lock_("SystemWeakHolder", level),
         new_weak_condition_("SystemWeakHolder new condition", allow_disallow_lock_),
-        allow_new_system_weak_(true) {
+        allow_new_system_weak_(true),
+        swept_(false) {
   }
   virtual ~SystemWeakHolder() {}
 
@@ -60,6 +65,7 @@ class SystemWeakHolder : public AbstractSystemWeakHolder {
     CHECK(!kUseReadBarrier);
     MutexLock mu(Thread::Current(), allow_disallow_lock_);
     allow_new_system_weak_ = false;
+    swept_ = false;
   }
 
   void Broadcast(bool broadcast_for_checkpoint ATTRIBUTE_UNUSED) OVERRIDE
@@ -68,6 +74,11 @@ class SystemWeakHolder : public AbstractSystemWeakHolder {
     new_weak_condition_.Broadcast(Thread::Current());
   }
 
+  void MarkUnswept() OVERRIDE REQUIRES(!allow_disallow_lock_) {
+    MutexLock mu(Thread::Current(), allow_disallow_lock_);
+    swept_ = false;
+  }
+
   // WARNING: For lock annotations only.
   Mutex* GetAllowDisallowLock() const RETURN_CAPABILITY(allow_disallow_lock_) {
     return nullptr;
@@ -77,9 +88,11 @@ class SystemWeakHolder : public AbstractSystemWeakHolder {
   void Wait(Thread* self)
       REQUIRES_SHARED(Locks::mutator_lock_)
       REQUIRES(allow_disallow_lock_) {
-    // Wait for GC's sweeping to complete and allow new records
-    while (UNLIKELY((!kUseReadBarrier && !allow_new_system_weak_) ||
-                    (kUseReadBarrier && !self->GetWeakRefAccessEnabled()))) {
+    // Wait for GC's sweeping to complete and allow new records. Once this holder is swept its
+    // entries are all live, so it can be used again while the GC sweeps the others.
+    while (UNLIKELY(!swept_ &&
+                    ((!kUseReadBarrier && !allow_new_system_weak_) ||
+                     (kUseReadBarrier && !self->GetWeakRefAccessEnabled())))) {
       // Check and run the empty checkpoint before blocking so the empty checkpoint will work in the
       // presence of threads blocking for weak ref access.
       self->CheckEmptyCheckpointFromWeakRefAccess(&allow_disallow_lock_);
@@ -87,9 +100,18 @@ class SystemWeakHolder : public AbstractSystemWeakHolder {
     }
   }
 
+  // To be called by Sweep() implementations once all entries are swept. Wakes up the threads
+  // waiting for access.
+  void MarkSweptLocked(Thread* self) REQUIRES(allow_disallow_lock_) {
+    swept_ = true;
+    new_weak_condition_.Broadcast(self);
+  }
+
   Mutex allow_disallow_lock_;
   ConditionVariable new_weak_condition_ GUARDED_BY(allow_disallow_lock_);
   bool allow_new_system_weak_ GUARDED_BY(allow_disallow_lock_);
+  // Whether the holder was swept since the GC last blocked weak accesses.
+  bool swept_ GUARDED_BY(allow_disallow_lock_);
 };
 
 }  // namespace gc
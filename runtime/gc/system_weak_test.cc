@@ -210,5 +210,55 @@ TEST_F(SystemWeakTest, Remove) {
   EXPECT_EQ(1U, cswh.sweep_count_);
 }
 
+// A holder that records the end of its sweep, which lets threads read it before the GC re-enables
+// weak accesses for all system weaks.
+struct SweptSystemWeakHolder : public CountingSystemWeakHolder {
+  void Sweep(IsMarkedVisitor* visitor) OVERRIDE
+      REQUIRES_SHARED(Locks::mutator_lock_)
+      REQUIRES(!allow_disallow_lock_) {
+    CountingSystemWeakHolder::Sweep(visitor);
+    MutexLock mu(Thread::Current(), allow_disallow_lock_);
+    MarkSweptLocked(Thread::Current());
+  }
+};
+
+class IdentityIsMarkedVisitor : public IsMarkedVisitor {
+ public:
+  mirror::Object* IsMarked(mirror::Object* obj) OVERRIDE {
+    return obj;
+  }
+};
+
+TEST_F(SystemWeakTest, AccessibleOnceSwept) {
+  SweptSystemWeakHolder holder;
+
+  ScopedObjectAccess soa(Thread::Current());
+
+  StackHandleScope<1> hs(soa.Self());
+
+  Handle<mirror::String> s(hs.NewHandle(mirror::String::AllocFromModifiedUtf8(soa.Self(), "ABC")));
+  holder.Set(GcRoot<mirror::Object>(s.Get()));
+
+  // Block weak accesses the way the collectors do.
+  if (kUseReadBarrier) {
+    holder.MarkUnswept();
+    soa.Self()->SetWeakRefAccessEnabled(false);
+  } else {
+    holder.Disallow();
+  }
+
+  // Once swept, reading the holder must not wait for weak accesses to be re-enabled.
+  IdentityIsMarkedVisitor visitor;
+  holder.Sweep(&visitor);
+  EXPECT_EQ(1U, holder.sweep_count_);
+  EXPECT_EQ(holder.Get().Read(), s.Get());
+
+  if (kUseReadBarrier) {
+    soa.Self()->SetWeakRefAccessEnabled(true);
+  } else {
+    holder.Allow();
+  }
+}
+
 }  // namespace gc
 }  // namespace art
@@ -27,19 +27,24 @@
 #include <cutils/open_memstream.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <signal.h>
 #include <stdio.h>
 #include <string.h>
 #include <sys/time.h>
 #include <sys/uio.h>
+#include <sys/wait.h>
 #include <time.h>
 #include <time.h>
 #include <unistd.h>
 #include <set>
+#include <vector>
+#include <zlib.h>
 
 #include "android-base/stringprintf.h"
 
 #include "art_field-inl.h"
 #include "art_method-inl.h"
+#include "base/casts.h"
 #include "base/logging.h"
 #include "base/time_utils.h"
 #include "base/unix_file/fd_file.h"
@@ -57,6 +62,8 @@
 #include "globals.h"
 #include "jdwp/jdwp.h"
 #include "jdwp/jdwp_priv.h"
+#include "jit/jit.h"
+#include "jit/jit_code_cache.h"
 #include "mirror/class.h"
 #include "mirror/class-inl.h"
 #include "mirror/object-refvisitor-inl.h"
@@ -77,6 +84,9 @@ static constexpr uint32_t kHprofNullThread = 0;
 static constexpr size_t kMaxObjectsPerSegment = 128;
 static constexpr size_t kMaxBytesPerSegment = 4096;
 
+// Records written to a file are gathered into chunks of this size.
+static constexpr size_t kFileChunkSize = 1 * MB;
+
 // The static field-name for the synthetic object generated to account for class static overhead.
 static constexpr const char* kClassOverheadName = "$classOverhead";
 
@@ -385,29 +395,115 @@ class EndianOutputBuffered : public EndianOutput {
   std::vector<uint8_t> buffer_;
 };
 
+// Gathers the records into chunks instead of writing each of them, and optionally gzip
+// compresses the output.
 class FileEndianOutput FINAL : public EndianOutputBuffered {
  public:
-  FileEndianOutput(File* fp, size_t reserved_size)
-      : EndianOutputBuffered(reserved_size), fp_(fp), errors_(false) {
+  FileEndianOutput(File* fp, size_t reserved_size, bool compress)
+      : EndianOutputBuffered(reserved_size), fp_(fp), compress_(compress), errors_(false) {
     DCHECK(fp != nullptr);
+    chunk_.reserve(kFileChunkSize);
+    if (compress_) {
+      memset(&zstream_, 0, sizeof(zstream_));
+      // 16 added to the window bits asks for a gzip header and trailer.
+      errors_ = deflateInit2(&zstream_, Z_BEST_SPEED, Z_DEFLATED, MAX_WBITS + 16, 8,
+                             Z_DEFAULT_STRATEGY) != Z_OK;
+      compressed_.resize(kFileChunkSize);
+    }
   }
   ~FileEndianOutput() {
+    if (compress_) {
+      deflateEnd(&zstream_);
+    }
   }
 
   bool Errors() {
     return errors_;
   }
 
+  // Write the pending chunk and end the compressed stream, once all the records are added.
+  void Finish() {
+    if (!errors_) {
+      if (compress_) {
+        Deflate(chunk_.data(), chunk_.size(), Z_FINISH);
+      } else {
+        errors_ = !fp_->WriteFully(chunk_.data(), chunk_.size());
+      }
+    }
+    chunk_.clear();
+  }
+
  protected:
   void HandleFlush(const uint8_t* buffer, size_t length) OVERRIDE {
-    if (!errors_) {
-      errors_ = !fp_->WriteFully(buffer, length);
+    if (errors_) {
+      return;
     }
+    if (chunk_.size() + length <= kFileChunkSize) {
+      chunk_.insert(chunk_.end(), buffer, buffer + length);
+      return;
+    }
+    if (compress_) {
+      Deflate(chunk_.data(), chunk_.size(), Z_NO_FLUSH);
+      Deflate(buffer, length, Z_NO_FLUSH);
+    } else {
+      // Write the record that does not fit along with the chunk, without copying it.
+      errors_ = !WriteFully(chunk_.data(), chunk_.size(), buffer, length);
+    }
+    chunk_.clear();
   }
 
  private:
+  bool WriteFully(const uint8_t* first, size_t first_length,
+                  const uint8_t* second, size_t second_length) {
+    iovec iov[2];
+    iov[0].iov_base = const_cast<uint8_t*>(first);
+    iov[0].iov_len = first_length;
+    iov[1].iov_base = const_cast<uint8_t*>(second);
+    iov[1].iov_len = second_length;
+    iovec* current = iov;
+    size_t count = arraysize(iov);
+    while (count != 0) {
+      ssize_t written = TEMP_FAILURE_RETRY(writev(fp_->Fd(), current, count));
+      if (written <= 0) {
+        return false;
+      }
+      // Skip over what was written.
+      size_t remaining = static_cast<size_t>(written);
+      while (count != 0 && remaining >= current->iov_len) {
+        remaining -= current->iov_len;
+        ++current;
+        --count;
+      }
+      if (count != 0) {
+        current->iov_base = reinterpret_cast<uint8_t*>(current->iov_base) + remaining;
+        current->iov_len -= remaining;
+      }
+    }
+    return true;
+  }
+
+  void Deflate(const uint8_t* buffer, size_t length, int flush) {
+    zstream_.next_in = const_cast<uint8_t*>(buffer);
+    zstream_.avail_in = length;
+    int result;
+    do {
+      zstream_.next_out = compressed_.data();
+      zstream_.avail_out = compressed_.size();
+      result = deflate(&zstream_, flush);
+      if (result == Z_STREAM_ERROR ||
+          !fp_->WriteFully(compressed_.data(), compressed_.size() - zstream_.avail_out)) {
+        errors_ = true;
+        return;
+      }
+    } while (flush == Z_FINISH ? result != Z_STREAM_END : zstream_.avail_out == 0);
+  }
+
   File* fp_;
+  const bool compress_;
   bool errors_;
+  std::vector<uint8_t> chunk_;
+  z_stream zstream_;
+  std::vector<uint8_t> compressed_;
 };
 
 class NetStateEndianOutput FINAL : public EndianOutputBuffered {
@@ -435,14 +531,17 @@ class NetStateEndianOutput FINAL : public EndianOutputBuffered {
 
 class Hprof : public SingleRootVisitor {
  public:
-  Hprof(const char* output_filename, int fd, bool direct_to_ddms)
+  Hprof(const char* output_filename, int fd, bool direct_to_ddms, bool compress)
       : filename_(output_filename),
         fd_(fd),
-        direct_to_ddms_(direct_to_ddms) {
+        direct_to_ddms_(direct_to_ddms),
+        compress_(compress) {
     LOG(INFO) << "hprof: heap dump \"" << filename_ << "\" starting...";
   }
 
-  void Dump()
+  // Returns false and sets the error message if the dump could not be written. Does not log, so
+  // that it may run in a forked child process.
+  bool Dump()
     REQUIRES(Locks::mutator_lock_)
     REQUIRES(!Locks::heap_bitmap_lock_, !Locks::alloc_tracker_lock_) {
     {
@@ -453,13 +552,12 @@ class Hprof : public SingleRootVisitor {
     }
 
     // First pass to measure the size of the dump.
-    size_t overall_size;
     size_t max_length;
     {
       EndianOutput count_output;
       output_ = &count_output;
       ProcessHeap(false);
-      overall_size = count_output.SumLength();
+      overall_size_ = count_output.SumLength();
       max_length = count_output.MaxLength();
       output_ = nullptr;
     }
@@ -468,21 +566,26 @@ class Hprof : public SingleRootVisitor {
     visited_objects_.clear();
     if (direct_to_ddms_) {
       if (kDirectStream) {
-        okay = DumpToDdmsDirect(overall_size, max_length, CHUNK_TYPE("HPDS"));
+        okay = DumpToDdmsDirect(overall_size_, max_length, CHUNK_TYPE("HPDS"));
       } else {
-        okay = DumpToDdmsBuffered(overall_size, max_length);
+        okay = DumpToDdmsBuffered(overall_size_, max_length);
       }
     } else {
-      okay = DumpToFile(overall_size, max_length);
+      okay = DumpToFile(overall_size_, max_length);
     }
+    return okay;
+  }
 
-    if (okay) {
-      const uint64_t duration = NanoTime() - start_ns_;
-      LOG(INFO) << "hprof: heap dump completed (" << PrettySize(RoundUp(overall_size, KB))
-                << ") in " << PrettyDuration(duration)
-                << " objects " << total_objects_
-                << " objects with stack traces " << total_objects_with_stack_trace_;
-    }
+  void LogCompletion() {
+    const uint64_t duration = NanoTime() - start_ns_;
+    LOG(INFO) << "hprof: heap dump completed (" << PrettySize(RoundUp(overall_size_, KB))
+              << ") in " << PrettyDuration(duration)
+              << " objects " << total_objects_
+              << " objects with stack traces " << total_objects_with_stack_trace_;
+  }
+
+  const std::string& GetErrorMessage() const {
+    return error_msg_;
   }
 
  private:
@@ -764,14 +867,15 @@ class Hprof : public SingleRootVisitor {
     if (fd_ >= 0) {
       out_fd = dup(fd_);
       if (out_fd < 0) {
-        ThrowRuntimeException("Couldn't dump heap; dup(%d) failed: %s", fd_, strerror(errno));
+        error_msg_ = android::base::StringPrintf("Couldn't dump heap; dup(%d) failed: %s",
+                                                 fd_, strerror(errno));
         return false;
       }
     } else {
       out_fd = open(filename_.c_str(), O_WRONLY|O_CREAT|O_TRUNC, 0644);
       if (out_fd < 0) {
-        ThrowRuntimeException("Couldn't dump heap; open(\"%s\") failed: %s", filename_.c_str(),
-                              strerror(errno));
+        error_msg_ = android::base::StringPrintf("Couldn't dump heap; open(\"%s\") failed: %s",
+                                                 filename_.c_str(), strerror(errno));
         return false;
       }
     }
@@ -779,9 +883,10 @@ class Hprof : public SingleRootVisitor {
     std::unique_ptr<File> file(new File(out_fd, filename_, true));
     bool okay;
     {
-      FileEndianOutput file_output(file.get(), max_length);
+      FileEndianOutput file_output(file.get(), max_length, compress_);
       output_ = &file_output;
       ProcessHeap(true);
+      file_output.Finish();
       okay = !file_output.Errors();
 
       if (okay) {
@@ -798,11 +903,9 @@ class Hprof : public SingleRootVisitor {
       file->Erase();
     }
     if (!okay) {
-      std::string msg(android::base::StringPrintf("Couldn't dump heap; writing \"%s\" failed: %s",
-                                                  filename_.c_str(),
-                                                  strerror(errno)));
-      ThrowRuntimeException("%s", msg.c_str());
-      LOG(ERROR) << msg;
+      error_msg_ = android::base::StringPrintf("Couldn't dump heap; writing \"%s\" failed: %s",
+                                               filename_.c_str(),
+                                               strerror(errno));
     }
 
     return okay;
@@ -885,8 +988,12 @@ class Hprof : public SingleRootVisitor {
   std::string filename_;
   int fd_;
   bool direct_to_ddms_;
+  // Whether the file output is gzip compressed.
+  bool compress_;
 
   uint64_t start_ns_ = NanoTime();
+  size_t overall_size_ = 0u;
+  std::string error_msg_;
 
   EndianOutput* output_ = nullptr;
 
@@ -1603,6 +1710,163 @@ void Hprof::VisitRoot(mirror::Object* obj, const RootInfo& info) {
   MarkRootObject(obj, 0, xlate[info.GetType()], info.GetThreadId());
 }
 
+// How long the parent waits for the forked child to dump the heap before killing it and dumping
+// the heap in process.
+static constexpr uint64_t kForkDumpTimeoutMs = 3 * 60 * 1000;
+static constexpr useconds_t kForkDumpPollUs = 10 * 1000;
+
+// The locks that Hprof::Dump takes, held by the dumping thread across fork() so that no other
+// thread, which does not exist in the child, holds one of them when the child is created. Both
+// processes release them after forking. Ordered by decreasing lock level. The JIT code cache lock
+// is taken by the method header lookups of stack walks, and may be held by the JIT thread while
+// it is suspended. The class table locks are checked instead, see ForkAndDumpHeap.
+static std::vector<BaseMutex*> GetForkDumpLocks() {
+  std::vector<BaseMutex*> locks = {
+    Locks::heap_bitmap_lock_,
+    Locks::alloc_tracker_lock_,
+    Locks::thread_list_lock_,
+    Locks::breakpoint_lock_,
+  };
+  jit::Jit* jit = Runtime::Current()->GetJit();
+  if (jit != nullptr) {
+    locks.push_back(jit->GetCodeCache()->GetLock());
+  }
+  locks.insert(locks.end(), {
+    Locks::classlinker_classes_lock_,
+    Locks::dex_lock_,
+    Locks::intern_table_lock_,
+    Locks::jni_globals_lock_,
+    Locks::jni_weak_globals_lock_,
+  });
+  return locks;
+}
+
+static void AcquireForkDumpLocks(Thread* self, const std::vector<BaseMutex*>& locks)
+    NO_THREAD_SAFETY_ANALYSIS {
+  for (BaseMutex* lock : locks) {
+    if (lock->IsReaderWriterMutex()) {
+      down_cast<ReaderWriterMutex*>(lock)->ExclusiveLock(self);
+    } else {
+      down_cast<Mutex*>(lock)->ExclusiveLock(self);
+    }
+  }
+}
+
+static void ReleaseForkDumpLocks(Thread* self, const std::vector<BaseMutex*>& locks)
+    NO_THREAD_SAFETY_ANALYSIS {
+  for (auto it = locks.rbegin(); it != locks.rend(); ++it) {
+    if ((*it)->IsReaderWriterMutex()) {
+      down_cast<ReaderWriterMutex*>(*it)->ExclusiveUnlock(self);
+    } else {
+      down_cast<Mutex*>(*it)->ExclusiveUnlock(self);
+    }
+  }
+}
+
+// Dump the heap to a file from a forked child process, which walks a copy-on-write snapshot of
+// the heap, so that the other threads are only suspended while forking. Returns false if the
+// heap should be dumped in process instead, because the child process could not be created or
+// did not finish in time.
+static bool ForkAndDumpHeap(Thread* self, const char* filename, int fd, bool compress) {
+  // A child which timed out may have written part of the dump.
+  const off_t fd_offset = (fd >= 0) ? lseek(fd, 0, SEEK_CUR) : 0;
+  if (fd_offset < 0) {
+    // The dump can't be rewound if the child times out.
+    return false;
+  }
+  int error_pipe[2];
+  if (pipe2(error_pipe, O_CLOEXEC) != 0) {
+    PLOG(WARNING) << "hprof: pipe failed, dumping the heap in process";
+    return false;
+  }
+  const uint64_t start_ns = NanoTime();
+  pid_t pid;
+  bool class_table_locked = false;
+  {
+    gc::ScopedGCCriticalSection gcs(self,
+                                    gc::kGcCauseHprof,
+                                    gc::kCollectorTypeHprof);
+    ScopedSuspendAll ssa(__FUNCTION__);
+    Hprof hprof(filename, fd, false, compress);
+    const std::vector<BaseMutex*> locks = GetForkDumpLocks();
+    AcquireForkDumpLocks(self, locks);
+    // There is one class table lock per class loader, all at the same level, so they can't be
+    // held together. Class tables are only locked by runnable threads, which normally release
+    // the locks before they suspend. If one is held anyway, the child would wait for it forever.
+    Locks::classlinker_classes_lock_->AssertExclusiveHeld(self);
+    class_table_locked = Runtime::Current()->GetClassLinker()->IsAnyClassTableLocked();
+    pid = class_table_locked ? -1 : fork();
+    ReleaseForkDumpLocks(self, locks);
+    if (pid == 0) {
+      // Only this thread exists in the child. It keeps the mutator lock and the GC critical
+      // section, so the snapshot does not change. It must not log since another thread may have
+      // held the logging lock when forking, the parent reports the result instead.
+      close(error_pipe[0]);
+      if (!hprof.Dump()) {
+        const std::string& error_msg = hprof.GetErrorMessage();
+        TEMP_FAILURE_RETRY(write(error_pipe[1], error_msg.data(), error_msg.size()));
+        _exit(1);
+      }
+      _exit(0);
+    }
+  }
+  close(error_pipe[1]);
+  if (class_table_locked) {
+    close(error_pipe[0]);
+    LOG(WARNING) << "hprof: a class table is locked, dumping the heap in process";
+    return false;
+  }
+  if (pid < 0) {
+    close(error_pipe[0]);
+    PLOG(WARNING) << "hprof: fork failed, dumping the heap in process";
+    return false;
+  }
+
+  std::string error_msg;
+  int status;
+  pid_t waited;
+  while ((waited = TEMP_FAILURE_RETRY(waitpid(pid, &status, WNOHANG))) == 0 &&
+         NanoTime() - start_ns < MsToNs(kForkDumpTimeoutMs)) {
+    usleep(kForkDumpPollUs);
+  }
+  if (waited == 0) {
+    kill(pid, SIGKILL);
+    TEMP_FAILURE_RETRY(waitpid(pid, &status, 0));
+    close(error_pipe[0]);
+    LOG(WARNING) << "hprof: process " << pid << " did not dump the heap in "
+                 << PrettyDuration(MsToNs(kForkDumpTimeoutMs)) << ", dumping the heap in process";
+    if (fd >= 0 && (lseek(fd, fd_offset, SEEK_SET) != fd_offset || ftruncate(fd, fd_offset) != 0)) {
+      error_msg = android::base::StringPrintf("Couldn't dump heap; rewinding fd %d failed: %s",
+                                              fd, strerror(errno));
+    } else {
+      return false;
+    }
+  } else {
+    // The child exited, read the error it reported, if any.
+    char buffer[256];
+    ssize_t bytes_read;
+    while ((bytes_read = TEMP_FAILURE_RETRY(read(error_pipe[0], buffer, sizeof(buffer)))) > 0) {
+      error_msg.append(buffer, bytes_read);
+    }
+    close(error_pipe[0]);
+    if (waited != pid) {
+      error_msg = android::base::StringPrintf("Couldn't dump heap; waitpid(%d) failed: %s",
+                                              pid, strerror(errno));
+    } else if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+      LOG(INFO) << "hprof: heap dump completed by process " << pid << " in "
+                << PrettyDuration(NanoTime() - start_ns);
+      return true;
+    } else if (error_msg.empty()) {
+      error_msg = android::base::StringPrintf(
+          "Couldn't dump heap; process %d failed with status %d", pid, status);
+    }
+  }
+  LOG(ERROR) << error_msg;
+  ScopedObjectAccess soa(self);
+  ThrowRuntimeException("%s", error_msg.c_str());
+  return true;
+}
+
 // If "direct_to_ddms" is true, the other arguments are ignored, and data is
 // sent directly to DDMS.
 // If "fd" is >= 0, the output will be written to that file descriptor.
@@ -1610,14 +1874,25 @@ void Hprof::VisitRoot(mirror::Object* obj, const RootInfo& info) {
 void DumpHeap(const char* filename, int fd, bool direct_to_ddms) {
   CHECK(filename != nullptr);
   Thread* self = Thread::Current();
+  Runtime* const runtime = Runtime::Current();
+  const bool compress = !direct_to_ddms && runtime->ShouldCompressHprof();
+  if (!direct_to_ddms && runtime->ShouldForkHprofDump() &&
+      ForkAndDumpHeap(self, filename, fd, compress)) {
+    return;
+  }
   // Need to take a heap dump while GC isn't running. See the comment in Heap::VisitObjects().
   // Also we need the critical section to avoid visiting the same object twice. See b/34967844
   gc::ScopedGCCriticalSection gcs(self,
                                   gc::kGcCauseHprof,
                                   gc::kCollectorTypeHprof);
   ScopedSuspendAll ssa(__FUNCTION__, true /* long suspend */);
-  Hprof hprof(filename, fd, direct_to_ddms);
-  hprof.Dump();
+  Hprof hprof(filename, fd, direct_to_ddms, compress);
+  if (hprof.Dump()) {
+    hprof.LogCompletion();
+  } else if (!hprof.GetErrorMessage().empty()) {
+    LOG(ERROR) << hprof.GetErrorMessage();
+    ThrowRuntimeException("%s", hprof.GetErrorMessage().c_str());
+  }
 }
 
 }  // namespace hprof
@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hprof.h"
+
+#include <cstring>
+#include <string>
+
+#include "android-base/file.h"
+#include "common_runtime_test.h"
+#include "scoped_thread_state_change-inl.h"
+
+namespace art {
+namespace hprof {
+
+static constexpr char kHprofMagic[] = "JAVA PROFILE 1.0.3";
+
+// Dumps the heap with -XX:HprofForkDump and -XX:HprofCompress set as given.
+class HprofTest : public CommonRuntimeTest {
+ protected:
+  HprofTest(bool fork_dump, bool compress) : fork_dump_(fork_dump), compress_(compress) {}
+
+  void SetUpRuntimeOptions(RuntimeOptions* options) OVERRIDE {
+    options->push_back(std::make_pair(fork_dump_ ? "-XX:HprofForkDump:true"
+                                                 : "-XX:HprofForkDump:false", nullptr));
+    options->push_back(std::make_pair(compress_ ? "-XX:HprofCompress:true"
+                                                : "-XX:HprofCompress:false", nullptr));
+  }
+
+  // Dumps the heap to a file and returns its content.
+  std::string DumpHeapToString() {
+    ScratchFile file;
+    DumpHeap(file.GetFilename().c_str(), /* fd */ -1, /* direct_to_ddms */ false);
+    {
+      ScopedObjectAccess soa(Thread::Current());
+      EXPECT_FALSE(soa.Self()->IsExceptionPending());
+    }
+    std::string content;
+    EXPECT_TRUE(android::base::ReadFileToString(file.GetFilename(), &content));
+    return content;
+  }
+
+  const bool fork_dump_;
+  const bool compress_;
+};
+
+class HprofForkTest : public HprofTest {
+ protected:
+  HprofForkTest() : HprofTest(/* fork_dump */ true, /* compress */ false) {}
+};
+
+class HprofCompressTest : public HprofTest {
+ protected:
+  HprofCompressTest() : HprofTest(/* fork_dump */ false, /* compress */ true) {}
+};
+
+class HprofForkCompressTest : public HprofTest {
+ protected:
+  HprofForkCompressTest() : HprofTest(/* fork_dump */ true, /* compress */ true) {}
+};
+
+TEST_F(HprofForkTest, DumpsFromChildProcess) {
+  ASSERT_TRUE(Runtime::Current()->ShouldForkHprofDump());
+  const std::string content = DumpHeapToString();
+  // The child wrote a complete uncompressed dump, and the parent is still here to check it.
+  ASSERT_GT(content.size(), sizeof(kHprofMagic));
+  EXPECT_EQ(0, memcmp(content.data(), kHprofMagic, sizeof(kHprofMagic)));
+}
+
+TEST_F(HprofCompressTest, WritesGzip) {
+  ASSERT_TRUE(Runtime::Current()->ShouldCompressHprof());
+  const std::string content = DumpHeapToString();
+  // A gzip member header with the deflate method.
+  ASSERT_GT(content.size(), 10u);
+  EXPECT_EQ(0x1f, static_cast<uint8_t>(content[0]));
+  EXPECT_EQ(0x8b, static_cast<uint8_t>(content[1]));
+  EXPECT_EQ(8, content[2]);
+}
+
+TEST_F(HprofForkCompressTest, WritesGzipFromChildProcess) {
+  const std::string content = DumpHeapToString();
+  ASSERT_GT(content.size(), 10u);
+  EXPECT_EQ(0x1f, static_cast<uint8_t>(content[0]));
+  EXPECT_EQ(0x8b, static_cast<uint8_t>(content[1]));
+  EXPECT_EQ(8, content[2]);
+}
+
+}  // namespace hprof
+}  // namespace art
@@ -37,7 +37,8 @@ namespace art {
 InternTable::InternTable()
     : log_new_roots_(false),
       weak_intern_condition_("New intern condition", *Locks::intern_table_lock_),
-      weak_root_state_(gc::kWeakRootStateNormal) {
+      weak_root_state_(gc::kWeakRootStateNormal),
+      weak_interns_swept_(false) {
 }
 
 size_t InternTable::Size() const {
@@ -195,13 +196,20 @@ void InternTable::BroadcastForNewInterns() {
   weak_intern_condition_.Broadcast(self);
 }
 
+bool InternTable::MayAccessWeakInterns(Thread* self) {
+  // The weak interns are usable again as soon as they are swept, without waiting for the GC to
+  // finish sweeping the other system weaks.
+  return weak_interns_swept_ ||
+      (!kUseReadBarrier && weak_root_state_ != gc::kWeakRootStateNoReadsOrWrites) ||
+      (kUseReadBarrier && self->GetWeakRefAccessEnabled());
+}
+
 void InternTable::WaitUntilAccessible(Thread* self) {
   Locks::intern_table_lock_->ExclusiveUnlock(self);
   {
     ScopedThreadSuspension sts(self, kWaitingWeakGcRootRead);
     MutexLock mu(self, *Locks::intern_table_lock_);
-    while ((!kUseReadBarrier && weak_root_state_ == gc::kWeakRootStateNoReadsOrWrites) ||
-           (kUseReadBarrier && !self->GetWeakRefAccessEnabled())) {
+    while (!MayAccessWeakInterns(self)) {
       weak_intern_condition_.Wait(self);
     }
   }
@@ -222,34 +230,25 @@ ObjPtr<mirror::String> InternTable::Insert(ObjPtr<mirror::String> s,
   }
   while (true) {
     if (holding_locks) {
-      if (!kUseReadBarrier) {
-        CHECK_EQ(weak_root_state_, gc::kWeakRootStateNormal);
-      } else {
-        CHECK(self->GetWeakRefAccessEnabled());
-      }
+      CHECK(MayAccessWeakInterns(self));
     }
     // Check the strong table for a match.
     ObjPtr<mirror::String> strong = LookupStrongLocked(s);
     if (strong != nullptr) {
       return strong;
     }
-    if ((!kUseReadBarrier && weak_root_state_ != gc::kWeakRootStateNoReadsOrWrites) ||
-        (kUseReadBarrier && self->GetWeakRefAccessEnabled())) {
+    if (MayAccessWeakInterns(self)) {
       break;
     }
-    // weak_root_state_ is set to gc::kWeakRootStateNoReadsOrWrites in the GC pause but is only
-    // cleared after SweepSystemWeaks has completed. This is why we need to wait until it is
-    // cleared.
+    // weak_root_state_ is set to gc::kWeakRootStateNoReadsOrWrites in the GC pause (and weak ref
+    // access disabled for CC) and the weak interns are only accessible again once they have been
+    // swept. This is why we need to wait.
     CHECK(!holding_locks);
     StackHandleScope<1> hs(self);
     auto h = hs.NewHandleWrapper(&s);
     WaitUntilAccessible(self);
   }
-  if (!kUseReadBarrier) {
-    CHECK_EQ(weak_root_state_, gc::kWeakRootStateNormal);
-  } else {
-    CHECK(self->GetWeakRefAccessEnabled());
-  }
+  CHECK(MayAccessWeakInterns(self));
   // There is no match in the strong table, check the weak table.
   ObjPtr<mirror::String> weak = LookupWeakLocked(s);
   if (weak != nullptr) {
@@ -299,8 +298,16 @@ bool InternTable::ContainsWeak(ObjPtr<mirror::String> s) {
 }
 
 void InternTable::SweepInternTableWeaks(IsMarkedVisitor* visitor) {
-  MutexLock mu(Thread::Current(), *Locks::intern_table_lock_);
+  Thread* const self = Thread::Current();
+  MutexLock mu(self, *Locks::intern_table_lock_);
   weak_interns_.SweepWeaks(visitor);
+  weak_interns_swept_ = true;
+  weak_intern_condition_.Broadcast(self);
+}
+
+void InternTable::MarkWeaksUnswept() {
+  MutexLock mu(Thread::Current(), *Locks::intern_table_lock_);
+  weak_interns_swept_ = false;
 }
 
 size_t InternTable::AddTableFromMemory(const uint8_t* ptr) {
@@ -492,6 +499,9 @@ void InternTable::ChangeWeakRootState(gc::WeakRootState new_state) {
 void InternTable::ChangeWeakRootStateLocked(gc::WeakRootState new_state) {
   CHECK(!kUseReadBarrier);
   weak_root_state_ = new_state;
+  if (new_state == gc::kWeakRootStateNoReadsOrWrites) {
+    weak_interns_swept_ = false;
+  }
   if (new_state != gc::kWeakRootStateNoReadsOrWrites) {
     weak_intern_condition_.Broadcast(Thread::Current());
   }
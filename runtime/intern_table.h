@@ -140,6 +140,10 @@ class InternTable {
   void ChangeWeakRootState(gc::WeakRootState new_state)
       REQUIRES(!Locks::intern_table_lock_);
 
+  // Called by the GC before it blocks weak accesses. The weak interns stay inaccessible until
+  // SweepInternTableWeaks has run.
+  void MarkWeaksUnswept() REQUIRES(!Locks::intern_table_lock_);
+
  private:
   // Modified UTF-8-encoded string treated as UTF16.
   class Utf8String {
@@ -266,6 +270,8 @@ class InternTable {
   void WaitUntilAccessible(Thread* self)
       REQUIRES(Locks::intern_table_lock_) REQUIRES_SHARED(Locks::mutator_lock_);
 
+  bool MayAccessWeakInterns(Thread* self) REQUIRES(Locks::intern_table_lock_);
+
   bool log_new_roots_ GUARDED_BY(Locks::intern_table_lock_);
   ConditionVariable weak_intern_condition_ GUARDED_BY(Locks::intern_table_lock_);
   // Since this contains (strong) roots, they need a read barrier to
@@ -281,6 +287,8 @@ class InternTable {
   Table weak_interns_ GUARDED_BY(Locks::intern_table_lock_);
   // Weak root state, used for concurrent system weak processing and more.
   gc::WeakRootState weak_root_state_ GUARDED_BY(Locks::intern_table_lock_);
+  // Whether the weak interns were swept since the GC last blocked weak accesses.
+  bool weak_interns_swept_ GUARDED_BY(Locks::intern_table_lock_);
 
   friend class Transaction;
   ART_FRIEND_TEST(InternTableTest, CrossHash);
@@ -464,6 +464,7 @@ JavaVMExt::JavaVMExt(Runtime* runtime,
                     IndirectReferenceTable::ResizableCapacity::kNo,
                     error_msg),
       allow_accessing_weak_globals_(true),
+      weak_globals_swept_(false),
       weak_globals_add_condition_("weak globals add condition",
                                   (CHECK(Locks::jni_weak_globals_lock_ != nullptr),
                                    *Locks::jni_weak_globals_lock_)),
@@ -678,9 +679,15 @@ void JavaVMExt::DisallowNewWeakGlobals() {
   // mutator lock exclusively held so that we don't have any threads in the middle of
   // DecodeWeakGlobal.
   Locks::mutator_lock_->AssertExclusiveHeld(self);
+  weak_globals_swept_.StoreSequentiallyConsistent(false);
   allow_accessing_weak_globals_.StoreSequentiallyConsistent(false);
 }
 
+void JavaVMExt::MarkWeakGlobalsUnswept() {
+  MutexLock mu(Thread::Current(), *Locks::jni_weak_globals_lock_);
+  weak_globals_swept_.StoreSequentiallyConsistent(false);
+}
+
 void JavaVMExt::AllowNewWeakGlobals() {
   CHECK(!kUseReadBarrier);
   Thread* self = Thread::Current();
@@ -710,9 +717,12 @@ inline bool JavaVMExt::MayAccessWeakGlobals(Thread* self) const {
 
 inline bool JavaVMExt::MayAccessWeakGlobalsUnlocked(Thread* self) const {
   DCHECK(self != nullptr);
-  return kUseReadBarrier ?
+  // Once swept, the table only holds live objects or the cleared sentinel, so it can be read
+  // while the GC is still sweeping the other system weaks.
+  return (kUseReadBarrier ?
       self->GetWeakRefAccessEnabled() :
-      allow_accessing_weak_globals_.LoadSequentiallyConsistent();
+      allow_accessing_weak_globals_.LoadSequentiallyConsistent()) ||
+      weak_globals_swept_.LoadSequentiallyConsistent();
 }
 
 ObjPtr<mirror::Object> JavaVMExt::DecodeWeakGlobal(Thread* self, IndirectRef ref) {
@@ -1015,6 +1025,8 @@ void JavaVMExt::SweepJniWeakGlobals(IsMarkedVisitor* visitor) {
       *entry = GcRoot<mirror::Object>(new_obj);
     }
   }
+  weak_globals_swept_.StoreSequentiallyConsistent(true);
+  weak_globals_add_condition_.Broadcast(Thread::Current());
 }
 
 void JavaVMExt::TrimGlobals() {
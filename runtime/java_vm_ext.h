@@ -138,6 +138,10 @@ class JavaVMExt : public JavaVM {
       REQUIRES(!Locks::jni_weak_globals_lock_);
   void BroadcastForNewWeakGlobals()
       REQUIRES(!Locks::jni_weak_globals_lock_);
+  // Called by the GC before it blocks weak accesses. The weak globals stay inaccessible until
+  // SweepJniWeakGlobals has run.
+  void MarkWeakGlobalsUnswept()
+      REQUIRES(!Locks::jni_weak_globals_lock_);
 
   jobject AddGlobalRef(Thread* self, ObjPtr<mirror::Object> obj)
       REQUIRES_SHARED(Locks::mutator_lock_)
@@ -240,6 +244,9 @@ class JavaVMExt : public JavaVM {
   IndirectReferenceTable weak_globals_;
   // Not guarded by weak_globals_lock since we may use SynchronizedGet in DecodeWeakGlobal.
   Atomic<bool> allow_accessing_weak_globals_;
+  // Whether weak_globals_ were swept since the GC last blocked weak accesses. Not guarded by
+  // weak_globals_lock for the same reason.
+  Atomic<bool> weak_globals_swept_;
   ConditionVariable weak_globals_add_condition_ GUARDED_BY(Locks::jni_weak_globals_lock_);
 
   // TODO Maybe move this to Runtime.
@@ -22,6 +22,7 @@
 #include "base/enums.h"
 #include "base/logging.h"
 #include "base/memory_tool.h"
+#include "base/time_utils.h"
 #include "debugger.h"
 #include "entrypoints/runtime_asm_entrypoints.h"
 #include "interpreter/interpreter.h"
@@ -158,6 +159,10 @@ void Jit::DumpInfo(std::ostream& os) {
 
 void Jit::DumpForSigQuit(std::ostream& os) {
   DumpInfo(os);
+  {
+    ScopedObjectAccess soa(Thread::Current());
+    code_cache_->DumpCompilationStats(os, kNumberOfMethodsInCompilationStatsDump);
+  }
   ProfileSaver::DumpInstanceInfo(os);
 }
 
@@ -187,6 +192,7 @@ Jit* Jit::Create(JitOptions* options, std::string* error_msg) {
       options->GetCodeCacheInitialCapacity(),
       options->GetCodeCacheMaxCapacity(),
       jit->generate_debug_info_,
+      Runtime::Current()->UseHugePages(),
       error_msg));
   if (jit->GetCodeCache() == nullptr) {
     return nullptr;
@@ -474,22 +480,21 @@ bool Jit::MaybeDoOnStackReplacement(Thread* thread,
 
   {
     ScopedAssertNoThreadSuspension sts("Holding OSR method");
-    const OatQuickMethodHeader* osr_method = jit->GetCodeCache()->LookupOsrMethodHeader(method);
+    // Find the OSR entry starting at the target dex_pc. The entry can be at the header of
+    // any loop of the method, including nested ones.
+    uint32_t stack_map_index = 0;
+    const OatQuickMethodHeader* osr_method =
+        jit->GetCodeCache()->LookupOsrEntry(method, dex_pc + dex_pc_offset, &stack_map_index);
     if (osr_method == nullptr) {
-      // No osr method yet, just return to the interpreter.
+      // No osr method yet, or no OSR stack map for this dex pc offset. Just return to the
+      // interpreter in the hope that the next branch has one.
       return false;
     }
 
     CodeInfo code_info = osr_method->GetOptimizedCodeInfo();
     CodeInfoEncoding encoding = code_info.ExtractEncoding();
-
-    // Find stack map starting at the target dex_pc.
-    StackMap stack_map = code_info.GetOsrStackMapForDexPc(dex_pc + dex_pc_offset, encoding);
-    if (!stack_map.IsValid()) {
-      // There is no OSR stack map for this dex pc offset. Just return to the interpreter in the
-      // hope that the next branch has one.
-      return false;
-    }
+    StackMap stack_map = code_info.GetStackMapAt(stack_map_index, encoding);
+    DCHECK(stack_map.IsValid());
 
     // Before allowing the jump, make sure the debugger is not active to avoid jumping from
     // interpreter to OSR while e.g. single stepping. Note that we could selectively disable
@@ -595,7 +600,8 @@ class JitCompileTask FINAL : public Task {
     kCompileOsr
   };
 
-  JitCompileTask(ArtMethod* method, TaskKind kind) : method_(method), kind_(kind) {
+  JitCompileTask(ArtMethod* method, TaskKind kind)
+      : method_(method), kind_(kind), enqueue_time_ns_(NanoTime()) {
     ScopedObjectAccess soa(Thread::Current());
     // Add a global ref to the class to prevent class unloading until compilation is done.
     klass_ = soa.Vm()->AddGlobalRef(soa.Self(), method_->GetDeclaringClass());
@@ -609,10 +615,14 @@ class JitCompileTask FINAL : public Task {
 
   void Run(Thread* self) OVERRIDE {
     ScopedObjectAccess soa(self);
-    if (kind_ == kCompile) {
-      Runtime::Current()->GetJit()->CompileMethod(method_, self, /* osr */ false);
-    } else if (kind_ == kCompileOsr) {
-      Runtime::Current()->GetJit()->CompileMethod(method_, self, /* osr */ true);
+    if (kind_ == kCompile || kind_ == kCompileOsr) {
+      bool osr = (kind_ == kCompileOsr);
+      uint64_t queue_wait_ns = NanoTime() - enqueue_time_ns_;
+      Jit* jit = Runtime::Current()->GetJit();
+      if (jit->CompileMethod(method_, self, osr)) {
+        jit->GetCodeCache()->AddCompilationQueueWait(
+            method_->GetInterfaceMethodIfProxy(kRuntimePointerSize), osr, queue_wait_ns);
+      }
     } else {
       DCHECK(kind_ == kAllocateProfile);
       if (ProfilingInfo::Create(self, method_, /* retry_allocation */ true)) {
@@ -629,6 +639,7 @@ class JitCompileTask FINAL : public Task {
  private:
   ArtMethod* const method_;
   const TaskKind kind_;
+  const uint64_t enqueue_time_ns_;
   jobject klass_;
 
   DISALLOW_IMPLICIT_CONSTRUCTORS(JitCompileTask);
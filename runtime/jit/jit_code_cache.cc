@@ -16,6 +16,9 @@
 
 #include "jit_code_cache.h"
 
+#include <algorithm>
+#include <functional>
+#include <set>
 #include <sstream>
 
 #include "arch/context.h"
@@ -63,6 +66,7 @@ static constexpr size_t kStackMapSizeLogThreshold = 50 * KB;
 JitCodeCache* JitCodeCache::Create(size_t initial_capacity,
                                    size_t max_capacity,
                                    bool generate_debug_info,
+                                   bool use_huge_pages,
                                    std::string* error_msg) {
   ScopedTrace trace(__PRETTY_FUNCTION__);
   CHECK_GE(max_capacity, initial_capacity);
@@ -70,7 +74,8 @@ JitCodeCache* JitCodeCache::Create(size_t initial_capacity,
   // Generating debug information is for using the Linux perf tool on
   // host which does not work with ashmem.
   // Also, target linux does not support ashmem.
-  bool use_ashmem = !generate_debug_info && !kIsTargetLinux;
+  // Ashmem regions do not get transparent huge pages either.
+  bool use_ashmem = !generate_debug_info && !kIsTargetLinux && !use_huge_pages;
 
   // With 'perf', we want a 1-1 mapping between an address and a method.
   bool garbage_collect_code = !generate_debug_info;
@@ -127,6 +132,16 @@ JitCodeCache* JitCodeCache::Create(size_t initial_capacity,
     return nullptr;
   }
   DCHECK_EQ(code_map->Begin(), divider);
+  if (use_huge_pages) {
+    // The maps are not aligned to huge pages since they have to be in the low 4GB, so only their
+    // aligned parts are advised. This is fine for the default capacity of tens of megabytes.
+    // Advise both maps even if the first one fails.
+    const bool data_advised = data_map->AdviseHugePages();
+    const bool code_advised = code_map->AdviseHugePages();
+    if (!data_advised || !code_advised) {
+      LOG(WARNING) << "Could not back the JIT code cache with huge pages";
+    }
+  }
   data_size = initial_capacity / 2;
   code_size = initial_capacity - data_size;
   DCHECK_EQ(code_size + data_size, initial_capacity);
@@ -157,6 +172,10 @@ JitCodeCache::JitCodeCache(MemMap* code_map,
       number_of_compilations_(0),
       number_of_osr_compilations_(0),
       number_of_collections_(0),
+      total_compilation_time_ns_(0),
+      total_compilation_queue_wait_ns_(0),
+      total_compiled_code_size_(0),
+      total_number_of_deoptimizations_(0),
       histogram_stack_map_memory_use_("Memory used for stack maps", 16),
       histogram_code_memory_use_("Memory used for compiled code", 16),
       histogram_profiling_info_memory_use_("Memory used for profiling info", 16),
@@ -414,6 +433,8 @@ void JitCodeCache::FreeCode(const void* code_ptr) {
   // Notify native debugger that we are about to remove the code.
   // It does nothing if we are not using native debugger.
   DeleteJITCodeEntryForAddress(reinterpret_cast<uintptr_t>(code_ptr));
+  osr_entry_map_.erase(code_ptr);
+  compilation_stats_.erase(code_ptr);
   FreeData(GetRootTable(code_ptr));
   FreeCode(reinterpret_cast<uint8_t*>(allocation));
 }
@@ -1270,6 +1291,49 @@ OatQuickMethodHeader* JitCodeCache::LookupOsrMethodHeader(ArtMethod* method) {
   return OatQuickMethodHeader::FromCodePointer(it->second);
 }
 
+OatQuickMethodHeader* JitCodeCache::LookupOsrEntry(ArtMethod* method,
+                                                   uint32_t dex_pc,
+                                                   uint32_t* stack_map_index) {
+  MutexLock mu(Thread::Current(), lock_);
+  auto it = osr_code_map_.find(method);
+  if (it == osr_code_map_.end()) {
+    return nullptr;
+  }
+  OatQuickMethodHeader* method_header = OatQuickMethodHeader::FromCodePointer(it->second);
+  auto entries_it = osr_entry_map_.find(it->second);
+  if (entries_it == osr_entry_map_.end()) {
+    // Index the OSR entries: an OSR entry is a stack map duplicated at the same dex pc and
+    // native pc, see CodeGenerator::RecordPcInfo.
+    std::vector<std::pair<uint32_t, uint32_t>> entries;
+    CodeInfo code_info = method_header->GetOptimizedCodeInfo();
+    CodeInfoEncoding encoding = code_info.ExtractEncoding();
+    const StackMapEncoding& stack_map_encoding = encoding.stack_map.encoding;
+    size_t number_of_stack_maps = code_info.GetNumberOfStackMaps(encoding);
+    for (size_t i = 0; i + 1 < number_of_stack_maps; ++i) {
+      StackMap stack_map = code_info.GetStackMapAt(i, encoding);
+      StackMap other = code_info.GetStackMapAt(i + 1, encoding);
+      uint32_t stack_map_dex_pc = stack_map.GetDexPc(stack_map_encoding);
+      if (other.GetDexPc(stack_map_encoding) == stack_map_dex_pc &&
+          other.GetNativePcOffset(stack_map_encoding, kRuntimeISA) ==
+              stack_map.GetNativePcOffset(stack_map_encoding, kRuntimeISA)) {
+        entries.emplace_back(stack_map_dex_pc, static_cast<uint32_t>(i));
+        ++i;
+      }
+    }
+    std::sort(entries.begin(), entries.end());
+    entries_it = osr_entry_map_.Put(it->second, std::move(entries));
+  }
+  const std::vector<std::pair<uint32_t, uint32_t>>& entries = entries_it->second;
+  auto entry = std::lower_bound(entries.begin(),
+                                entries.end(),
+                                std::make_pair(dex_pc, 0u));
+  if (entry == entries.end() || entry->first != dex_pc) {
+    return nullptr;
+  }
+  *stack_map_index = entry->second;
+  return method_header;
+}
+
 ProfilingInfo* JitCodeCache::AddProfilingInfo(Thread* self,
                                               ArtMethod* method,
                                               const std::vector<uint32_t>& entries,
@@ -1491,6 +1555,15 @@ size_t JitCodeCache::GetMemorySizeOfCodePointer(const void* ptr) {
 
 void JitCodeCache::InvalidateCompiledCodeFor(ArtMethod* method,
                                              const OatQuickMethodHeader* header) {
+  {
+    MutexLock mu(Thread::Current(), lock_);
+    total_number_of_deoptimizations_++;
+    auto stats_it = compilation_stats_.find(header->GetCode());
+    if (stats_it != compilation_stats_.end()) {
+      stats_it->second.number_of_deoptimizations++;
+    }
+  }
+
   ProfilingInfo* profiling_info = method->GetProfilingInfo(kRuntimePointerSize);
   if ((profiling_info != nullptr) &&
       (profiling_info->GetSavedEntryPoint() == header->GetEntryPoint())) {
@@ -1556,5 +1629,132 @@ void JitCodeCache::Dump(std::ostream& os) {
   histogram_profiling_info_memory_use_.PrintMemoryUse(os);
 }
 
+// Returns the number of distinct methods inlined into the given optimized code.
+static size_t CountInlinedMethods(const OatQuickMethodHeader* method_header) {
+  CodeInfo code_info = method_header->GetOptimizedCodeInfo();
+  CodeInfoEncoding encoding = code_info.ExtractEncoding();
+  if (!code_info.HasInlineInfo(encoding)) {
+    return 0;
+  }
+  const InlineInfoEncoding& inline_info_encoding = encoding.inline_info.encoding;
+  std::set<uintptr_t> inlined_methods;
+  for (size_t i = 0, e = code_info.GetNumberOfStackMaps(encoding); i < e; ++i) {
+    StackMap stack_map = code_info.GetStackMapAt(i, encoding);
+    if (!stack_map.HasInlineInfo(encoding.stack_map.encoding)) {
+      continue;
+    }
+    InlineInfo inline_info = code_info.GetInlineInfoOf(stack_map, encoding);
+    for (uint32_t depth = 0; depth < inline_info.GetDepth(inline_info_encoding); ++depth) {
+      // ArtMethod pointers are aligned, so tag method indices with the low bit.
+      if (inline_info.EncodesArtMethodAtDepth(inline_info_encoding, depth)) {
+        inlined_methods.insert(reinterpret_cast<uintptr_t>(
+            inline_info.GetArtMethodAtDepth(inline_info_encoding, depth)));
+      } else {
+        uintptr_t index = inline_info.GetMethodIndexIdxAtDepth(inline_info_encoding, depth);
+        inlined_methods.insert((index << 1) | 1u);
+      }
+    }
+  }
+  return inlined_methods.size();
+}
+
+void JitCodeCache::AddCompilationStats(
+    const void* code_ptr,
+    const JitCompilationStats& stats,
+    const std::vector<std::pair<const char*, uint64_t>>& pass_timings) {
+  JitCompilationStats method_stats = stats;
+  method_stats.number_of_inlined_methods =
+      CountInlinedMethods(OatQuickMethodHeader::FromCodePointer(code_ptr));
+  for (const std::pair<const char*, uint64_t>& pass_timing : pass_timings) {
+    if (pass_timing.second > method_stats.slowest_pass_time_ns) {
+      method_stats.slowest_pass = pass_timing.first;
+      method_stats.slowest_pass_time_ns = pass_timing.second;
+    }
+  }
+
+  MutexLock mu(Thread::Current(), lock_);
+  total_compilation_time_ns_ += method_stats.compile_time_ns;
+  total_compiled_code_size_ += method_stats.code_size;
+  for (const std::pair<const char*, uint64_t>& pass_timing : pass_timings) {
+    total_pass_time_ns_.FindOrAdd(pass_timing.first, 0u)->second += pass_timing.second;
+  }
+  // Only keep the statistics of code still in the cache.
+  if (method_code_map_.find(code_ptr) != method_code_map_.end()) {
+    compilation_stats_.Overwrite(code_ptr, method_stats);
+  }
+}
+
+void JitCodeCache::AddCompilationQueueWait(ArtMethod* method, bool osr, uint64_t queue_wait_ns) {
+  MutexLock mu(Thread::Current(), lock_);
+  total_compilation_queue_wait_ns_ += queue_wait_ns;
+  const void* code_ptr = nullptr;
+  if (osr) {
+    auto it = osr_code_map_.find(method);
+    if (it != osr_code_map_.end()) {
+      code_ptr = it->second;
+    }
+  } else {
+    const void* entry_point = method->GetEntryPointFromQuickCompiledCode();
+    if (ContainsPc(entry_point)) {
+      code_ptr = OatQuickMethodHeader::FromEntryPoint(entry_point)->GetCode();
+    }
+  }
+  auto stats_it = compilation_stats_.find(code_ptr);
+  if (stats_it != compilation_stats_.end()) {
+    stats_it->second.queue_wait_ns = queue_wait_ns;
+  }
+}
+
+void JitCodeCache::DumpCompilationStats(std::ostream& os, size_t max_methods) {
+  MutexLock mu(Thread::Current(), lock_);
+  os << "Total JIT compilation time: " << PrettyDuration(total_compilation_time_ns_) << "\n"
+     << "Total JIT compilation queue wait time: "
+        << PrettyDuration(total_compilation_queue_wait_ns_) << "\n"
+     << "Total JIT compiled code size: " << PrettySize(total_compiled_code_size_) << "\n"
+     << "Total number of JIT code deoptimizations: " << total_number_of_deoptimizations_ << "\n";
+  if (!total_pass_time_ns_.empty()) {
+    std::vector<std::pair<uint64_t, const std::string*>> passes;
+    for (const auto& it : total_pass_time_ns_) {
+      passes.emplace_back(it.second, &it.first);
+    }
+    std::sort(passes.rbegin(), passes.rend());
+    os << "JIT compilation time per pass:\n";
+    for (const auto& pass : passes) {
+      os << "  " << *pass.second << ": " << PrettyDuration(pass.first) << "\n";
+    }
+  }
+
+  std::vector<std::pair<uint64_t, const void*>> methods;
+  for (const auto& it : compilation_stats_) {
+    methods.emplace_back(it.second.compile_time_ns, it.first);
+  }
+  size_t number_of_methods = std::min(max_methods, methods.size());
+  std::partial_sort(methods.begin(),
+                    methods.begin() + number_of_methods,
+                    methods.end(),
+                    std::greater<std::pair<uint64_t, const void*>>());
+  if (number_of_methods != 0) {
+    os << "Most expensive JIT compilations in the code cache:\n";
+  }
+  for (size_t i = 0; i < number_of_methods; ++i) {
+    const void* code_ptr = methods[i].second;
+    const JitCompilationStats& stats = compilation_stats_.find(code_ptr)->second;
+    auto method_it = method_code_map_.find(code_ptr);
+    DCHECK(method_it != method_code_map_.end());
+    os << "  " << method_it->second->PrettyMethod()
+       << (stats.osr ? " (osr)" : "")
+       << " compile=" << PrettyDuration(stats.compile_time_ns)
+       << " queue-wait=" << PrettyDuration(stats.queue_wait_ns)
+       << " code-size=" << stats.code_size
+       << " inlined=" << stats.number_of_inlined_methods
+       << " deopts=" << stats.number_of_deoptimizations;
+    if (!stats.slowest_pass.empty()) {
+      os << " slowest-pass=" << stats.slowest_pass
+         << ":" << PrettyDuration(stats.slowest_pass_time_ns);
+    }
+    os << "\n";
+  }
+}
+
 }  // namespace jit
 }  // namespace art
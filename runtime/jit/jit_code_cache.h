@@ -50,6 +50,22 @@ class JitInstrumentationCache;
 static constexpr int kJitCodeAlignment = 16;
 using CodeCacheBitmap = gc::accounting::MemoryRangeBitmap<kJitCodeAlignment>;
 
+// Cost of a JIT compilation and what it produced, kept while the code is in the cache.
+struct JitCompilationStats {
+  // Time the compilation request waited in the JIT thread pool.
+  uint64_t queue_wait_ns = 0;
+  // Time spent in the compiler, and the optimization pass that took most of it.
+  uint64_t compile_time_ns = 0;
+  std::string slowest_pass;
+  uint64_t slowest_pass_time_ns = 0;
+  size_t code_size = 0;
+  // Number of distinct methods inlined into the compiled code.
+  size_t number_of_inlined_methods = 0;
+  // Number of times the compiled code explicitly deoptimized.
+  size_t number_of_deoptimizations = 0;
+  bool osr = false;
+};
+
 class JitCodeCache {
  public:
   static constexpr size_t kMaxCapacity = 64 * MB;
@@ -61,15 +77,22 @@ class JitCodeCache {
   static constexpr size_t kReservedCapacity = kInitialCapacity * 4;
 
   // Create the code cache with a code + data capacity equal to "capacity", error message is passed
-  // in the out arg error_msg.
+  // in the out arg error_msg. If use_huge_pages is true, the code and data maps are advised to use
+  // transparent huge pages.
   static JitCodeCache* Create(size_t initial_capacity,
                               size_t max_capacity,
                               bool generate_debug_info,
+                              bool use_huge_pages,
                               std::string* error_msg);
 
   // Number of bytes allocated in the code cache.
   size_t CodeCacheSize() REQUIRES(!lock_);
 
+  // For the forked heap dump, which holds the lock across fork() since stack walks take it.
+  Mutex* GetLock() RETURN_CAPABILITY(lock_) {
+    return &lock_;
+  }
+
   // Number of bytes allocated in the data cache.
   size_t DataCacheSize() REQUIRES(!lock_);
 
@@ -171,6 +194,17 @@ class JitCodeCache {
       REQUIRES(!lock_)
       REQUIRES_SHARED(Locks::mutator_lock_);
 
+  // Find the OSR entry of 'method' at 'dex_pc'. Returns the OSR method header and sets
+  // 'stack_map_index' to the index of the entry's stack map, or returns null if the method
+  // has no OSR code or the code has no entry at 'dex_pc'. The entries of each OSR method
+  // are indexed on first lookup, so that repeated lookups from hot loops do not walk all
+  // stack maps. The caller must not suspend while holding the returned header.
+  OatQuickMethodHeader* LookupOsrEntry(ArtMethod* method,
+                                       uint32_t dex_pc,
+                                       /*out*/ uint32_t* stack_map_index)
+      REQUIRES(!lock_)
+      REQUIRES_SHARED(Locks::mutator_lock_);
+
   // Removes method from the cache for testing purposes. The caller
   // must ensure that all threads are suspended and the method should
   // not be in any thread's stack.
@@ -223,6 +257,24 @@ class JitCodeCache {
 
   void Dump(std::ostream& os) REQUIRES(!lock_);
 
+  // Record the cost of compiling the code at 'code_ptr'. 'pass_timings' holds the time spent
+  // in each optimization pass, and is also accumulated into per-pass totals.
+  void AddCompilationStats(const void* code_ptr,
+                           const JitCompilationStats& stats,
+                           const std::vector<std::pair<const char*, uint64_t>>& pass_timings)
+      REQUIRES(!lock_)
+      REQUIRES_SHARED(Locks::mutator_lock_);
+
+  // Record how long the compilation of 'method' that just completed waited in the queue.
+  void AddCompilationQueueWait(ArtMethod* method, bool osr, uint64_t queue_wait_ns)
+      REQUIRES(!lock_)
+      REQUIRES_SHARED(Locks::mutator_lock_);
+
+  // Dump the totals and the 'max_methods' most expensive compilations still in the cache.
+  void DumpCompilationStats(std::ostream& os, size_t max_methods)
+      REQUIRES(!lock_)
+      REQUIRES_SHARED(Locks::mutator_lock_);
+
   bool IsOsrCompiled(ArtMethod* method) REQUIRES(!lock_);
 
   void SweepRootTables(IsMarkedVisitor* visitor)
@@ -355,6 +407,10 @@ class JitCodeCache {
   SafeMap<const void*, ArtMethod*> method_code_map_ GUARDED_BY(lock_);
   // Holds osr compiled code associated to the ArtMethod.
   SafeMap<ArtMethod*, const void*> osr_code_map_ GUARDED_BY(lock_);
+  // Holds, for osr compiled code, its OSR entries as (dex pc, stack map index) pairs
+  // sorted by dex pc. Populated lazily by LookupOsrEntry and dropped when the code is freed.
+  SafeMap<const void*, std::vector<std::pair<uint32_t, uint32_t>>> osr_entry_map_
+      GUARDED_BY(lock_);
   // ProfilingInfo objects we have allocated.
   std::vector<ProfilingInfo*> profiling_infos_ GUARDED_BY(lock_);
 
@@ -395,6 +451,16 @@ class JitCodeCache {
   // Number of code cache collections done throughout the lifetime of the JIT.
   size_t number_of_collections_ GUARDED_BY(lock_);
 
+  // Compilation statistics of the code currently in the cache.
+  SafeMap<const void*, JitCompilationStats> compilation_stats_ GUARDED_BY(lock_);
+
+  // Compilation totals throughout the lifetime of the JIT, including freed code.
+  uint64_t total_compilation_time_ns_ GUARDED_BY(lock_);
+  uint64_t total_compilation_queue_wait_ns_ GUARDED_BY(lock_);
+  size_t total_compiled_code_size_ GUARDED_BY(lock_);
+  size_t total_number_of_deoptimizations_ GUARDED_BY(lock_);
+  SafeMap<std::string, uint64_t> total_pass_time_ns_ GUARDED_BY(lock_);
+
   // Histograms for keeping track of stack map size statistics.
   Histogram<uint64_t> histogram_stack_map_memory_use_ GUARDED_BY(lock_);
 
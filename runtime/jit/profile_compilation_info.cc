@@ -17,11 +17,14 @@
 #include "profile_compilation_info.h"
 
 #include "errno.h"
+#include <algorithm>
 #include <limits.h>
+#include <set>
 #include <string>
 #include <vector>
 #include <stdlib.h>
 #include <sys/file.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/uio.h>
 #include <sys/types.h>
@@ -39,6 +42,7 @@
 #include "base/systrace.h"
 #include "base/unix_file/fd_file.h"
 #include "jit/profiling_info.h"
+#include "memory_region.h"
 #include "os.h"
 #include "safe_map.h"
 #include "utils.h"
@@ -49,6 +53,8 @@ namespace art {
 const uint8_t ProfileCompilationInfo::kProfileMagic[] = { 'p', 'r', 'o', '\0' };
 // Last profile version: update the multidex separator.
 const uint8_t ProfileCompilationInfo::kProfileVersion[] = { '0', '0', '9', '\0' };
+// Uncompressed, offset indexed version of the format which can be mmapped and queried in place.
+const uint8_t ProfileCompilationInfo::kProfileMappedVersion[] = { '0', '1', '0', '\0' };
 
 static constexpr uint16_t kMaxDexFileKeyLength = PATH_MAX;
 
@@ -75,14 +81,18 @@ ProfileCompilationInfo::ProfileCompilationInfo(ArenaPool* custom_arena_pool)
     : default_arena_pool_(),
       arena_(custom_arena_pool),
       info_(arena_.Adapter(kArenaAllocProfile)),
-      profile_key_map_(std::less<const std::string>(), arena_.Adapter(kArenaAllocProfile)) {
+      profile_key_map_(std::less<const std::string>(), arena_.Adapter(kArenaAllocProfile)),
+      number_of_journal_entries_(0u),
+      has_truncated_journal_entry_(false) {
 }
 
 ProfileCompilationInfo::ProfileCompilationInfo()
     : default_arena_pool_(/*use_malloc*/true, /*low_4gb*/false, "ProfileCompilationInfo"),
       arena_(&default_arena_pool_),
       info_(arena_.Adapter(kArenaAllocProfile)),
-      profile_key_map_(std::less<const std::string>(), arena_.Adapter(kArenaAllocProfile)) {
+      profile_key_map_(std::less<const std::string>(), arena_.Adapter(kArenaAllocProfile)),
+      number_of_journal_entries_(0u),
+      has_truncated_journal_entry_(false) {
 }
 
 ProfileCompilationInfo::~ProfileCompilationInfo() {
@@ -254,6 +264,51 @@ bool ProfileCompilationInfo::Save(const std::string& filename, uint64_t* bytes_w
   return result;
 }
 
+bool ProfileCompilationInfo::Append(const std::string& filename, uint64_t* bytes_written) {
+  ScopedTrace trace(__PRETTY_FUNCTION__);
+  std::string error;
+  // Read access is needed to check the format of the existing profile.
+  int flags = O_RDWR | O_NOFOLLOW | O_CLOEXEC;
+  ScopedFlock profile_file = LockedFile::Open(filename.c_str(), flags,
+                                              /*block*/false, &error);
+  if (profile_file.get() == nullptr) {
+    LOG(WARNING) << "Couldn't lock the profile file " << filename << ": " << error;
+    return false;
+  }
+
+  int fd = profile_file->Fd();
+  off_t old_size = lseek(fd, 0, SEEK_END);
+  if (old_size == static_cast<off_t>(-1)) {
+    PLOG(WARNING) << "Could not seek to the end of profile file: " << filename;
+    return false;
+  }
+  // Journal entries are regular profiles. Mapped profiles have a fixed layout and cannot
+  // be appended to.
+  if (old_size != 0) {
+    if (lseek(fd, 0, SEEK_SET) != 0 ||
+        IsMappedProfile(fd) ||
+        lseek(fd, 0, SEEK_END) != old_size) {
+      LOG(WARNING) << "Cannot append profile data to " << filename;
+      return false;
+    }
+  }
+
+  bool result = Save(fd);
+  if (result) {
+    int64_t size = GetFileSizeBytes(filename);
+    if (size != -1) {
+      VLOG(profiler) << "Successfully appended profile info to " << filename
+                     << " Size: " << size;
+      if (bytes_written != nullptr) {
+        *bytes_written = static_cast<uint64_t>(size - old_size);
+      }
+    }
+  } else {
+    VLOG(profiler) << "Failed to append profile info to " << filename;
+  }
+  return result;
+}
+
 // Returns true if all the bytes were successfully written to the file descriptor.
 static bool WriteBuffer(int fd, const uint8_t* buffer, size_t byte_count) {
   while (byte_count > 0) {
@@ -485,6 +540,116 @@ void ProfileCompilationInfo::AddInlineCacheToBuffer(std::vector<uint8_t>* buffer
   }
 }
 
+// Pad the buffer with zeros up to the next multiple of `alignment`.
+static void AlignBuffer(std::vector<uint8_t>* buffer, size_t alignment) {
+  buffer->resize(RoundUp(buffer->size(), alignment), 0u);
+}
+
+/**
+ * Mapped serialization format (see ProfileCompilationInfo::MappedProfile for the layout).
+ * Unlike the regular format nothing is compressed: the price is a bigger file, but readers
+ * can mmap it and look up methods and classes without parsing or allocating anything.
+ **/
+bool ProfileCompilationInfo::SaveMapped(int fd) {
+  uint64_t start = NanoTime();
+  ScopedTrace trace(__PRETTY_FUNCTION__);
+  DCHECK_GE(fd, 0);
+  using MappedHeader = MappedProfile::MappedHeader;
+  using MappedDexEntry = MappedProfile::MappedDexEntry;
+  using MappedMethodEntry = MappedProfile::MappedMethodEntry;
+
+  std::vector<MappedDexEntry> entries(info_.size());
+  // The variable size data which follows the header and the dex entries.
+  std::vector<uint8_t> data;
+  const size_t data_offset = sizeof(MappedHeader) + sizeof(MappedDexEntry) * info_.size();
+  for (const DexFileData* dex_data_ptr : info_) {
+    const DexFileData& dex_data = *dex_data_ptr;
+    if (dex_data.profile_key.size() >= kMaxDexFileKeyLength) {
+      LOG(WARNING) << "DexFileKey exceeds allocated limit";
+      return false;
+    }
+    MappedDexEntry& entry = entries[dex_data.profile_index];
+    entry.checksum = dex_data.checksum;
+    entry.num_method_ids = dex_data.num_method_ids;
+
+    entry.key_offset = data_offset + data.size();
+    entry.key_size = dex_data.profile_key.size();
+    AddStringToBuffer(&data, dex_data.profile_key);
+    AlignBuffer(&data, sizeof(uint32_t));
+
+    // Reserve the method table now; the inline cache offsets are patched in below once the
+    // encoded caches have been appended.
+    entry.methods_offset = data_offset + data.size();
+    entry.num_methods = dex_data.method_map.size();
+    const size_t methods_start = data.size();
+    data.resize(data.size() + sizeof(MappedMethodEntry) * entry.num_methods, 0u);
+
+    entry.classes_offset = data_offset + data.size();
+    entry.num_classes = dex_data.class_set.size();
+    for (const dex::TypeIndex& type_index : dex_data.class_set) {
+      AddUintToBuffer(&data, type_index.index_);
+    }
+    AlignBuffer(&data, sizeof(uint32_t));
+
+    entry.bitmap_offset = data_offset + data.size();
+    entry.bitmap_size = dex_data.bitmap_storage.size();
+    data.insert(data.end(), dex_data.bitmap_storage.begin(), dex_data.bitmap_storage.end());
+    AlignBuffer(&data, sizeof(uint32_t));
+
+    // The SafeMap is ordered by method index, which keeps the method table sorted.
+    size_t method_pos = 0;
+    for (const auto& method_it : dex_data.method_map) {
+      MappedMethodEntry method_entry;
+      method_entry.method_index = method_it.first;
+      method_entry.padding = 0u;
+      method_entry.inline_cache_offset = data_offset + data.size();
+      AddInlineCacheToBuffer(&data, method_it.second);
+      method_entry.inline_cache_size =
+          data_offset + data.size() - method_entry.inline_cache_offset;
+      memcpy(&data[methods_start + method_pos * sizeof(MappedMethodEntry)],
+             &method_entry,
+             sizeof(MappedMethodEntry));
+      ++method_pos;
+    }
+    AlignBuffer(&data, sizeof(uint32_t));
+  }
+
+  MappedHeader header;
+  static_assert(sizeof(header.magic) == sizeof(kProfileMagic), "Unexpected magic size");
+  static_assert(sizeof(header.version) == sizeof(kProfileMappedVersion), "Unexpected version size");
+  memcpy(header.magic, kProfileMagic, sizeof(header.magic));
+  memcpy(header.version, kProfileMappedVersion, sizeof(header.version));
+  header.number_of_dex_files = info_.size();
+  header.file_size = data_offset + data.size();
+
+  if (!WriteBuffer(fd, reinterpret_cast<const uint8_t*>(&header), sizeof(header)) ||
+      !WriteBuffer(fd,
+                   reinterpret_cast<const uint8_t*>(entries.data()),
+                   sizeof(MappedDexEntry) * entries.size()) ||
+      !WriteBuffer(fd, data.data(), data.size())) {
+    return false;
+  }
+  VLOG(profiler) << "Time to save mapped profile (" << header.file_size << " bytes): "
+                 << std::to_string(NanoTime() - start);
+  return true;
+}
+
+bool ProfileCompilationInfo::IsMappedProfile(int fd) {
+  off_t offset = lseek(fd, 0, SEEK_CUR);
+  if (offset == static_cast<off_t>(-1)) {
+    return false;
+  }
+  uint8_t buffer[sizeof(kProfileMagic) + sizeof(kProfileMappedVersion)];
+  if (TEMP_FAILURE_RETRY(pread(fd, buffer, sizeof(buffer), offset)) !=
+      static_cast<ssize_t>(sizeof(buffer))) {
+    return false;
+  }
+  return memcmp(buffer, kProfileMagic, sizeof(kProfileMagic)) == 0 &&
+      memcmp(buffer + sizeof(kProfileMagic),
+             kProfileMappedVersion,
+             sizeof(kProfileMappedVersion)) == 0;
+}
+
 uint32_t ProfileCompilationInfo::GetMethodsRegionSize(const DexFileData& dex_data) {
   // ((uint16_t)method index + (uint16_t)inline cache size) * number of methods
   uint32_t size = 2 * sizeof(uint16_t) * dex_data.method_map.size();
@@ -697,10 +862,12 @@ bool ProfileCompilationInfo::AddClassIndex(const std::string& dex_location,
   }                                                     \
   while (false)
 
-bool ProfileCompilationInfo::ReadInlineCache(SafeBuffer& buffer,
-                                             uint8_t number_of_dex_files,
-                                             /*out*/ InlineCacheMap* inline_cache,
-                                             /*out*/ std::string* error) {
+bool ProfileCompilationInfo::ReadInlineCache(
+    SafeBuffer& buffer,
+    uint8_t number_of_dex_files,
+    /*out*/ InlineCacheMap* inline_cache,
+    /*out*/ std::string* error,
+    const SafeMap<uint8_t, uint8_t>* dex_profile_index_remap) {
   uint16_t inline_cache_size;
   READ_UINT(uint16_t, buffer, inline_cache_size, error);
   for (; inline_cache_size > 0; inline_cache_size--) {
@@ -727,6 +894,9 @@ bool ProfileCompilationInfo::ReadInlineCache(SafeBuffer& buffer,
         *error += std::to_string(dex_profile_index) + " " + std::to_string(number_of_dex_files);
         return false;
       }
+      if (dex_profile_index_remap != nullptr) {
+        dex_profile_index = dex_profile_index_remap->Get(dex_profile_index);
+      }
       for (; dex_classes_size > 0; dex_classes_size--) {
         uint16_t type_index;
         READ_UINT(uint16_t, buffer, type_index, error);
@@ -737,6 +907,39 @@ bool ProfileCompilationInfo::ReadInlineCache(SafeBuffer& buffer,
   return true;
 }
 
+bool ProfileCompilationInfo::SkipInlineCache(SafeBuffer& buffer,
+                                             uint8_t number_of_dex_files,
+                                             /*out*/std::string* error) {
+  uint16_t inline_cache_size;
+  READ_UINT(uint16_t, buffer, inline_cache_size, error);
+  for (; inline_cache_size > 0; inline_cache_size--) {
+    uint16_t dex_pc;
+    uint8_t dex_to_classes_map_size;
+    READ_UINT(uint16_t, buffer, dex_pc, error);
+    READ_UINT(uint8_t, buffer, dex_to_classes_map_size, error);
+    if (dex_to_classes_map_size == kIsMissingTypesEncoding ||
+        dex_to_classes_map_size == kIsMegamorphicEncoding) {
+      continue;
+    }
+    for (; dex_to_classes_map_size > 0; dex_to_classes_map_size--) {
+      uint8_t dex_profile_index;
+      uint8_t dex_classes_size;
+      READ_UINT(uint8_t, buffer, dex_profile_index, error);
+      READ_UINT(uint8_t, buffer, dex_classes_size, error);
+      if (dex_profile_index >= number_of_dex_files) {
+        *error = "dex_profile_index out of bounds ";
+        *error += std::to_string(dex_profile_index) + " " + std::to_string(number_of_dex_files);
+        return false;
+      }
+      for (; dex_classes_size > 0; dex_classes_size--) {
+        uint16_t type_index;
+        READ_UINT(uint16_t, buffer, type_index, error);
+      }
+    }
+  }
+  return true;
+}
+
 bool ProfileCompilationInfo::ReadMethods(SafeBuffer& buffer,
                                          uint8_t number_of_dex_files,
                                          const ProfileLineHeader& line_header,
@@ -801,16 +1004,6 @@ bool ProfileCompilationInfo::ReadClasses(SafeBuffer& buffer,
   return true;
 }
 
-// Tests for EOF by trying to read 1 byte from the descriptor.
-// Returns:
-//   0 if the descriptor is at the EOF,
-//  -1 if there was an IO error
-//   1 if the descriptor has more content to read
-static int testEOF(int fd) {
-  uint8_t buffer[1];
-  return TEMP_FAILURE_RETRY(read(fd, buffer, 1));
-}
-
 // Reads an uint value previously written with AddUintToBuffer.
 template <typename T>
 bool ProfileCompilationInfo::SafeBuffer::ReadUintAndAdvance(/*out*/T* value) {
@@ -1025,6 +1218,88 @@ ProfileCompilationInfo::ProfileLoadSatus ProfileCompilationInfo::LoadInternal(
   if (stat_buffer.st_size == 0) {
     return kProfileLoadSuccess;
   }
+  if (IsMappedProfile(fd)) {
+    return LoadMappedInternal(fd, error);
+  }
+
+  ProfileLoadSatus status = LoadProfileEntry(fd, error);
+  if (status != kProfileLoadSuccess) {
+    return status;
+  }
+
+  // The profile saver may have appended delta entries after the base profile (see Append).
+  // Fold them into the current object.
+  while (true) {
+    off_t position = lseek(fd, 0, SEEK_CUR);
+    if (position == static_cast<off_t>(-1)) {
+      *error += std::string("Profile IO error: ") + strerror(errno);
+      return kProfileLoadIOError;
+    }
+    if (position >= stat_buffer.st_size) {
+      break;
+    }
+    // An Append that did not complete (e.g. the process was killed while writing) leaves a
+    // partial entry at the end of the file. Keep the complete entries before it rather than
+    // rejecting the whole profile. Anything else after the entries is bad data.
+    if (IsTruncatedProfileEntry(fd, position, stat_buffer.st_size)) {
+      LOG(WARNING) << "Ignoring a truncated profile journal entry at offset " << position;
+      has_truncated_journal_entry_ = true;
+      break;
+    }
+    ProfileCompilationInfo journal_entry;
+    status = journal_entry.LoadProfileEntry(fd, error);
+    if (status != kProfileLoadSuccess) {
+      return status;
+    }
+    if (!MergeWith(journal_entry)) {
+      *error += "Could not merge profile journal entry";
+      return kProfileLoadBadData;
+    }
+    number_of_journal_entries_++;
+  }
+  return kProfileLoadSuccess;
+}
+
+bool ProfileCompilationInfo::IsTruncatedProfileEntry(int fd, off_t offset, off_t file_size) {
+  // Same layout as read by ReadProfileHeader, the compressed data size comes last.
+  const size_t kMagicVersionSize = sizeof(kProfileMagic) + sizeof(kProfileVersion);
+  const size_t kHeaderSize =
+      kMagicVersionSize +
+      sizeof(uint8_t) +  // number of dex files
+      sizeof(uint32_t) +  // size of uncompressed profile data
+      sizeof(uint32_t);  // size of compressed profile data
+  DCHECK_LT(offset, file_size);
+  const size_t available =
+      static_cast<size_t>(std::min(file_size - offset, static_cast<off_t>(kHeaderSize)));
+  uint8_t header[kHeaderSize];
+  if (TEMP_FAILURE_RETRY(pread(fd, header, available, offset)) !=
+      static_cast<ssize_t>(available)) {
+    // Let LoadProfileEntry report the error.
+    return false;
+  }
+  // Append only writes regular profiles, so whatever part of the magic and version made it to
+  // the file must match.
+  uint8_t magic_version[kMagicVersionSize];
+  memcpy(magic_version, kProfileMagic, sizeof(kProfileMagic));
+  memcpy(magic_version + sizeof(kProfileMagic), kProfileVersion, sizeof(kProfileVersion));
+  if (memcmp(header, magic_version, std::min(available, kMagicVersionSize)) != 0) {
+    return false;
+  }
+  if (available < kHeaderSize) {
+    return true;
+  }
+  uint32_t compressed_data_size = 0;
+  for (size_t i = 0; i < sizeof(uint32_t); i++) {
+    compressed_data_size |=
+        static_cast<uint32_t>(header[kHeaderSize - sizeof(uint32_t) + i]) << (i * kBitsPerByte);
+  }
+  return static_cast<uint64_t>(offset) + kHeaderSize + compressed_data_size >
+      static_cast<uint64_t>(file_size);
+}
+
+ProfileCompilationInfo::ProfileLoadSatus ProfileCompilationInfo::LoadProfileEntry(
+      int fd, std::string* error) {
+  DCHECK(IsEmpty());
   // Read profile header: magic + version + number_of_dex_files.
   uint8_t number_of_dex_files;
   uint32_t uncompressed_data_size;
@@ -1056,11 +1331,6 @@ ProfileCompilationInfo::ProfileLoadSatus ProfileCompilationInfo::LoadInternal(
   bool bytes_read_success =
       android::base::ReadFully(fd, compressed_data.get(), compressed_data_size);
 
-  if (testEOF(fd) != 0) {
-    *error += "Unexpected data in the profile file.";
-    return kProfileLoadBadData;
-  }
-
   if (!bytes_read_success) {
     *error += "Unable to read compressed profile data";
     return kProfileLoadBadData;
@@ -1103,6 +1373,19 @@ ProfileCompilationInfo::ProfileLoadSatus ProfileCompilationInfo::LoadInternal(
   }
 }
 
+ProfileCompilationInfo::ProfileLoadSatus ProfileCompilationInfo::LoadMappedInternal(
+      int fd, std::string* error) {
+  std::unique_ptr<MappedProfile> mapped = MappedProfile::Open(fd, error);
+  if (mapped == nullptr) {
+    return kProfileLoadBadData;
+  }
+  if (!MergeWith(*mapped)) {
+    *error += "Could not load the mapped profile data";
+    return kProfileLoadBadData;
+  }
+  return kProfileLoadSuccess;
+}
+
 std::unique_ptr<uint8_t[]> ProfileCompilationInfo::DeflateBuffer(const uint8_t* in_buffer,
                                                                  uint32_t in_size,
                                                                  uint32_t* compressed_data_size) {
@@ -1237,6 +1520,191 @@ bool ProfileCompilationInfo::MergeWith(const ProfileCompilationInfo& other,
   return true;
 }
 
+bool ProfileCompilationInfo::MergeWith(const MappedProfile& mapped, bool merge_classes) {
+  ScopedTrace trace(__PRETTY_FUNCTION__);
+  using MappedDexEntry = MappedProfile::MappedDexEntry;
+  using MappedMethodEntry = MappedProfile::MappedMethodEntry;
+  const uint32_t number_of_dex_files = mapped.GetNumberOfDexFiles();
+
+  // Same as for the regular merge: validate everything first so that we don't add garbage
+  // to the current profile. Open() checked that the sections are within the mapping; the
+  // dex files, method indices and inline caches are checked here.
+  std::set<std::string> profile_keys;
+  uint32_t number_of_new_dex_files = 0;
+  for (uint32_t i = 0; i < number_of_dex_files; ++i) {
+    const MappedDexEntry& entry = mapped.GetDexEntry(i);
+    const std::string profile_key = mapped.GetProfileKey(entry);
+    if (!profile_keys.insert(profile_key).second) {
+      LOG(WARNING) << "Duplicate dex " << profile_key << " in mapped profile";
+      return false;
+    }
+    const DexFileData* dex_data = FindDexData(profile_key, 0u, /* verify_checksum */ false);
+    if (dex_data == nullptr) {
+      ++number_of_new_dex_files;
+    } else if (dex_data->checksum != entry.checksum) {
+      LOG(WARNING) << "Checksum mismatch for dex " << profile_key;
+      return false;
+    } else if (dex_data->num_method_ids != entry.num_method_ids) {
+      LOG(WARNING) << "num_method_ids mismatch for dex " << profile_key;
+      return false;
+    }
+    const MappedMethodEntry* methods = mapped.GetMethods(entry);
+    for (uint32_t k = 0; k < entry.num_methods; ++k) {
+      if (methods[k].method_index >= entry.num_method_ids) {
+        LOG(WARNING) << "Invalid method index " << methods[k].method_index
+                     << " in mapped profile for " << profile_key;
+        return false;
+      }
+      if (static_cast<uint64_t>(methods[k].inline_cache_offset) + methods[k].inline_cache_size >
+          mapped.map_->Size()) {
+        LOG(WARNING) << "Inline cache out of bounds in mapped profile for " << profile_key;
+        return false;
+      }
+      SafeBuffer buffer(mapped.Begin() + methods[k].inline_cache_offset,
+                        methods[k].inline_cache_size);
+      std::string error;
+      if (!SkipInlineCache(buffer, number_of_dex_files, &error) ||
+          buffer.CountUnreadBytes() != 0) {
+        LOG(WARNING) << "Invalid inline cache in mapped profile for " << profile_key << ": "
+                     << error;
+        return false;
+      }
+    }
+  }
+  if (info_.size() + number_of_new_dex_files > std::numeric_limits<uint8_t>::max()) {
+    LOG(WARNING) << "Exceeded the maximum number of dex files when merging a mapped profile";
+    return false;
+  }
+  // All checks passed. Import the data.
+
+  SafeMap<uint8_t, uint8_t> dex_profile_index_remap;
+  for (uint32_t i = 0; i < number_of_dex_files; ++i) {
+    const MappedDexEntry& entry = mapped.GetDexEntry(i);
+    const DexFileData* dex_data = GetOrAddDexFileData(mapped.GetProfileKey(entry),
+                                                      entry.checksum,
+                                                      entry.num_method_ids);
+    DCHECK(dex_data != nullptr);
+    dex_profile_index_remap.Put(i, dex_data->profile_index);
+  }
+
+  // Stream through the mapped data. Only the inline caches need decoding; they are read
+  // straight into the destination maps with their dex profile indices remapped.
+  for (uint32_t i = 0; i < number_of_dex_files; ++i) {
+    const MappedDexEntry& entry = mapped.GetDexEntry(i);
+    DexFileData* dex_data = info_[dex_profile_index_remap.Get(i)];
+
+    if (merge_classes) {
+      const uint16_t* classes = mapped.GetClasses(entry);
+      for (uint32_t k = 0; k < entry.num_classes; ++k) {
+        dex_data->class_set.insert(dex::TypeIndex(classes[k]));
+      }
+    }
+
+    const MappedMethodEntry* methods = mapped.GetMethods(entry);
+    for (uint32_t k = 0; k < entry.num_methods; ++k) {
+      InlineCacheMap* inline_cache = dex_data->FindOrAddMethod(methods[k].method_index);
+      SafeBuffer buffer(mapped.Begin() + methods[k].inline_cache_offset,
+                        methods[k].inline_cache_size);
+      std::string error;
+      bool success = ReadInlineCache(buffer,
+                                     number_of_dex_files,
+                                     inline_cache,
+                                     &error,
+                                     &dex_profile_index_remap);
+      DCHECK(success) << error;
+    }
+
+    DCHECK_EQ(entry.bitmap_size, dex_data->bitmap_storage.size());
+    const uint8_t* bitmap = mapped.Begin() + entry.bitmap_offset;
+    for (size_t k = 0; k < dex_data->bitmap_storage.size(); ++k) {
+      dex_data->bitmap_storage[k] |= bitmap[k];
+    }
+  }
+  return true;
+}
+
+bool ProfileCompilationInfo::ExtractNewData(const ProfileCompilationInfo& base,
+                                            /*out*/ProfileCompilationInfo* delta) const {
+  DCHECK(delta->IsEmpty());
+  // Register the dex files in profile index order so that the class references found in the
+  // inline caches keep their meaning in `delta`.
+  for (const DexFileData* dex_data : info_) {
+    if (delta->GetOrAddDexFileData(dex_data->profile_key,
+                                   dex_data->checksum,
+                                   dex_data->num_method_ids) == nullptr) {
+      return false;
+    }
+  }
+  // Inline caches can only be compared with the ones from `base` if both profiles assign
+  // the same profile indices to the dex files. Otherwise treat them as always different.
+  bool same_dex_indices = true;
+  for (const DexFileData* dex_data : info_) {
+    if (dex_data->profile_index >= base.info_.size() ||
+        base.info_[dex_data->profile_index]->profile_key != dex_data->profile_key) {
+      same_dex_indices = false;
+      break;
+    }
+  }
+
+  for (const DexFileData* dex_data : info_) {
+    DexFileData* delta_data = delta->info_[dex_data->profile_index];
+    const DexFileData* base_data = base.FindDexData(dex_data->profile_key, dex_data->checksum);
+
+    for (const dex::TypeIndex& type_idx : dex_data->class_set) {
+      if (base_data == nullptr ||
+          base_data->class_set.find(type_idx) == base_data->class_set.end()) {
+        delta_data->class_set.insert(type_idx);
+      }
+    }
+
+    for (const auto& method_it : dex_data->method_map) {
+      if (base_data != nullptr) {
+        auto base_it = base_data->method_map.find(method_it.first);
+        if (base_it != base_data->method_map.end() &&
+            (method_it.second.empty() ||
+             (same_dex_indices && base_it->second == method_it.second))) {
+          continue;
+        }
+      }
+      InlineCacheMap* inline_cache = delta_data->FindOrAddMethod(method_it.first);
+      for (const auto& ic_it : method_it.second) {
+        DexPcData* dex_pc_data = delta->FindOrAddDexPc(inline_cache, ic_it.first);
+        if (ic_it.second.is_missing_types) {
+          dex_pc_data->SetIsMissingTypes();
+        } else if (ic_it.second.is_megamorphic) {
+          dex_pc_data->SetIsMegamorphic();
+        } else {
+          for (const ClassReference& class_ref : ic_it.second.classes) {
+            dex_pc_data->AddClass(class_ref.dex_profile_index, class_ref.type_index);
+          }
+        }
+      }
+    }
+
+    DCHECK(base_data == nullptr ||
+           base_data->bitmap_storage.size() == dex_data->bitmap_storage.size());
+    for (size_t i = 0; i < dex_data->bitmap_storage.size(); ++i) {
+      uint8_t known_bits = (base_data != nullptr) ? base_data->bitmap_storage[i] : 0u;
+      delta_data->bitmap_storage[i] = dex_data->bitmap_storage[i] & ~known_bits;
+    }
+  }
+  return true;
+}
+
+bool ProfileCompilationInfo::HasMethodOrClassData() const {
+  for (const DexFileData* dex_data : info_) {
+    if (!dex_data->method_map.empty() || !dex_data->class_set.empty()) {
+      return true;
+    }
+    for (uint8_t byte : dex_data->bitmap_storage) {
+      if (byte != 0u) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
 const ProfileCompilationInfo::DexFileData* ProfileCompilationInfo::FindDexData(
     const DexFile* dex_file) const {
   return FindDexData(GetProfileDexFileKey(dex_file->GetLocation()),
@@ -1688,4 +2156,160 @@ std::unordered_set<std::string> ProfileCompilationInfo::GetClassDescriptors(
   return ret;
 }
 
+std::unique_ptr<ProfileCompilationInfo::MappedProfile> ProfileCompilationInfo::MappedProfile::Open(
+    int fd, /*out*/std::string* error) {
+  ScopedTrace trace(__PRETTY_FUNCTION__);
+  struct stat stat_buffer;
+  off_t offset = lseek(fd, 0, SEEK_CUR);
+  if (offset == static_cast<off_t>(-1) || fstat(fd, &stat_buffer) != 0) {
+    *error = std::string("Could not stat mapped profile: ") + strerror(errno);
+    return nullptr;
+  }
+  if (stat_buffer.st_size < offset ||
+      static_cast<size_t>(stat_buffer.st_size - offset) < sizeof(MappedHeader)) {
+    *error = "Mapped profile is too small";
+    return nullptr;
+  }
+  const size_t size = stat_buffer.st_size - offset;
+  std::unique_ptr<MemMap> map(MemMap::MapFile(size,
+                                              PROT_READ,
+                                              MAP_PRIVATE,
+                                              fd,
+                                              offset,
+                                              /* low_4gb */ false,
+                                              "profile",
+                                              error));
+  if (map == nullptr) {
+    return nullptr;
+  }
+  std::unique_ptr<MappedProfile> mapped(new MappedProfile(map.release()));
+
+  // Validate the header and that all the sections are within bounds. This is linear in
+  // the number of dex files only; the sections themselves are not parsed.
+  const MappedHeader* header = mapped->GetHeader();
+  if (memcmp(header->magic, kProfileMagic, sizeof(header->magic)) != 0 ||
+      memcmp(header->version, kProfileMappedVersion, sizeof(header->version)) != 0) {
+    *error = "Profile version mismatch";
+    return nullptr;
+  }
+  if (header->file_size != size) {
+    *error = "Mapped profile size mismatch";
+    return nullptr;
+  }
+  if (header->number_of_dex_files > std::numeric_limits<uint8_t>::max() ||
+      sizeof(MappedHeader) + header->number_of_dex_files * sizeof(MappedDexEntry) > size) {
+    *error = "Invalid number of dex files in mapped profile";
+    return nullptr;
+  }
+  auto in_bounds = [size](uint64_t section_offset, uint64_t count, uint64_t element_size) {
+    return IsAligned<sizeof(uint32_t)>(section_offset) &&
+        section_offset + count * element_size <= size;
+  };
+  for (uint32_t i = 0; i < header->number_of_dex_files; ++i) {
+    const MappedDexEntry& entry = mapped->GetDexEntry(i);
+    const uint32_t expected_bitmap_size =
+        RoundUp(entry.num_method_ids * 2u, kBitsPerByte) / kBitsPerByte;
+    if (entry.key_size == 0 || entry.key_size >= kMaxDexFileKeyLength ||
+        !in_bounds(entry.key_offset, entry.key_size, sizeof(char)) ||
+        !in_bounds(entry.methods_offset, entry.num_methods, sizeof(MappedMethodEntry)) ||
+        !in_bounds(entry.classes_offset, entry.num_classes, sizeof(uint16_t)) ||
+        !in_bounds(entry.bitmap_offset, entry.bitmap_size, sizeof(uint8_t)) ||
+        entry.bitmap_size != expected_bitmap_size) {
+      *error = "Invalid dex entry " + std::to_string(i) + " in mapped profile";
+      return nullptr;
+    }
+  }
+  return mapped;
+}
+
+const ProfileCompilationInfo::MappedProfile::MappedDexEntry*
+ProfileCompilationInfo::MappedProfile::FindDexEntry(const std::string& profile_key,
+                                                    uint32_t checksum) const {
+  // The number of dex files is small (at most 255) so a linear scan is fine.
+  for (uint32_t i = 0; i < GetNumberOfDexFiles(); ++i) {
+    const MappedDexEntry& entry = GetDexEntry(i);
+    if (entry.key_size == profile_key.size() &&
+        memcmp(Begin() + entry.key_offset, profile_key.data(), entry.key_size) == 0) {
+      return ChecksumMatch(entry.checksum, checksum) ? &entry : nullptr;
+    }
+  }
+  return nullptr;
+}
+
+ProfileCompilationInfo::MethodHotness ProfileCompilationInfo::MappedProfile::GetHotnessInfo(
+    const MappedDexEntry& entry,
+    uint32_t dex_method_index) const {
+  MethodHotness ret;
+  if (dex_method_index >= entry.num_method_ids) {
+    return ret;
+  }
+  // Same layout as DexFileData::method_bitmap: [startup bitmap][post startup bitmap].
+  BitMemoryRegion bitmap(
+      MemoryRegion(const_cast<uint8_t*>(Begin()) + entry.bitmap_offset, entry.bitmap_size),
+      0,
+      entry.num_method_ids * 2u);
+  if (bitmap.LoadBit(dex_method_index)) {
+    ret.AddFlag(MethodHotness::kFlagStartup);
+  }
+  if (bitmap.LoadBit(entry.num_method_ids + dex_method_index)) {
+    ret.AddFlag(MethodHotness::kFlagPostStartup);
+  }
+  const MappedMethodEntry* methods_begin = GetMethods(entry);
+  const MappedMethodEntry* methods_end = methods_begin + entry.num_methods;
+  const MappedMethodEntry* it = std::lower_bound(
+      methods_begin,
+      methods_end,
+      dex_method_index,
+      [](const MappedMethodEntry& method, uint32_t index) {
+        return method.method_index < index;
+      });
+  if (it != methods_end && it->method_index == dex_method_index) {
+    ret.AddFlag(MethodHotness::kFlagHot);
+  }
+  return ret;
+}
+
+ProfileCompilationInfo::MethodHotness ProfileCompilationInfo::MappedProfile::GetMethodHotness(
+    const MethodReference& method_ref) const {
+  return GetMethodHotness(method_ref.dex_file->GetLocation(),
+                          method_ref.dex_file->GetLocationChecksum(),
+                          method_ref.dex_method_index);
+}
+
+ProfileCompilationInfo::MethodHotness ProfileCompilationInfo::MappedProfile::GetMethodHotness(
+    const std::string& dex_location,
+    uint32_t dex_checksum,
+    uint16_t dex_method_index) const {
+  const MappedDexEntry* entry = FindDexEntry(GetProfileDexFileKey(dex_location), dex_checksum);
+  return entry != nullptr ? GetHotnessInfo(*entry, dex_method_index) : MethodHotness();
+}
+
+bool ProfileCompilationInfo::MappedProfile::ContainsClass(const DexFile& dex_file,
+                                                          dex::TypeIndex type_idx) const {
+  const MappedDexEntry* entry = FindDexEntry(GetProfileDexFileKey(dex_file.GetLocation()),
+                                             dex_file.GetLocationChecksum());
+  if (entry == nullptr) {
+    return false;
+  }
+  const uint16_t* classes_begin = GetClasses(*entry);
+  const uint16_t* classes_end = classes_begin + entry->num_classes;
+  return std::binary_search(classes_begin, classes_end, type_idx.index_);
+}
+
+uint32_t ProfileCompilationInfo::MappedProfile::GetNumberOfMethods() const {
+  uint32_t total = 0;
+  for (uint32_t i = 0; i < GetNumberOfDexFiles(); ++i) {
+    total += GetDexEntry(i).num_methods;
+  }
+  return total;
+}
+
+uint32_t ProfileCompilationInfo::MappedProfile::GetNumberOfResolvedClasses() const {
+  uint32_t total = 0;
+  for (uint32_t i = 0; i < GetNumberOfDexFiles(); ++i) {
+    total += GetDexEntry(i).num_classes;
+  }
+  return total;
+}
+
 }  // namespace art
@@ -27,6 +27,7 @@
 #include "dex_cache_resolved_classes.h"
 #include "dex_file.h"
 #include "dex_file_types.h"
+#include "mem_map.h"
 #include "method_reference.h"
 #include "safe_map.h"
 #include "type_reference.h"
@@ -70,6 +71,9 @@ class ProfileCompilationInfo {
  public:
   static const uint8_t kProfileMagic[];
   static const uint8_t kProfileVersion[];
+  static const uint8_t kProfileMappedVersion[];
+
+  class MappedProfile;
 
   // Data structures for encoding the offline representation of inline caches.
   // This is exposed as public in order to make it available to dex2oat compilations
@@ -305,12 +309,53 @@ class ProfileCompilationInfo {
   // we don't want all of the classes to be image classes.
   bool MergeWith(const ProfileCompilationInfo& info, bool merge_classes = true);
 
+  // Merge the data from a memory mapped profile into the current object. The mapped
+  // profile is streamed through once; its inline caches are decoded directly into
+  // this object without building an intermediate ProfileCompilationInfo.
+  bool MergeWith(const MappedProfile& mapped, bool merge_classes = true);
+
   // Save the profile data to the given file descriptor.
   bool Save(int fd);
 
+  // Save the profile data to the given file descriptor using the uncompressed, offset indexed
+  // format (kProfileMappedVersion) which can be queried in place with MappedProfile.
+  bool SaveMapped(int fd);
+
+  // Return true if the profile at the current position of `fd` uses the mapped format.
+  // The file offset is not modified.
+  static bool IsMappedProfile(int fd);
+
   // Save the current profile into the given file. The file will be cleared before saving.
   bool Save(const std::string& filename, uint64_t* bytes_written);
 
+  // Append the current profile to the given file as a journal entry. Journal entries are
+  // regular profiles written back to back after the base profile; Load() merges them all,
+  // and any Save() of the loaded data compacts them back into a single profile.
+  // bytes_written is set to the number of bytes appended.
+  bool Append(const std::string& filename, uint64_t* bytes_written);
+
+  // Return the number of journal entries that were merged by the last Load().
+  uint32_t GetNumberOfJournalEntries() const {
+    return number_of_journal_entries_;
+  }
+
+  // Return whether the last Load() ignored a journal entry that was cut short. Appending to
+  // such a file would extend the partial entry, so it has to be rewritten with Save() instead.
+  bool HasTruncatedJournalEntry() const {
+    return has_truncated_journal_entry_;
+  }
+
+  // Store into `delta` the data of this profile that is not present in `base`: new classes,
+  // new startup/post startup flags and hot methods which are missing from `base` or whose
+  // inline caches differ. Merging `delta` into `base` yields the union of both profiles.
+  // `delta` must be empty. Returns false if `delta` could not be populated.
+  bool ExtractNewData(const ProfileCompilationInfo& base,
+                      /*out*/ProfileCompilationInfo* delta) const;
+
+  // Return true if the profile records any method, class or startup/post startup flag.
+  // Unlike IsEmpty(), dex files registered without any data do not count.
+  bool HasMethodOrClassData() const;
+
   // Return the number of methods that were profiled.
   uint32_t GetNumberOfMethods() const;
 
@@ -560,6 +605,12 @@ class ProfileCompilationInfo {
       ptr_end_ = ptr_current_ + size;
     }
 
+    // Creates a read-only view over memory owned by someone else (e.g. a mapped profile).
+    SafeBuffer(const uint8_t* data, size_t size)
+        : storage_(nullptr),
+          ptr_end_(const_cast<uint8_t*>(data) + size),
+          ptr_current_(const_cast<uint8_t*>(data)) {}
+
     // Reads the content of the descriptor at the current position.
     ProfileLoadSatus FillFromFd(int fd,
                                 const std::string& source,
@@ -598,6 +649,14 @@ class ProfileCompilationInfo {
   // Entry point for profile loding functionality.
   ProfileLoadSatus LoadInternal(int fd, std::string* error);
 
+  // Load a single regular profile (base or journal entry) from the current position of `fd`.
+  ProfileLoadSatus LoadProfileEntry(int fd, std::string* error);
+
+  // Return whether the `file_size - offset` bytes starting at `offset` of `fd` are the start of a
+  // regular profile entry cut short by an interrupted Append: they begin with (a prefix of) the
+  // profile magic and version, and the header is incomplete or announces more data than is left.
+  static bool IsTruncatedProfileEntry(int fd, off_t offset, off_t file_size);
+
   // Read the profile header from the given fd and store the number of profile
   // lines into number_of_dex_files.
   ProfileLoadSatus ReadProfileHeader(int fd,
@@ -635,10 +694,18 @@ class ProfileCompilationInfo {
                    /*out*/std::string* error);
 
   // Read the inline cache encoding from line_bufer into inline_cache.
+  // If dex_profile_index_remap is not null, the dex profile indices found in the buffer
+  // are translated through it before being added to inline_cache.
   bool ReadInlineCache(SafeBuffer& buffer,
                        uint8_t number_of_dex_files,
                        /*out*/InlineCacheMap* inline_cache,
-                       /*out*/std::string* error);
+                       /*out*/std::string* error,
+                       const SafeMap<uint8_t, uint8_t>* dex_profile_index_remap = nullptr);
+
+  // Check the inline cache encoding in buffer and advance past it, without storing anything.
+  static bool SkipInlineCache(SafeBuffer& buffer,
+                              uint8_t number_of_dex_files,
+                              /*out*/std::string* error);
 
   // Encode the inline cache into the given buffer.
   void AddInlineCacheToBuffer(std::vector<uint8_t>* buffer,
@@ -658,6 +725,10 @@ class ProfileCompilationInfo {
   // if no previous data exists.
   DexPcData* FindOrAddDexPc(InlineCacheMap* inline_cache, uint32_t dex_pc);
 
+  // Entry point for loading a profile saved with SaveMapped. The whole file is deserialized into
+  // the regular maps, so the compiler's queries don't go through MappedProfile.
+  ProfileLoadSatus LoadMappedInternal(int fd, std::string* error);
+
   friend class ProfileCompilationInfoTest;
   friend class CompilerDriverProfileTest;
   friend class ProfileAssistantTest;
@@ -675,6 +746,120 @@ class ProfileCompilationInfo {
   // This is used to speed up searches since it avoids iterating
   // over the info_ vector when searching by profile key.
   ArenaSafeMap<const std::string, uint8_t> profile_key_map_;
+
+  // Number of journal entries merged during Load().
+  uint32_t number_of_journal_entries_;
+
+  // Whether Load() stopped before a partial journal entry at the end of the file.
+  bool has_truncated_journal_entry_;
+};
+
+/**
+ * Read-only view of a profile saved with ProfileCompilationInfo::SaveMapped.
+ * The file is memory mapped and queried in place: dex entries, hot methods and classes are
+ * stored sorted at fixed offsets so lookups are binary searches over the mapping and
+ * nothing is deserialized up front. Inline caches are kept in their regular encoding and
+ * are only decoded when the profile is merged into a ProfileCompilationInfo.
+ */
+class ProfileCompilationInfo::MappedProfile {
+ public:
+  // On-disk layout. All the fields are little endian and naturally aligned; every
+  // section offset is relative to the beginning of the profile and is 4-byte aligned.
+  //
+  //    MappedHeader,
+  //    MappedDexEntry[number_of_dex_files],
+  //    for each dex file:
+  //        profile key,
+  //        MappedMethodEntry[num_methods] (sorted by method_index),
+  //        uint16_t class_ids[num_classes] (sorted),
+  //        startup/post startup bitmap (same layout as DexFileData::method_bitmap),
+  //        inline caches (same encoding as the regular format, one blob per hot method).
+  struct MappedHeader {
+    uint8_t magic[4];
+    uint8_t version[4];
+    uint32_t number_of_dex_files;
+    uint32_t file_size;
+  };
+
+  struct MappedDexEntry {
+    uint32_t key_offset;
+    uint32_t key_size;
+    uint32_t checksum;
+    uint32_t num_method_ids;
+    uint32_t methods_offset;
+    uint32_t num_methods;
+    uint32_t classes_offset;
+    uint32_t num_classes;
+    uint32_t bitmap_offset;
+    uint32_t bitmap_size;
+  };
+
+  struct MappedMethodEntry {
+    uint16_t method_index;
+    uint16_t padding;
+    uint32_t inline_cache_offset;
+    uint32_t inline_cache_size;
+  };
+
+  // Map the profile found at the current position of `fd`. Returns null and sets `error`
+  // if the file is not a well formed mapped profile.
+  static std::unique_ptr<MappedProfile> Open(int fd, /*out*/std::string* error);
+
+  // Returns the hotness of the given method. The inline cache map of the result is never set.
+  MethodHotness GetMethodHotness(const MethodReference& method_ref) const;
+  MethodHotness GetMethodHotness(const std::string& dex_location,
+                                 uint32_t dex_checksum,
+                                 uint16_t dex_method_index) const;
+
+  // Return true if the class's type is present in the profile.
+  bool ContainsClass(const DexFile& dex_file, dex::TypeIndex type_idx) const;
+
+  uint32_t GetNumberOfMethods() const;
+  uint32_t GetNumberOfResolvedClasses() const;
+
+  uint32_t GetNumberOfDexFiles() const {
+    return GetHeader()->number_of_dex_files;
+  }
+
+ private:
+  explicit MappedProfile(MemMap* map) : map_(map) {}
+
+  const uint8_t* Begin() const {
+    return map_->Begin();
+  }
+
+  const MappedHeader* GetHeader() const {
+    return reinterpret_cast<const MappedHeader*>(Begin());
+  }
+
+  const MappedDexEntry& GetDexEntry(size_t index) const {
+    DCHECK_LT(index, GetNumberOfDexFiles());
+    return reinterpret_cast<const MappedDexEntry*>(Begin() + sizeof(MappedHeader))[index];
+  }
+
+  std::string GetProfileKey(const MappedDexEntry& entry) const {
+    return std::string(reinterpret_cast<const char*>(Begin() + entry.key_offset), entry.key_size);
+  }
+
+  const MappedMethodEntry* GetMethods(const MappedDexEntry& entry) const {
+    return reinterpret_cast<const MappedMethodEntry*>(Begin() + entry.methods_offset);
+  }
+
+  const uint16_t* GetClasses(const MappedDexEntry& entry) const {
+    return reinterpret_cast<const uint16_t*>(Begin() + entry.classes_offset);
+  }
+
+  // Return the entry for the given profile key or null if the profile doesn't contain
+  // the key or the checksum does not match.
+  const MappedDexEntry* FindDexEntry(const std::string& profile_key, uint32_t checksum) const;
+
+  MethodHotness GetHotnessInfo(const MappedDexEntry& entry, uint32_t dex_method_index) const;
+
+  std::unique_ptr<MemMap> map_;
+
+  friend class ProfileCompilationInfo;
+
+  DISALLOW_COPY_AND_ASSIGN(MappedProfile);
 };
 
 }  // namespace art
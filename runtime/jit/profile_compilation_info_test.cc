@@ -16,6 +16,8 @@
 
 #include <gtest/gtest.h>
 
+#include "android-base/file.h"
+
 #include "base/unix_file/fd_file.h"
 #include "art_method-inl.h"
 #include "class_linker-inl.h"
@@ -29,6 +31,7 @@
 #include "linear_alloc.h"
 #include "scoped_thread_state_change-inl.h"
 #include "type_reference.h"
+#include "utils.h"
 
 namespace art {
 
@@ -940,4 +943,260 @@ TEST_F(ProfileCompilationInfoTest, SampledMethodsTest) {
   }
 }
 
+TEST_F(ProfileCompilationInfoTest, SaveMappedInlineCaches) {
+  ScratchFile profile;
+
+  ProfileCompilationInfo saved_info;
+  ProfileCompilationInfo::OfflineProfileMethodInfo pmi = GetOfflineProfileMethodInfo();
+
+  for (uint16_t method_idx = 0; method_idx < 10; method_idx++) {
+    ASSERT_TRUE(AddMethod("dex_location1", /* checksum */ 1, method_idx, pmi, &saved_info));
+    ASSERT_TRUE(AddMethod("dex_location4", /* checksum */ 4, method_idx, pmi, &saved_info));
+  }
+  for (uint16_t type_idx = 0; type_idx < 10; type_idx++) {
+    ASSERT_TRUE(AddClass("dex_location1", /* checksum */ 1, dex::TypeIndex(type_idx), &saved_info));
+  }
+
+  ASSERT_TRUE(saved_info.SaveMapped(GetFd(profile)));
+  ASSERT_EQ(0, profile.GetFile()->Flush());
+  ASSERT_TRUE(profile.GetFile()->ResetOffset());
+  ASSERT_TRUE(ProfileCompilationInfo::IsMappedProfile(GetFd(profile)));
+
+  // Check that the regular load path gets back what we saved.
+  ProfileCompilationInfo loaded_info;
+  ASSERT_TRUE(loaded_info.Load(GetFd(profile)));
+  ASSERT_TRUE(loaded_info.Equals(saved_info));
+  std::unique_ptr<ProfileCompilationInfo::OfflineProfileMethodInfo> loaded_pmi =
+      loaded_info.GetMethod("dex_location4", /* checksum */ 4, /* method_idx */ 3);
+  ASSERT_TRUE(loaded_pmi != nullptr);
+  ASSERT_TRUE(*loaded_pmi == pmi);
+}
+
+TEST_F(ProfileCompilationInfoTest, MappedProfileQueries) {
+  static constexpr size_t kNumMethods = 1000;
+  static constexpr uint32_t kChecksum1 = 1234;
+  static constexpr uint32_t kChecksum2 = 4321;
+  static const std::string kDex1 = "dex1";
+  static const std::string kDex2 = "dex2";
+  ProfileCompilationInfo saved_info;
+  saved_info.AddMethodIndex(Hotness::kFlagHot, kDex1, kChecksum1, 7, kNumMethods);
+  saved_info.AddMethodIndex(Hotness::kFlagStartup, kDex1, kChecksum1, 1, kNumMethods);
+  saved_info.AddMethodIndex(Hotness::kFlagPostStartup, kDex1, kChecksum1, 5, kNumMethods);
+  saved_info.AddMethodIndex(Hotness::kFlagHot, kDex2, kChecksum2, 999, kNumMethods);
+  saved_info.AddMethodIndex(Hotness::kFlagStartup, kDex2, kChecksum2, 2, kNumMethods);
+
+  ScratchFile profile;
+  ASSERT_TRUE(saved_info.SaveMapped(GetFd(profile)));
+  ASSERT_EQ(0, profile.GetFile()->Flush());
+  ASSERT_TRUE(profile.GetFile()->ResetOffset());
+
+  std::string error;
+  std::unique_ptr<ProfileCompilationInfo::MappedProfile> mapped =
+      ProfileCompilationInfo::MappedProfile::Open(GetFd(profile), &error);
+  ASSERT_TRUE(mapped != nullptr) << error;
+  EXPECT_EQ(2u, mapped->GetNumberOfDexFiles());
+  EXPECT_EQ(saved_info.GetNumberOfMethods(), mapped->GetNumberOfMethods());
+  EXPECT_TRUE(mapped->GetMethodHotness(kDex1, kChecksum1, 7).IsHot());
+  EXPECT_FALSE(mapped->GetMethodHotness(kDex1, kChecksum1, 8).IsHot());
+  EXPECT_TRUE(mapped->GetMethodHotness(kDex1, kChecksum1, 1).IsStartup());
+  EXPECT_FALSE(mapped->GetMethodHotness(kDex1, kChecksum1, 1).IsPostStartup());
+  EXPECT_TRUE(mapped->GetMethodHotness(kDex1, kChecksum1, 5).IsPostStartup());
+  EXPECT_FALSE(mapped->GetMethodHotness(kDex1, kChecksum1, 2).IsInProfile());
+  EXPECT_TRUE(mapped->GetMethodHotness(kDex2, kChecksum2, 999).IsHot());
+  EXPECT_TRUE(mapped->GetMethodHotness(kDex2, kChecksum2, 2).IsStartup());
+  // A checksum mismatch hides the data.
+  EXPECT_FALSE(mapped->GetMethodHotness(kDex2, kChecksum1, 999).IsInProfile());
+
+  // Merging streams the mapped data into an existing profile.
+  ProfileCompilationInfo merged_info;
+  merged_info.AddMethodIndex(Hotness::kFlagHot, kDex1, kChecksum1, 3, kNumMethods);
+  ASSERT_TRUE(merged_info.MergeWith(*mapped));
+  EXPECT_TRUE(merged_info.GetMethodHotness(kDex1, kChecksum1, 3).IsHot());
+  EXPECT_TRUE(merged_info.GetMethodHotness(kDex1, kChecksum1, 7).IsHot());
+  EXPECT_TRUE(merged_info.GetMethodHotness(kDex1, kChecksum1, 1).IsStartup());
+  EXPECT_TRUE(merged_info.GetMethodHotness(kDex2, kChecksum2, 999).IsHot());
+
+  // The mapped data cannot be merged into a profile with mismatching checksums.
+  ProfileCompilationInfo mismatch_info;
+  mismatch_info.AddMethodIndex(Hotness::kFlagHot, kDex1, kChecksum2, 3, kNumMethods);
+  ASSERT_FALSE(mismatch_info.MergeWith(*mapped));
+
+  // A failed merge leaves the profile untouched, even when an earlier dex file of the mapped
+  // profile was fine.
+  ProfileCompilationInfo method_ids_info;
+  method_ids_info.AddMethodIndex(Hotness::kFlagHot, kDex2, kChecksum2, 3, kNumMethods + 1);
+  ProfileCompilationInfo method_ids_copy;
+  ASSERT_TRUE(method_ids_copy.MergeWith(method_ids_info));
+  ASSERT_FALSE(method_ids_info.MergeWith(*mapped));
+  EXPECT_TRUE(method_ids_info.Equals(method_ids_copy));
+  EXPECT_FALSE(method_ids_info.GetMethodHotness(kDex1, kChecksum1, 7).IsInProfile());
+}
+
+TEST_F(ProfileCompilationInfoTest, MappedProfileIncomplete) {
+  ProfileCompilationInfo saved_info;
+  for (uint16_t i = 0; i < 10; i++) {
+    ASSERT_TRUE(AddMethod("dex_location1", /* checksum */ 1, /* method_idx */ i, &saved_info));
+  }
+  ScratchFile full_profile;
+  ASSERT_TRUE(saved_info.SaveMapped(GetFd(full_profile)));
+  ASSERT_EQ(0, full_profile.GetFile()->Flush());
+  std::string content;
+  ASSERT_TRUE(android::base::ReadFileToString(full_profile.GetFilename(), &content));
+
+  // Drop the tail of the profile: the header no longer matches the file size.
+  ScratchFile profile;
+  ASSERT_TRUE(profile.GetFile()->WriteFully(content.data(), content.size() - 4));
+  ASSERT_EQ(0, profile.GetFile()->Flush());
+  ASSERT_TRUE(profile.GetFile()->ResetOffset());
+  ProfileCompilationInfo loaded_info;
+  ASSERT_FALSE(loaded_info.Load(GetFd(profile)));
+}
+
+TEST_F(ProfileCompilationInfoTest, AppendJournalEntries) {
+  ScratchFile profile;
+
+  ProfileCompilationInfo base_info;
+  for (uint16_t i = 0; i < 10; i++) {
+    ASSERT_TRUE(AddMethod("dex_location1", /* checksum */ 1, /* method_idx */ i, &base_info));
+  }
+  ASSERT_TRUE(base_info.Save(profile.GetFilename(), nullptr));
+
+  // Append two deltas, one of them introducing a new dex file.
+  ProfileCompilationInfo delta1;
+  ASSERT_TRUE(AddMethod("dex_location1", /* checksum */ 1, /* method_idx */ 20, &delta1));
+  ASSERT_TRUE(AddClass("dex_location1", /* checksum */ 1, dex::TypeIndex(3), &delta1));
+  uint64_t bytes_written = 0;
+  ASSERT_TRUE(delta1.Append(profile.GetFilename(), &bytes_written));
+  ASSERT_GT(bytes_written, 0u);
+  ProfileCompilationInfo delta2;
+  ASSERT_TRUE(AddMethod("dex_location2", /* checksum */ 2, /* method_idx */ 5, &delta2));
+  ASSERT_TRUE(delta2.Append(profile.GetFilename(), nullptr));
+
+  ProfileCompilationInfo expected_info;
+  ASSERT_TRUE(expected_info.MergeWith(base_info));
+  ASSERT_TRUE(expected_info.MergeWith(delta1));
+  ASSERT_TRUE(expected_info.MergeWith(delta2));
+
+  ProfileCompilationInfo loaded_info;
+  ASSERT_TRUE(loaded_info.Load(profile.GetFilename(), /* clear_if_invalid */ false));
+  ASSERT_EQ(2u, loaded_info.GetNumberOfJournalEntries());
+  ASSERT_TRUE(loaded_info.Equals(expected_info));
+
+  // A regular save compacts the journal.
+  ASSERT_TRUE(loaded_info.Save(profile.GetFilename(), nullptr));
+  ProfileCompilationInfo compacted_info;
+  ASSERT_TRUE(compacted_info.Load(profile.GetFilename(), /* clear_if_invalid */ false));
+  ASSERT_EQ(0u, compacted_info.GetNumberOfJournalEntries());
+  ASSERT_TRUE(compacted_info.Equals(expected_info));
+}
+
+TEST_F(ProfileCompilationInfoTest, TruncatedJournalEntry) {
+  ScratchFile full_profile;
+  ProfileCompilationInfo base_info;
+  for (uint16_t i = 0; i < 10; i++) {
+    ASSERT_TRUE(AddMethod("dex_location1", /* checksum */ 1, /* method_idx */ i, &base_info));
+  }
+  ASSERT_TRUE(base_info.Save(full_profile.GetFilename(), nullptr));
+  ProfileCompilationInfo delta;
+  ASSERT_TRUE(AddMethod("dex_location1", /* checksum */ 1, /* method_idx */ 20, &delta));
+  uint64_t bytes_written = 0;
+  ASSERT_TRUE(delta.Append(full_profile.GetFilename(), &bytes_written));
+  std::string content;
+  ASSERT_TRUE(android::base::ReadFileToString(full_profile.GetFilename(), &content));
+
+  // Cut the journal entry short, in its header and in its data.
+  for (size_t dropped : { static_cast<size_t>(bytes_written) - 4, static_cast<size_t>(1) }) {
+    ScratchFile profile;
+    ASSERT_TRUE(profile.GetFile()->WriteFully(content.data(), content.size() - dropped));
+    ASSERT_EQ(0, profile.GetFile()->Flush());
+
+    // The complete entries load, and the file is left as it is.
+    ProfileCompilationInfo loaded_info;
+    ASSERT_TRUE(loaded_info.Load(profile.GetFilename(), /* clear_if_invalid */ true));
+    ASSERT_TRUE(loaded_info.Equals(base_info));
+    ASSERT_EQ(0u, loaded_info.GetNumberOfJournalEntries());
+    ASSERT_TRUE(loaded_info.HasTruncatedJournalEntry());
+    ASSERT_EQ(static_cast<int64_t>(content.size() - dropped),
+              GetFileSizeBytes(profile.GetFilename()));
+  }
+}
+
+TEST_F(ProfileCompilationInfoTest, JunkAfterProfileIsNotATruncatedEntry) {
+  ScratchFile full_profile;
+  ProfileCompilationInfo base_info;
+  ASSERT_TRUE(AddMethod("dex_location1", /* checksum */ 1, /* method_idx */ 1, &base_info));
+  ASSERT_TRUE(base_info.Save(full_profile.GetFilename(), nullptr));
+  std::string content;
+  ASSERT_TRUE(android::base::ReadFileToString(full_profile.GetFilename(), &content));
+
+  // A header sized run of bytes that is not a profile header, and the start of a profile header
+  // with a different version.
+  const std::string junk(32, 'x');
+  const std::string other_version("pro\0" "000", 7);
+  for (const std::string& tail : { junk, other_version }) {
+    ScratchFile profile;
+    ASSERT_TRUE(profile.GetFile()->WriteFully(content.data(), content.size()));
+    ASSERT_TRUE(profile.GetFile()->WriteFully(tail.data(), tail.size()));
+    ASSERT_EQ(0, profile.GetFile()->Flush());
+    ASSERT_TRUE(profile.GetFile()->ResetOffset());
+    ProfileCompilationInfo loaded_info;
+    ASSERT_FALSE(loaded_info.Load(GetFd(profile)));
+  }
+}
+
+TEST_F(ProfileCompilationInfoTest, AppendToMappedProfile) {
+  ProfileCompilationInfo saved_info;
+  for (uint16_t i = 0; i < 10; i++) {
+    ASSERT_TRUE(AddMethod("dex_location1", /* checksum */ 1, /* method_idx */ i, &saved_info));
+  }
+  ScratchFile profile;
+  ASSERT_TRUE(saved_info.SaveMapped(GetFd(profile)));
+  ASSERT_EQ(0, profile.GetFile()->Flush());
+  std::string content;
+  ASSERT_TRUE(android::base::ReadFileToString(profile.GetFilename(), &content));
+
+  // Mapped profiles have a fixed layout, the journal entry is refused and nothing is written.
+  ProfileCompilationInfo delta;
+  ASSERT_TRUE(AddMethod("dex_location1", /* checksum */ 1, /* method_idx */ 20, &delta));
+  uint64_t bytes_written = 0;
+  ASSERT_FALSE(delta.Append(profile.GetFilename(), &bytes_written));
+  std::string new_content;
+  ASSERT_TRUE(android::base::ReadFileToString(profile.GetFilename(), &new_content));
+  ASSERT_EQ(content, new_content);
+}
+
+TEST_F(ProfileCompilationInfoTest, ExtractNewData) {
+  static constexpr size_t kNumMethods = 1000;
+  ProfileCompilationInfo base_info;
+  base_info.AddMethodIndex(Hotness::kFlagHot, "dex1", /* checksum */ 1, 1, kNumMethods);
+  base_info.AddMethodIndex(Hotness::kFlagStartup, "dex1", /* checksum */ 1, 2, kNumMethods);
+  ASSERT_TRUE(AddClass("dex1", /* checksum */ 1, dex::TypeIndex(1), &base_info));
+
+  ProfileCompilationInfo current_info;
+  ASSERT_TRUE(current_info.MergeWith(base_info));
+  current_info.AddMethodIndex(Hotness::kFlagHot, "dex1", /* checksum */ 1, 3, kNumMethods);
+  current_info.AddMethodIndex(Hotness::kFlagPostStartup, "dex1", /* checksum */ 1, 2, kNumMethods);
+  ASSERT_TRUE(AddClass("dex1", /* checksum */ 1, dex::TypeIndex(2), &current_info));
+  current_info.AddMethodIndex(Hotness::kFlagHot, "dex2", /* checksum */ 2, 4, kNumMethods);
+
+  ProfileCompilationInfo delta_info;
+  ASSERT_TRUE(current_info.ExtractNewData(base_info, &delta_info));
+  EXPECT_EQ(2u, delta_info.GetNumberOfMethods());
+  EXPECT_EQ(1u, delta_info.GetNumberOfResolvedClasses());
+  EXPECT_FALSE(delta_info.GetMethodHotness("dex1", 1, 1).IsHot());
+  EXPECT_TRUE(delta_info.GetMethodHotness("dex1", 1, 3).IsHot());
+  EXPECT_FALSE(delta_info.GetMethodHotness("dex1", 1, 2).IsStartup());
+  EXPECT_TRUE(delta_info.GetMethodHotness("dex1", 1, 2).IsPostStartup());
+  EXPECT_TRUE(delta_info.GetMethodHotness("dex2", 2, 4).IsHot());
+
+  // Merging the delta back into the base gives the current profile.
+  ASSERT_TRUE(base_info.MergeWith(delta_info));
+  ASSERT_TRUE(base_info.Equals(current_info));
+
+  // Nothing is new anymore.
+  ProfileCompilationInfo empty_delta;
+  ASSERT_TRUE(current_info.ExtractNewData(base_info, &empty_delta));
+  EXPECT_FALSE(empty_delta.HasMethodOrClassData());
+}
+
 }  // namespace art
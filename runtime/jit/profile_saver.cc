@@ -38,6 +38,7 @@
 #include "jit/profile_compilation_info.h"
 #include "oat_file_manager.h"
 #include "scoped_thread_state_change-inl.h"
+#include "utils.h"
 
 namespace art {
 
@@ -91,6 +92,8 @@ ProfileSaver::ProfileSaver(const ProfileSaverOptions& options,
       max_number_of_profile_entries_cached_(0),
       total_number_of_hot_spikes_(0),
       total_number_of_wake_ups_(0),
+      total_number_of_journal_appends_(0),
+      total_number_of_compactions_(0),
       options_(options) {
   DCHECK(options_.IsEnabled());
   AddTrackedLocations(output_filename, code_paths);
@@ -100,6 +103,9 @@ ProfileSaver::~ProfileSaver() {
   for (auto& it : profile_cache_) {
     delete it.second;
   }
+  for (auto& it : saved_profiles_) {
+    delete it.second.info;
+  }
 }
 
 void ProfileSaver::Run() {
@@ -498,28 +504,35 @@ bool ProfileSaver::ProcessProfilingInfo(bool force_save, /*out*/uint16_t* number
       total_number_of_code_cache_queries_++;
     }
     {
-      ProfileCompilationInfo info(Runtime::Current()->GetArenaPool());
-      if (!info.Load(filename, /*clear_if_invalid*/ true)) {
+      // Load what was already persisted after each compaction; while journal entries are
+      // appended the in-memory snapshot is kept up to date with every save. It is reloaded
+      // if the file was modified behind our back (e.g. cleared after being merged by profman).
+      ProfileCompilationInfo* saved_info = GetSavedProfile(filename);
+      if (saved_info == nullptr) {
         LOG(WARNING) << "Could not forcefully load profile " << filename;
         continue;
       }
-      uint64_t last_save_number_of_methods = info.GetNumberOfMethods();
-      uint64_t last_save_number_of_classes = info.GetNumberOfResolvedClasses();
 
+      ProfileCompilationInfo info(Runtime::Current()->GetArenaPool());
       info.AddMethods(profile_methods);
       auto profile_cache_it = profile_cache_.find(filename);
       if (profile_cache_it != profile_cache_.end()) {
         info.MergeWith(*(profile_cache_it->second));
       }
 
-      int64_t delta_number_of_methods =
-          info.GetNumberOfMethods() - last_save_number_of_methods;
-      int64_t delta_number_of_classes =
-          info.GetNumberOfResolvedClasses() - last_save_number_of_classes;
+      // Only the data which is not yet in the file gets written.
+      ProfileCompilationInfo delta_info(Runtime::Current()->GetArenaPool());
+      if (!info.ExtractNewData(*saved_info, &delta_info)) {
+        LOG(WARNING) << "Could not compute the profile delta for " << filename;
+        continue;
+      }
+      int64_t delta_number_of_methods = delta_info.GetNumberOfMethods();
+      int64_t delta_number_of_classes = delta_info.GetNumberOfResolvedClasses();
 
-      if (!force_save &&
-          delta_number_of_methods < options_.GetMinMethodsToSave() &&
-          delta_number_of_classes < options_.GetMinClassesToSave()) {
+      if (!delta_info.HasMethodOrClassData() ||
+          (!force_save &&
+           delta_number_of_methods < options_.GetMinMethodsToSave() &&
+           delta_number_of_classes < options_.GetMinClassesToSave())) {
         VLOG(profiler) << "Not enough information to save to: " << filename
                        << " Number of methods: " << delta_number_of_methods
                        << " Number of classes: " << delta_number_of_classes;
@@ -533,9 +546,7 @@ bool ProfileSaver::ProcessProfilingInfo(bool force_save, /*out*/uint16_t* number
                      *number_of_new_methods);
       }
       uint64_t bytes_written;
-      // Force the save. In case the profile data is corrupted or the the profile
-      // has the wrong version this will "fix" the file to the correct format.
-      if (info.Save(filename, &bytes_written)) {
+      if (SaveDelta(filename, delta_info, &bytes_written)) {
         // We managed to save the profile. Clear the cache stored during startup.
         if (profile_cache_it != profile_cache_.end()) {
           ProfileCompilationInfo *cached_info = profile_cache_it->second;
@@ -547,10 +558,6 @@ bool ProfileSaver::ProcessProfilingInfo(bool force_save, /*out*/uint16_t* number
           total_bytes_written_ += bytes_written;
           profile_file_saved = true;
         } else {
-          // At this point we could still have avoided the write.
-          // We load and merge the data from the file lazily at its first ever
-          // save attempt. So, whatever we are trying to save could already be
-          // in the file.
           total_number_of_skipped_writes_++;
         }
       } else {
@@ -567,6 +574,100 @@ bool ProfileSaver::ProcessProfilingInfo(bool force_save, /*out*/uint16_t* number
   return profile_file_saved;
 }
 
+ProfileSaver::FileStamp ProfileSaver::GetFileStamp(const std::string& filename) {
+  FileStamp stamp;
+  struct stat stat_buffer;
+  if (stat(filename.c_str(), &stat_buffer) != 0) {
+    stamp.size = -1;
+    stamp.inode = 0;
+    stamp.mtime_ns = 0;
+    return stamp;
+  }
+  stamp.size = stat_buffer.st_size;
+  stamp.inode = stat_buffer.st_ino;
+#if defined(__APPLE__)
+  const struct timespec& mtime = stat_buffer.st_mtimespec;
+#else
+  const struct timespec& mtime = stat_buffer.st_mtim;
+#endif
+  stamp.mtime_ns = static_cast<int64_t>(mtime.tv_sec) * 1000000000 + mtime.tv_nsec;
+  return stamp;
+}
+
+ProfileCompilationInfo* ProfileSaver::GetSavedProfile(const std::string& filename) {
+  FileStamp file_stamp = GetFileStamp(filename);
+  auto it = saved_profiles_.find(filename);
+  if (it != saved_profiles_.end()) {
+    if (it->second.file_stamp == file_stamp) {
+      return it->second.info;
+    }
+    VLOG(profiler) << "Profile " << filename << " changed since the last save, reloading it";
+    delete it->second.info;
+    saved_profiles_.erase(it);
+  }
+  std::unique_ptr<ProfileCompilationInfo> info(
+      new ProfileCompilationInfo(Runtime::Current()->GetArenaPool()));
+  if (!info->Load(filename, /*clear_if_invalid*/ true)) {
+    return nullptr;
+  }
+  SavedProfile saved;
+  saved.info = info.release();
+  saved.journal_entries = saved.info->GetNumberOfJournalEntries();
+  saved.truncated = saved.info->HasTruncatedJournalEntry();
+  // Clearing an invalid profile changes the file.
+  saved.file_stamp = GetFileStamp(filename);
+  saved_profiles_.Put(filename, saved);
+  return saved.info;
+}
+
+bool ProfileSaver::SaveDelta(const std::string& filename,
+                             const ProfileCompilationInfo& delta_info,
+                             /*out*/uint64_t* bytes_written) {
+  auto it = saved_profiles_.find(filename);
+  DCHECK(it != saved_profiles_.end());
+  SavedProfile& saved = it->second;
+  if (!saved.info->MergeWith(delta_info)) {
+    // Most likely a checksum mismatch. Drop the snapshot so it gets reloaded.
+    delete saved.info;
+    saved_profiles_.erase(it);
+    return false;
+  }
+
+  bool compact = options_.GetMaxJournalEntries() == 0 ||
+      saved.journal_entries >= options_.GetMaxJournalEntries() ||
+      saved.truncated ||
+      saved.file_stamp.size <= 0;
+  bool success;
+  if (compact) {
+    // Rewrite the whole profile, folding the journal entries back into a single profile.
+    // In case the profile data is corrupted or the the profile has the wrong version this
+    // will "fix" the file to the correct format.
+    success = saved.info->Save(filename, bytes_written);
+    if (success) {
+      total_number_of_compactions_++;
+      // The file now holds everything, drop the snapshot rather than keep a second copy of the
+      // whole profile in memory. The next save reloads it from disk.
+      delete saved.info;
+      saved_profiles_.erase(it);
+      return true;
+    }
+  } else {
+    success = delta_info.Append(filename, bytes_written);
+    if (success) {
+      saved.journal_entries++;
+      total_number_of_journal_appends_++;
+    }
+  }
+  if (!success) {
+    // The snapshot no longer reflects what is on disk.
+    delete saved.info;
+    saved_profiles_.erase(it);
+    return false;
+  }
+  saved.file_stamp = GetFileStamp(filename);
+  return true;
+}
+
 void* ProfileSaver::RunProfileSaverThread(void* arg) {
   Runtime* runtime = Runtime::Current();
 
@@ -782,7 +883,10 @@ void ProfileSaver::DumpInfo(std::ostream& os) {
      << "ProfileSaver max_number_profile_entries_cached="
      << max_number_of_profile_entries_cached_ << '\n'
      << "ProfileSaver total_number_of_hot_spikes=" << total_number_of_hot_spikes_ << '\n'
-     << "ProfileSaver total_number_of_wake_ups=" << total_number_of_wake_ups_ << '\n';
+     << "ProfileSaver total_number_of_wake_ups=" << total_number_of_wake_ups_ << '\n'
+     << "ProfileSaver total_number_of_journal_appends="
+     << total_number_of_journal_appends_ << '\n'
+     << "ProfileSaver total_number_of_compactions=" << total_number_of_compactions_ << '\n';
 }
 
 
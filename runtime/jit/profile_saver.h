@@ -100,6 +100,18 @@ class ProfileSaver {
 
   void DumpInfo(std::ostream& os);
 
+  // Returns the snapshot of what has been persisted to `filename`, loading it from disk if
+  // needed. Returns null if the file cannot be loaded.
+  ProfileCompilationInfo* GetSavedProfile(const std::string& filename);
+
+  // Persists `delta_info`, which must have been extracted against GetSavedProfile(filename).
+  // The delta is appended to the file as a journal entry unless the journal is full or the file
+  // ends with a partial entry, in which case the whole profile is rewritten and the snapshot is
+  // dropped until the next save.
+  bool SaveDelta(const std::string& filename,
+                 const ProfileCompilationInfo& delta_info,
+                 /*out*/uint64_t* bytes_written);
+
   // Resolve the realpath of the locations stored in tracked_dex_base_locations_to_be_resolved_
   // and put the result in tracked_dex_base_locations_.
   void ResolveTrackedLocations() REQUIRES(!Locks::profiler_lock_);
@@ -133,6 +145,37 @@ class ProfileSaver {
   // to just a few hundreds entries in the ProfileCompilationInfo objects.
   SafeMap<std::string, ProfileCompilationInfo*> profile_cache_;
 
+  // What has been persisted to each tracked file. Saves only write the data that is not part
+  // of the snapshot yet, which keeps the I/O and the merging cost proportional to the amount
+  // of new information rather than to the size of the profile.
+  // Identity of a profile file, used to detect modifications made by someone else (e.g. profman
+  // clearing the profile after merging it). A rewrite to the same size still changes the
+  // modification time, and a replaced file has another inode.
+  struct FileStamp {
+    // -1 if the file could not be stat'ed.
+    int64_t size;
+    ino_t inode;
+    int64_t mtime_ns;
+
+    bool operator==(const FileStamp& other) const {
+      return size == other.size && inode == other.inode && mtime_ns == other.mtime_ns;
+    }
+  };
+  static FileStamp GetFileStamp(const std::string& filename);
+
+  struct SavedProfile {
+    ProfileCompilationInfo* info;
+    // Number of journal entries appended since the last full rewrite.
+    uint32_t journal_entries;
+    // Whether the file ends with a partial journal entry, so that it must be rewritten.
+    bool truncated;
+    // The file after our last write.
+    FileStamp file_stamp;
+  };
+  // What was persisted to each profile since its last full rewrite. Each entry is a complete
+  // copy of the profile, so it is only kept while journal entries are being appended.
+  SafeMap<std::string, SavedProfile> saved_profiles_;
+
   // Save period condition support.
   Mutex wait_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
   ConditionVariable period_condition_ GUARDED_BY(wait_lock_);
@@ -148,6 +191,8 @@ class ProfileSaver {
   uint64_t max_number_of_profile_entries_cached_;
   uint64_t total_number_of_hot_spikes_;
   uint64_t total_number_of_wake_ups_;
+  uint64_t total_number_of_journal_appends_;
+  uint64_t total_number_of_compactions_;
 
   const ProfileSaverOptions options_;
   DISALLOW_COPY_AND_ASSIGN(ProfileSaver);
@@ -29,6 +29,9 @@ struct ProfileSaverOptions {
   static constexpr uint32_t kMinClassesToSave = 10;
   static constexpr uint32_t kMinNotificationBeforeWake = 10;
   static constexpr uint32_t kMaxNotificationBeforeWake = 50;
+  // Number of delta entries appended to a profile before the saver rewrites it in full.
+  // 0 disables the journal: every save rewrites the whole profile.
+  static constexpr uint32_t kMaxJournalEntries = 16;
   static constexpr uint32_t kHotStartupMethodSamplesNotSet = std::numeric_limits<uint32_t>::max();
 
   ProfileSaverOptions() :
@@ -40,6 +43,7 @@ struct ProfileSaverOptions {
     min_classes_to_save_(kMinClassesToSave),
     min_notification_before_wake_(kMinNotificationBeforeWake),
     max_notification_before_wake_(kMaxNotificationBeforeWake),
+    max_journal_entries_(kMaxJournalEntries),
     profile_path_(""),
     profile_boot_class_path_(false) {}
 
@@ -52,6 +56,7 @@ struct ProfileSaverOptions {
       uint32_t min_classes_to_save,
       uint32_t min_notification_before_wake,
       uint32_t max_notification_before_wake,
+      uint32_t max_journal_entries,
       const std::string& profile_path,
       bool profile_boot_class_path)
   : enabled_(enabled),
@@ -62,6 +67,7 @@ struct ProfileSaverOptions {
     min_classes_to_save_(min_classes_to_save),
     min_notification_before_wake_(min_notification_before_wake),
     max_notification_before_wake_(max_notification_before_wake),
+    max_journal_entries_(max_journal_entries),
     profile_path_(profile_path),
     profile_boot_class_path_(profile_boot_class_path) {}
 
@@ -97,6 +103,9 @@ struct ProfileSaverOptions {
   uint32_t GetMaxNotificationBeforeWake() const {
     return max_notification_before_wake_;
   }
+  uint32_t GetMaxJournalEntries() const {
+    return max_journal_entries_;
+  }
   std::string GetProfilePath() const {
     return profile_path_;
   }
@@ -113,6 +122,7 @@ struct ProfileSaverOptions {
         << ", min_classes_to_save_" << pso.min_classes_to_save_
         << ", min_notification_before_wake_" << pso.min_notification_before_wake_
         << ", max_notification_before_wake_" << pso.max_notification_before_wake_
+        << ", max_journal_entries_" << pso.max_journal_entries_
         << ", profile_boot_class_path_" << pso.profile_boot_class_path_;
     return os;
   }
@@ -127,6 +137,7 @@ struct ProfileSaverOptions {
   uint32_t min_classes_to_save_;
   uint32_t min_notification_before_wake_;
   uint32_t max_notification_before_wake_;
+  uint32_t max_journal_entries_;
   std::string profile_path_;
   bool profile_boot_class_path_;
 };
@@ -619,6 +619,21 @@ void MemMap::MadviseDontNeedAndZero() {
   }
 }
 
+bool MemMap::AdviseHugePages() {
+  uint8_t* const huge_begin = AlignUp(begin_, kHugePageSize);
+  uint8_t* const huge_end = AlignDown(begin_ + size_, kHugePageSize);
+  if (huge_begin >= huge_end) {
+    return false;
+  }
+#ifdef MADV_HUGEPAGE
+  if (madvise(huge_begin, huge_end - huge_begin, MADV_HUGEPAGE) == 0) {
+    return true;
+  }
+  PLOG(WARNING) << "madvise(MADV_HUGEPAGE) failed for " << name_;
+#endif
+  return false;
+}
+
 bool MemMap::Sync() {
   bool result;
   if (redzone_size_ != 0) {
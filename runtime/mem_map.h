@@ -25,6 +25,7 @@
 #include <string>
 
 #include "android-base/thread_annotations.h"
+#include "globals.h"
 
 namespace art {
 
@@ -52,6 +53,9 @@ static constexpr bool kMadviseZeroes = false;
 // Otherwise, calls might see uninitialized values.
 class MemMap {
  public:
+  // Size of the transparent huge pages that AdviseHugePages asks for.
+  static constexpr size_t kHugePageSize = 2 * MB;
+
   // Request an anonymous region of length 'byte_count' and a requested base address.
   // Use null as the requested base address if you don't care.
   // "reuse" allows re-mapping an address range from an existing mapping.
@@ -132,6 +136,13 @@ class MemMap {
 
   void MadviseDontNeedAndZero();
 
+  // Ask the kernel to back the map with transparent huge pages (MADV_HUGEPAGE). Only the
+  // kHugePageSize aligned part of the map can get them. Releasing part of a huge page with
+  // madvise(MADV_DONTNEED) still works; the kernel splits the huge page first. Returns false if
+  // no part of the map is aligned or the kernel does not support the advice. The map should not
+  // use ashmem, since huge pages for shared memory are usually disabled.
+  bool AdviseHugePages();
+
   int GetProtect() const {
     return prot_;
   }
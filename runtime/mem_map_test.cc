@@ -23,6 +23,7 @@
 #include "common_runtime_test.h"
 #include "base/memory_tool.h"
 #include "base/unix_file/fd_file.h"
+#include "os.h"
 
 namespace art {
 
@@ -537,4 +538,49 @@ TEST_F(MemMapTest, AlignBy) {
   }
 }
 
+TEST_F(MemMapTest, AdviseHugePages) {
+  CommonInit();
+  std::string error_msg;
+  // A map smaller than a huge page cannot contain an aligned one.
+  std::unique_ptr<MemMap> small(MemMap::MapAnonymous("MemMapTest_AdviseHugePagesTest_small",
+                                                     nullptr,
+                                                     MemMap::kHugePageSize / 2,
+                                                     PROT_READ | PROT_WRITE,
+                                                     false,
+                                                     false,
+                                                     &error_msg,
+                                                     /* use_ashmem */ false));
+  ASSERT_TRUE(small != nullptr) << error_msg;
+  EXPECT_FALSE(small->AdviseHugePages());
+
+  std::unique_ptr<MemMap> map(MemMap::MapAnonymous("MemMapTest_AdviseHugePagesTest_map",
+                                                   nullptr,
+                                                   3 * MemMap::kHugePageSize,
+                                                   PROT_READ | PROT_WRITE,
+                                                   false,
+                                                   false,
+                                                   &error_msg,
+                                                   /* use_ashmem */ false));
+  ASSERT_TRUE(map != nullptr) << error_msg;
+  map->AlignBy(MemMap::kHugePageSize);
+  ASSERT_TRUE(IsAlignedParam(map->Begin(), MemMap::kHugePageSize));
+  // A kernel with transparent huge pages accepts the advice for an aligned anonymous map. Either
+  // way the map must stay usable and releasing a single page out of a huge page must zero it.
+  const bool advised = map->AdviseHugePages();
+#ifdef MADV_HUGEPAGE
+  if (OS::FileExists("/sys/kernel/mm/transparent_hugepage/enabled")) {
+    EXPECT_TRUE(advised);
+  }
+#else
+  EXPECT_FALSE(advised);
+#endif
+  memset(map->Begin(), 0xAB, map->Size());
+  uint8_t* const page = map->Begin() + kPageSize;
+  ASSERT_EQ(madvise(page, kPageSize, MADV_DONTNEED), 0);
+  EXPECT_EQ(page[0], 0u);
+  EXPECT_EQ(page[kPageSize - 1], 0u);
+  EXPECT_EQ(map->Begin()[0], 0xABu);
+  EXPECT_EQ(page[kPageSize], 0xABu);
+}
+
 }  // namespace art
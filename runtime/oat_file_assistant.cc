@@ -28,6 +28,7 @@
 #include "compiler_filter.h"
 #include "class_linker.h"
 #include "exec_utils.h"
+#include "field_layout_profile.h"
 #include "gc/heap.h"
 #include "gc/space/image_space.h"
 #include "image.h"
@@ -460,6 +461,19 @@ OatFileAssistant::OatStatus OatFileAssistant::GivenOatFileStatus(const OatFile&
     return kOatCannotOpen;
   }
 
+  // Verify the field layout profile, the compiled code has the field offsets of that layout.
+  // Files compiled without a profile are fine, the profile is not applied to their classes.
+  const char* field_layout_profile =
+      file.GetOatHeader().GetStoreValueByKey(OatHeader::kFieldLayoutProfileKey);
+  if (field_layout_profile != nullptr) {
+    const FieldLayoutProfile* profile =
+        Runtime::Current()->GetClassLinker()->GetFieldLayoutProfile();
+    if (profile == nullptr || profile->GetChecksum() != field_layout_profile) {
+      VLOG(oat) << "Field layout profile does not match for " << file.GetLocation();
+      return kOatCannotOpen;
+    }
+  }
+
   // Verify the dex checksum.
   std::string error_msg;
   if (kIsVdexEnabled) {
@@ -204,6 +204,7 @@ void JvmtiWeakTable<T>::SweepImpl(art::IsMarkedVisitor* visitor) {
 
   UpdateTableWith<decltype(IsMarkedUpdater),
                   kHandleNull ? kCallHandleNull : kRemoveNull>(IsMarkedUpdater);
+  MarkSweptLocked(self);
 }
 
 template <typename T>
@@ -173,14 +173,42 @@ std::unique_ptr<RuntimeParser> ParsedOptions::MakeParser(bool ignore_unrecognize
       .Define({"-XX:EnableHSpaceCompactForOOM", "-XX:DisableHSpaceCompactForOOM"})
           .WithValues({true, false})
           .IntoKey(M::EnableHSpaceCompactForOOM)
+      .Define({"-XX:NumaAwareRegions", "-XX:NoNumaAwareRegions"})
+          .WithValues({true, false})
+          .IntoKey(M::NumaAwareRegions)
+      .Define({"-XX:GcWorkerNumaAffinity", "-XX:NoGcWorkerNumaAffinity"})
+          .WithValues({true, false})
+          .IntoKey(M::GcWorkerNumaAffinity)
+      .Define("-XX:GcPauseTargetMs=_")  // in ms
+          .WithType<MillisecondsToNanoseconds>()  // store as ns
+          .IntoKey(M::GcPauseTarget)
+      .Define("-XX:GcCpuPercent=_")
+          .WithType<unsigned int>()
+          .WithRange(0, 100)
+          .IntoKey(M::GcCpuPercent)
+      .Define("-XX:IdleTrimDelayMs=_")  // in ms
+          .WithType<MillisecondsToNanoseconds>()  // store as ns
+          .IntoKey(M::IdleTrimDelay)
+      .Define("-XX:IdleTrimCpuPercent=_")
+          .WithType<unsigned int>()
+          .WithRange(0, 100)
+          .IntoKey(M::IdleTrimCpuPercent)
       .Define("-XX:DumpNativeStackOnSigQuit:_")
           .WithType<bool>()
           .WithValueMap({{"false", false}, {"true", true}})
           .IntoKey(M::DumpNativeStackOnSigQuit)
+      .Define("-XX:DumpClassHistogramOnSigQuit:_")
+          .WithType<bool>()
+          .WithValueMap({{"false", false}, {"true", true}})
+          .IntoKey(M::DumpClassHistogramOnSigQuit)
       .Define("-XX:MadviseRandomAccess:_")
           .WithType<bool>()
           .WithValueMap({{"false", false}, {"true", true}})
           .IntoKey(M::MadviseRandomAccess)
+      .Define("-Xusehugepages:_")
+          .WithType<bool>()
+          .WithValueMap({{"false", false}, {"true", true}})
+          .IntoKey(M::UseHugePages)
       .Define("-Xusejit:_")
           .WithType<bool>()
           .WithValueMap({{"false", false}, {"true", true}})
@@ -336,12 +364,39 @@ std::unique_ptr<RuntimeParser> ParsedOptions::MakeParser(bool ignore_unrecognize
       .Define("-X:GcProfileDir:_")
           .WithType<std::string>()
           .IntoKey(M::GcProfileDir)
+      .Define("-XX:GcProfileStreamSize=_")
+          .WithType<Memory<1>>()
+          .IntoKey(M::GcProfileStreamSize)
       .Define("-XX:GcProfAlloc")
           .WithValue(true)
           .IntoKey(M::GcProfAlloc)
       .Define("-XX:GcProfAtStart")
           .WithValue(true)
           .IntoKey(M::GcProfAtStart)
+      .Define("-XX:AllocSampleInterval=_")
+          .WithType<Memory<1>>()
+          .IntoKey(M::AllocSampleInterval)
+      .Define("-XX:AllocSampleProfile=_")
+          .WithType<std::string>()
+          .IntoKey(M::AllocSampleProfile)
+      .Define("-XX:HprofForkDump:_")
+          .WithType<bool>()
+          .WithValueMap({{"false", false}, {"true", true}})
+          .IntoKey(M::HprofForkDump)
+      .Define("-XX:HprofCompress:_")
+          .WithType<bool>()
+          .WithValueMap({{"false", false}, {"true", true}})
+          .IntoKey(M::HprofCompress)
+      .Define("-XX:FieldLayoutProfile=_")
+          .WithType<std::string>()
+          .IntoKey(M::FieldLayoutProfile)
+      .Define("-XX:PretenureAllocationSites:_")
+          .WithType<bool>()
+          .WithValueMap({{"false", false}, {"true", true}})
+          .IntoKey(M::PretenureAllocationSites)
+      .Define("-XX:StartupClassPreloadThreads=_")
+          .WithType<unsigned int>()
+          .IntoKey(M::StartupClassPreloadThreads)
       .Define("-Xplugin:_")
           .WithType<std::vector<Plugin>>().AppendValues()
           .IntoKey(M::Plugins)
@@ -610,7 +665,8 @@ bool ParsedOptions::DoParse(const RuntimeOptions& options,
 
     args.Set(M::BackgroundGc, BackgroundGcOption { background_collector_type_ });
 
-    // If foregroud is SS/GSS/GenCopying, Enable Parallel GC.
+    // If foregroud is SS/GSS/GenCopying, Enable Parallel GC. CC marks in parallel only when
+    // -XX:ParallelGCThreads is given.
     if (collector_type_ == gc::kCollectorTypeGSS ||
         collector_type_ == gc::kCollectorTypeSS||
         collector_type_ == gc::kCollectorTypeGenCopying) {
@@ -740,6 +796,7 @@ void ParsedOptions::Usage(const char* fmt, ...) {
   UsageMessage(stream, "  -Xstacktracefile:<filename>\n");
   UsageMessage(stream, "  -Xgc:[no]preverify\n");
   UsageMessage(stream, "  -Xgc:[no]postverify\n");
+  UsageMessage(stream, "  -Xgc:[no]generational_cc\n");
   UsageMessage(stream, "  -XX:HeapGrowthLimit=N\n");
   UsageMessage(stream, "  -XX:HeapMinFree=N\n");
   UsageMessage(stream, "  -XX:HeapMaxFree=N\n");
@@ -770,10 +827,19 @@ void ParsedOptions::Usage(const char* fmt, ...) {
   UsageMessage(stream, "  -XX:DumpJITInfoOnShutdown\n");
   UsageMessage(stream, "  -XX:IgnoreMaxFootprint\n");
   UsageMessage(stream, "  -XX:UseTLAB\n");
+  UsageMessage(stream, "  -XX:[No]NumaAwareRegions\n");
+  UsageMessage(stream, "  -XX:[No]GcWorkerNumaAffinity\n");
+  UsageMessage(stream, "  -XX:GcPauseTargetMs=integervalue\n");
+  UsageMessage(stream, "  -XX:GcCpuPercent=0-100\n");
+  UsageMessage(stream, "  -XX:IdleTrimDelayMs=integervalue\n");
+  UsageMessage(stream, "  -XX:IdleTrimCpuPercent=0-100\n");
   UsageMessage(stream, "  -XX:BackgroundGC=none\n");
   UsageMessage(stream, "  -XX:LargeObjectSpace={disabled,map,freelist}\n");
   UsageMessage(stream, "  -XX:LargeObjectThreshold=N\n");
   UsageMessage(stream, "  -XX:DumpNativeStackOnSigQuit=booleanvalue\n");
+  UsageMessage(stream, "  -XX:DumpClassHistogramOnSigQuit:booleanvalue (walks the whole heap "
+                       "on every SIGQUIT; with the concurrent copying collector this pauses all "
+                       "threads for the full walk)\n");
   UsageMessage(stream, "  -XX:MadviseRandomAccess:booleanvalue\n");
   UsageMessage(stream, "  -XX:SlowDebug={false,true}\n");
   UsageMessage(stream, "  -Xmethod-trace\n");
@@ -786,11 +852,13 @@ void ParsedOptions::Usage(const char* fmt, ...) {
   UsageMessage(stream, "  -Xps-min-classes-to-save:integervalue\n");
   UsageMessage(stream, "  -Xps-min-notification-before-wake:integervalue\n");
   UsageMessage(stream, "  -Xps-max-notification-before-wake:integervalue\n");
+  UsageMessage(stream, "  -Xps-max-journal-entries:integervalue\n");
   UsageMessage(stream, "  -Xps-profile-path:file-path\n");
   UsageMessage(stream, "  -Xcompiler:filename\n");
   UsageMessage(stream, "  -Xcompiler-option dex2oat-option\n");
   UsageMessage(stream, "  -Ximage-compiler-option dex2oat-option\n");
   UsageMessage(stream, "  -Xpatchoat:filename\n");
+  UsageMessage(stream, "  -Xusehugepages:booleanvalue\n");
   UsageMessage(stream, "  -Xusejit:booleanvalue\n");
   UsageMessage(stream, "  -Xjitinitialsize:N\n");
   UsageMessage(stream, "  -Xjitmaxsize:N\n");
@@ -846,8 +914,16 @@ void ParsedOptions::Usage(const char* fmt, ...) {
   UsageMessage(stream, "  -XX:mainThreadStackSize=N\n");
   UsageMessage(stream, "  -XX:GcProfile\n");
   UsageMessage(stream, "  -XGcProfileDir:dirname\n");
+  UsageMessage(stream, "  -XX:GcProfileStreamSize=N\n");
   UsageMessage(stream, "  -XX:GcProfAlloc\n");
   UsageMessage(stream, "  -XX:GcProfAtStart\n");
+  UsageMessage(stream, "  -XX:AllocSampleInterval=N\n");
+  UsageMessage(stream, "  -XX:AllocSampleProfile=filename\n");
+  UsageMessage(stream, "  -XX:HprofForkDump:booleanvalue\n");
+  UsageMessage(stream, "  -XX:HprofCompress:booleanvalue\n");
+  UsageMessage(stream, "  -XX:FieldLayoutProfile=filename\n");
+  UsageMessage(stream, "  -XX:PretenureAllocationSites:booleanvalue\n");
+  UsageMessage(stream, "  -XX:StartupClassPreloadThreads=integervalue\n");
   UsageMessage(stream, "\n");
 
   Exit((error) ? 1 : 0);
@@ -63,8 +63,10 @@
 #include "base/enums.h"
 #include "base/stl_util.h"
 #include "base/systrace.h"
+#include "base/time_utils.h"
 #include "base/unix_file/fd_file.h"
 #include "class_linker-inl.h"
+#include "class_preloader.h"
 #include "compiler_callbacks.h"
 #ifdef __ANDROID__
 #include "cutils/properties.h"
@@ -74,12 +76,15 @@
 #include "entrypoints/runtime_asm_entrypoints.h"
 #include "experimental_flags.h"
 #include "fault_handler.h"
+#include "field_layout_profile.h"
 #include "gc/accounting/card_table-inl.h"
+#include "gc/allocation_sampler.h"
 #include "gc/heap.h"
 #include "gc/scoped_gc_critical_section.h"
 #include "gc/space/image_space.h"
 #include "gc/space/space-inl.h"
 #include "gc/system_weak.h"
+#include "gc/task_processor.h"
 #include "handle_scope-inl.h"
 #include "image-inl.h"
 #include "instrumentation.h"
@@ -248,8 +253,11 @@ Runtime::Runtime()
       dump_gc_performance_on_shutdown_(false),
       enable_gcprofile_(false),
       gcprofile_dir_("/data/local/tmp/gcprofile"),
+      gcprofile_stream_size_(0),
+      alloc_sample_profile_(),
       enable_succ_alloc_profile_(false),
       enable_gcprofile_at_start_(false),
+      class_preload_threads_(0u),
       preinitialization_transaction_(nullptr),
       verify_(verifier::VerifyMode::kNone),
       allow_dex_file_fallback_(true),
@@ -267,8 +275,12 @@ Runtime::Runtime()
       experimental_flags_(ExperimentalFlags::kNone),
       oat_file_manager_(nullptr),
       is_low_memory_mode_(false),
+      use_huge_pages_(false),
+      hprof_fork_dump_(false),
+      hprof_compress_(false),
       safe_mode_(false),
       dump_native_stack_on_sig_quit_(true),
+      dump_class_histogram_on_sig_quit_(false),
       pruned_dalvik_cache_(false),
       // Initially assume we perceive jank in case the process state is never updated.
       process_state_(kProcessStateJankPerceptible),
@@ -307,6 +319,14 @@ Runtime::~Runtime() {
     heap_->DumpGcPerformanceInfo(LOG_STREAM(INFO));
   }
 
+  if (heap_->GetAllocationSampler() != nullptr && !alloc_sample_profile_.empty()) {
+    ScopedObjectAccess soa(self);
+    std::string error_msg;
+    if (!heap_->GetAllocationSampler()->WriteProfile(alloc_sample_profile_, &error_msg)) {
+      LOG(WARNING) << error_msg;
+    }
+  }
+
   if (jit_ != nullptr) {
     // Stop the profile saver thread before marking the runtime as shutting down.
     // The saver will try to dump the profiles before being sopped and that
@@ -360,6 +380,9 @@ Runtime::~Runtime() {
     // JIT compiler threads.
     jit_->DeleteThreadPool();
   }
+  if (class_preloader_ != nullptr) {
+    DeleteClassPreloader();
+  }
 
   // Make sure our internal threads are dead before we start tearing down things they're using.
   Dbg::StopJdwp();
@@ -585,9 +608,10 @@ void Runtime::CallExitHook(jint status) {
 }
 
 void Runtime::SweepSystemWeaks(IsMarkedVisitor* visitor) {
+  // Sweep the tables whose readers block on the sweep first, so that they are released early.
   GetInternTable()->SweepInternTableWeaks(visitor);
-  GetMonitorList()->SweepMonitorList(visitor);
   GetJavaVM()->SweepJniWeakGlobals(visitor);
+  GetMonitorList()->SweepMonitorList(visitor);
   GetHeap()->SweepAllocationRecords(visitor);
   if (GetJit() != nullptr) {
     // Visit JIT literal tables. Objects in these tables are classes and strings
@@ -1143,6 +1167,8 @@ bool Runtime::Init(RuntimeArgumentMap&& runtime_options_in) {
   dex2oat_enabled_ = runtime_options.GetOrDefault(Opt::Dex2Oat);
   image_dex2oat_enabled_ = runtime_options.GetOrDefault(Opt::ImageDex2Oat);
   dump_native_stack_on_sig_quit_ = runtime_options.GetOrDefault(Opt::DumpNativeStackOnSigQuit);
+  dump_class_histogram_on_sig_quit_ =
+      runtime_options.GetOrDefault(Opt::DumpClassHistogramOnSigQuit);
 
   vfprintf_ = runtime_options.GetOrDefault(Opt::HookVfprintf);
   exit_ = runtime_options.GetOrDefault(Opt::HookExit);
@@ -1195,6 +1221,9 @@ bool Runtime::Init(RuntimeArgumentMap&& runtime_options_in) {
   experimental_flags_ = runtime_options.GetOrDefault(Opt::Experimental);
   is_low_memory_mode_ = runtime_options.Exists(Opt::LowMemoryMode);
   madvise_random_access_ = runtime_options.GetOrDefault(Opt::MadviseRandomAccess);
+  use_huge_pages_ = runtime_options.GetOrDefault(Opt::UseHugePages);
+  hprof_fork_dump_ = runtime_options.GetOrDefault(Opt::HprofForkDump);
+  hprof_compress_ = runtime_options.GetOrDefault(Opt::HprofCompress);
 
   plugins_ = runtime_options.ReleaseOrDefault(Opt::Plugins);
   agents_ = runtime_options.ReleaseOrDefault(Opt::AgentPath);
@@ -1215,7 +1244,10 @@ bool Runtime::Init(RuntimeArgumentMap&& runtime_options_in) {
 
   enable_gcprofile_ = runtime_options.GetOrDefault(Opt::GcProfile);
   gcprofile_dir_ = runtime_options.ReleaseOrDefault(Opt::GcProfileDir);
+  gcprofile_stream_size_ = runtime_options.GetOrDefault(Opt::GcProfileStreamSize);
+  alloc_sample_profile_ = runtime_options.ReleaseOrDefault(Opt::AllocSampleProfile);
   enable_succ_alloc_profile_ = runtime_options.GetOrDefault(Opt::GcProfAlloc);
+  class_preload_threads_ = runtime_options.GetOrDefault(Opt::StartupClassPreloadThreads);
   enable_gcprofile_at_start_ = runtime_options.GetOrDefault(Opt::GcProfAtStart);
 
   heap_ = new gc::Heap(runtime_options.GetOrDefault(Opt::MemoryInitialSize),
@@ -1232,6 +1264,7 @@ bool Runtime::Init(RuntimeArgumentMap&& runtime_options_in) {
                        kUseReadBarrier ? gc::kCollectorTypeCC : xgc_option.collector_type_,
                        kUseReadBarrier ? BackgroundGcOption(gc::kCollectorTypeCCBackground)
                                        : runtime_options.GetOrDefault(Opt::BackgroundGc),
+                       xgc_option.generational_cc_,
                        runtime_options.GetOrDefault(Opt::LargeObjectSpace),
                        runtime_options.GetOrDefault(Opt::LargeObjectThreshold),
                        runtime_options.GetOrDefault(Opt::ParallelGCThreads),
@@ -1241,6 +1274,11 @@ bool Runtime::Init(RuntimeArgumentMap&& runtime_options_in) {
                        runtime_options.GetOrDefault(Opt::LongGCLogThreshold),
                        runtime_options.Exists(Opt::IgnoreMaxFootprint),
                        runtime_options.GetOrDefault(Opt::UseTLAB),
+                       runtime_options.GetOrDefault(Opt::NumaAwareRegions),
+                       runtime_options.GetOrDefault(Opt::GcWorkerNumaAffinity),
+                       runtime_options.GetOrDefault(Opt::GcPauseTarget),
+                       runtime_options.GetOrDefault(Opt::GcCpuPercent),
+                       use_huge_pages_,
                        xgc_option.verify_pre_gc_heap_,
                        xgc_option.verify_pre_sweeping_heap_,
                        xgc_option.verify_post_gc_heap_,
@@ -1294,8 +1332,20 @@ bool Runtime::Init(RuntimeArgumentMap&& runtime_options_in) {
   }
   linear_alloc_.reset(CreateLinearAlloc());
 
+  const uint64_t idle_trim_delay = runtime_options.GetOrDefault(Opt::IdleTrimDelay);
+  if (idle_trim_delay != 0) {
+    GetHeap()->EnableIdleTrim(idle_trim_delay,
+                              runtime_options.GetOrDefault(Opt::IdleTrimCpuPercent));
+  }
+
+  const size_t alloc_sample_interval = runtime_options.GetOrDefault(Opt::AllocSampleInterval);
+  if (alloc_sample_interval != 0) {
+    GetHeap()->EnableAllocationSampling(alloc_sample_interval);
+  }
+
   if (enable_gcprofile_) {
     GetHeap()->GCProfileSetDir(gcprofile_dir_);
+    GetHeap()->GCProfileSetStreamSize(gcprofile_stream_size_);
     GetHeap()->GCProfileEnableSuccAllocProfile(enable_succ_alloc_profile_);
   } else {
     enable_succ_alloc_profile_ = false;
@@ -1379,12 +1429,26 @@ bool Runtime::Init(RuntimeArgumentMap&& runtime_options_in) {
   // Now we're attached, we can take the heap locks and validate the heap.
   GetHeap()->EnableObjectValidation();
 
+  if (runtime_options.GetOrDefault(Opt::PretenureAllocationSites) && !IsAotCompiler()) {
+    GetHeap()->EnableAllocationSiteTracking();
+  }
+
   CHECK_GE(GetHeap()->GetContinuousSpaces().size(), 1U);
   if (UNLIKELY(IsAotCompiler())) {
     class_linker_ = new AotClassLinker(intern_table_);
   } else {
     class_linker_ = new ClassLinker(intern_table_);
   }
+  if (runtime_options.Exists(Opt::FieldLayoutProfile)) {
+    std::unique_ptr<FieldLayoutProfile> field_layout_profile =
+        FieldLayoutProfile::Create(runtime_options.GetOrDefault(Opt::FieldLayoutProfile),
+                                   &error_msg);
+    if (field_layout_profile == nullptr) {
+      LOG(WARNING) << error_msg;
+    } else {
+      class_linker_->SetFieldLayoutProfile(std::move(field_layout_profile));
+    }
+  }
   if (GetHeap()->HasBootImageSpace()) {
     bool result = class_linker_->InitFromBootImage(&error_msg);
     if (!result) {
@@ -1738,6 +1802,13 @@ void Runtime::DumpForSigQuit(std::ostream& os) {
   GetJavaVM()->DumpForSigQuit(os);
   GetHeap()->DumpForSigQuit(os);
   oat_file_manager_->DumpForSigQuit(os);
+  {
+    // The class preloader is deleted with the threads suspended.
+    ReaderMutexLock mu(Thread::Current(), *Locks::mutator_lock_);
+    if (class_preloader_ != nullptr) {
+      class_preloader_->Dump(os);
+    }
+  }
   if (GetJit() != nullptr) {
     GetJit()->DumpForSigQuit(os);
   } else {
@@ -2065,6 +2136,15 @@ void Runtime::AllowNewSystemWeaks() {
   }
 }
 
+void Runtime::MarkSystemWeaksUnswept() {
+  CHECK(kUseReadBarrier);
+  intern_table_->MarkWeaksUnswept();
+  java_vm_->MarkWeakGlobalsUnswept();
+  for (gc::AbstractSystemWeakHolder* holder : system_weak_holders_) {
+    holder->MarkUnswept();
+  }
+}
+
 void Runtime::BroadcastForNewSystemWeaks(bool broadcast_for_checkpoint) {
   // This is used for the read barrier case that uses the thread-local
   // Thread::GetWeakRefAccessEnabled() flag and the checkpoint while weak ref access is disabled
@@ -2136,8 +2216,53 @@ void Runtime::ClearCalleeSaveMethods() {
   }
 }
 
+// Deletes the class preloader once the startup period is over. The profile only records the
+// classes resolved during that period, so what is still queued by then is left to its first use.
+class DeleteClassPreloaderTask FINAL : public gc::HeapTask {
+ public:
+  explicit DeleteClassPreloaderTask(uint64_t target_time) : gc::HeapTask(target_time) {}
+
+  void Run(Thread* self ATTRIBUTE_UNUSED) OVERRIDE {
+    Runtime::Current()->DeleteClassPreloader();
+  }
+};
+
+void Runtime::DeleteClassPreloader() {
+  ScopedTrace trace("Delete class preloader");
+  std::unique_ptr<ClassPreloader> class_preloader;
+  {
+    ScopedSuspendAll ssa(__FUNCTION__);
+    // Clear the field while the threads are suspended, RegisterDexFile checks against it.
+    class_preloader = std::move(class_preloader_);
+  }
+  if (class_preloader != nullptr) {
+    VLOG(class_linker) << "Deleting class preloader after "
+                       << class_preloader->GetLoadedCount() << " classes";
+    // Skips the queued classes and stops the worker threads.
+    class_preloader.reset();
+  }
+}
+
 void Runtime::RegisterAppInfo(const std::vector<std::string>& code_paths,
                               const std::string& profile_output_filename) {
+  if (class_preload_threads_ != 0u &&
+      class_preloader_ == nullptr &&
+      !profile_output_filename.empty()) {
+    std::string error_msg;
+    class_preloader_ =
+        ClassPreloader::Create(profile_output_filename, class_preload_threads_, &error_msg);
+    if (class_preloader_ == nullptr) {
+      VLOG(class_linker) << "Not preloading startup classes: " << error_msg;
+    } else {
+      // Don't keep the worker threads and the profile past the startup period, which is when the
+      // profile saver records the startup classes.
+      const uint64_t startup_ns =
+          MsToNs(jit_options_->GetProfileSaverOptions().GetSaveResolvedClassesDelayMs());
+      GetHeap()->GetTaskProcessor()->AddTask(
+          Thread::Current(), new DeleteClassPreloaderTask(NanoTime() + startup_ns));
+    }
+  }
+
   if (jit_.get() == nullptr) {
     // We are not JITing. Nothing to do.
     return;
@@ -73,6 +73,7 @@ class ArenaPool;
 class ArtMethod;
 enum class CalleeSaveType: uint32_t;
 class ClassLinker;
+class ClassPreloader;
 class CompilerCallbacks;
 class DexFile;
 class InternTable;
@@ -311,6 +312,9 @@ class Runtime {
   // checkpoint requests. It's false when we broadcast to unblock blocking threads after system weak
   // access is reenabled.
   void BroadcastForNewSystemWeaks(bool broadcast_for_checkpoint = false);
+  // Used by the read barrier collector before it disables weak ref access. Each weak table becomes
+  // readable again as soon as SweepSystemWeaks has swept it, rather than after all are swept.
+  void MarkSystemWeaksUnswept();
 
   static const char* GetArtExtensionVersion() {
     return art_extension_version;
@@ -438,6 +442,15 @@ class Runtime {
     return jit_.get();
   }
 
+  // Returns null unless the startup classes of the app are preloaded.
+  ClassPreloader* GetClassPreloader() const {
+    return class_preloader_.get();
+  }
+
+  // Stops preloading the startup classes and deletes the preloader's threads and profile. Called
+  // by a heap task once the startup period is over, and on shutdown.
+  void DeleteClassPreloader() REQUIRES(!Locks::mutator_lock_);
+
   // Returns true if JIT compilations are enabled. GetJit() will be not null in this case.
   bool UseJitCompilation() const;
 
@@ -614,6 +627,10 @@ class Runtime {
     return dump_native_stack_on_sig_quit_;
   }
 
+  bool GetDumpClassHistogramOnSigQuit() const {
+    return dump_class_histogram_on_sig_quit_;
+  }
+
   bool GetPrunedDalvikCache() const {
     return pruned_dalvik_cache_;
   }
@@ -701,6 +718,21 @@ class Runtime {
     return madvise_random_access_;
   }
 
+  // Whether the heap spaces and the JIT code cache are advised to use transparent huge pages.
+  bool UseHugePages() const {
+    return use_huge_pages_;
+  }
+
+  // Whether heap dumps to a file are taken from a forked child process.
+  bool ShouldForkHprofDump() const {
+    return hprof_fork_dump_;
+  }
+
+  // Whether heap dumps to a file are gzip compressed.
+  bool ShouldCompressHprof() const {
+    return hprof_compress_;
+  }
+
  private:
   static void InitPlatformSignalHandlers();
 
@@ -872,11 +904,22 @@ class Runtime {
   // Dir path for saving gc profile data, used with setprop "-XGcProfileDir:filename".
   std::string gcprofile_dir_;
 
+  // Size of each binary trace file when streaming gc profile records, 0 to dump .csv files.
+  size_t gcprofile_stream_size_;
+
+  // Where the sampled allocation profile is written at shutdown, if allocation sampling is on.
+  std::string alloc_sample_profile_;
+
   // Enable gc profiling for success allocation info.
   bool enable_succ_alloc_profile_;
 
   // Enabling gc profiling at process start up. Must combine with setprop "-XX:GcProfile".
   bool enable_gcprofile_at_start_;
+
+  // Number of threads preloading the startup classes of the app, 0 to not preload them.
+  size_t class_preload_threads_;
+  std::unique_ptr<ClassPreloader> class_preloader_;
+
   // Transaction used for pre-initializing classes at compilation time.
   Transaction* preinitialization_transaction_;
 
@@ -950,12 +993,26 @@ class Runtime {
   // This is beneficial for low RAM devices since it reduces page cache thrashing.
   bool madvise_random_access_;
 
+  // Whether the heap spaces and the JIT code cache are advised to use transparent huge pages.
+  bool use_huge_pages_;
+
+  // Whether heap dumps to a file are taken from a forked child process, so that the other threads
+  // are only suspended while forking.
+  bool hprof_fork_dump_;
+
+  // Whether heap dumps to a file are gzip compressed.
+  bool hprof_compress_;
+
   // Whether the application should run in safe mode, that is, interpreter only.
   bool safe_mode_;
 
   // Whether threads should dump their native stack on SIGQUIT.
   bool dump_native_stack_on_sig_quit_;
 
+  // Whether the SIGQUIT dump includes a class histogram of the heap, compared with the previous
+  // SIGQUIT dump.
+  bool dump_class_histogram_on_sig_quit_;
+
   // Whether the dalvik cache was pruned when initializing the runtime.
   bool pruned_dalvik_cache_;
   // Version of ART Extension
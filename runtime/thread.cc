@@ -53,6 +53,7 @@
 #include "gc/accounting/card_table-inl.h"
 #include "gc/accounting/heap_bitmap-inl.h"
 #include "gc/allocator/rosalloc.h"
+#include "gc/gcprofiler.h"
 #include "gc/heap.h"
 #include "gc/space/space-inl.h"
 #include "gc_root.h"
@@ -2041,7 +2042,8 @@ Thread::Thread(bool daemon)
     : tls32_(daemon),
       wait_monitor_(nullptr),
       custom_tls_(nullptr),
-      can_call_into_java_(true) {
+      can_call_into_java_(true),
+      is_gc_marking_worker_(false) {
   wait_mutex_ = new Mutex("a thread wait mutex");
   wait_cond_ = new ConditionVariable("a thread wait condition variable", *wait_mutex_);
   tlsPtr_.instrumentation_stack = new std::deque<instrumentation::InstrumentationStackFrame>;
@@ -2062,6 +2064,7 @@ Thread::Thread(bool daemon)
   }
   tlsPtr_.flip_function = nullptr;
   tlsPtr_.thread_local_mark_stack = nullptr;
+  tlsPtr_.gc_profiler_buffer = nullptr;
   tls32_.is_transitioning_to_runnable = false;
 }
 
@@ -2215,6 +2218,11 @@ Thread::~Thread() {
   delete wait_cond_;
   delete wait_mutex_;
 
+  if (tlsPtr_.gc_profiler_buffer != nullptr) {
+    gc::GcProfiler::GetInstance()->RetireThreadBuffer(tlsPtr_.gc_profiler_buffer);
+    tlsPtr_.gc_profiler_buffer = nullptr;
+  }
+
   if (tlsPtr_.long_jump_context != nullptr) {
     delete tlsPtr_.long_jump_context;
   }
@@ -2904,6 +2912,7 @@ void Thread::DumpThreadOffset(std::ostream& os, uint32_t offset) {
   QUICK_ENTRY_POINT_INFO(pAllocObjectResolved)
   QUICK_ENTRY_POINT_INFO(pAllocObjectInitialized)
   QUICK_ENTRY_POINT_INFO(pAllocObjectWithChecks)
+  QUICK_ENTRY_POINT_INFO(pAllocObjectNonMoving)
   QUICK_ENTRY_POINT_INFO(pAllocStringFromBytes)
   QUICK_ENTRY_POINT_INFO(pAllocStringFromChars)
   QUICK_ENTRY_POINT_INFO(pAllocStringFromString)
@@ -3552,6 +3561,11 @@ void Thread::SetStackEndForStackOverflow() {
 void Thread::SetTlab(uint8_t* start, uint8_t* end, uint8_t* limit) {
   DCHECK_LE(start, end);
   DCHECK_LE(end, limit);
+  if (tlsPtr_.thread_local_start != nullptr) {
+    // The current TLAB is being retired, either for a refill or because the GC revokes it.
+    Runtime::Current()->GetHeap()->RecordTlabRetirement(
+        tlsPtr_.thread_local_limit - tlsPtr_.thread_local_pos);
+  }
   tlsPtr_.thread_local_start = start;
   tlsPtr_.thread_local_pos  = tlsPtr_.thread_local_start;
   tlsPtr_.thread_local_end = end;
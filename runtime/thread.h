@@ -54,6 +54,7 @@ namespace accounting {
 namespace collector {
   class SemiSpace;
 }  // namespace collector
+class GcProfilerThreadBuffer;
 }  // namespace gc
 
 namespace mirror {
@@ -117,7 +118,7 @@ enum class StackedShadowFrameType {
 };
 
 // This should match RosAlloc::kNumThreadLocalSizeBrackets.
-static constexpr size_t kNumRosAllocThreadLocalSizeBracketsInThread = 16;
+static constexpr size_t kNumRosAllocThreadLocalSizeBracketsInThread = 24;
 
 // Thread's stack layout for implicit stack overflow checks:
 //
@@ -275,6 +276,13 @@ class Thread {
     tlsPtr_.thread_local_mark_stack = stack;
   }
 
+  gc::GcProfilerThreadBuffer* GetGcProfilerBuffer() const {
+    return tlsPtr_.gc_profiler_buffer;
+  }
+  void SetGcProfilerBuffer(gc::GcProfilerThreadBuffer* buffer) {
+    tlsPtr_.gc_profiler_buffer = buffer;
+  }
+
   // Called when thread detected that the thread_suspend_count_ was non-zero. Gives up share of
   // mutator_lock_ and waits until it is resumed and thread_suspend_count_ is zero.
   void FullSuspendCheck()
@@ -927,6 +935,50 @@ class Thread {
     can_call_into_java_ = can_call_into_java;
   }
 
+  // Returns true while the thread marks as a parallel marking worker of the concurrent copying
+  // collector.
+  bool IsGcMarkingWorker() const {
+    return is_gc_marking_worker_;
+  }
+
+  void SetIsGcMarkingWorker(bool is_gc_marking_worker) {
+    is_gc_marking_worker_ = is_gc_marking_worker;
+  }
+
+  // Allocation rate of this thread, used by Heap::AllocWithNewTLAB to size its TLABs. Only the
+  // thread itself reads and writes it.
+  struct TlabSizing {
+    // The TLAB (or partial TLAB chunk) size requested on the next refill, 0 before the first one.
+    size_t desired_size = 0;
+    // The TLAB bytes and refills this thread took since the current epoch began.
+    size_t epoch_bytes = 0;
+    size_t epoch_refills = 0;
+    // The heap's TLAB sizing epoch, i.e. the number of completed GCs, this state belongs to.
+    uint32_t epoch = 0;
+  };
+
+  TlabSizing* GetTlabSizing() {
+    return &tlab_sizing_;
+  }
+
+  // Allocation sampling state, see gc::AllocationSampler. Only the thread itself reads and writes
+  // it.
+  struct AllocSampling {
+    // The bytes past the end of the TLAB before the next sample point. 0 if the TLAB end was
+    // lowered to the sample point, which keeps the allocation fast paths from crossing it.
+    size_t bytes_left = 0;
+    // False until the thread drew its first sample point.
+    bool armed = false;
+    // Set by a TLAB refill that charged the allocation in progress.
+    bool charged = false;
+    // Set when the allocation in progress reached the sample point.
+    bool take_sample = false;
+  };
+
+  AllocSampling* GetAllocSampling() {
+    return &alloc_sampling_;
+  }
+
   // Activates single step control for debugging. The thread takes the
   // ownership of the given SingleStepControl*. It is deleted by a call
   // to DeactivateSingleStepControl or upon thread destruction.
@@ -1509,7 +1561,8 @@ class Thread {
       thread_local_objects(0), mterp_current_ibase(nullptr), mterp_default_ibase(nullptr),
       mterp_alt_ibase(nullptr), thread_local_alloc_stack_top(nullptr),
       thread_local_alloc_stack_end(nullptr),
-      flip_function(nullptr), method_verifier(nullptr), thread_local_mark_stack(nullptr) {
+      flip_function(nullptr), method_verifier(nullptr), thread_local_mark_stack(nullptr),
+      gc_profiler_buffer(nullptr) {
       std::fill(held_mutexes, held_mutexes + kLockLevelCount, nullptr);
     }
 
@@ -1666,6 +1719,9 @@ class Thread {
 
     // Thread-local mark stack for the concurrent copying collector.
     gc::accounting::AtomicStack<mirror::Object>* thread_local_mark_stack;
+
+    // Successful allocations recorded for the GcProfiler, owned by the GcProfiler.
+    gc::GcProfilerThreadBuffer* gc_profiler_buffer;
   } tlsPtr_;
 
   // Guards the 'wait_monitor_' members.
@@ -1693,6 +1749,16 @@ class Thread {
   // By default this is true.
   bool can_call_into_java_;
 
+  // True while the thread runs a parallel marking task of the concurrent copying collector. Only
+  // the thread itself reads and writes it.
+  bool is_gc_marking_worker_;
+
+  // Adaptive TLAB sizing state, see GetTlabSizing().
+  TlabSizing tlab_sizing_;
+
+  // Allocation sampling state, see GetAllocSampling().
+  AllocSampling alloc_sampling_;
+
   friend class Dbg;  // For SetStateUnsafe.
   friend class gc::collector::SemiSpace;  // For getting stack traces.
   friend class Runtime;  // For CreatePeer.
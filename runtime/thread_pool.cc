@@ -17,6 +17,7 @@
 #include "thread_pool.h"
 
 #include <pthread.h>
+#include <sched.h>
 
 #include <sys/mman.h>
 #include <sys/time.h>
@@ -31,6 +32,7 @@
 #include "base/time_utils.h"
 #include "runtime.h"
 #include "thread-current-inl.h"
+#include "utils.h"
 
 namespace art {
 
@@ -76,6 +78,30 @@ void ThreadPoolWorker::SetPthreadPriority(int priority) {
 #endif
 }
 
+bool ThreadPoolWorker::SetNumaAffinity(uint32_t node) {
+#if defined(__linux__)
+  std::vector<uint32_t> cpus;
+  if (!GetNumaNodeCpus(node, &cpus) || cpus.empty()) {
+    return false;
+  }
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  for (uint32_t cpu : cpus) {
+    if (cpu < CPU_SETSIZE) {
+      CPU_SET(cpu, &cpu_set);
+    }
+  }
+  if (sched_setaffinity(thread_->GetTid(), sizeof(cpu_set), &cpu_set) != 0) {
+    PLOG(WARNING) << "Failed to pin " << name_ << " to NUMA node " << node;
+    return false;
+  }
+  return true;
+#else
+  UNUSED(node);
+  return false;
+#endif
+}
+
 void ThreadPoolWorker::Run() {
   Thread* self = Thread::Current();
   Task* task = nullptr;
@@ -251,4 +277,11 @@ void ThreadPool::SetPthreadPriority(int priority) {
   }
 }
 
+void ThreadPool::SetNumaAffinity(size_t num_nodes) {
+  DCHECK_GT(num_nodes, 0u);
+  for (size_t i = 0; i < threads_.size(); ++i) {
+    threads_[i]->SetNumaAffinity(i % num_nodes);
+  }
+}
+
 }  // namespace art
@@ -62,6 +62,9 @@ class ThreadPoolWorker {
   // Set the "nice" priorty for this worker.
   void SetPthreadPriority(int priority);
 
+  // Restrict this worker to the cpus of the given NUMA node. Returns false on failure.
+  bool SetNumaAffinity(uint32_t node);
+
   Thread* GetThread() const { return thread_; }
 
  protected:
@@ -132,6 +135,10 @@ class ThreadPool {
   // Set the "nice" priorty for threads in the pool.
   void SetPthreadPriority(int priority);
 
+  // Spread the workers round-robin over the given number of NUMA nodes and pin each one to the
+  // cpus of its node.
+  void SetNumaAffinity(size_t num_nodes);
+
  protected:
   // get a task to run, blocks if there are no tasks left
   virtual Task* GetTask(Thread* self) REQUIRES(!task_queue_lock_);
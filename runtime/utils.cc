@@ -24,6 +24,7 @@
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <unistd.h>
+#include <algorithm>
 #include <memory>
 
 #include "android-base/stringprintf.h"
@@ -734,6 +735,65 @@ void GetTaskStats(pid_t tid, char* state, int* utime, int* stime, int* task_cpu)
   *task_cpu = strtoull(fields[36].c_str(), nullptr, 10);
 }
 
+bool ParseCpuList(const std::string& list, std::vector<uint32_t>* ids) {
+  std::vector<std::string> ranges;
+  Split(android::base::Trim(list), ',', &ranges);
+  for (const std::string& range : ranges) {
+    size_t dash = range.find('-');
+    char* end = nullptr;
+    uint64_t first = strtoull(range.c_str(), &end, 10);
+    if (end == range.c_str() || (dash == std::string::npos ? *end != '\0' : *end != '-')) {
+      return false;
+    }
+    uint64_t last = first;
+    if (dash != std::string::npos) {
+      const char* last_str = range.c_str() + dash + 1;
+      last = strtoull(last_str, &end, 10);
+      if (end == last_str || *end != '\0' || last < first) {
+        return false;
+      }
+    }
+    for (uint64_t id = first; id <= last; ++id) {
+      ids->push_back(static_cast<uint32_t>(id));
+    }
+  }
+  return true;
+}
+
+size_t GetNumaNodeCount() {
+  static const size_t node_count = []() {
+    std::string possible;
+    std::vector<uint32_t> nodes;
+    if (!ReadFileToString("/sys/devices/system/node/possible", &possible) ||
+        !ParseCpuList(possible, &nodes) ||
+        nodes.empty()) {
+      return static_cast<size_t>(1);
+    }
+    return static_cast<size_t>(*std::max_element(nodes.begin(), nodes.end())) + 1;
+  }();
+  return node_count;
+}
+
+uint32_t GetCurrentNumaNode() {
+#if defined(__linux__) && defined(__NR_getcpu)
+  unsigned int cpu = 0;
+  unsigned int node = 0;
+  if (syscall(__NR_getcpu, &cpu, &node, nullptr) == 0) {
+    return node;
+  }
+#endif
+  return 0;
+}
+
+bool GetNumaNodeCpus(uint32_t node, std::vector<uint32_t>* cpus) {
+  std::string cpu_list;
+  if (!ReadFileToString(StringPrintf("/sys/devices/system/node/node%u/cpulist", node),
+                        &cpu_list)) {
+    return false;
+  }
+  return ParseCpuList(cpu_list, cpus);
+}
+
 static const char* GetAndroidDirSafe(const char* env_var,
                                      const char* default_dir,
                                      std::string* error_msg) {
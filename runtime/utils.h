@@ -137,6 +137,19 @@ std::string GetThreadName(pid_t tid);
 // Reads data from "/proc/self/task/${tid}/stat".
 void GetTaskStats(pid_t tid, char* state, int* utime, int* stime, int* task_cpu);
 
+// Parses a kernel cpu/node list such as "0-3,8,10-11" into the individual ids it names.
+// Returns false if the list is malformed.
+bool ParseCpuList(const std::string& list, std::vector<uint32_t>* ids);
+
+// Returns the number of NUMA nodes the kernel reports as possible, or 1 if it reports none.
+size_t GetNumaNodeCount();
+
+// Returns the NUMA node the calling thread is running on, or 0 if it cannot be determined.
+uint32_t GetCurrentNumaNode();
+
+// Reads the cpus that belong to the given NUMA node. Returns false if the node is unknown.
+bool GetNumaNodeCpus(uint32_t node, std::vector<uint32_t>* cpus);
+
 // Sets the name of the current thread. The name may be truncated to an
 // implementation-defined limit.
 void SetThreadName(const char* thread_name);
@@ -277,6 +277,30 @@ TEST_F(UtilsTest, Split) {
   EXPECT_EQ(expected, actual);
 }
 
+TEST_F(UtilsTest, ParseCpuList) {
+  std::vector<uint32_t> ids;
+  EXPECT_TRUE(ParseCpuList("0\n", &ids));
+  EXPECT_EQ(std::vector<uint32_t>({0}), ids);
+
+  ids.clear();
+  EXPECT_TRUE(ParseCpuList("0-3,8,10-11", &ids));
+  EXPECT_EQ(std::vector<uint32_t>({0, 1, 2, 3, 8, 10, 11}), ids);
+
+  ids.clear();
+  EXPECT_TRUE(ParseCpuList("", &ids));
+  EXPECT_TRUE(ids.empty());
+
+  EXPECT_FALSE(ParseCpuList("3-1", &ids));
+  EXPECT_FALSE(ParseCpuList("0-", &ids));
+  EXPECT_FALSE(ParseCpuList("a", &ids));
+}
+
+TEST_F(UtilsTest, GetNumaNodeCount) {
+  size_t node_count = GetNumaNodeCount();
+  EXPECT_GE(node_count, 1u);
+  EXPECT_LT(GetCurrentNumaNode(), node_count);
+}
+
 TEST_F(UtilsTest, GetDalvikCacheFilename) {
   std::string name;
   std::string error;
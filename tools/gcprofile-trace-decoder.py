@@ -0,0 +1,170 @@
+#!/usr/bin/env python
+#
+# Copyright (C) 2017 The Android Open Source Project
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Script that decodes the binary trace files written by the GC profiler when it runs with
+   -XX:GcProfileStreamSize=N, see runtime/gc/gcprofiler_stream.h for the file format. It
+   prints one line per GC followed by histograms of the pauses, of the allocation sizes and
+   of the large objects. Files from the same process are ordered by their index, so all of
+   gc_trace_<pid>_*.bin can be passed at once."""
+
+import struct
+import sys
+
+MAGIC = 0x54504347
+VERSION = 1
+RECORD_HEADER = struct.Struct('<II')
+
+RECORD_GC, RECORD_SUCC, RECORD_FAIL, RECORD_LARGE, RECORD_ALLOC = range(5)
+
+GC_RECORD = struct.Struct('<III' + 'Q' * 8 + 'I' * 15)
+GC_FIELDS = ('id', 'cause', 'type', 'timestamp', 'pause', 'mark', 'sweep', 'duration',
+             'max_wait', 'blocking', 'wasted_wait', 'freed_bytes', 'freed_objects',
+             'freed_large_bytes', 'freed_large_objects', 'max_allowed_footprint',
+             'concurrent_start_bytes', 'allocated_before', 'allocated_after',
+             'alloc_stack_objects', 'footprint_before', 'footprint_after',
+             'main_space_before', 'main_space_after', 'los_before', 'los_after')
+NUM_SIZE_DIST = 12
+SUCC_RECORD = struct.Struct('<II' + 'I' * NUM_SIZE_DIST)
+FAIL_RECORD = struct.Struct('<IIII')
+LARGE_RECORD = struct.Struct('<II')
+ALLOC_RECORD = struct.Struct('<QII')
+
+# Keep in sync with runtime/gc/gc_cause.h and runtime/gc/collector/gc_type.h.
+GC_CAUSES = ['None', 'Alloc', 'Background', 'Explicit', 'NativeAlloc', 'NativeAllocBlocking',
+             'CollectorTransition', 'DisableMovingGc', 'Trim', 'Instrumentation',
+             'AddRemoveAppImageSpace', 'Debugger', 'HomogeneousSpaceCompact', 'ClassLinker',
+             'JitCodeCache', 'AddRemoveSystemWeakHolder', 'Hprof', 'GetObjectsAllocated',
+             'ProfileSaver', 'Idle']
+GC_TYPES = ['none', 'sticky', 'young', 'partial', 'full']
+# Keep in sync with AllocFailPhase in runtime/gc/gcprofiler.h.
+FAIL_PHASES = ['GCConcurrent', 'GCForAlloc', 'GCForAllocClearRef', 'GCForAllocWithFragment',
+               'GCConcurrentWithFragment', 'GCForAllocClearRefWithFragment', 'AllocGrowHeap',
+               'ThrowGCOOM', 'Null']
+
+PAUSE_BUCKETS_US = [100, 500, 1000, 2000, 5000, 10000, 20000, 50000, 100000]
+
+class DecodeError(Exception):
+  pass
+
+def Name(names, value):
+  if value < len(names):
+    return names[value]
+  return str(value)
+
+def ReadFile(name):
+  """Returns (pid, index, records) where records are (type, payload) pairs."""
+  with open(name, 'rb') as f:
+    data = f.read()
+  if len(data) < 16:
+    raise DecodeError('%s: truncated header' % name)
+  magic, version, header_size, pid, index = struct.unpack_from('<IHHII', data, 0)
+  if magic != MAGIC:
+    raise DecodeError('%s: bad magic 0x%x' % (name, magic))
+  if version != VERSION:
+    raise DecodeError('%s: unsupported version %d' % (name, version))
+  records = []
+  pos = header_size
+  while pos + RECORD_HEADER.size <= len(data):
+    size, record_type = RECORD_HEADER.unpack_from(data, pos)
+    if size == 0 and record_type == 0:
+      break
+    pos += RECORD_HEADER.size
+    if pos + size > len(data):
+      raise DecodeError('%s: truncated record at offset %d' % (name, pos))
+    records.append((record_type, data[pos:pos + size]))
+    pos += size
+  return pid, index, records
+
+def Histogram(title, buckets, labels):
+  total = sum(buckets)
+  print('\n%s:' % title)
+  for label, count in zip(labels, buckets):
+    percent = 100.0 * count / total if total else 0.0
+    print('  %-16s %8d %6.2f%%' % (label, count, percent))
+
+def main():
+  if len(sys.argv) < 2:
+    print('Usage: %s gc_trace_<pid>_<index>.bin...' % sys.argv[0])
+    sys.exit(1)
+  files = sorted((ReadFile(name) for name in sys.argv[1:]), key=lambda f: (f[0], f[1]))
+  gcs = []
+  size_dist = [0] * NUM_SIZE_DIST
+  allocated = {}
+  large_objects = {}
+  fails = []
+  alloc_info = None
+  for _, _, records in files:
+    for record_type, payload in records:
+      if record_type == RECORD_GC:
+        gcs.append(dict(zip(GC_FIELDS, GC_RECORD.unpack_from(payload))))
+      elif record_type == RECORD_SUCC:
+        values = SUCC_RECORD.unpack_from(payload)
+        allocated[values[0]] = allocated.get(values[0], 0) + values[1]
+        for i in range(NUM_SIZE_DIST):
+          size_dist[i] += values[2 + i]
+      elif record_type == RECORD_FAIL:
+        values = FAIL_RECORD.unpack_from(payload)
+        fails.append(values + (payload[FAIL_RECORD.size:].decode('utf-8', 'replace'),))
+      elif record_type == RECORD_LARGE:
+        gc_id, size = LARGE_RECORD.unpack_from(payload)
+        descriptor = payload[LARGE_RECORD.size:].decode('utf-8', 'replace')
+        count, total = large_objects.get(descriptor, (0, 0))
+        large_objects[descriptor] = (count + 1, total + size)
+      elif record_type == RECORD_ALLOC:
+        alloc_info = ALLOC_RECORD.unpack_from(payload)
+
+  print('%6s %-26s %-8s %10s %10s %10s %10s %10s' % ('id', 'cause', 'type', 'pause(us)',
+                                                   'gc(us)', 'freed(KB)', 'after(KB)',
+                                                   'alloc(KB)'))
+  pause_buckets = [0] * (len(PAUSE_BUCKETS_US) + 1)
+  for gc in gcs:
+    pause_us = gc['pause'] // 1000
+    print('%6d %-26s %-8s %10d %10d %10d %10d %10d' % (
+        gc['id'], Name(GC_CAUSES, gc['cause']), Name(GC_TYPES, gc['type']), pause_us,
+        gc['duration'] // 1000, (gc['freed_bytes'] + gc['freed_large_bytes']) // 1024,
+        gc['allocated_after'] // 1024, allocated.get(gc['id'], 0) // 1024))
+    bucket = 0
+    while bucket < len(PAUSE_BUCKETS_US) and pause_us > PAUSE_BUCKETS_US[bucket]:
+      bucket += 1
+    pause_buckets[bucket] += 1
+
+  Histogram('Max pause per GC', pause_buckets,
+            ['<= %d us' % limit for limit in PAUSE_BUCKETS_US] +
+            ['> %d us' % PAUSE_BUCKETS_US[-1]])
+  Histogram('Allocation sizes', size_dist,
+            ['<= %d B' % (16 << i) for i in range(NUM_SIZE_DIST - 1)] + ['large object'])
+
+  if large_objects:
+    print('\nLarge objects:')
+    for descriptor, (count, total) in sorted(large_objects.items(),
+                                             key=lambda item: -item[1][1]):
+      print('  %10d KB %8d %s' % (total // 1024, count, descriptor))
+  if fails:
+    print('\nFailed allocations:')
+    for gc_id, size, phase, last_gc_type, descriptor in fails:
+      print('  gc %d: %d B of %s until %s (last GC %s)' % (
+          gc_id, size, descriptor, Name(FAIL_PHASES, phase), Name(GC_TYPES, last_gc_type)))
+  if alloc_info is not None:
+    duration_ms, alloc_bytes, alloc_objects = alloc_info
+    print('\nAllocated %d KB in %d objects over %d ms' % (alloc_bytes // 1024, alloc_objects,
+                                                         duration_ms))
+
+if __name__ == '__main__':
+  try:
+    main()
+  except DecodeError as e:
+    print(e)
+    sys.exit(1)